@@ -10,13 +10,12 @@
 #include <math.h>
 #include <string.h>
 #include "glut_wrap.h"
+#include "bench.h"
 
 
-static float MinPeriod = 2.0;   /* 2 seconds */
 static int ColorMode = GLUT_RGB;
 static int Width = 400.0;
 static int Height = 400.0;
-static int Loops = 100;
 static float ClearColor = 0.0;
 static GLbitfield BufferMask = GL_COLOR_BUFFER_BIT;
 static GLboolean SwapFlag = GL_FALSE;
@@ -29,59 +28,38 @@ static void Idle( void )
 }
 
 
-static void Display( void )
+static void ClearLoop( void *data, unsigned iterations )
 {
-   double t0, t1;
-   double clearRate;
-   double pixelRate;
-   int i;
+   unsigned i;
+
+   (void) data;
+   for (i=0;i<iterations;i++) {
+      glClear( BufferMask );
+      if (SwapFlag)
+         glutSwapBuffers();
+   }
+   glFinish();
+}
 
+
+static void Display( void )
+{
    glClearColor( ClearColor, ClearColor, ClearColor, 0.0 );
    ClearColor += 0.1;
    if (ClearColor>1.0)
       ClearColor = 0.0;
 
-   if (SwapFlag) {
-      t0 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
-      for (i=0;i<Loops;i++) {
-         glClear( BufferMask );
-         glutSwapBuffers();
-      }
-      glFinish();
-      t1 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
-   }
-   else {
-      t0 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
-      for (i=0;i<Loops;i++) {
-         glClear( BufferMask );
-      }
-      glFinish();
-      t1 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
-      glutSwapBuffers();
-   }
-
    /* NOTE: If clearspd doesn't map it's window immediately on
-    * starting, swaps will be istantaneous, so this will send Loops
-    * towards infinity.  When a window is finally mapped, it may be
-    * minutes before the first call to glutSwapBuffers, making it look
-    * like there's a driver bug.
+    * starting, swaps will be istantaneous, so the calibration will
+    * pick a huge iteration count.  When a window is finally mapped, it
+    * may be minutes before the first call to glutSwapBuffers, making it
+    * look like there's a driver bug.
     */
-   if (t1-t0 < MinPeriod) {
-      /* Next time do more clears to get longer elapsed time */
-      Loops *= 2;
-      return;
-   }
+   bench_run(SwapFlag ? "clear+swap" : "clear", ClearLoop, NULL,
+             Width * Height / 1000000.0, "MPixels", NULL);
 
-   clearRate = Loops / (t1-t0);
-   pixelRate = clearRate * Width * Height;
-   if (SwapFlag) {
-      printf("Rate: %d clears+swaps in %gs = %g clears+swaps/s   %g pixels/s\n",
-             Loops, t1-t0, clearRate, pixelRate );
-   }
-   else {
-      printf("Rate: %d clears in %gs = %g clears/s   %g pixels/s\n",
-             Loops, t1-t0, clearRate, pixelRate);
-   }
+   if (!SwapFlag)
+      glutSwapBuffers();
 }
 
 
@@ -185,6 +163,8 @@ int main( int argc, char *argv[] )
 
    printf("For options:  %s -help\n", argv[0]);
 
+   bench_init( &argc, argv );
+
    Init( argc, argv );
 
    glutInitWindowSize( (int) Width, (int) Height );
@@ -201,6 +181,7 @@ int main( int argc, char *argv[] )
    glutInitDisplayMode(mode);
 
    glutCreateWindow( argv[0] );
+   bench_set_renderer( (const char *) glGetString(GL_RENDERER) );
 
    if (argc==2 && strcmp(argv[1],"-help")==0) {
       Help(argv[0]);
@@ -11,6 +11,7 @@
 #include <string.h>
 #include <math.h>
 #include "glut_wrap.h"
+#include "bench.h"
 
 typedef struct
 {
@@ -359,8 +360,6 @@ test06(int size, int num)
 
 /***************************************************************************/
 
-#define BMARKS_TIME 5.0
-
 #define NUM_BMARKS 6
 
 /* 554 ~= sqrt(640*480) */
@@ -382,74 +381,60 @@ static benchmark bmarks[NUM_BMARKS] = {
 
 /***************************************************************************/
 
+struct run {
+   benchmark *bmark;
+   int size;
+};
+
 static void
-dotest0param(benchmark * bmark)
+runloop(void *data, unsigned iterations)
 {
-   float stime, etime, dtime, tottime, maxtime, mintime;
-   int num, numelem, calibnum, j;
-
-   glPushAttrib(GL_ALL_ATTRIB_BITS);
-   bmark->init();
-
-   stime = glutGet(GLUT_ELAPSED_TIME);
-
-   dtime = 0.0f;
-   calibnum = 0;
-   while (dtime < 2.0f) {
-      bmark->run(0, 1);
-      glFinish();
-      etime = glutGet(GLUT_ELAPSED_TIME);
-      dtime = (etime - stime) / 1000.0f;
-      calibnum++;
-   }
-   glPopAttrib();
-
-   fprintf(stderr, "Elapsed time for the calibration test (%d): %f\n",
-	   calibnum, dtime);
-
-   num = (int) ((BMARKS_TIME / dtime) * calibnum);
+   struct run *r = (struct run *) data;
 
-   if (num < 1)
-      num = 1;
-
-   fprintf(stderr, "Selected number of benchmark iterations: %d\n", num);
-
-   mintime = HUGE_VAL;
-   maxtime = -HUGE_VAL;
+   r->bmark->run(r->size, iterations);
+   glFinish();
+}
 
-   for (tottime = 0.0f, j = 0; j < 5; j++) {
-      glPushAttrib(GL_ALL_ATTRIB_BITS);
-      bmark->init();
+static void
+dotest(benchmark * bmark, int size)
+{
+   struct bench_result result;
+   struct run r;
+   char name[100];
+   int numelem;
 
-      stime = glutGet(GLUT_ELAPSED_TIME);
-      numelem = bmark->run(0, num);
-      glFinish();
-      etime = glutGet(GLUT_ELAPSED_TIME);
+   glPushAttrib(GL_ALL_ATTRIB_BITS);
+   bmark->init();
 
-      glPopAttrib();
+   /* elements per iteration, without the ones a strip starts with */
+   numelem = bmark->run(size, 2) - bmark->run(size, 1);
+   glFinish();
 
-      dtime = (etime - stime) / 1000.0f;
-      tottime += dtime;
+   if (bmark->type == 0 || bmark->type == 3)
+      snprintf(name, sizeof(name), "%s", bmark->name);
+   else
+      snprintf(name, sizeof(name), "%s SIZE=%03d", bmark->name, size);
 
-      fprintf(stderr, "Elapsed time for run %d: %f\n", j, dtime);
+   r.bmark = bmark;
+   r.size = size;
+   bench_run(name, runloop, &r, numelem, bmark->unit, &result);
 
-      if (dtime < mintime)
-	 mintime = dtime;
-      if (dtime > maxtime)
-	 maxtime = dtime;
-   }
+   glPopAttrib();
 
-   tottime -= mintime + maxtime;
+   if (bmark->type == 3)
+      fprintf(stdout, "MPixel Fill/sec: %f\n",
+	      result.median * size * size / 1000000.0);
+   else if (bmark->type == 2)
+      fprintf(stdout, "MPixel Fill/sec: %f\n",
+	      result.median * size * size / 2.0 / 1000000.0);
+}
 
-   fprintf(stdout, "%s\n%f %s/sec", bmark->name,
-      (float) numelem / (tottime / 3.0f), bmark->unit);
+/***************************************************************************/
 
-   if (bmark->type == 3)
-      fprintf(stdout, ", MPixel Fill/sec: %f\n\n",
-	      ((float) numelem * bmark->size[0] * bmark->size[0]) /
-	      (1000000.0f * tottime / 3.0f));
-   else
-      fprintf(stdout, "\n\n");
+static void
+dotest0param(benchmark * bmark)
+{
+   dotest(bmark, bmark->size[0]);
 }
 
 /***************************************************************************/
@@ -457,78 +442,12 @@ dotest0param(benchmark * bmark)
 static void
 dotest1param(benchmark * bmark)
 {
-   float stime, etime, dtime, tottime, maxtime, mintime;
-   int num, numelem, calibnum, j, k;
-
-   fprintf(stdout, "%s\n", bmark->name);
+   int j;
 
    for (j = 0; j < bmark->numsize; j++) {
       fprintf(stderr, "Current size: %d\n", bmark->size[j]);
-
-      glPushAttrib(GL_ALL_ATTRIB_BITS);
-      bmark->init();
-
-      stime = glutGet(GLUT_ELAPSED_TIME);
-
-      dtime = 0.0f;
-      calibnum = 0;
-      while (dtime < 2.0f) {
-	 bmark->run(bmark->size[j], 1);
-	 glFinish();
-	 etime = glutGet(GLUT_ELAPSED_TIME);
-	 dtime = (etime - stime) / 1000.0f;
-	 calibnum++;
-      }
-      glPopAttrib();
-
-      fprintf(stderr, "Elapsed time for the calibration test (%d): %f\n",
-	      calibnum, dtime);
-
-      num = (int) ((BMARKS_TIME / dtime) * calibnum);
-
-      if (num < 1)
-	 num = 1;
-
-      fprintf(stderr, "Selected number of benchmark iterations: %d\n", num);
-
-      mintime = HUGE_VAL;
-      maxtime = -HUGE_VAL;
-
-      for (numelem = 1, tottime = 0.0, k = 0; k < 5; k++) {
-	 glPushAttrib(GL_ALL_ATTRIB_BITS);
-	 bmark->init();
-
-	 stime = glutGet(GLUT_ELAPSED_TIME);
-	 numelem = bmark->run(bmark->size[j], num);
-	 glFinish();
-	 etime = glutGet(GLUT_ELAPSED_TIME);
-
-	 glPopAttrib();
-
-	 dtime = (etime - stime) / 1000.0f;
-	 tottime += dtime;
-
-	 fprintf(stderr, "Elapsed time for run %d: %f\n", k, dtime);
-
-	 if (dtime < mintime)
-	    mintime = dtime;
-	 if (dtime > maxtime)
-	    maxtime = dtime;
-      }
-
-      tottime -= mintime + maxtime;
-
-      fprintf(stdout, "SIZE=%03d => %f %s/sec", bmark->size[j],
-	      (float) numelem / (tottime / 3.0f), bmark->unit);
-      if (bmark->type == 2)
-	 fprintf(stdout, ", MPixel Fill/sec: %f\n",
-		 ((float) numelem * bmark->size[j] * bmark->size[j] / 2.0f) /
-		 (1000000.0f * tottime / 3.0f));
-      else
-	 fprintf(stdout, "\n");
+      dotest(bmark, bmark->size[j]);
    }
-
-   fprintf(stdout, "\n\n");
 }
 
 /***************************************************************************/
@@ -566,6 +485,8 @@ main(int ac, char **av)
 {
    fprintf(stderr, "GLTest v1.0\nWritten by David Bucciarelli\n");
 
+   bench_init(&ac, av);
+
    if (ac == 2)
       frontbuffer = 0;
 
@@ -573,6 +494,7 @@ main(int ac, char **av)
    glutInit(&ac, av);
    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
    glutCreateWindow("OpenGL/Mesa Performances");
+   bench_set_renderer((const char *) glGetString(GL_RENDERER));
    glutDisplayFunc(display);
    glutMainLoop();
 
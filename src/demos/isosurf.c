@@ -4,6 +4,9 @@
  *
  * Command line options:
  *    -info      print GL implementation information
+ *    -sweep     measure every render path, with and without lighting, fog
+ *               and clipping, print a table of triangles/sec and exit.
+ *               Accepts the -bench-* options of util/bench.h.
  *
  * Brian Paul  This file in public domain.
  */
@@ -36,6 +39,7 @@
 #include "glut_wrap.h"
 
 #include "readtex.h"
+#include "bench.h"
 #define TEXTURE_FILE DEMOS_DATA_DIR "reflect.png"
 
 #define LIT		0x00000001
@@ -103,6 +107,8 @@ static GLdouble plane[4];
 static GLuint surf1, dlist_state;
 
 static GLboolean PrintInfo = GL_FALSE;
+static GLboolean Sweep = GL_FALSE;
+static GLboolean Verbose = GL_TRUE;
 
 
 static GLubyte halftone[] = {
@@ -148,6 +154,9 @@ static void read_surface( char *filename )
 
 static void print_flags( const char *msg, GLuint flags )
 {
+   if (!Verbose)
+      return;
+
    fprintf(stderr,
 	   "%s (0x%x): %s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s\n",
 	   msg, flags,
@@ -379,7 +388,8 @@ static void draw_surface( unsigned int with_state )
 	  dlist_state) {
 	 /*
 	  */
-	 fprintf(stderr, "rebuilding displaylist\n");
+	 if (Verbose)
+	    fprintf(stderr, "rebuilding displaylist\n");
 
 	 if (dlist_state)
 	    glDeleteLists( surf1, 1 );
@@ -758,7 +768,8 @@ static void ModeMenu(int m)
 	   (state & RENDER_STYLE_MASK) == ARRAY_ELT ||
 	   (state & PRIMITIVE_MASK) == POINTS))
       {
-	 fprintf(stderr, "enabling small arrays\n");
+	 if (Verbose)
+	    fprintf(stderr, "enabling small arrays\n");
 	 /* Rendering any primitive with draw-element/array-element
 	  *  --> Can't do strips here as ordering has been lost in
 	  *  compaction process...
@@ -775,7 +786,8 @@ static void ModeMenu(int m)
       }
       else if ((state & PRIMITIVE_MASK) == TRIANGLES &&
 	       (state & RENDER_STYLE_MASK) == DRAW_ARRAYS) {
-	 fprintf(stderr, "enabling big arrays\n");
+	 if (Verbose)
+	    fprintf(stderr, "enabling big arrays\n");
 	 /* Only get here for TRIANGLES and drawarrays
 	  */
 	 glVertexPointer( 3, GL_FLOAT, sizeof(data[0]), expanded_data );
@@ -790,7 +802,8 @@ static void ModeMenu(int m)
 	 }
       }
       else {
-	 fprintf(stderr, "enabling normal arrays\n");
+	 if (Verbose)
+	    fprintf(stderr, "enabling normal arrays\n");
 	 glVertexPointer( 3, GL_FLOAT, sizeof(data[0]), data );
 	 glNormalPointer( GL_FLOAT, sizeof(data[0]), &data[0][3] );
 	 if (allowed & LOCKED) {
@@ -1004,6 +1017,148 @@ static void SpecialKey( int key, int x, int y )
 
 
 
+/* Sweep mode: time each way of submitting the surface, in each of the
+ * lighting modes, with and without fog and a user clip plane.
+ */
+
+struct sweep_option {
+   GLuint flags;
+   const char *name;
+};
+
+static const struct sweep_option sweep_styles[] = {
+   { GLVERTEX,    "glVertex" },
+   { DRAW_ARRAYS, "glDrawArrays" },
+   { DRAW_ELTS,   "glDrawElements" },
+   { ARRAY_ELT,   "glArrayElement" },
+};
+
+static const struct sweep_option sweep_prims[] = {
+   { TRIANGLES, "triangles" },
+   { STRIPS,    "strips" },
+   { POINTS,    "points" },
+};
+
+static const struct sweep_option sweep_paths[] = {
+   { IMMEDIATE|UNLOCKED,   "immediate" },
+   { IMMEDIATE|LOCKED,     "locked" },
+   { DISPLAYLIST|UNLOCKED, "displaylist" },
+};
+
+static const struct sweep_option sweep_lights[] = {
+   { LIT,     "lit" },
+   { UNLIT,   "unlit" },
+   { REFLECT, "reflect" },
+};
+
+static const struct sweep_option sweep_extras[] = {
+   { NO_FOG|NO_USER_CLIP, "" },
+   { FOG|NO_USER_CLIP,    "fog" },
+   { NO_FOG|USER_CLIP,    "clip" },
+   { FOG|USER_CLIP,       "fog+clip" },
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define SWEEP_COLUMNS (ARRAY_SIZE(sweep_lights) * ARRAY_SIZE(sweep_extras))
+#define SWEEP_ROWS (ARRAY_SIZE(sweep_styles) * ARRAY_SIZE(sweep_prims) * \
+                    ARRAY_SIZE(sweep_paths))
+
+
+static void SweepLoop( void *data, unsigned iterations )
+{
+   unsigned i;
+
+   (void) data;
+   for (i = 0; i < iterations; i++) {
+      xrot += 5.0;
+      set_matrix();
+      Display();
+   }
+   glFinish();
+}
+
+
+static void SweepDisplay(void)
+{
+   char rows[SWEEP_ROWS][64];
+   double rates[SWEEP_ROWS][SWEEP_COLUMNS];
+   unsigned s, p, m, l, e, num_rows = 0;
+
+   for (s = 0; s < ARRAY_SIZE(sweep_styles); s++) {
+      if (!(allowed & sweep_styles[s].flags))
+         continue;
+      for (p = 0; p < ARRAY_SIZE(sweep_prims); p++) {
+         for (m = 0; m < ARRAY_SIZE(sweep_paths); m++) {
+            GLuint path = sweep_styles[s].flags | sweep_prims[p].flags |
+                          sweep_paths[m].flags;
+
+            /* glVertex doesn't use the arrays, so locking them is moot */
+            if ((path & LOCKED) &&
+                (!(allowed & LOCKED) || (path & GLVERTEX)))
+               continue;
+
+            snprintf(rows[num_rows], sizeof(rows[0]), "%s %s %s",
+                     sweep_styles[s].name, sweep_prims[p].name,
+                     sweep_paths[m].name);
+
+            for (l = 0; l < ARRAY_SIZE(sweep_lights); l++) {
+               for (e = 0; e < ARRAY_SIZE(sweep_extras); e++) {
+                  GLuint flags = path | sweep_lights[l].flags |
+                                 sweep_extras[e].flags;
+                  struct bench_result result;
+                  char name[128];
+                  GLenum err;
+
+                  /* Arrays can't be locked twice, so unlock them before
+                   * switching arrays.
+                   */
+                  ModeMenu((flags & ~LOCK_MASK) | UNLOCKED);
+                  if (flags & LOCKED)
+                     ModeMenu(LOCKED);
+                  while (glGetError() != GL_NO_ERROR)
+                     ;
+
+                  snprintf(name, sizeof(name), "%s %s%s%s", rows[num_rows],
+                           sweep_lights[l].name,
+                           sweep_extras[e].name[0] ? " " : "",
+                           sweep_extras[e].name);
+                  bench_run(name, SweepLoop, NULL,
+                            (numverts - 2) / 1000000.0, "Mtri", &result);
+                  rates[num_rows][l * ARRAY_SIZE(sweep_extras) + e] =
+                     result.median;
+
+                  err = glGetError();
+                  if (err != GL_NO_ERROR)
+                     fprintf(stderr, "%s: GL error 0x%x\n", name, err);
+               }
+            }
+            num_rows++;
+         }
+      }
+   }
+
+   printf("\nMtri/sec, %d triangles per frame:\n\n%-36s", numverts - 2, "");
+   for (l = 0; l < ARRAY_SIZE(sweep_lights); l++)
+      printf("  %-*s", l + 1 < ARRAY_SIZE(sweep_lights) ?
+             (int) ARRAY_SIZE(sweep_extras) * 9 - 2 : 0,
+             sweep_lights[l].name);
+   printf("\n%-36s", "");
+   for (l = 0; l < ARRAY_SIZE(sweep_lights); l++)
+      for (e = 0; e < ARRAY_SIZE(sweep_extras); e++)
+         printf(" %8s", sweep_extras[e].name[0] ? sweep_extras[e].name : "-");
+   printf("\n");
+   for (s = 0; s < num_rows; s++) {
+      printf("%-36s", rows[s]);
+      for (m = 0; m < SWEEP_COLUMNS; m++)
+         printf(" %8.2f", rates[s][m]);
+      printf("\n");
+   }
+   fflush(stdout);
+
+   exit(0);
+}
+
+
 static GLint Args(int argc, char **argv)
 {
    GLint i;
@@ -1019,6 +1174,10 @@ static GLint Args(int argc, char **argv)
       else if (strcmp(argv[i], "-info") == 0) {
          PrintInfo = GL_TRUE;
       }
+      else if (strcmp(argv[i], "-sweep") == 0) {
+         Sweep = GL_TRUE;
+         Verbose = GL_FALSE;
+      }
       else if (strcmp(argv[i], "-10") == 0) {
          maxverts = 10;
       }
@@ -1040,8 +1199,13 @@ static GLint Args(int argc, char **argv)
 int main(int argc, char **argv)
 {
    GLenum type;
+   GLuint arg_mode;
+
+   /* a full sweep is some 400 measurements */
+   bench_set_defaults(3, 0.1, 0.05);
+   bench_init(&argc, argv);
 
-   GLuint arg_mode = Args(argc, argv);
+   arg_mode = Args(argc, argv);
 
    if (arg_mode & QUIT)
       exit(0);
@@ -1061,6 +1225,7 @@ int main(int argc, char **argv)
    }
 
    gladLoaderLoadGL();
+   bench_set_renderer((const char *) glGetString(GL_RENDERER));
 
    /* Make sure server supports vertex arrays */
    if (!GLAD_GL_VERSION_1_1)
@@ -1125,7 +1290,7 @@ int main(int argc, char **argv)
    glutReshapeFunc(Reshape);
    glutKeyboardFunc(Key);
    glutSpecialFunc(SpecialKey);
-   glutDisplayFunc(Display);
+   glutDisplayFunc(Sweep ? SweepDisplay : Display);
 
    glutMainLoop();
    gladLoaderUnloadGL();
@@ -9,12 +9,11 @@
 #include <math.h>
 #include <string.h>
 #include "glut_wrap.h"
+#include "bench.h"
 
 
-static float MinPeriod = 2.0;   /* 2 seconds */
 static float Width = 400.0;
 static float Height = 400.0;
-static int Loops = 1;
 static int Size = 50;
 static int Texture = 0;
 
@@ -26,75 +25,78 @@ static void Idle( void )
 }
 
 
-static void Display( void )
+/* Draw the window full of strips once, return the number of triangles */
+static int DrawStrips( void )
 {
    float x, y;
    float xStep;
    float yStep;
-   double t0, t1;
-   double triRate;
-   double pixelRate;
    int triCount;
-   int i;
    float red[3] = { 1.0, 0.0, 0.0 };
    float blue[3] = { 0.0, 0.0, 1.0 };
 
    xStep = yStep = sqrt( 2.0 * Size );
 
-   glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-
    triCount = 0;
-   t0 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
    if (Texture) {
       float uStep = xStep / Width;
       float vStep = yStep / Height;
       float u, v;
-      for (i=0; i<Loops; i++) {
-	 for (y=1.0, v=0.0f; y<Height-yStep; y+=yStep, v+=vStep) {
-	    glBegin(GL_TRIANGLE_STRIP);
-	    for (x=1.0, u=0.0f; x<Width; x+=xStep, u+=uStep) {
-	       glColor3fv(red);
-	       glTexCoord2f(u, v);
-	       glVertex2f(x, y);
-	       glColor3fv(blue);
-	       glTexCoord2f(u, v+vStep);
-	       glVertex2f(x, y+yStep);
-	       triCount += 2;
-	    }
-	    glEnd();
-	    triCount -= 2;
-	 }
+      for (y=1.0, v=0.0f; y<Height-yStep; y+=yStep, v+=vStep) {
+         glBegin(GL_TRIANGLE_STRIP);
+         for (x=1.0, u=0.0f; x<Width; x+=xStep, u+=uStep) {
+            glColor3fv(red);
+            glTexCoord2f(u, v);
+            glVertex2f(x, y);
+            glColor3fv(blue);
+            glTexCoord2f(u, v+vStep);
+            glVertex2f(x, y+yStep);
+            triCount += 2;
+         }
+         glEnd();
+         triCount -= 2;
       }
    }
    else {
-      for (i=0; i<Loops; i++) {
-	 for (y=1.0; y<Height-yStep; y+=yStep) {
-	    glBegin(GL_TRIANGLE_STRIP);
-	    for (x=1.0; x<Width; x+=xStep) {
-	       glColor3fv(red);
-	       glVertex2f(x, y);
-	       glColor3fv(blue);
-	       glVertex2f(x, y+yStep);
-	       triCount += 2;
-	    }
-	    glEnd();
-	    triCount -= 2;
-	 }
+      for (y=1.0; y<Height-yStep; y+=yStep) {
+         glBegin(GL_TRIANGLE_STRIP);
+         for (x=1.0; x<Width; x+=xStep) {
+            glColor3fv(red);
+            glVertex2f(x, y);
+            glColor3fv(blue);
+            glVertex2f(x, y+yStep);
+            triCount += 2;
+         }
+         glEnd();
+         triCount -= 2;
       }
    }
+   return triCount;
+}
+
+
+static void DrawLoop( void *data, unsigned iterations )
+{
+   unsigned i;
+
+   (void) data;
+   for (i=0; i<iterations; i++)
+      DrawStrips();
    glFinish();
-   t1 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
+}
 
-   if (t1-t0 < MinPeriod) {
-      /* Next time draw more triangles to get longer elapsed time */
-      Loops *= 2;
-      return;
-   }
 
-   triRate = triCount / (t1-t0);
-   pixelRate = triRate * Size;
-   printf("Rate: %d tri in %gs = %g tri/s  %g pixels/s\n",
-          triCount, t1-t0, triRate, pixelRate);
+static void Display( void )
+{
+   struct bench_result result;
+   int triCount;
+
+   glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+
+   triCount = DrawStrips();
+   bench_run("triangle strips", DrawLoop, NULL, triCount / 1000000.0,
+             "Mtri", &result);
+   printf("Rate: %g pixels/s\n", result.median * 1000000.0 * Size);
    fflush(stdout);
 
    glutSwapBuffers();
@@ -228,10 +230,12 @@ static void Help( const char *program )
 
 int main( int argc, char *argv[] )
 {
+   bench_init( &argc, argv );
    glutInitWindowSize( (int) Width, (int) Height );
    glutInit( &argc, argv );
    glutInitDisplayMode( GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH );
    glutCreateWindow( argv[0] );
+   bench_set_renderer( (const char *) glGetString(GL_RENDERER) );
 
    printf("For options:  %s -help\n", argv[0]);
    if (argc==2 && strcmp(argv[1],"-help")==0) {
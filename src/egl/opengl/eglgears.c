@@ -32,10 +32,12 @@
 #include <EGL/egl.h>
 
 #include "eglut.h"
+#include "frametime.h"
 
 static GLfloat view_rotx = 20.0, view_roty = 30.0, view_rotz = 0.0;
 static GLint gear1, gear2, gear3;
 static GLfloat angle = 0.0;
+static struct frametime *Timing;
 
 /*
  *
@@ -179,6 +181,9 @@ gear(GLfloat inner_radius, GLfloat outer_radius, GLfloat width,
 static void
 draw(void)
 {
+   frametime_begin(Timing);
+   frametime_gl_begin(Timing);
+
    glClearColor(0.0, 0.0, 0.0, 1.0);
    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -206,25 +211,40 @@ draw(void)
    glPopMatrix();
 
    glPopMatrix();
+
+   /* eglut swaps when this returns */
+   frametime_gl_end(Timing);
+   frametime_swap(Timing);
 }
 
 
 static void
 idle(void)
 {
-   static double t0 = -1.;
+   static double t0 = -1., tReport = 0.0;
    double dt, t = eglutGet(EGLUT_ELAPSED_TIME) / 1000.0;
    if (t0 < 0.0)
       t0 = t;
    dt = t - t0;
    t0 = t;
 
+   if (t - tReport >= 5.0) {
+      frametime_report(Timing);
+      tReport = t;
+   }
+
    angle += 70.0 * dt;  /* 70 degrees per second */
    angle = fmodf(angle, 360.0f); /* prevents eventual overflow */
 
    eglutPostRedisplay();
 }
 
+static frametime_proc
+get_proc_address(const char *name)
+{
+   return eglGetProcAddress(name);
+}
+
 /* new window size or exposure */
 static void
 reshape(int width, int height)
@@ -316,6 +336,9 @@ main(int argc, char *argv[])
    init();
    glDrawBuffer(GL_BACK);
 
+   Timing = frametime_create("eglgears");
+   frametime_gl_init(Timing, get_proc_address);
+
    eglutMainLoop();
 
    return 0;
@@ -50,6 +50,7 @@
 #include <EGL/eglext.h>
 #include "eglut.h"
 #include "matrix.h"
+#include "frametime.h"
 
 #define STRIPS_PER_TOOTH 7
 #define VERTICES_PER_TOOTH 46
@@ -76,6 +77,8 @@ static GLfloat view_rot[3] = { 20.0, 30.0, 0.0 };
 static struct gear *gear1, *gear2, *gear3;
 /** The current gear rotation angle */
 static GLfloat angle = 0.0;
+/** Per-frame timing, NULL unless FRAMETIME is set */
+static struct frametime *Timing;
 /** The location of the shader uniforms */
 static GLuint ModelViewProjectionMatrix_location,
               NormalMatrix_location,
@@ -365,6 +368,9 @@ gears_draw(void)
    float transform[4][4];
    mat4_identity(transform);
 
+   frametime_begin(Timing);
+   frametime_gl_begin(Timing);
+
    glClearColor(0.0, 0.0, 0.0, 1.0);
    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -378,6 +384,10 @@ gears_draw(void)
    draw_gear(gear1, transform, -3.0, -2.0, angle, red);
    draw_gear(gear2, transform, 3.1, -2.0, -2 * angle - 9.0, green);
    draw_gear(gear3, transform, -3.1, 4.2, -2 * angle - 25.0, blue);
+
+   /* eglut swaps when this returns */
+   frametime_gl_end(Timing);
+   frametime_swap(Timing);
 }
 
 /**
@@ -447,6 +457,7 @@ gears_idle(void)
       GLfloat fps = frames / seconds;
       printf("%d frames in %3.1f seconds = %6.3f FPS\n", frames, seconds,
             fps);
+      frametime_report(Timing);
       tRate0 = t;
       frames = 0;
    }
@@ -546,6 +557,12 @@ gears_init(void)
    gear3 = create_gear(1.3, 2.0, 0.5, 10, 0.7);
 }
 
+static frametime_proc
+get_proc_address(const char *name)
+{
+   return eglGetProcAddress(name);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -565,6 +582,9 @@ main(int argc, char *argv[])
    /* Initialize the gears */
    gears_init();
 
+   Timing = frametime_create("es2gears");
+   frametime_gl_init(Timing, get_proc_address);
+
    eglutMainLoop();
 
    return 0;
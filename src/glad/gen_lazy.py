@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+#
+# Generate src/gl_lazy.c from include/glad/gl.h: a trampoline for each
+# GL entry point that resolves the real function on its first call,
+# patches the glad_gl* pointer and calls through it.
+#
+# Run from this directory after regenerating glad:
+#
+#     python3 gen_lazy.py > src/gl_lazy.c
+
+import re
+import sys
+
+TYPEDEF = re.compile(r'^typedef (.+?) ?\(GLAD_API_PTR \*(PFNGL\w+PROC)\)\((.*)\);$')
+POINTER = re.compile(r'^GLAD_API_CALL (PFNGL\w+PROC) glad_(gl\w+);$')
+
+HEADER = '''\
+/**
+ * Lazy GL entry point resolution, see gladLoadGLLazyUserPtr().
+ *
+ * Generated by gen_lazy.py from include/glad/gl.h, do not edit.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glad/gl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static GLADuserptrloadfunc glad_lazy_load = NULL;
+static void *glad_lazy_userptr = NULL;
+
+static GLADapiproc glad_lazy_resolve(const char *name) {
+    GLADapiproc proc;
+    if (glad_lazy_load == NULL) {
+        fprintf(stderr, "glad: %s called after the GL was unloaded\\n", name);
+        abort();
+    }
+    proc = glad_lazy_load(glad_lazy_userptr, name);
+    if (proc == NULL) {
+        fprintf(stderr, "glad: %s is not available\\n", name);
+        abort();
+    }
+    return proc;
+}
+'''
+
+FOOTER = '''
+static int glad_lazy_compare(const void *key, const void *elem) {
+    return strcmp((const char *) key, ((const struct glad_lazy_proc *) elem)->name);
+}
+
+static GLADapiproc glad_lazy_get_proc(void *userptr, const char *name) {
+    const struct glad_lazy_proc *proc;
+    GLAD_UNUSED(userptr);
+    proc = (const struct glad_lazy_proc *) bsearch(name, glad_lazy_procs,
+        sizeof(glad_lazy_procs) / sizeof(glad_lazy_procs[0]),
+        sizeof(glad_lazy_procs[0]), glad_lazy_compare);
+    return proc ? proc->trampoline : NULL;
+}
+
+int gladLoadGLLazyUserPtr( GLADuserptrloadfunc load, void *userptr) {
+    glad_lazy_load = load;
+    glad_lazy_userptr = userptr;
+    return gladLoadGLUserPtr(glad_lazy_get_proc, NULL);
+}
+
+void gladUnloadGLLazy(void) {
+    glad_lazy_load = NULL;
+    glad_lazy_userptr = NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+'''
+
+
+def param_names(params):
+    if params.strip() == 'void':
+        return []
+    return [re.findall(r'\w+', p)[-1] for p in params.split(',')]
+
+
+def main():
+    typedefs = {}
+    pointers = []
+    with open('include/glad/gl.h') as f:
+        for line in f:
+            m = TYPEDEF.match(line)
+            if m:
+                typedefs[m.group(2)] = (m.group(1), m.group(3))
+                continue
+            m = POINTER.match(line)
+            if m:
+                pointers.append((m.group(2), m.group(1)))
+
+    out = sys.stdout
+    out.write(HEADER)
+    for name, pfn in pointers:
+        ret, params = typedefs[pfn]
+        args = ', '.join(param_names(params))
+        call = 'return ' if ret != 'void' else ''
+        out.write('static %s GLAD_API_PTR glad_lazy_%s(%s) {\n' % (ret, name, params))
+        out.write('    glad_%s = (%s) glad_lazy_resolve("%s");\n' % (name, pfn, name))
+        out.write('    %sglad_%s(%s);\n' % (call, name, args))
+        out.write('}\n')
+
+    out.write('\nstruct glad_lazy_proc {\n')
+    out.write('    const char *name;\n')
+    out.write('    GLADapiproc trampoline;\n')
+    out.write('};\n\n')
+    out.write('static const struct glad_lazy_proc glad_lazy_procs[] = {\n')
+    for name, pfn in sorted(pointers, key=lambda p: p[0].encode()):
+        out.write('    { "%s", (GLADapiproc) glad_lazy_%s },\n' % (name, name))
+    out.write('};\n')
+    out.write(FOOTER)
+
+
+if __name__ == '__main__':
+    main()
@@ -17787,6 +17787,8 @@ GLAD_API_CALL PFNGLVIEWPORTINDEXEDFVOESPROC glad_glViewportIndexedfvOES;
 
 GLAD_API_CALL int gladLoadGLUserPtr( GLADuserptrloadfunc load, void *userptr);
 GLAD_API_CALL int gladLoadGL( GLADloadfunc load);
+GLAD_API_CALL int gladLoadGLLazyUserPtr( GLADuserptrloadfunc load, void *userptr);
+GLAD_API_CALL void gladUnloadGLLazy(void);
 
 GLAD_API_CALL int gladLoadGLES1UserPtr( GLADuserptrloadfunc load, void *userptr);
 GLAD_API_CALL int gladLoadGLES1( GLADloadfunc load);
@@ -17798,6 +17800,7 @@ GLAD_API_CALL int gladLoadGLES2( GLADloadfunc load);
 #ifdef GLAD_GL
 
 GLAD_API_CALL int gladLoaderLoadGL(void);
+GLAD_API_CALL int gladLoaderLoadGLLazy(void);
 GLAD_API_CALL void gladLoaderUnloadGL(void);
 
 #endif
@@ -9841,90 +9841,131 @@ static void glad_gl_load_GL_QCOM_texture_foveated( GLADuserptrloadfunc load, voi
 #define GLAD_GL_IS_SOME_NEW_VERSION 0
 #endif
 
+/*
+ * The available extensions go in an open addressing hash table that
+ * points into the GL's own strings, so each of the known extensions is
+ * found in O(1) and nothing is copied.  glad_gl_get_extensions() builds
+ * it and glad_gl_free_extensions() frees it.  The exts, num_exts_i and
+ * exts_i arguments are only kept for the generated callers.
+ */
+struct glad_gl_ext_entry {
+    const char *name;
+    size_t length;
+};
+
+static struct glad_gl_ext_entry *glad_gl_ext_table = NULL;
+static unsigned int glad_gl_ext_mask = 0;
+
+static unsigned int glad_gl_ext_hash(const char *name, size_t length) {
+    unsigned int hash = 2166136261u;
+    size_t i;
+    for(i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char) name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static int glad_gl_ext_alloc(unsigned int count) {
+    unsigned int size = 16;
+    while(size < 2 * count) {
+        size *= 2;
+    }
+    glad_gl_ext_table = (struct glad_gl_ext_entry *) calloc(size, sizeof *glad_gl_ext_table);
+    glad_gl_ext_mask = size - 1;
+    return glad_gl_ext_table != NULL;
+}
+
+static void glad_gl_ext_insert(const char *name, size_t length) {
+    unsigned int i = glad_gl_ext_hash(name, length) & glad_gl_ext_mask;
+    while(glad_gl_ext_table[i].name != NULL) {
+        if(glad_gl_ext_table[i].length == length &&
+            memcmp(glad_gl_ext_table[i].name, name, length) == 0) {
+            return;
+        }
+        i = (i + 1) & glad_gl_ext_mask;
+    }
+    glad_gl_ext_table[i].name = name;
+    glad_gl_ext_table[i].length = length;
+}
+
 static int glad_gl_get_extensions( int version, const char **out_exts, unsigned int *out_num_exts_i, char ***out_exts_i) {
+    const char *exts;
+    const char *end;
+    unsigned int count = 1;
+    GLAD_UNUSED(out_exts);
+    GLAD_UNUSED(out_num_exts_i);
+    GLAD_UNUSED(out_exts_i);
 #if GLAD_GL_IS_SOME_NEW_VERSION
     if(GLAD_VERSION_MAJOR(version) < 3) {
 #else
     GLAD_UNUSED(version);
-    GLAD_UNUSED(out_num_exts_i);
-    GLAD_UNUSED(out_exts_i);
 #endif
         if (glad_glGetString == NULL) {
             return 0;
         }
-        *out_exts = (const char *)glad_glGetString(GL_EXTENSIONS);
+        exts = (const char *)glad_glGetString(GL_EXTENSIONS);
+        if (exts == NULL) {
+            exts = "";
+        }
+        for(end = exts; *end; end++) {
+            count += *end == ' ';
+        }
+        if (!glad_gl_ext_alloc(count)) {
+            return 0;
+        }
+        while(*exts) {
+            for(end = exts; *end && *end != ' '; end++);
+            if(end > exts) {
+                glad_gl_ext_insert(exts, end - exts);
+            }
+            exts = *end ? end + 1 : end;
+        }
 #if GLAD_GL_IS_SOME_NEW_VERSION
     } else {
         unsigned int index = 0;
         unsigned int num_exts_i = 0;
-        char **exts_i = NULL;
         if (glad_glGetStringi == NULL || glad_glGetIntegerv == NULL) {
             return 0;
         }
         glad_glGetIntegerv(GL_NUM_EXTENSIONS, (int*) &num_exts_i);
-        if (num_exts_i > 0) {
-            exts_i = (char **) malloc(num_exts_i * (sizeof *exts_i));
-        }
-        if (exts_i == NULL) {
+        if (!glad_gl_ext_alloc(num_exts_i)) {
             return 0;
         }
+        /* these are static strings, no need to copy them */
         for(index = 0; index < num_exts_i; index++) {
-            const char *gl_str_tmp = (const char*) glad_glGetStringi(GL_EXTENSIONS, index);
-            size_t len = strlen(gl_str_tmp) + 1;
-
-            char *local_str = (char*) malloc(len * sizeof(char));
-            if(local_str != NULL) {
-                memcpy(local_str, gl_str_tmp, len * sizeof(char));
+            exts = (const char*) glad_glGetStringi(GL_EXTENSIONS, index);
+            if(exts != NULL) {
+                glad_gl_ext_insert(exts, strlen(exts));
             }
-
-            exts_i[index] = local_str;
         }
-
-        *out_num_exts_i = num_exts_i;
-        *out_exts_i = exts_i;
     }
 #endif
     return 1;
 }
 static void glad_gl_free_extensions(char **exts_i, unsigned int num_exts_i) {
-    if (exts_i != NULL) {
-        unsigned int index;
-        for(index = 0; index < num_exts_i; index++) {
-            free((void *) (exts_i[index]));
-        }
-        free((void *)exts_i);
-        exts_i = NULL;
-    }
+    GLAD_UNUSED(exts_i);
+    GLAD_UNUSED(num_exts_i);
+    free((void *) glad_gl_ext_table);
+    glad_gl_ext_table = NULL;
 }
 static int glad_gl_has_extension(int version, const char *exts, unsigned int num_exts_i, char **exts_i, const char *ext) {
-    if(GLAD_VERSION_MAJOR(version) < 3 || !GLAD_GL_IS_SOME_NEW_VERSION) {
-        const char *extensions;
-        const char *loc;
-        const char *terminator;
-        extensions = exts;
-        if(extensions == NULL || ext == NULL) {
-            return 0;
-        }
-        while(1) {
-            loc = strstr(extensions, ext);
-            if(loc == NULL) {
-                return 0;
-            }
-            terminator = loc + strlen(ext);
-            if((loc == extensions || *(loc - 1) == ' ') &&
-                (*terminator == ' ' || *terminator == '\0')) {
-                return 1;
-            }
-            extensions = terminator;
-        }
-    } else {
-        unsigned int index;
-        for(index = 0; index < num_exts_i; index++) {
-            const char *e = exts_i[index];
-            if(strcmp(e, ext) == 0) {
-                return 1;
-            }
+    size_t length;
+    unsigned int i;
+    GLAD_UNUSED(version);
+    GLAD_UNUSED(exts);
+    GLAD_UNUSED(num_exts_i);
+    GLAD_UNUSED(exts_i);
+    if(glad_gl_ext_table == NULL || ext == NULL) {
+        return 0;
+    }
+    length = strlen(ext);
+    i = glad_gl_ext_hash(ext, length) & glad_gl_ext_mask;
+    while(glad_gl_ext_table[i].name != NULL) {
+        if(glad_gl_ext_table[i].length == length &&
+            memcmp(glad_gl_ext_table[i].name, ext, length) == 0) {
+            return 1;
         }
+        i = (i + 1) & glad_gl_ext_mask;
     }
     return 0;
 }
@@ -11789,6 +11830,10 @@ int gladLoaderLoadGL(void) {
     int did_load = 0;
     struct _glad_gl_userptr userptr;
 
+    if (getenv("GLAD_LAZY") != NULL && atoi(getenv("GLAD_LAZY"))) {
+        return gladLoaderLoadGLLazy();
+    }
+
     did_load = _glad_GL_loader_handle == NULL;
     handle = glad_gl_dlopen_handle();
     if (handle) {
@@ -11806,7 +11851,28 @@ int gladLoaderLoadGL(void) {
 
 
 
+static struct _glad_gl_userptr _glad_GL_lazy_userptr;
+
+/*
+ * Like gladLoaderLoadGL(), but only resolves each function when it is
+ * first called (see gl_lazy.c).  The library handle stays open for that
+ * until gladLoaderUnloadGL(); a function first called after that aborts
+ * instead of looking itself up in the closed library.  Setting
+ * GLAD_LAZY=1 in the environment makes gladLoaderLoadGL() do this.
+ */
+int gladLoaderLoadGLLazy(void) {
+    void *handle;
+
+    handle = glad_gl_dlopen_handle();
+    if (handle == NULL) return 0;
+    _glad_GL_lazy_userptr = glad_gl_build_userptr(handle);
+
+    return gladLoadGLLazyUserPtr(glad_gl_get_proc, &_glad_GL_lazy_userptr);
+}
+
 void gladLoaderUnloadGL(void) {
+    gladUnloadGLLazy();
+    memset(&_glad_GL_lazy_userptr, 0, sizeof(_glad_GL_lazy_userptr));
     if (_glad_GL_loader_handle != NULL) {
         glad_close_dlopen_handle(_glad_GL_loader_handle);
         _glad_GL_loader_handle = NULL;
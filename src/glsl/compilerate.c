@@ -0,0 +1,272 @@
+/*
+ * Measure how much compiling shaders in parallel speeds up building a
+ * set of programs.
+ *
+ * Each iteration builds -programs programs from a vertex and a fragment
+ * shader, first one after the other with CompileShaderText() and
+ * LinkShaders(), waiting for each, with the GL's compiler threads turned
+ * off, then all at once with the asynchronous shaderutil functions and
+ * as many compiler threads as the GL likes (GL_ARB_parallel_shader_compile):
+ * every compile is submitted, then every link, then the programs are
+ * polled with GL_COMPLETION_STATUS until they're all done.  The programs
+ * per second each way and the speedup are reported.
+ *
+ * Every shader has a different constant in it, so that the GL's shader
+ * cache can't skip any of the work.  Since they never repeat, it's best
+ * to turn the cache off (MESA_SHADER_CACHE_DISABLE=true) rather than let
+ * them fill it.
+ *
+ * Command line options:
+ *    -programs N   programs per iteration (default 32)
+ *    -threads N    compiler threads for the parallel case (default: the
+ *                  GL's choice)
+ *    -terms N      terms of the fragment shader's sum, to make it bigger
+ *                  (default 16)
+ * and the -bench-* options of util/bench.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "glad/gl.h"
+#include "glut_wrap.h"
+#include "shaderutil.h"
+#include "bench.h"
+
+
+#define MAX_PROGRAMS 100000
+#define MAX_TERMS 10000
+
+static GLuint NumPrograms = 32;
+static GLuint Threads = 0xffffffff;
+static GLuint NumTerms = 16;
+
+static GLuint Seed = 0;
+static GLuint *VertShaders, *FragShaders, *Programs;
+static char *VertText, *FragText;
+
+
+static const char *
+GenVertexShader(GLuint seed)
+{
+   sprintf(VertText,
+           "varying vec2 coord;\n"
+           "void main()\n"
+           "{\n"
+           "   coord = gl_MultiTexCoord0.xy * %u.0;\n"
+           "   gl_Position = ftransform();\n"
+           "}\n", seed);
+   return VertText;
+}
+
+
+static const char *
+GenFragmentShader(GLuint seed)
+{
+   char *p = FragText;
+   GLuint i;
+
+   p += sprintf(p,
+                "uniform sampler2D tex;\n"
+                "varying vec2 coord;\n"
+                "void main()\n"
+                "{\n"
+                "   vec4 color = vec4(%u.0);\n", seed);
+   for (i = 0; i < NumTerms; i++) {
+      p += sprintf(p, "   color += texture2D(tex, coord * %u.0) * "
+                   "sin(color.wxyz + %u.0);\n", i + 1, i);
+   }
+   sprintf(p,
+           "   gl_FragColor = color;\n"
+           "}\n");
+   return FragText;
+}
+
+
+static void
+DeletePrograms(void)
+{
+   GLuint i;
+
+   for (i = 0; i < NumPrograms; i++) {
+      glDeleteProgram(Programs[i]);
+      glDeleteShader(VertShaders[i]);
+      glDeleteShader(FragShaders[i]);
+   }
+}
+
+
+/** Build the programs one at a time, waiting for each */
+static void
+BuildSerial(void *data, unsigned iterations)
+{
+   unsigned it;
+   GLuint i;
+
+   (void) data;
+   for (it = 0; it < iterations; it++) {
+      for (i = 0; i < NumPrograms; i++) {
+         VertShaders[i] = CompileShaderText(GL_VERTEX_SHADER,
+                                            GenVertexShader(Seed));
+         FragShaders[i] = CompileShaderText(GL_FRAGMENT_SHADER,
+                                            GenFragmentShader(Seed));
+         Programs[i] = LinkShaders(VertShaders[i], FragShaders[i]);
+         if (!Programs[i])
+            exit(1);
+         Seed++;
+      }
+      DeletePrograms();
+   }
+}
+
+
+/** Submit all the compiles and links, then poll until they're done */
+static void
+BuildParallel(void *data, unsigned iterations)
+{
+   unsigned it;
+   GLuint i, pending;
+
+   (void) data;
+   for (it = 0; it < iterations; it++) {
+      for (i = 0; i < NumPrograms; i++) {
+         VertShaders[i] = CompileShaderTextAsync(GL_VERTEX_SHADER,
+                                                 GenVertexShader(Seed));
+         FragShaders[i] = CompileShaderTextAsync(GL_FRAGMENT_SHADER,
+                                                 GenFragmentShader(Seed));
+         Seed++;
+      }
+      for (i = 0; i < NumPrograms; i++) {
+         Programs[i] = LinkShaders3Async(VertShaders[i], 0, FragShaders[i]);
+      }
+
+      /* the first program not known to be done */
+      pending = 0;
+      while (pending < NumPrograms) {
+         if (!ProgramIsReady(Programs[pending]))
+            continue;
+         if (!CheckProgramLink(Programs[pending]))
+            exit(1);
+         pending++;
+      }
+      DeletePrograms();
+   }
+}
+
+
+static void
+Draw(void)
+{
+   struct bench_result serial, parallel;
+
+   SetShaderCompilerThreads(0);
+   bench_run("serial", BuildSerial, NULL, NumPrograms, "programs", &serial);
+
+   SetShaderCompilerThreads(Threads);
+   bench_run("parallel", BuildParallel, NULL, NumPrograms, "programs",
+             &parallel);
+
+   printf("%u programs: serial %.1f ms, parallel %.1f ms, speedup %.2fx\n",
+          NumPrograms,
+          1000.0 * NumPrograms / serial.median,
+          1000.0 * NumPrograms / parallel.median,
+          parallel.median / serial.median);
+   exit(0);
+}
+
+
+static void
+Reshape(int width, int height)
+{
+   glViewport(0, 0, width, height);
+}
+
+
+static void
+Key(unsigned char key, int x, int y)
+{
+   (void) x;
+   (void) y;
+   switch (key) {
+   case 27:
+      exit(0);
+      break;
+   }
+   glutPostRedisplay();
+}
+
+
+static void
+Init(void)
+{
+   if (!ShadersSupported())
+      exit(1);
+
+   printf("GL_RENDERER = %s\n", (char *) glGetString(GL_RENDERER));
+   printf("GL_VERSION = %s\n", (char *) glGetString(GL_VERSION));
+   bench_set_renderer((const char *) glGetString(GL_RENDERER));
+
+   if (!SetShaderCompilerThreads(0))
+      printf("Note: no GL_ARB_parallel_shader_compile, "
+             "the parallel case will be serial too\n");
+
+   VertShaders = calloc(NumPrograms, sizeof(GLuint));
+   FragShaders = calloc(NumPrograms, sizeof(GLuint));
+   Programs = calloc(NumPrograms, sizeof(GLuint));
+   VertText = malloc(200);
+   FragText = malloc(200 + 100 * (size_t) NumTerms);
+   if (!VertShaders || !FragShaders || !Programs || !VertText || !FragText) {
+      printf("Error: out of memory\n");
+      exit(1);
+   }
+}
+
+
+static void
+Usage(const char *program)
+{
+   printf("Usage: %s [-programs N] [-threads N] [-terms N]\n", program);
+   printf("  -programs 1..%d, -terms 0..%d\n", MAX_PROGRAMS, MAX_TERMS);
+   exit(1);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   int i, programs = NumPrograms, terms = NumTerms;
+
+   /* each iteration is slow */
+   bench_set_defaults(3, 0.5, 0.0);
+   bench_init(&argc, argv);
+   glutInit(&argc, argv);
+
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-programs") == 0 && i + 1 < argc)
+         programs = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+         Threads = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-terms") == 0 && i + 1 < argc)
+         terms = atoi(argv[++i]);
+      else
+         Usage(argv[0]);
+   }
+   if (programs < 1 || programs > MAX_PROGRAMS ||
+       terms < 0 || terms > MAX_TERMS)
+      Usage(argv[0]);
+   NumPrograms = programs;
+   NumTerms = terms;
+
+   glutInitWindowPosition(0, 0);
+   glutInitWindowSize(64, 64);
+   glutInitDisplayMode(GLUT_RGB);
+   glutCreateWindow(argv[0]);
+   gladLoaderLoadGL();
+   glutReshapeFunc(Reshape);
+   glutKeyboardFunc(Key);
+   glutDisplayFunc(Draw);
+   Init();
+   glutMainLoop();
+   gladLoaderUnloadGL();
+   return 0;
+}
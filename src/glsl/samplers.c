@@ -292,10 +292,15 @@ CreateAProgram(void)
 
    printf("%s", fragShaderText);
 
-   vertShader = CompileShaderText(GL_VERTEX_SHADER, vertShaderText);
-   fragShader = CompileShaderText(GL_FRAGMENT_SHADER, fragShaderText);
+   /* let the GL compile both shaders and link at once */
+   vertShader = CompileShaderTextAsync(GL_VERTEX_SHADER, vertShaderText);
+   fragShader = CompileShaderTextAsync(GL_FRAGMENT_SHADER, fragShaderText);
    assert(vertShader);
-   program = LinkShaders(vertShader, fragShader);
+   program = LinkShaders3Async(vertShader, 0, fragShader);
+   if (!CheckShaderCompile(vertShader) ||
+       !CheckShaderCompile(fragShader) ||
+       !CheckProgramLink(program))
+      exit(1);
 
    glUseProgram(program);
 
@@ -0,0 +1,685 @@
+/*
+ * Measure the GL's shader compiler on a set of shader files.
+ *
+ * Each shader is compiled and linked -n times, each time cold and warm:
+ * cold with a unique comment put in front of the source, so that no
+ * cache in the driver can have seen it, warm with the source as it is,
+ * after compiling it once beforehand.  A compile is timed from
+ * glCompileShader() until GL_COMPILE_STATUS is known, a link likewise.
+ * With -draw the first draw with the program, which is where some
+ * drivers do the rest of the work, is timed too (glFinish() included);
+ * leave out the infinite-loop shaders for that.
+ *
+ * Shaders are linked with the file given with -pair, or the file of the
+ * other stage that has the same name (CH06-brick.vert with
+ * CH06-brick.frag), or else with a pass-through shader.  The shader type
+ * comes from the .vert or .frag extension, or from the last -vert or
+ * -frag option before the file.  "-pair VERT FRAG" adds both files if
+ * they aren't given otherwise.  Shaders that fail to compile or link are
+ * reported and left out.
+ *
+ * The median, 90th and 99th percentile and worst time of each step of
+ * each shader are reported, then the same over all the shaders, then
+ * the throughput in shaders compiled and linked per second (including
+ * the draw, with -draw).  -json FILE
+ * writes all of it to FILE, to compare Mesa builds.
+ *
+ * Usage: shaderbench [-n N] [-draw] [-json FILE] [-pair VERT FRAG]
+ *                    [-vert|-frag] file...
+ *
+ * For the shaders in this tree, give the .vert and .frag files of glsl/,
+ * then -frag and the .glsl files of fpglsl/, then -vert and the .glsl
+ * files of vpglsl/, and pair the fragment shaders that have no vertex
+ * shader of their own name with the ones they're used with:
+ *    -pair glsl/CH11-bumpmap.vert glsl/CH11-bumpmaptex.frag
+ *    -pair glsl/reflect.vert glsl/cubemap.frag
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "glad/gl.h"
+#include "glut_wrap.h"
+#include "shaderutil.h"
+#include "bench.h"
+
+
+enum pass { COLD, WARM, NUM_PASSES };
+enum step { COMPILE, LINK, DRAW, NUM_STEPS };
+
+static const char *PassNames[NUM_PASSES] = { "cold", "warm" };
+static const char *StepNames[NUM_STEPS] = { "compile", "link", "draw" };
+
+struct shader {
+   const char *file;
+   GLenum type;
+   char *source;
+   const char *pairFile;        /* from -pair, or NULL */
+   GLuint partner;              /* compiled shader of the other stage */
+   GLboolean failed;
+   uint64_t *ns[NUM_PASSES][NUM_STEPS];
+};
+
+/** latency percentiles, in ms */
+struct stats {
+   double p50, p90, p99, max;
+};
+
+#define MAX_ITERATIONS 100000
+
+static unsigned Iterations = 10;
+static GLboolean Draw = GL_FALSE;
+static const char *JsonFile = NULL;
+
+static struct shader *Shaders;
+static unsigned NumShaders;
+
+/** total time of each pass of each iteration, for the throughput */
+static uint64_t *PassNs[NUM_PASSES];
+
+static GLuint PassVert, PassFrag;
+
+static const char *PassVertText =
+   "void main() {\n"
+   "   gl_FrontColor = gl_Color;\n"
+   "   gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
+   "}\n";
+
+static const char *PassFragText =
+   "void main() {\n"
+   "   gl_FragColor = gl_Color;\n"
+   "}\n";
+
+
+static char *
+ReadFile(const char *file)
+{
+   char *text = NULL;
+   long size;
+   FILE *f;
+
+   f = fopen(file, "rb");
+   if (!f)
+      return NULL;
+   if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) >= 0 &&
+       fseek(f, 0, SEEK_SET) == 0 && (text = malloc(size + 1))) {
+      if (fread(text, 1, size, f) == (size_t) size) {
+         text[size] = 0;
+      }
+      else {
+         free(text);
+         text = NULL;
+      }
+   }
+   fclose(f);
+   return text;
+}
+
+
+static const char *
+Extension(const char *file)
+{
+   const char *dot = strrchr(file, '.');
+   const char *slash = strrchr(file, '/');
+
+   if (!dot || (slash && dot < slash))
+      return file + strlen(file);
+   return dot;
+}
+
+
+/** Do two files have the same name, but for the extension? */
+static GLboolean
+SameName(const char *a, const char *b)
+{
+   size_t len = Extension(a) - a;
+
+   return len == (size_t) (Extension(b) - b) && strncmp(a, b, len) == 0;
+}
+
+
+/**
+ * Compile and link the shader from the given source, adding the time of
+ * each step to ns[].  Returns GL_FALSE if it failed.
+ */
+static GLboolean
+Build(const struct shader *s, const char *source, uint64_t ns[NUM_STEPS])
+{
+   GLuint shader, program;
+   GLboolean ok;
+   uint64_t t0, t1, t2, t3;
+
+   t0 = bench_time_ns();
+   shader = CompileShaderTextAsync(s->type, source);
+   ok = CheckShaderCompile(shader);
+   t1 = bench_time_ns();
+   if (!ok) {
+      glDeleteShader(shader);
+      return GL_FALSE;
+   }
+
+   if (s->type == GL_VERTEX_SHADER)
+      program = LinkShaders3Async(shader, 0, s->partner);
+   else
+      program = LinkShaders3Async(s->partner, 0, shader);
+   ok = CheckProgramLink(program);
+   t2 = bench_time_ns();
+
+   t3 = t2;
+   if (ok && Draw) {
+      glUseProgram(program);
+      glBegin(GL_TRIANGLES);
+      glVertex2f(-1.0f, -1.0f);
+      glVertex2f(1.0f, -1.0f);
+      glVertex2f(0.0f, 1.0f);
+      glEnd();
+      glFinish();
+      t3 = bench_time_ns();
+      glUseProgram(0);
+   }
+
+   glDeleteProgram(program);
+   glDeleteShader(shader);
+
+   ns[COMPILE] += t1 - t0;
+   ns[LINK] += t2 - t1;
+   ns[DRAW] += t3 - t2;
+   return ok;
+}
+
+
+static void
+Measure(void)
+{
+   uint64_t nonce = bench_time_ns();
+   unsigned i, k;
+   int pass, step;
+   char *cold;
+
+   for (i = 0; i < Iterations; i++) {
+      for (k = 0; k < NumShaders; k++) {
+         struct shader *s = &Shaders[k];
+         uint64_t ns[NUM_PASSES][NUM_STEPS];
+
+         if (s->failed)
+            continue;
+
+         /* a comment may come before #version */
+         cold = malloc(strlen(s->source) + 100);
+         if (!cold) {
+            printf("Error: out of memory\n");
+            exit(1);
+         }
+         sprintf(cold, "// shaderbench %llu %u %u\n%s",
+                 (unsigned long long) nonce, i, k, s->source);
+
+         memset(ns, 0, sizeof(ns));
+         if (!Build(s, cold, ns[COLD]) || !Build(s, s->source, ns[WARM])) {
+            printf("%s: failed on iteration %u\n", s->file, i);
+            s->failed = GL_TRUE;
+         }
+         free(cold);
+
+         /* take the earlier iterations out of the totals again */
+         if (s->failed) {
+            unsigned j;
+
+            for (j = 0; j < i; j++) {
+               for (pass = 0; pass < NUM_PASSES; pass++) {
+                  for (step = 0; step < NUM_STEPS; step++)
+                     PassNs[pass][j] -= s->ns[pass][step][j];
+               }
+            }
+            continue;
+         }
+
+         for (pass = 0; pass < NUM_PASSES; pass++) {
+            for (step = 0; step < NUM_STEPS; step++) {
+               s->ns[pass][step][i] = ns[pass][step];
+               PassNs[pass][i] += ns[pass][step];
+            }
+         }
+      }
+   }
+}
+
+
+static int
+CompareU64(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+   return (x > y) - (x < y);
+}
+
+
+static double
+Percentile(const uint64_t *sorted, unsigned count, double p)
+{
+   double pos = p * (count - 1);
+   unsigned i = (unsigned) pos;
+
+   if (i + 1 >= count)
+      return sorted[count - 1];
+   return sorted[i] + (pos - i) * (sorted[i + 1] - sorted[i]);
+}
+
+
+static void
+GetStats(uint64_t *ns, unsigned count, struct stats *st)
+{
+   qsort(ns, count, sizeof(uint64_t), CompareU64);
+   st->p50 = Percentile(ns, count, 0.50) / 1e6;
+   st->p90 = Percentile(ns, count, 0.90) / 1e6;
+   st->p99 = Percentile(ns, count, 0.99) / 1e6;
+   st->max = ns[count - 1] / 1e6;
+}
+
+
+/** Stats of one step of one pass of a shader, or of all of them */
+static void
+StepStats(const struct shader *only, int pass, int step, struct stats *st)
+{
+   uint64_t *ns = malloc(NumShaders * Iterations * sizeof(uint64_t));
+   unsigned count = 0, k;
+
+   if (!ns) {
+      printf("Error: out of memory\n");
+      exit(1);
+   }
+   for (k = 0; k < NumShaders; k++) {
+      const struct shader *s = &Shaders[k];
+
+      if (s->failed || (only && s != only))
+         continue;
+      memcpy(ns + count, s->ns[pass][step], Iterations * sizeof(uint64_t));
+      count += Iterations;
+   }
+   if (count)
+      GetStats(ns, count, st);
+   else
+      memset(st, 0, sizeof(*st));
+   free(ns);
+}
+
+
+/** Shaders compiled and linked per second in the given pass */
+static double
+Throughput(int pass, unsigned good, struct stats *st)
+{
+   uint64_t *ns = malloc(Iterations * sizeof(uint64_t));
+   uint64_t total = 0;
+   unsigned i;
+
+   if (!ns) {
+      printf("Error: out of memory\n");
+      exit(1);
+   }
+   for (i = 0; i < Iterations; i++) {
+      ns[i] = PassNs[pass][i];
+      total += ns[i];
+   }
+   GetStats(ns, Iterations, st);
+   free(ns);
+   return total ? 1e9 * good * Iterations / total : 0.0;
+}
+
+
+static void
+PrintStats(FILE *f, const struct stats *st)
+{
+   fprintf(f, "{\"p50\": %.6f, \"p90\": %.6f, \"p99\": %.6f, \"max\": %.6f}",
+           st->p50, st->p90, st->p99, st->max);
+}
+
+
+static void
+PrintString(FILE *f, const char *s)
+{
+   fputc('"', f);
+   for (; *s; s++) {
+      if (*s == '"' || *s == '\\')
+         fputc('\\', f);
+      if ((unsigned char) *s >= ' ')
+         fputc(*s, f);
+   }
+   fputc('"', f);
+}
+
+
+/** The stats of all the steps of one shader, or of all of them */
+static void
+PrintPasses(FILE *f, const struct shader *only)
+{
+   struct stats st;
+   int pass, step;
+
+   fprintf(f, "{");
+   for (pass = 0; pass < NUM_PASSES; pass++) {
+      fprintf(f, "%s\"%s\": {", pass ? ", " : "", PassNames[pass]);
+      for (step = 0; step < NUM_STEPS; step++) {
+         if (step == DRAW && !Draw)
+            continue;
+         StepStats(only, pass, step, &st);
+         fprintf(f, "%s\"%s\": ", step ? ", " : "", StepNames[step]);
+         PrintStats(f, &st);
+      }
+      fprintf(f, "}");
+   }
+   fprintf(f, "}");
+}
+
+
+static void
+WriteJson(unsigned good)
+{
+   struct stats st;
+   unsigned k, first = 1;
+   double rate;
+   int pass;
+   FILE *f;
+
+   f = fopen(JsonFile, "w");
+   if (!f) {
+      printf("Error: couldn't open %s\n", JsonFile);
+      return;
+   }
+
+   fprintf(f, "{\n  \"renderer\": ");
+   PrintString(f, (const char *) glGetString(GL_RENDERER));
+   fprintf(f, ",\n  \"version\": ");
+   PrintString(f, (const char *) glGetString(GL_VERSION));
+   fprintf(f, ",\n  \"iterations\": %u,\n  \"shaders\": [", Iterations);
+   for (k = 0; k < NumShaders; k++) {
+      const struct shader *s = &Shaders[k];
+
+      fprintf(f, "%s\n    {\"file\": ", k ? "," : "");
+      PrintString(f, s->file);
+      fprintf(f, ", \"type\": \"%s\", \"failed\": %s",
+              s->type == GL_VERTEX_SHADER ? "vertex" : "fragment",
+              s->failed ? "true" : "false");
+      if (!s->failed) {
+         fprintf(f, ", \"ms\": ");
+         PrintPasses(f, s);
+      }
+      fprintf(f, "}");
+   }
+   fprintf(f, "\n  ],\n  \"all_ms\": ");
+   PrintPasses(f, NULL);
+   fprintf(f, ",\n  \"throughput\": {");
+   for (pass = 0; pass < NUM_PASSES; pass++) {
+      rate = Throughput(pass, good, &st);
+      fprintf(f, "%s\"%s\": {\"shaders_per_sec\": %.3f, \"iteration_ms\": ",
+              first ? "" : ", ", PassNames[pass], rate);
+      PrintStats(f, &st);
+      fprintf(f, "}");
+      first = 0;
+   }
+   fprintf(f, "}\n}\n");
+
+   if (fclose(f) != 0)
+      printf("Error: couldn't write %s\n", JsonFile);
+}
+
+
+static void
+Report(void)
+{
+   struct stats st;
+   unsigned k, good = 0;
+   int pass, step;
+
+   printf("\n%-32s %-7s %-7s %9s %9s %9s %9s\n",
+          "shader", "pass", "step", "p50 ms", "p90 ms", "p99 ms", "max ms");
+   for (k = 0; k <= NumShaders; k++) {
+      const struct shader *s = k < NumShaders ? &Shaders[k] : NULL;
+
+      if (s && s->failed)
+         continue;
+      if (s)
+         good++;
+      for (pass = 0; pass < NUM_PASSES; pass++) {
+         for (step = 0; step < NUM_STEPS; step++) {
+            if (step == DRAW && !Draw)
+               continue;
+            StepStats(s, pass, step, &st);
+            printf("%-32s %-7s %-7s %9.3f %9.3f %9.3f %9.3f\n",
+                   s ? s->file : "all", PassNames[pass], StepNames[step],
+                   st.p50, st.p90, st.p99, st.max);
+         }
+      }
+   }
+
+   printf("\n");
+   for (pass = 0; pass < NUM_PASSES; pass++) {
+      double rate = Throughput(pass, good, &st);
+
+      printf("%s: %u shaders in %.1f ms per iteration (median), "
+             "%.1f shaders/sec\n",
+             PassNames[pass], good, st.p50, rate);
+   }
+   if (JsonFile)
+      WriteJson(good);
+}
+
+
+static void
+DeleteShaders(void)
+{
+   unsigned k;
+
+   for (k = 0; k < NumShaders; k++) {
+      if (Shaders[k].partner != PassVert && Shaders[k].partner != PassFrag)
+         glDeleteShader(Shaders[k].partner);
+   }
+   glDeleteShader(PassVert);
+   glDeleteShader(PassFrag);
+}
+
+
+static void
+Display(void)
+{
+   Measure();
+   Report();
+   DeleteShaders();
+   exit(0);
+}
+
+
+static void
+Reshape(int width, int height)
+{
+   glViewport(0, 0, width, height);
+}
+
+
+static void
+Key(unsigned char key, int x, int y)
+{
+   (void) x;
+   (void) y;
+   switch (key) {
+   case 27:
+      exit(0);
+      break;
+   }
+   glutPostRedisplay();
+}
+
+
+static void
+Init(void)
+{
+   uint64_t ns[NUM_STEPS];
+   unsigned k, j;
+   int pass, step;
+
+   if (!ShadersSupported())
+      exit(1);
+
+   printf("GL_RENDERER = %s\n", (char *) glGetString(GL_RENDERER));
+   printf("GL_VERSION = %s\n", (char *) glGetString(GL_VERSION));
+
+   PassVert = CompileShaderText(GL_VERTEX_SHADER, PassVertText);
+   PassFrag = CompileShaderText(GL_FRAGMENT_SHADER, PassFragText);
+
+   for (k = 0; k < NumShaders; k++) {
+      struct shader *s = &Shaders[k];
+
+      s->partner = s->type == GL_VERTEX_SHADER ? PassFrag : PassVert;
+      for (j = 0; j < NumShaders; j++) {
+         const struct shader *p = &Shaders[j];
+
+         if (s->pairFile ? strcmp(p->file, s->pairFile) == 0 :
+             p->type != s->type && SameName(p->file, s->file)) {
+            GLuint shader = CompileShaderTextAsync(p->type, p->source);
+
+            if (CheckShaderCompile(shader))
+               s->partner = shader;
+            break;
+         }
+      }
+
+      for (pass = 0; pass < NUM_PASSES; pass++) {
+         for (step = 0; step < NUM_STEPS; step++) {
+            s->ns[pass][step] = calloc(Iterations, sizeof(uint64_t));
+            if (!s->ns[pass][step]) {
+               printf("Error: out of memory\n");
+               exit(1);
+            }
+         }
+      }
+
+      /* this also warms the caches for the warm pass */
+      memset(ns, 0, sizeof(ns));
+      if (!Build(s, s->source, ns)) {
+         printf("%s: failed, left out\n", s->file);
+         s->failed = GL_TRUE;
+      }
+   }
+
+   for (pass = 0; pass < NUM_PASSES; pass++) {
+      PassNs[pass] = calloc(Iterations, sizeof(uint64_t));
+      if (!PassNs[pass]) {
+         printf("Error: out of memory\n");
+         exit(1);
+      }
+   }
+}
+
+
+/**
+ * Add a shader file to the list, unless it's there already.  Its type
+ * comes from the extension, or is the given one.
+ */
+static struct shader *
+AddShader(const char *file, GLenum type)
+{
+   const char *ext = Extension(file);
+   struct shader *s;
+   unsigned k;
+
+   for (k = 0; k < NumShaders; k++) {
+      if (strcmp(Shaders[k].file, file) == 0)
+         return &Shaders[k];
+   }
+
+   s = &Shaders[NumShaders];
+   s->file = file;
+   if (strcmp(ext, ".vert") == 0)
+      s->type = GL_VERTEX_SHADER;
+   else if (strcmp(ext, ".frag") == 0)
+      s->type = GL_FRAGMENT_SHADER;
+   else
+      s->type = type;
+   if (s->type == GL_NONE) {
+      printf("Error: is %s a vertex or fragment shader? "
+             "Give -vert or -frag\n", s->file);
+      exit(1);
+   }
+   s->source = ReadFile(s->file);
+   if (!s->source) {
+      printf("Error: couldn't read %s\n", s->file);
+      exit(1);
+   }
+   NumShaders++;
+   return s;
+}
+
+
+static void
+Usage(const char *program)
+{
+   printf("Usage: %s [-n N] [-draw] [-json FILE] [-pair VERT FRAG] "
+          "[-vert|-frag] file...\n", program);
+   printf("  -n 1..%d\n", MAX_ITERATIONS);
+   exit(1);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   GLenum type = GL_NONE;
+   int i, iterations = Iterations;
+
+   glutInit(&argc, argv);
+
+   Shaders = calloc(argc, sizeof(struct shader));
+   if (!Shaders)
+      return 1;
+
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+         iterations = atoi(argv[++i]);
+      }
+      else if (strcmp(argv[i], "-draw") == 0) {
+         Draw = GL_TRUE;
+      }
+      else if (strcmp(argv[i], "-json") == 0 && i + 1 < argc) {
+         JsonFile = argv[++i];
+      }
+      else if (strcmp(argv[i], "-pair") == 0 && i + 2 < argc) {
+         struct shader *vert = AddShader(argv[i + 1], GL_VERTEX_SHADER);
+         struct shader *frag = AddShader(argv[i + 2], GL_FRAGMENT_SHADER);
+
+         if (vert->type != GL_VERTEX_SHADER ||
+             frag->type != GL_FRAGMENT_SHADER) {
+            printf("Error: -pair takes a vertex and a fragment shader\n");
+            exit(1);
+         }
+         vert->pairFile = frag->file;
+         frag->pairFile = vert->file;
+         i += 2;
+      }
+      else if (strcmp(argv[i], "-vert") == 0) {
+         type = GL_VERTEX_SHADER;
+      }
+      else if (strcmp(argv[i], "-frag") == 0) {
+         type = GL_FRAGMENT_SHADER;
+      }
+      else if (argv[i][0] == '-') {
+         Usage(argv[0]);
+      }
+      else {
+         AddShader(argv[i], type);
+      }
+   }
+   if (NumShaders == 0 || iterations < 1 || iterations > MAX_ITERATIONS)
+      Usage(argv[0]);
+   Iterations = iterations;
+
+   glutInitWindowPosition(0, 0);
+   glutInitWindowSize(64, 64);
+   glutInitDisplayMode(GLUT_RGB);
+   glutCreateWindow(argv[0]);
+   gladLoaderLoadGL();
+   glutReshapeFunc(Reshape);
+   glutKeyboardFunc(Key);
+   glutDisplayFunc(Display);
+   Init();
+   glutMainLoop();
+   gladLoaderUnloadGL();
+   return 0;
+}
@@ -8,12 +8,21 @@
 
 /* includes */
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include "glm.h"
 #include "readtex.h"
+#include "bench.h"
 
 
 typedef unsigned char boolean;
@@ -24,6 +33,16 @@ typedef unsigned char boolean;
 /* defines */
 #define T(x) model->triangles[(x)]
 
+/* smallest piece of an OBJ file worth parsing on its own thread */
+#define GLM_MIN_CHUNK_SIZE (1 << 20)
+
+/* smallest number of vertices worth smoothing on their own thread */
+#define GLM_MIN_SMOOTHING_VERTICES (1 << 16)
+
+/* how much worse than its surroundings the ACMR of a cluster split off
+   for overdraw ordering may be */
+#define GLM_OVERDRAW_THRESHOLD 1.05f
+
 
 /* enums */
 enum { X, Y, Z, W };   /* elements of a vertex */
@@ -31,13 +50,137 @@ enum { X, Y, Z, W };   /* elements of a vertex */
 
 /* typedefs */
 
-/* _GLMnode: general purpose node
+/* _GLMsmoothing: a range of vertices to compute smooth normals for on
+ * one thread in glmVertexNormals()
+ */
+typedef struct {
+   GLMmodel*   model;
+   const uint* adjacency;   /* triangles of each vertex, back to back */
+   const uint* start;       /* start of each vertex' triangles */
+   uint*       counts;      /* number of normals of each vertex */
+   const uint* offsets;     /* first normal of each vertex, or NULL when
+                               counting */
+   float       cos_angle;
+   uint        begin;       /* range of vertices */
+   uint        end;
+   uint        lonely;      /* number of vertices w/o a triangle */
+} _GLMsmoothing;
+
+/* _GLMop: a group, material or face statement recorded while parsing
+ * a chunk of an OBJ file
+ */
+enum { GLM_OP_FACES, GLM_OP_GROUP, GLM_OP_USEMTL, GLM_OP_MTLLIB };
+
+typedef struct {
+   uint  kind;           /* one of GLM_OP_* */
+   char* name;           /* group, material or library name */
+   uint  numtriangles;   /* number of triangles for GLM_OP_FACES */
+} _GLMop;
+
+/* _GLMchunk: a range of lines of an OBJ file and the data parsed from
+ * it.  Vertex, normal and texcoord arrays are 1-based like the model
+ * ones.
  */
-typedef struct _GLMnode {
-   uint           index;
-   boolean        averaged;
-   struct _GLMnode* next;
-} GLMnode;
+typedef struct {
+   const char*  begin;            /* first line of the chunk */
+   const char*  end;              /* end of the chunk */
+   GLMmodel*    model;            /* model the chunk is merged into */
+
+   uint         numvertices;
+   float*       vertices;
+   uint         numnormals;
+   float*       normals;
+   uint         numtexcoords;
+   float*       texcoords;
+   uint         numtriangles;
+   GLMtriangle* triangles;
+   uint         numops;
+   _GLMop*      ops;
+
+   uint         vertexoffset;     /* offsets into the model arrays */
+   uint         normaloffset;
+   uint         texcoordoffset;
+   uint         triangleoffset;
+} _GLMchunk;
+
+/* _GLMoverdraw: a run of triangles of a group that _glmSortOverdraw()
+ * keeps together
+ */
+typedef struct {
+   float key;            /* larger is drawn first */
+   uint  first;          /* first triangle */
+   uint  count;          /* number of triangles */
+} _GLMoverdraw;
+
+/* GLM binary model files: a header followed by arrays, each aligned
+ * to GLM_BINARY_ALIGN bytes, that the model arrays point to directly.
+ * All offsets are from the start of the file, 0 meaning none.
+ */
+#define GLM_BINARY_MAGIC     "GLMBIN\r\n"
+#define GLM_BINARY_VERSION   2
+#define GLM_BINARY_BYTEORDER 0x01020304
+#define GLM_BINARY_ALIGN     64
+
+typedef struct {
+   char     magic[8];         /* GLM_BINARY_MAGIC */
+   uint     version;          /* GLM_BINARY_VERSION */
+   uint     byteorder;        /* GLM_BINARY_BYTEORDER, as written */
+   uint     headersize;       /* sizeof(_GLMbinaryHeader) */
+   uint     trianglesize;     /* sizeof(GLMtriangle) */
+   uint64_t filesize;         /* to catch truncated files */
+
+   uint     numvertices;
+   uint     numnormals;
+   uint     numtexcoords;
+   uint     numfacetnorms;
+   uint     numtriangles;
+   uint     nummaterials;
+   uint     numgroups;
+   float    position[3];
+   float    scale;
+
+   uint     vertexSize;       /* layout of vertexdata */
+   uint     posOffset;
+   uint     normOffset;
+   uint     texOffset;
+   uint     vertexFormat;
+   float    posScale;
+   float    posBias[3];
+
+   uint64_t pathname;         /* strings */
+   uint64_t mtllibname;
+   uint64_t vertices;         /* model arrays, 1-based like in GLMmodel */
+   uint64_t normals;
+   uint64_t texcoords;
+   uint64_t facetnorms;
+   uint64_t triangles;
+   uint64_t materials;        /* array of _GLMbinaryMaterial */
+   uint64_t groups;           /* array of _GLMbinaryGroup, in list order */
+   uint64_t indexdata;        /* triIndexes of all groups, back to back */
+   uint64_t vertexdata;       /* interleaved vertex data for the VBO */
+   uint64_t vertexdatasize;
+} _GLMbinaryHeader;
+
+typedef struct {
+   uint64_t name;
+   uint64_t map_kd;
+   float    diffuse[4];
+   float    ambient[4];
+   float    specular[4];
+   float    emmissive[4];
+   float    shininess;
+   uint     pad;
+} _GLMbinaryMaterial;
+
+typedef struct {
+   uint64_t name;
+   uint64_t triangles;        /* numtriangles triangle indices */
+   uint64_t triIndexes;       /* 3 * numtriangles element indexes, or 0 */
+   uint     numtriangles;
+   uint     material;
+   uint     minIndex;
+   uint     maxIndex;
+} _GLMbinaryGroup;
 
 /* strdup is actually not a standard ANSI C or POSIX routine
    so implement a private one.  OpenVMS does not have a strdup; Linux's
@@ -57,6 +200,57 @@ stralloc(const char *string)
 
 /* private functions */
 
+/* _glmFree: free an array of a model, unless it points into the file
+ * mapping of a model read with glmReadBinary().
+ */
+static void
+_glmFree(GLMmodel* model, void* array)
+{
+   const char* p = (const char*)array;
+   const char* mapping = (const char*)model->mapping;
+
+   if (mapping && p >= mapping && p < mapping + model->mappingsize)
+      return;
+   free(array);
+}
+
+/* _glmDropClusters: forget the clusters of a model */
+static void
+_glmDropClusters(GLMmodel* model)
+{
+   GLMgroup* group;
+
+   for (group = model->groups; group; group = group->next) {
+      free(group->clusters);
+      group->clusters = NULL;
+      group->numclusters = 0;
+   }
+   model->numclusters = 0;
+}
+
+/* _glmDropVertexData: forget the prebuilt interleaved vertex data and
+ * the clusters of a model whose vertices, normals, texcoords or
+ * triangles are about to change.
+ */
+static void
+_glmDropVertexData(GLMmodel* model)
+{
+   if (model->vertexdata) {
+      _glmFree(model, model->vertexdata);
+      model->vertexdata = NULL;
+   }
+   _glmDropClusters(model);
+}
+
+/* _glmMin: returns the minimum of two floats */
+static float
+_glmMin(float a, float b)
+{
+   if (a < b)
+      return a;
+   return b;
+}
+
 /* _glmMax: returns the maximum of two floats */
 static float
 _glmMax(float a, float b)
@@ -127,65 +321,163 @@ _glmNormalize(float* n)
    n[2] /= l;
 }
 
+/* _glmNow: returns a monotonic clock time in seconds, used for
+ * reporting throughput of the heavier model operations.
+ */
+static double
+_glmNow(void)
+{
+   return bench_time_ns() * 1e-9;
+}
+
 /* _glmEqual: compares two vectors and returns TRUE if they are
  * equal (within a certain threshold) or FALSE if not. An epsilon
  * that works fairly well is 0.000001.
  *
- * u - array of 3 floats (float u[3])
- * v - array of 3 floats (float v[3])
+ * u    - array of size floats
+ * v    - array of size floats
+ * size - number of components in each vector (2 or 3)
  */
 static boolean
-_glmEqual(float* u, float* v, float epsilon)
+_glmEqual(const float* u, const float* v, uint size, float epsilon)
 {
-   if (_glmAbs(u[0] - v[0]) < epsilon &&
-       _glmAbs(u[1] - v[1]) < epsilon &&
-       _glmAbs(u[2] - v[2]) < epsilon)
-   {
-      return TRUE;
+   uint k;
+
+   for (k = 0; k < size; k++) {
+      if (_glmAbs(u[k] - v[k]) >= epsilon)
+         return FALSE;
    }
-   return FALSE;
+   return TRUE;
+}
+
+/* _glmWeldCell: quantize a vector component to the epsilon-sized
+ * grid cell it falls in.
+ */
+static long long
+_glmWeldCell(float f, float epsilon)
+{
+   double c = floor((double) f / epsilon);
+
+   /* keep huge coordinates / tiny epsilons from overflowing */
+   if (c > 1e15)
+      c = 1e15;
+   else if (c < -1e15)
+      c = -1e15;
+   return (long long) c;
+}
+
+/* _glmWeldHash: hash a grid cell into a bucket of the weld table
+ *
+ * cell - array of size cell coordinates
+ * mask - number of buckets minus one (buckets is a power of two)
+ */
+static uint
+_glmWeldHash(const long long* cell, uint size, uint mask)
+{
+   static const unsigned long long primes[3] = {
+      73856093ULL, 19349663ULL, 83492791ULL
+   };
+   unsigned long long h = 0;
+   uint k;
+
+   for (k = 0; k < size; k++)
+      h ^= (unsigned long long) cell[k] * primes[k];
+   h ^= h >> 29;
+   h *= 0xbf58476d1ce4e5b9ULL;
+   h ^= h >> 32;
+
+   return (uint) h & mask;
 }
 
 /* _glmWeldVectors: eliminate (weld) vectors that are within an
  * epsilon of each other.
  *
- * vectors    - array of float[3]'s to be welded
- * numvectors - number of float[3]'s in vectors
+ * Rather than comparing every vector against every unique vector
+ * found so far, the unique vectors are bucketed in a hash grid of
+ * epsilon-sized cells.  Two vectors closer than epsilon always lie in
+ * the same or adjacent cells, so only the 3^size neighboring cells
+ * have to be searched.  Like the exhaustive search, a vector is
+ * welded to the earliest unique vector it matches.
+ *
+ * vectors    - array of size-float vectors to be welded (1-based)
+ * size       - number of components per vector (2 or 3)
+ * numvectors - number of vectors in vectors, updated to the number
+ *              of unique vectors on return
  * epsilon    - maximum difference between vectors
+ * remap      - array of (numvectors + 1) uints that receives the new
+ *              index of each vector
  *
+ * Returns the (1-based) array of unique vectors, which should be
+ * free'd.
  */
 static float*
-_glmWeldVectors(float* vectors, uint* numvectors, float epsilon)
+_glmWeldVectors(const float* vectors, uint size, uint* numvectors,
+                float epsilon, uint* remap)
 {
-   float* copies;
-   uint   copied;
-   uint   i, j;
-
-   copies = (float*)malloc(sizeof(float) * 3 * (*numvectors + 1));
-   memcpy(copies, vectors, (sizeof(float) * 3 * (*numvectors + 1)));
-
-   copied = 1;
+   float*    copies;
+   uint*     buckets;
+   uint*     next;
+   uint      numbuckets, mask;
+   uint      copied;
+   uint      i, j, k, n, best;
+   long long cell[3], neighbor[3];
+
+   assert(size == 2 || size == 3);
+
+   /* nothing is within a non-positive epsilon of anything, but keep
+      the grid math sane */
+   if (!(epsilon > 0.0f))
+      epsilon = 1.0f;
+
+   copies = (float*)malloc(sizeof(float) * size * (*numvectors + 1));
+   next = (uint*)malloc(sizeof(uint) * (*numvectors + 1));
+
+   numbuckets = 1;
+   while (numbuckets < 2 * *numvectors && numbuckets < (1u << 31))
+      numbuckets <<= 1;
+   mask = numbuckets - 1;
+   buckets = (uint*)calloc(numbuckets, sizeof(uint));   /* 0 = empty */
+
+   copied = 0;
    for (i = 1; i <= *numvectors; i++) {
-      for (j = 1; j <= copied; j++) {
-         if (_glmEqual(&vectors[3 * i], &copies[3 * j], epsilon)) {
-            goto duplicate;
+      const float* v = &vectors[size * i];
+
+      for (k = 0; k < size; k++)
+         cell[k] = _glmWeldCell(v[k], epsilon);
+
+      /* search the 3x3(x3) block of cells around this vector for the
+         earliest matching unique vector */
+      best = 0;
+      for (n = 0; n < (size == 3 ? 27u : 9u); n++) {
+         uint d = n;
+         for (k = 0; k < size; k++) {
+            neighbor[k] = cell[k] + (long long)(d % 3) - 1;
+            d /= 3;
+         }
+         for (j = buckets[_glmWeldHash(neighbor, size, mask)]; j; j = next[j]) {
+            if ((!best || j < best) &&
+                _glmEqual(v, &copies[size * j], size, epsilon))
+               best = j;
          }
       }
 
-      /* must not be any duplicates -- add to the copies array */
-      copies[3 * copied + 0] = vectors[3 * i + 0];
-      copies[3 * copied + 1] = vectors[3 * i + 1];
-      copies[3 * copied + 2] = vectors[3 * i + 2];
-      j = copied;   /* pass this along for below */
-      copied++;
+      if (!best) {
+         /* must not be any duplicates -- add to the copies array */
+         best = ++copied;
+         memcpy(&copies[size * best], v, sizeof(float) * size);
+
+         j = _glmWeldHash(cell, size, mask);
+         next[best] = buckets[j];
+         buckets[j] = best;
+      }
 
-   duplicate:
-      /* set the first component of this vector to point at the correct
-         index into the new copies array */
-      vectors[3 * i + 0] = (float)j;
+      remap[i] = best;
    }
 
-   *numvectors = copied-1;
+   free(buckets);
+   free(next);
+
+   *numvectors = copied;
    return copies;
 }
 
@@ -222,6 +514,11 @@ _glmAddGroup(GLMmodel* model, char* name)
       group->material = 0;
       group->numtriangles = 0;
       group->triangles = NULL;
+      group->triIndexes = NULL;
+      group->minIndex = group->maxIndex = 0;
+      group->indexVboOffset = 0;
+      group->numclusters = 0;
+      group->clusters = NULL;
       group->next = model->groups;
       model->groups = group;
       model->numgroups++;
@@ -475,353 +772,662 @@ _glmWriteMTL(GLMmodel* model, char* modelpath, char* mtllibname)
 }
 
 
-/* _glmFirstPass: first pass at a Wavefront OBJ file that gets all the
- * statistics of the model (such as #vertices, #normals, etc)
+/* _glmMapFile: map a whole file into memory for reading
  *
- * model - properly initialized GLMmodel structure
- * file  - (fopen'd) file descriptor
+ * filename - name of the file
+ * size     - returns the size of the file in bytes
+ *
+ * Returns NULL if the file can't be read.  The data is not NUL
+ * terminated and should be released with _glmUnmapFile().
+ */
+static char*
+_glmMapFile(const char* filename, size_t* size)
+{
+#ifdef _WIN32
+   FILE* file;
+   char* data;
+   long  length;
+
+   file = fopen(filename, "rb");
+   if (!file)
+      return NULL;
+   fseek(file, 0, SEEK_END);
+   length = ftell(file);
+   rewind(file);
+   data = (char*)malloc(length > 0 ? length : 1);
+   if (!data || fread(data, 1, length, file) != (size_t)length) {
+      free(data);
+      fclose(file);
+      return NULL;
+   }
+   fclose(file);
+   *size = length;
+   return data;
+#else
+   struct stat st;
+   char* data;
+   int   fd;
+
+   fd = open(filename, O_RDONLY);
+   if (fd < 0)
+      return NULL;
+   if (fstat(fd, &st) < 0) {
+      close(fd);
+      return NULL;
+   }
+   *size = st.st_size;
+   if (*size == 0) {
+      /* can't mmap an empty file */
+      close(fd);
+      return (char*)malloc(1);
+   }
+   /* private and writable, so that models read with glmReadBinary()
+      can be modified in place (copy on write) */
+   data = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (data == MAP_FAILED)
+      return NULL;
+#ifdef MADV_SEQUENTIAL
+   madvise(data, *size, MADV_SEQUENTIAL);
+#endif
+   return data;
+#endif
+}
+
+/* _glmUnmapFile: release a file mapped with _glmMapFile()
  */
 static void
-_glmFirstPass(GLMmodel* model, FILE* file)
+_glmUnmapFile(char* data, size_t size)
 {
-   uint    numvertices;    /* number of vertices in model */
-   uint    numnormals;     /* number of normals in model */
-   uint    numtexcoords;   /* number of texcoords in model */
-   uint    numtriangles;   /* number of triangles in model */
-   GLMgroup* group;        /* current group */
-   unsigned  v, n, t;
-   char      buf[128];
+#ifdef _WIN32
+   (void) size;
+   free(data);
+#else
+   if (size == 0)
+      free(data);
+   else
+      munmap(data, size);
+#endif
+}
 
-   /* make a default group */
-   group = _glmAddGroup(model, "default");
+/* _glmGrow: make room for element number index in an array that is
+ * grown by doubling.  The capacity is implied by index (the next power
+ * of two, at least 64), so it doesn't have to be stored anywhere.
+ *
+ * array - the array, or NULL if nothing has been allocated yet
+ * index - index of the element about to be written
+ * size  - size of each element in bytes
+ */
+static void*
+_glmGrow(void* array, uint index, size_t size)
+{
+   if (!array || (index >= 64 && !(index & (index - 1)))) {
+      size_t capacity = index < 64 ? 64 : (size_t)index * 2;
 
-   numvertices = numnormals = numtexcoords = numtriangles = 0;
-   while(fscanf(file, "%s", buf) != EOF) {
-      switch(buf[0]) {
-      case '#':   /* comment */
-         /* eat up rest of line */
-         fgets(buf, sizeof(buf), file);
-         break;
-      case 'v':   /* v, vn, vt */
-         switch(buf[1]) {
-         case '\0':   /* vertex */
-            /* eat up rest of line */
-            fgets(buf, sizeof(buf), file);
-            numvertices++;
-            break;
-         case 'n':   /* normal */
-            /* eat up rest of line */
-            fgets(buf, sizeof(buf), file);
-            numnormals++;
-            break;
-         case 't':   /* texcoord */
-            /* eat up rest of line */
-            fgets(buf, sizeof(buf), file);
-            numtexcoords++;
-            break;
-         default:
-            printf("_glmFirstPass(): Unknown token \"%s\".\n", buf);
-            exit(1);
-            break;
-         }
-         break;
-      case 'm':
-         fgets(buf, sizeof(buf), file);
-         sscanf(buf, "%s %s", buf, buf);
-         model->mtllibname = stralloc(buf);
-         _glmReadMTL(model, buf);
-         break;
-      case 'u':
-         /* eat up rest of line */
-         fgets(buf, sizeof(buf), file);
-         break;
-      case 'g':   /* group */
-         /* eat up rest of line */
-         fgets(buf, sizeof(buf), file);
-         sscanf(buf, "%s", buf);
-         group = _glmAddGroup(model, buf);
-         break;
-      case 'f':   /* face */
-         v = n = t = 0;
-         fscanf(file, "%s", buf);
-         /* can be one of %d, %d//%d, %d/%d, %d/%d/%d %d//%d */
-         if (strstr(buf, "//")) {
-            /* v//n */
-            sscanf(buf, "%u//%u", &v, &n);
-            fscanf(file, "%u//%u", &v, &n);
-            fscanf(file, "%u//%u", &v, &n);
-            numtriangles++;
-            group->numtriangles++;
-            while(fscanf(file, "%u//%u", &v, &n) > 0) {
-               numtriangles++;
-               group->numtriangles++;
-            }
-         } else if (sscanf(buf, "%u/%u/%u", &v, &t, &n) == 3) {
-            /* v/t/n */
-            fscanf(file, "%u/%u/%u", &v, &t, &n);
-            fscanf(file, "%u/%u/%u", &v, &t, &n);
-            numtriangles++;
-            group->numtriangles++;
-            while(fscanf(file, "%u/%u/%u", &v, &t, &n) > 0) {
-               numtriangles++;
-               group->numtriangles++;
-            }
-         } else if (sscanf(buf, "%u/%u", &v, &t) == 2) {
-            /* v/t */
-            fscanf(file, "%u/%u", &v, &t);
-            fscanf(file, "%u/%u", &v, &t);
-            numtriangles++;
-            group->numtriangles++;
-            while(fscanf(file, "%u/%u", &v, &t) > 0) {
-               numtriangles++;
-               group->numtriangles++;
-            }
-         } else {
-            /* v */
-            fscanf(file, "%u", &v);
-            fscanf(file, "%u", &v);
-            numtriangles++;
-            group->numtriangles++;
-            while(fscanf(file, "%u", &v) > 0) {
-               numtriangles++;
-               group->numtriangles++;
-            }
+      array = realloc(array, capacity * size);
+      if (!array) {
+         fprintf(stderr, "glmReadOBJ() failed: out of memory.\n");
+         exit(1);
+      }
+   }
+   return array;
+}
+
+/* _glmIsSpace: returns TRUE for whitespace within a line
+ */
+static inline boolean
+_glmIsSpace(char c)
+{
+   return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+/* _glmSkipSpace: skip whitespace, but not the end of the line
+ */
+static inline const char*
+_glmSkipSpace(const char* p, const char* end)
+{
+   while (p < end && _glmIsSpace(*p))
+      p++;
+   return p;
+}
+
+/* _glmSkipLine: skip to the beginning of the next line
+ */
+static inline const char*
+_glmSkipLine(const char* p, const char* end)
+{
+   p = memchr(p, '\n', end - p);
+   return p ? p + 1 : end;
+}
+
+/* _glmParseWord: copy the next whitespace delimited word on the line
+ * into buf (truncating it to size-1 characters).
+ */
+static const char*
+_glmParseWord(const char* p, const char* end, char* buf, size_t size)
+{
+   size_t n = 0;
+
+   p = _glmSkipSpace(p, end);
+   while (p < end && *p != '\n' && !_glmIsSpace(*p)) {
+      if (n + 1 < size)
+         buf[n++] = *p;
+      p++;
+   }
+   buf[n] = '\0';
+   return p;
+}
+
+/* _glmParseUint: parse an unsigned decimal integer.  Returns a pointer
+ * past the digits, or p itself if there are none.
+ */
+static inline const char*
+_glmParseUint(const char* p, const char* end, uint* value)
+{
+   uint v = 0;
+
+   while (p < end && *p >= '0' && *p <= '9')
+      v = v * 10 + (uint)(*p++ - '0');
+   *value = v;
+   return p;
+}
+
+/* _glmParseFloat: parse a decimal floating point number without going
+ * through the (locale aware, and slow) scanf family.  Returns a
+ * pointer past the number, or p itself if there is none.
+ */
+static const char*
+_glmParseFloat(const char* p, const char* end, float* value)
+{
+   static const double powers[] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+   };
+   const char*        start;
+   unsigned long long mantissa = 0;
+   int                exponent = 0, digits = 0, e;
+   boolean            negative = FALSE;
+   double             d;
+
+   p = _glmSkipSpace(p, end);
+   start = p;
+
+   if (p < end && (*p == '-' || *p == '+'))
+      negative = *p++ == '-';
+
+   for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+      if (mantissa < 100000000000000000ULL)
+         mantissa = mantissa * 10 + (*p - '0');
+      else
+         exponent++;   /* beyond float precision anyway */
+   }
+   if (p < end && *p == '.') {
+      for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+         if (mantissa < 100000000000000000ULL) {
+            mantissa = mantissa * 10 + (*p - '0');
+            exponent--;
          }
-         break;
+      }
+   }
+   if (!digits) {
+      *value = 0.0f;
+      return start;
+   }
 
-      default:
-         /* eat up rest of line */
-         fgets(buf, sizeof(buf), file);
-         break;
+   if (p < end && (*p == 'e' || *p == 'E')) {
+      const char* q = p + 1;
+      boolean     eneg = FALSE;
+      uint        ev;
+
+      if (q < end && (*q == '-' || *q == '+'))
+         eneg = *q++ == '-';
+      if (q < end && *q >= '0' && *q <= '9') {
+         p = _glmParseUint(q, end, &ev);
+         if (ev > 1000)
+            ev = 1000;
+         exponent += eneg ? -(int)ev : (int)ev;
       }
    }
 
-#if 0
-   /* announce the model statistics */
-   printf(" Vertices: %d\n", numvertices);
-   printf(" Normals: %d\n", numnormals);
-   printf(" Texcoords: %d\n", numtexcoords);
-   printf(" Triangles: %d\n", numtriangles);
-   printf(" Groups: %d\n", model->numgroups);
-#endif
+   d = (double)mantissa;
+   for (e = exponent; e > 22; e -= 22)
+      d *= 1e22;
+   for (; e < -22; e += 22)
+      d /= 1e22;
+   d = e < 0 ? d / powers[-e] : d * powers[e];
+
+   *value = (float)(negative ? -d : d);
+   return p;
+}
 
-   /* set the stats in the model structure */
-   model->numvertices  = numvertices;
-   model->numnormals   = numnormals;
-   model->numtexcoords = numtexcoords;
-   model->numtriangles = numtriangles;
+/* _glmParseFaceVertex: parse one vertex of a face, which can be one
+ * of v, v//n, v/t or v/t/n.  Missing indices are set to 0.  Returns a
+ * pointer past the vertex, or NULL if there is no vertex to parse.
+ */
+static inline const char*
+_glmParseFaceVertex(const char* p, const char* end, uint* v, uint* t, uint* n)
+{
+   const char* q;
 
-   /* allocate memory for the triangles in each group */
-   group = model->groups;
-   while(group) {
-      group->triangles = (uint*)malloc(sizeof(uint) * group->numtriangles);
-      group->numtriangles = 0;
-      group = group->next;
+   p = _glmSkipSpace(p, end);
+   q = _glmParseUint(p, end, v);
+   if (q == p)
+      return NULL;
+   p = q;
+
+   *t = *n = 0;
+   if (p < end && *p == '/') {
+      p = _glmParseUint(p + 1, end, t);
+      if (p < end && *p == '/')
+         p = _glmParseUint(p + 1, end, n);
    }
+   return p;
 }
 
-/* _glmSecondPass: second pass at a Wavefront OBJ file that gets all
- * the data.
- *
- * model - properly initialized GLMmodel structure
- * file  - (fopen'd) file descriptor
+/* _glmAddOp: append a group/material event to a chunk, or for faces,
+ * add triangles to the current run of faces.
  */
 static void
-_glmSecondPass(GLMmodel* model, FILE* file)
-{
-   uint    numvertices;    /* number of vertices in model */
-   uint    numnormals;     /* number of normals in model */
-   uint    numtexcoords;   /* number of texcoords in model */
-   uint    numtriangles;   /* number of triangles in model */
-   float*  vertices;       /* array of vertices  */
-   float*  normals;        /* array of normals */
-   float*  texcoords;      /* array of texture coordinates */
-   GLMgroup* group;        /* current group pointer */
-   uint    material;       /* current material */
-   uint    v, n, t;
-   char      buf[128];
-
-   /* set the pointer shortcuts */
-   vertices     = model->vertices;
-   normals      = model->normals;
-   texcoords    = model->texcoords;
-   group        = model->groups;
-
-   /* on the second pass through the file, read all the data into the
-      allocated arrays */
-   numvertices = numnormals = numtexcoords = 1;
-   numtriangles = 0;
-   material = 0;
-   while(fscanf(file, "%s", buf) != EOF) {
-      switch(buf[0]) {
-      case '#':   /* comment */
-         /* eat up rest of line */
-         fgets(buf, sizeof(buf), file);
+_glmAddOp(_GLMchunk* chunk, uint kind, const char* name, uint numtriangles)
+{
+   _GLMop* op;
+
+   if (kind == GLM_OP_FACES && chunk->numops &&
+       chunk->ops[chunk->numops - 1].kind == GLM_OP_FACES) {
+      chunk->ops[chunk->numops - 1].numtriangles += numtriangles;
+      return;
+   }
+
+   chunk->ops = _glmGrow(chunk->ops, chunk->numops, sizeof(_GLMop));
+   op = &chunk->ops[chunk->numops++];
+   op->kind = kind;
+   op->name = name ? stralloc(name) : NULL;
+   op->numtriangles = numtriangles;
+}
+
+/* _glmParseChunk: read all the data in a range of lines of a
+ * Wavefront OBJ file in a single pass, growing the chunk arrays as
+ * they fill up.  Group, material and material library statements are
+ * only recorded, in order, so that chunks can be parsed independently
+ * and merged afterwards.
+ *
+ * arg - _GLMchunk with the range of the file to parse
+ */
+static void*
+_glmParseChunk(void* arg)
+{
+   _GLMchunk*   chunk = (_GLMchunk*)arg;
+   const char*  p = chunk->begin;
+   const char*  end = chunk->end;
+   const char*  q;
+   uint         numvertices;    /* number of vertices in chunk */
+   uint         numnormals;     /* number of normals in chunk */
+   uint         numtexcoords;   /* number of texcoords in chunk */
+   uint         numtriangles;   /* number of triangles in chunk */
+   uint         v, n, t, corners;
+   GLMtriangle* tri;
+   float*       f;
+   char         buf[128];
+
+   numvertices = numnormals = numtexcoords = numtriangles = 0;
+   while (p < end) {
+      p = _glmSkipSpace(p, end);
+      if (p == end)
          break;
+
+      switch (*p) {
       case 'v':   /* v, vn, vt */
-         switch(buf[1]) {
-         case '\0':   /* vertex */
-            fscanf(file, "%f %f %f",
-                   &vertices[3 * numvertices + X],
-                   &vertices[3 * numvertices + Y],
-                   &vertices[3 * numvertices + Z]);
-            numvertices++;
-            break;
-         case 'n':   /* normal */
-            fscanf(file, "%f %f %f",
-                   &normals[3 * numnormals + X],
-                   &normals[3 * numnormals + Y],
-                   &normals[3 * numnormals + Z]);
-            numnormals++;
-            break;
-         case 't':   /* texcoord */
-            fscanf(file, "%f %f",
-                   &texcoords[2 * numtexcoords + X],
-                   &texcoords[2 * numtexcoords + Y]);
-            numtexcoords++;
-            break;
+         if (p + 1 < end && _glmIsSpace(p[1])) {
+            /* vertex */
+            chunk->vertices = _glmGrow(chunk->vertices, numvertices + 1,
+                                       3 * sizeof(float));
+            f = &chunk->vertices[3 * ++numvertices];
+            p = _glmParseFloat(p + 1, end, &f[X]);
+            p = _glmParseFloat(p, end, &f[Y]);
+            p = _glmParseFloat(p, end, &f[Z]);
+         } else if (p + 2 < end && p[1] == 'n' && _glmIsSpace(p[2])) {
+            /* normal */
+            chunk->normals = _glmGrow(chunk->normals, numnormals + 1,
+                                      3 * sizeof(float));
+            f = &chunk->normals[3 * ++numnormals];
+            p = _glmParseFloat(p + 2, end, &f[X]);
+            p = _glmParseFloat(p, end, &f[Y]);
+            p = _glmParseFloat(p, end, &f[Z]);
+         } else if (p + 2 < end && p[1] == 't' && _glmIsSpace(p[2])) {
+            /* texcoord */
+            chunk->texcoords = _glmGrow(chunk->texcoords, numtexcoords + 1,
+                                        2 * sizeof(float));
+            f = &chunk->texcoords[2 * ++numtexcoords];
+            p = _glmParseFloat(p + 2, end, &f[X]);
+            p = _glmParseFloat(p, end, &f[Y]);
+         } else {
+            _glmParseWord(p, end, buf, sizeof(buf));
+            printf("glmReadOBJ(): Unknown token \"%s\".\n", buf);
+            exit(1);
          }
          break;
-      case 'u':
-         fgets(buf, sizeof(buf), file);
-         sscanf(buf, "%s %s", buf, buf);
-         material = _glmFindMaterial(model, buf);
-         if (!group->material)
-            group->material = material;
-         /*printf("material %s = %u\n", buf, material);*/
-         break;
-      case 'g':   /* group */
-         /* eat up rest of line */
-         fgets(buf, sizeof(buf), file);
-         sscanf(buf, "%s", buf);
-         group = _glmFindGroup(model, buf);
-         group->material = material;
-         /*printf("GROUP %s  material %u\n", buf, material);*/
-         break;
       case 'f':   /* face */
-         v = n = t = 0;
-         fscanf(file, "%s", buf);
-         /* can be one of %d, %d//%d, %d/%d, %d/%d/%d %d//%d */
-         if (strstr(buf, "//")) {
-            /* v//n */
-            sscanf(buf, "%u//%u", &v, &n);
-            T(numtriangles).vindices[0] = v;
-            T(numtriangles).nindices[0] = n;
-            fscanf(file, "%u//%u", &v, &n);
-            T(numtriangles).vindices[1] = v;
-            T(numtriangles).nindices[1] = n;
-            fscanf(file, "%u//%u", &v, &n);
-            T(numtriangles).vindices[2] = v;
-            T(numtriangles).nindices[2] = n;
-            group->triangles[group->numtriangles++] = numtriangles;
-            numtriangles++;
-            while (fscanf(file, "%u//%u", &v, &n) > 0) {
-               T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-               T(numtriangles).nindices[0] = T(numtriangles-1).nindices[0];
-               T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-               T(numtriangles).nindices[1] = T(numtriangles-1).nindices[2];
-               T(numtriangles).vindices[2] = v;
-               T(numtriangles).nindices[2] = n;
-               group->triangles[group->numtriangles++] = numtriangles;
-               numtriangles++;
-            }
-         } else if (sscanf(buf, "%u/%u/%u", &v, &t, &n) == 3) {
-            /* v/t/n */
-            T(numtriangles).vindices[0] = v;
-            T(numtriangles).tindices[0] = t;
-            T(numtriangles).nindices[0] = n;
-            fscanf(file, "%u/%u/%u", &v, &t, &n);
-            T(numtriangles).vindices[1] = v;
-            T(numtriangles).tindices[1] = t;
-            T(numtriangles).nindices[1] = n;
-            fscanf(file, "%u/%u/%u", &v, &t, &n);
-            T(numtriangles).vindices[2] = v;
-            T(numtriangles).tindices[2] = t;
-            T(numtriangles).nindices[2] = n;
-            group->triangles[group->numtriangles++] = numtriangles;
-            numtriangles++;
-            while (fscanf(file, "%u/%u/%u", &v, &t, &n) > 0) {
-               T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-               T(numtriangles).tindices[0] = T(numtriangles-1).tindices[0];
-               T(numtriangles).nindices[0] = T(numtriangles-1).nindices[0];
-               T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-               T(numtriangles).tindices[1] = T(numtriangles-1).tindices[2];
-               T(numtriangles).nindices[1] = T(numtriangles-1).nindices[2];
-               T(numtriangles).vindices[2] = v;
-               T(numtriangles).tindices[2] = t;
-               T(numtriangles).nindices[2] = n;
-               group->triangles[group->numtriangles++] = numtriangles;
-               numtriangles++;
-            }
-         } else if (sscanf(buf, "%u/%u", &v, &t) == 2) {
-            /* v/t */
-            T(numtriangles).vindices[0] = v;
-            T(numtriangles).tindices[0] = t;
-            fscanf(file, "%u/%u", &v, &t);
-            T(numtriangles).vindices[1] = v;
-            T(numtriangles).tindices[1] = t;
-            fscanf(file, "%u/%u", &v, &t);
-            T(numtriangles).vindices[2] = v;
-            T(numtriangles).tindices[2] = t;
-            group->triangles[group->numtriangles++] = numtriangles;
-            numtriangles++;
-            while (fscanf(file, "%u/%u", &v, &t) > 0) {
-               T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-               T(numtriangles).tindices[0] = T(numtriangles-1).tindices[0];
-               T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-               T(numtriangles).tindices[1] = T(numtriangles-1).tindices[2];
-               T(numtriangles).vindices[2] = v;
-               T(numtriangles).tindices[2] = t;
-               group->triangles[group->numtriangles++] = numtriangles;
-               numtriangles++;
-            }
-         } else {
-            /* v */
-            sscanf(buf, "%u", &v);
-            T(numtriangles).vindices[0] = v;
-            fscanf(file, "%u", &v);
-            T(numtriangles).vindices[1] = v;
-            fscanf(file, "%u", &v);
-            T(numtriangles).vindices[2] = v;
-            group->triangles[group->numtriangles++] = numtriangles;
-            numtriangles++;
-            while (fscanf(file, "%u", &v) > 0) {
-               T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-               T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-               T(numtriangles).vindices[2] = v;
-               group->triangles[group->numtriangles++] = numtriangles;
+         /* triangulate the polygon as a fan around its first vertex;
+            indices are absolute, so they need no fixing up on merge */
+         corners = 0;
+         for (q = p + 1; (q = _glmParseFaceVertex(q, end, &v, &t, &n)); p = q) {
+            chunk->triangles = _glmGrow(chunk->triangles, numtriangles,
+                                        sizeof(GLMtriangle));
+            tri = &chunk->triangles[numtriangles];
+            if (corners < 2) {
+               /* stash the first two vertices in the next triangle */
+               tri->vindices[corners] = v;
+               tri->tindices[corners] = t;
+               tri->nindices[corners] = n;
+            } else {
+               if (corners > 2) {
+                  /* copy the first and last vertex of the previous
+                     triangle of this polygon */
+                  *tri = tri[-1];
+                  tri->vindices[1] = tri[-1].vindices[2];
+                  tri->tindices[1] = tri[-1].tindices[2];
+                  tri->nindices[1] = tri[-1].nindices[2];
+               }
+               tri->vindices[2] = v;
+               tri->tindices[2] = t;
+               tri->nindices[2] = n;
                numtriangles++;
             }
+            corners++;
          }
+         if (corners > 2)
+            _glmAddOp(chunk, GLM_OP_FACES, NULL, corners - 2);
+         break;
+      case 'g':   /* group */
+         if (p + 1 < end && !_glmIsSpace(p[1]) && p[1] != '\n')
+            break;
+         _glmParseWord(p + 1, end, buf, sizeof(buf));
+         _glmAddOp(chunk, GLM_OP_GROUP, buf[0] ? buf : "default", 0);
+         break;
+      case 'u':   /* usemtl */
+         p = _glmParseWord(p, end, buf, sizeof(buf));
+         if (strcmp(buf, "usemtl"))
+            break;
+         _glmParseWord(p, end, buf, sizeof(buf));
+         _glmAddOp(chunk, GLM_OP_USEMTL, buf, 0);
+         break;
+      case 'm':   /* mtllib */
+         p = _glmParseWord(p, end, buf, sizeof(buf));
+         if (strcmp(buf, "mtllib"))
+            break;
+         _glmParseWord(p, end, buf, sizeof(buf));
+         _glmAddOp(chunk, GLM_OP_MTLLIB, buf, 0);
          break;
-
       default:
-         /* eat up rest of line */
-         fgets(buf, sizeof(buf), file);
+         /* comments and everything else */
          break;
       }
+
+      /* eat up rest of line */
+      p = _glmSkipLine(p, end);
    }
 
-#if 0
-   /* announce the memory requirements */
-   printf(" Memory: %d bytes\n",
-          numvertices  * 3*sizeof(float) +
-          numnormals   * 3*sizeof(float) * (numnormals ? 1 : 0) +
-          numtexcoords * 3*sizeof(float) * (numtexcoords ? 1 : 0) +
-          numtriangles * sizeof(GLMtriangle));
-#endif
+   chunk->numvertices  = numvertices;
+   chunk->numnormals   = numnormals;
+   chunk->numtexcoords = numtexcoords;
+   chunk->numtriangles = numtriangles;
+
+   return NULL;
 }
 
+/* _glmCopyChunk: copy the data of a parsed chunk to its place in the
+ * model arrays, at the offsets computed by _glmParseOBJ().
+ *
+ * arg - parsed _GLMchunk
+ */
+static void*
+_glmCopyChunk(void* arg)
+{
+   _GLMchunk* chunk = (_GLMchunk*)arg;
+   GLMmodel*  model = chunk->model;
 
+   if (chunk->numvertices) {
+      memcpy(&model->vertices[3 * (chunk->vertexoffset + 1)],
+             &chunk->vertices[3],
+             sizeof(float) * 3 * chunk->numvertices);
+   }
+   if (chunk->numnormals) {
+      memcpy(&model->normals[3 * (chunk->normaloffset + 1)],
+             &chunk->normals[3],
+             sizeof(float) * 3 * chunk->numnormals);
+   }
+   if (chunk->numtexcoords) {
+      memcpy(&model->texcoords[2 * (chunk->texcoordoffset + 1)],
+             &chunk->texcoords[2],
+             sizeof(float) * 2 * chunk->numtexcoords);
+   }
+   if (chunk->numtriangles) {
+      memcpy(&model->triangles[chunk->triangleoffset],
+             chunk->triangles,
+             sizeof(GLMtriangle) * chunk->numtriangles);
+   }
 
+   free(chunk->vertices);
+   free(chunk->normals);
+   free(chunk->texcoords);
+   free(chunk->triangles);
 
-/* public functions */
+   return NULL;
+}
 
-/* glmUnitize: "unitize" a model by translating it to the origin and
- * scaling it to fit in a unit cube around the origin.  Returns the
- * scalefactor used.
+/* _glmRunThreads: run func on every element of an array of per-thread
+ * arguments, each on its own thread (the first one on the calling
+ * thread).
  *
- * model - properly initialized GLMmodel structure
+ * args  - array of arguments
+ * count - number of elements in args
+ * size  - size of each element in bytes
+ * func  - function to run
+ */
+static void
+_glmRunThreads(void* args, uint count, size_t size, void* (*func)(void*))
+{
+   char* arg = (char*)args;
+#ifdef _WIN32
+   uint i;
+
+   for (i = 0; i < count; i++)
+      func(arg + i * size);
+#else
+   pthread_t* threads;
+   boolean*   started;
+   uint       i;
+
+   threads = (pthread_t*)malloc(sizeof(pthread_t) * count);
+   started = (boolean*)calloc(count, sizeof(boolean));
+
+   for (i = 1; i < count; i++)
+      started[i] = pthread_create(&threads[i], NULL, func, arg + i * size) == 0;
+
+   func(arg);
+
+   for (i = 1; i < count; i++) {
+      if (started[i])
+         pthread_join(threads[i], NULL);
+      else
+         func(arg + i * size);
+   }
+
+   free(threads);
+   free(started);
+#endif
+}
+
+/* _glmParseOBJ: read all the data of a Wavefront OBJ file.  The file
+ * is split at line boundaries into chunks that are parsed on worker
+ * threads.  Then the chunk arrays are merged using prefix sums of the
+ * chunk sizes, and the recorded group and material statements are
+ * replayed in file order to build the groups.
+ *
+ * model      - properly initialized GLMmodel structure
+ * data       - file data
+ * size       - size of the file data in bytes
+ * numthreads - number of threads to parse with
+ */
+static void
+_glmParseOBJ(GLMmodel* model, const char* data, size_t size, uint numthreads)
+{
+   _GLMchunk* chunks;
+   _GLMchunk* chunk;
+   GLMgroup*  group;        /* current group */
+   uint       material;     /* current material */
+   uint       numchunks, triangle;
+   uint       i, j, k;
+   const char* p;
+
+   /* don't bother splitting small files */
+   if (numthreads < 1)
+      numthreads = 1;
+   if (size / numthreads < GLM_MIN_CHUNK_SIZE)
+      numthreads = size / GLM_MIN_CHUNK_SIZE + 1;
+
+   /* split the file at line boundaries */
+   chunks = (_GLMchunk*)calloc(numthreads, sizeof(_GLMchunk));
+   p = data;
+   numchunks = 0;
+   for (i = 0; i < numthreads && p < data + size; i++) {
+      const char* end = data + size / numthreads * (i + 1);
+      if (i == numthreads - 1 || end <= p)
+         end = data + size;
+      else
+         end = _glmSkipLine(end, data + size);
+
+      chunks[numchunks].begin = p;
+      chunks[numchunks].end = end;
+      chunks[numchunks].model = model;
+      numchunks++;
+      p = end;
+   }
+
+   _glmRunThreads(chunks, numchunks, sizeof(_GLMchunk), _glmParseChunk);
+
+   /* compute where each chunk goes in the model arrays */
+   for (i = 0; i < numchunks; i++) {
+      chunk = &chunks[i];
+      chunk->vertexoffset   = model->numvertices;
+      chunk->normaloffset   = model->numnormals;
+      chunk->texcoordoffset = model->numtexcoords;
+      chunk->triangleoffset = model->numtriangles;
+      model->numvertices   += chunk->numvertices;
+      model->numnormals    += chunk->numnormals;
+      model->numtexcoords  += chunk->numtexcoords;
+      model->numtriangles  += chunk->numtriangles;
+   }
+
+   if (numchunks == 1) {
+      /* just take over the arrays */
+      chunk = &chunks[0];
+      model->vertices  = chunk->vertices;
+      model->normals   = chunk->normals;
+      model->texcoords = chunk->texcoords;
+      model->triangles = chunk->triangles;
+   } else {
+      model->vertices = (float*)malloc(sizeof(float) *
+                                       3 * (model->numvertices + 1));
+      if (model->numnormals) {
+         model->normals = (float*)malloc(sizeof(float) *
+                                         3 * (model->numnormals + 1));
+      }
+      if (model->numtexcoords) {
+         model->texcoords = (float*)malloc(sizeof(float) *
+                                           2 * (model->numtexcoords + 1));
+      }
+      model->triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) *
+                                              model->numtriangles);
+      _glmRunThreads(chunks, numchunks, sizeof(_GLMchunk), _glmCopyChunk);
+   }
+
+   /* make a default group */
+   group = _glmAddGroup(model, "default");
+   material = 0;
+
+   /* replay the group and material statements in order */
+   triangle = 0;
+   for (i = 0; i < numchunks; i++) {
+      chunk = &chunks[i];
+      for (j = 0; j < chunk->numops; j++) {
+         _GLMop* op = &chunk->ops[j];
+
+         switch (op->kind) {
+         case GLM_OP_FACES:
+            for (k = 0; k < op->numtriangles; k++) {
+               group->triangles = _glmGrow(group->triangles,
+                                           group->numtriangles, sizeof(uint));
+               group->triangles[group->numtriangles++] = triangle++;
+            }
+            break;
+         case GLM_OP_GROUP:
+            group = _glmAddGroup(model, op->name);
+            group->material = material;
+            break;
+         case GLM_OP_USEMTL:
+            material = _glmFindMaterial(model, op->name);
+            if (!group->material)
+               group->material = material;
+            break;
+         case GLM_OP_MTLLIB:
+            free(model->mtllibname);
+            model->mtllibname = stralloc(op->name);
+            _glmReadMTL(model, op->name);
+            break;
+         }
+         free(op->name);
+      }
+      free(chunk->ops);
+   }
+   free(chunks);
+
+   /* trim the arrays to their final size */
+   model->vertices = (float*)realloc(model->vertices, sizeof(float) *
+                                     3 * (model->numvertices + 1));
+   model->triangles = (GLMtriangle*)realloc(model->triangles,
+                                            sizeof(GLMtriangle) *
+                                            (model->numtriangles ?
+                                             model->numtriangles : 1));
+   if (model->numnormals) {
+      model->normals = (float*)realloc(model->normals, sizeof(float) *
+                                       3 * (model->numnormals + 1));
+   }
+   if (model->numtexcoords) {
+      model->texcoords = (float*)realloc(model->texcoords, sizeof(float) *
+                                         2 * (model->numtexcoords + 1));
+   }
+   for (group = model->groups; group; group = group->next) {
+      if (group->numtriangles) {
+         group->triangles = (uint*)realloc(group->triangles,
+                                           sizeof(uint) * group->numtriangles);
+      }
+   }
+}
+
+/* _glmNumCPUs: number of CPUs available for threaded work
+ */
+static uint
+_glmNumCPUs(void)
+{
+#if defined(_SC_NPROCESSORS_ONLN)
+   long n = sysconf(_SC_NPROCESSORS_ONLN);
+   return n > 0 ? (uint)n : 1;
+#else
+   return 1;
+#endif
+}
+
+
+
+
+/* public functions */
+
+/* glmUnitize: "unitize" a model by translating it to the origin and
+ * scaling it to fit in a unit cube around the origin.  Returns the
+ * scalefactor used.
+ *
+ * model - properly initialized GLMmodel structure
  */
 float
 glmUnitize(GLMmodel* model)
@@ -834,6 +1440,8 @@ glmUnitize(GLMmodel* model)
    assert(model);
    assert(model->vertices);
 
+   _glmDropVertexData(model);
+
    /* get the max/mins */
    maxx = minx = model->vertices[3 + X];
    maxy = miny = model->vertices[3 + Y];
@@ -934,6 +1542,8 @@ glmScale(GLMmodel* model, float scale)
 {
    uint i;
 
+   _glmDropVertexData(model);
+
    for (i = 1; i <= model->numvertices; i++) {
       model->vertices[3 * i + X] *= scale;
       model->vertices[3 * i + Y] *= scale;
@@ -954,6 +1564,8 @@ glmReverseWinding(GLMmodel* model)
 
    assert(model);
 
+   _glmDropVertexData(model);
+
    for (i = 0; i < model->numtriangles; i++) {
       swap = T(i).vindices[0];
       T(i).vindices[0] = T(i).vindices[2];
@@ -1005,7 +1617,7 @@ glmFacetNormals(GLMmodel* model)
 
    /* clobber any old facetnormals */
    if (model->facetnorms)
-      free(model->facetnorms);
+      _glmFree(model, model->facetnorms);
 
    /* allocate memory for the new facet normals */
    model->numfacetnorms = model->numtriangles;
@@ -1034,6 +1646,111 @@ glmFacetNormals(GLMmodel* model)
    }
 }
 
+/* _glmSmoothVertices: compute the smooth normals of a range of
+ * vertices for glmVertexNormals().  In the first pass only the number
+ * of normals each vertex needs is counted, in the second pass the
+ * normals are written starting at each vertex' offset and the normal
+ * indices of the triangles are set.
+ *
+ * arg - _GLMsmoothing with the range of vertices
+ */
+static void*
+_glmSmoothVertices(void* arg)
+{
+   _GLMsmoothing* job = (_GLMsmoothing*)arg;
+   GLMmodel*      model = job->model;
+   const uint*    adjacency = job->adjacency;
+   const uint*    start = job->start;
+   const float*   facetnorms = model->facetnorms;
+   float*         normals = model->normals;
+   float          average[3];
+   const float*   first;
+   const float*   facet;
+   uint           i, k, numnormals, avg;
+
+   for (i = job->begin; i < job->end; i++) {
+      if (start[i] == start[i + 1]) {
+         job->lonely++;
+         continue;
+      }
+
+      /* only average if the dot product of the angle between the two
+         facet normals is greater than the cosine of the threshold
+         angle -- or, said another way, the angle between the two
+         facet normals is less than (or equal to) the threshold angle */
+      first = &facetnorms[3 * T(adjacency[start[i]]).findex];
+
+      if (!job->offsets) {
+         /* count: one averaged normal (if any), plus one facet normal
+            for each triangle that wasn't averaged */
+         avg = 0;
+         numnormals = 0;
+         for (k = start[i]; k < start[i + 1]; k++) {
+            facet = &facetnorms[3 * T(adjacency[k]).findex];
+            if (_glmDot((float*)facet, (float*)first) > job->cos_angle)
+               avg = 1;
+            else
+               numnormals++;
+         }
+         job->counts[i] = numnormals + avg;
+         continue;
+      }
+
+      /* calculate an average normal for this vertex by averaging the
+         facet normal of every triangle this vertex is in */
+      average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
+      avg = 0;
+      for (k = start[i]; k < start[i + 1]; k++) {
+         facet = &facetnorms[3 * T(adjacency[k]).findex];
+         if (_glmDot((float*)facet, (float*)first) > job->cos_angle) {
+            average[0] += facet[0];
+            average[1] += facet[1];
+            average[2] += facet[2];
+            avg = 1;   /* we averaged at least one normal! */
+         }
+      }
+
+      numnormals = job->offsets[i];
+      if (avg) {
+         /* normalize the averaged normal */
+         _glmNormalize(average);
+
+         /* add the normal to the vertex normals list */
+         normals[3 * numnormals + 0] = average[0];
+         normals[3 * numnormals + 1] = average[1];
+         normals[3 * numnormals + 2] = average[2];
+         avg = numnormals;
+         numnormals++;
+      }
+
+      /* set the normal of this vertex in each triangle it is in */
+      for (k = start[i]; k < start[i + 1]; k++) {
+         GLMtriangle* t = &T(adjacency[k]);
+         uint n;
+
+         facet = &facetnorms[3 * t->findex];
+         if (_glmDot((float*)facet, (float*)first) > job->cos_angle) {
+            /* if this triangle was averaged, use the average normal */
+            n = avg;
+         } else {
+            /* if this triangle wasn't averaged, use the facet normal */
+            normals[3 * numnormals + 0] = facet[0];
+            normals[3 * numnormals + 1] = facet[1];
+            normals[3 * numnormals + 2] = facet[2];
+            n = numnormals++;
+         }
+         if (t->vindices[0] == i)
+            t->nindices[0] = n;
+         else if (t->vindices[1] == i)
+            t->nindices[1] = n;
+         else if (t->vindices[2] == i)
+            t->nindices[2] = n;
+      }
+   }
+
+   return NULL;
+}
+
 /* glmVertexNormals: Generates smooth vertex normals for a model.
  * First builds a list of all the triangles each vertex is in.  Then
  * loops through each vertex in the list averaging all the facet
@@ -1047,156 +1764,119 @@ glmFacetNormals(GLMmodel* model)
  * the facet normal.  This tends to preserve hard edges.  The angle to
  * use depends on the model, but 90 degrees is usually a good start.
  *
+ * The lists are kept in one compressed (CSR) array, built with a
+ * counting pass and a prefix sum, and the vertices are processed on
+ * several threads: once to count the normals each vertex generates,
+ * and, after a prefix sum of the counts, once more to write them.
+ *
  * model - initialized GLMmodel structure
  * angle - maximum angle (in degrees) to smooth across
  */
 void
 glmVertexNormals(GLMmodel* model, float angle)
 {
-   GLMnode*  node;
-   GLMnode*  tail;
-   GLMnode** members;
-   float*  normals;
-   uint    numnormals;
-   float   average[3];
-   float   dot, cos_angle;
-   uint    i, avg;
+   glmVertexNormalsThreaded(model, angle, 0);
+}
+
+/* glmVertexNormalsThreaded: Generates smooth vertex normals like
+ * glmVertexNormals(), with a given number of threads.
+ *
+ * model      - initialized GLMmodel structure
+ * angle      - maximum angle (in degrees) to smooth across
+ * numthreads - number of threads to use, 0 for one per CPU
+ */
+void
+glmVertexNormalsThreaded(GLMmodel* model, float angle, uint numthreads)
+{
+   _GLMsmoothing* jobs;
+   uint*   adjacency;
+   uint*   start;
+   uint*   counts;
+   uint    numjobs, numnormals, lonely;
+   float   cos_angle;
+   uint    i, j, v;
 
    assert(model);
    assert(model->facetnorms);
 
+   _glmDropVertexData(model);
+
    /* calculate the cosine of the angle (in degrees) */
    cos_angle = cos(angle * M_PI / 180.0);
 
    /* nuke any previous normals */
    if (model->normals)
-      free(model->normals);
-
-   /* allocate space for new normals */
-   model->numnormals = model->numtriangles * 3; /* 3 normals per triangle */
-   model->normals = (float*)malloc(sizeof(float)* 3* (model->numnormals+1));
-
-   /* allocate a structure that will hold a linked list of triangle
-      indices for each vertex */
-   members = (GLMnode**)malloc(sizeof(GLMnode*) * (model->numvertices + 1));
-   for (i = 1; i <= model->numvertices; i++)
-      members[i] = NULL;
-
-   /* for every triangle, create a node for each vertex in it */
+      _glmFree(model, model->normals);
+   model->normals = NULL;
+
+   /* build the list of triangles each vertex is in: count them,
+      turn the counts into offsets, then fill the lists in from the
+      back, so that each list is in the same (most recent triangle
+      first) order as the linked lists this used to build */
+   start = (uint*)calloc(model->numvertices + 2, sizeof(uint));
    for (i = 0; i < model->numtriangles; i++) {
-      node = (GLMnode*)malloc(sizeof(GLMnode));
-      node->index = i;
-      node->next  = members[T(i).vindices[0]];
-      members[T(i).vindices[0]] = node;
-
-      node = (GLMnode*)malloc(sizeof(GLMnode));
-      node->index = i;
-      node->next  = members[T(i).vindices[1]];
-      members[T(i).vindices[1]] = node;
-
-      node = (GLMnode*)malloc(sizeof(GLMnode));
-      node->index = i;
-      node->next  = members[T(i).vindices[2]];
-      members[T(i).vindices[2]] = node;
+      start[T(i).vindices[0] + 1]++;
+      start[T(i).vindices[1] + 1]++;
+      start[T(i).vindices[2] + 1]++;
    }
+   for (v = 1; v <= model->numvertices + 1; v++)
+      start[v] += start[v - 1];
 
-   /* calculate the average normal for each vertex */
-   numnormals = 1;
-   for (i = 1; i <= model->numvertices; i++) {
-      /* calculate an average normal for this vertex by averaging the
-         facet normal of every triangle this vertex is in */
-      node = members[i];
-      if (!node)
-         fprintf(stderr, "glmVertexNormals(): vertex w/o a triangle\n");
-      average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
-      avg = 0;
-      while (node) {
-         /* only average if the dot product of the angle between the two
-            facet normals is greater than the cosine of the threshold
-            angle -- or, said another way, the angle between the two
-            facet normals is less than (or equal to) the threshold angle */
-         dot = _glmDot(&model->facetnorms[3 * T(node->index).findex],
-                       &model->facetnorms[3 * T(members[i]->index).findex]);
-         if (dot > cos_angle) {
-            node->averaged = TRUE;
-            average[0] += model->facetnorms[3 * T(node->index).findex + 0];
-            average[1] += model->facetnorms[3 * T(node->index).findex + 1];
-            average[2] += model->facetnorms[3 * T(node->index).findex + 2];
-            avg = 1;   /* we averaged at least one normal! */
-         } else {
-            node->averaged = FALSE;
-         }
-         node = node->next;
-      }
+   adjacency = (uint*)malloc(sizeof(uint) * 3 * (model->numtriangles + 1));
+   counts = (uint*)malloc(sizeof(uint) * (model->numvertices + 1));
+   for (v = 0; v <= model->numvertices; v++)
+      counts[v] = start[v + 1];
+   for (i = 0; i < model->numtriangles; i++) {
+      for (j = 0; j < 3; j++)
+         adjacency[--counts[T(i).vindices[j]]] = i;
+   }
 
-      if (avg) {
-         /* normalize the averaged normal */
-         _glmNormalize(average);
+   /* split the vertices between the threads */
+   numjobs = numthreads ? numthreads : _glmNumCPUs();
+   if (model->numvertices / numjobs < GLM_MIN_SMOOTHING_VERTICES)
+      numjobs = model->numvertices / GLM_MIN_SMOOTHING_VERTICES + 1;
+   jobs = (_GLMsmoothing*)calloc(numjobs, sizeof(_GLMsmoothing));
+   for (j = 0; j < numjobs; j++) {
+      jobs[j].model     = model;
+      jobs[j].adjacency = adjacency;
+      jobs[j].start     = start;
+      jobs[j].counts    = counts;
+      jobs[j].cos_angle = cos_angle;
+      jobs[j].begin     = 1 + (uint)((uint64_t)model->numvertices * j / numjobs);
+      jobs[j].end       = 1 + (uint)((uint64_t)model->numvertices * (j + 1) / numjobs);
+   }
 
-         /* add the normal to the vertex normals list */
-         model->normals[3 * numnormals + 0] = average[0];
-         model->normals[3 * numnormals + 1] = average[1];
-         model->normals[3 * numnormals + 2] = average[2];
-         avg = numnormals;
-         numnormals++;
-      }
+   /* count the normals of every vertex */
+   for (v = 0; v <= model->numvertices; v++)
+      counts[v] = 0;
+   _glmRunThreads(jobs, numjobs, sizeof(_GLMsmoothing), _glmSmoothVertices);
 
-      /* set the normal of this vertex in each triangle it is in */
-      node = members[i];
-      while (node) {
-         if (node->averaged) {
-            /* if this node was averaged, use the average normal */
-            if (T(node->index).vindices[0] == i)
-               T(node->index).nindices[0] = avg;
-            else if (T(node->index).vindices[1] == i)
-               T(node->index).nindices[1] = avg;
-            else if (T(node->index).vindices[2] == i)
-               T(node->index).nindices[2] = avg;
-         } else {
-            /* if this node wasn't averaged, use the facet normal */
-            model->normals[3 * numnormals + 0] =
-               model->facetnorms[3 * T(node->index).findex + 0];
-            model->normals[3 * numnormals + 1] =
-               model->facetnorms[3 * T(node->index).findex + 1];
-            model->normals[3 * numnormals + 2] =
-               model->facetnorms[3 * T(node->index).findex + 2];
-            if (T(node->index).vindices[0] == i)
-               T(node->index).nindices[0] = numnormals;
-            else if (T(node->index).vindices[1] == i)
-               T(node->index).nindices[1] = numnormals;
-            else if (T(node->index).vindices[2] == i)
-               T(node->index).nindices[2] = numnormals;
-            numnormals++;
-         }
-         node = node->next;
-      }
+   /* turn the counts into offsets into the normals array */
+   numnormals = 1;
+   for (v = 1; v <= model->numvertices; v++) {
+      uint n = counts[v];
+      counts[v] = numnormals;
+      numnormals += n;
    }
 
+   /* allocate space for the normals and compute them */
    model->numnormals = numnormals - 1;
-
-   /* free the member information */
-   for (i = 1; i <= model->numvertices; i++) {
-      node = members[i];
-      while (node) {
-         tail = node;
-         node = node->next;
-         free(tail);
-      }
+   model->normals = (float*)malloc(sizeof(float) * 3 * (model->numnormals + 1));
+   lonely = 0;
+   for (j = 0; j < numjobs; j++) {
+      lonely += jobs[j].lonely;
+      jobs[j].lonely = 0;
+      jobs[j].offsets = counts;
    }
-   free(members);
+   _glmRunThreads(jobs, numjobs, sizeof(_GLMsmoothing), _glmSmoothVertices);
 
-   /* pack the normals array (we previously allocated the maximum
-      number of normals that could possibly be created (numtriangles *
-      3), so get rid of some of them (usually alot unless none of the
-      facet normals were averaged)) */
-   normals = model->normals;
-   model->normals = (float*)malloc(sizeof(float)* 3* (model->numnormals+1));
-   for (i = 1; i <= model->numnormals; i++) {
-      model->normals[3 * i + 0] = normals[3 * i + 0];
-      model->normals[3 * i + 1] = normals[3 * i + 1];
-      model->normals[3 * i + 2] = normals[3 * i + 2];
-   }
-   free(normals);
+   if (lonely)
+      fprintf(stderr, "glmVertexNormals(): %u vertices w/o a triangle\n", lonely);
+
+   free(jobs);
+   free(counts);
+   free(adjacency);
+   free(start);
 
    printf("glmVertexNormals(): %d normals generated\n", model->numnormals);
 }
@@ -1218,8 +1898,10 @@ glmLinearTexture(GLMmodel* model)
 
    assert(model);
 
+   _glmDropVertexData(model);
+
    if (model->texcoords)
-      free(model->texcoords);
+      _glmFree(model, model->texcoords);
    model->numtexcoords = model->numvertices;
    model->texcoords=(float*)malloc(sizeof(float)*2*(model->numtexcoords+1));
 
@@ -1273,8 +1955,10 @@ glmSpheremapTexture(GLMmodel* model)
    assert(model);
    assert(model->normals);
 
+   _glmDropVertexData(model);
+
    if (model->texcoords)
-      free(model->texcoords);
+      _glmFree(model, model->texcoords);
    model->numtexcoords = model->numnormals;
    model->texcoords=(float*)malloc(sizeof(float)*2*(model->numtexcoords+1));
 
@@ -1343,23 +2027,30 @@ glmDelete(GLMmodel* model)
 
    if (model->pathname)   free(model->pathname);
    if (model->mtllibname) free(model->mtllibname);
-   if (model->vertices)   free(model->vertices);
-   if (model->normals)    free(model->normals);
-   if (model->texcoords)  free(model->texcoords);
-   if (model->facetnorms) free(model->facetnorms);
-   if (model->triangles)  free(model->triangles);
+   if (model->vertices)   _glmFree(model, model->vertices);
+   if (model->normals)    _glmFree(model, model->normals);
+   if (model->texcoords)  _glmFree(model, model->texcoords);
+   if (model->facetnorms) _glmFree(model, model->facetnorms);
+   if (model->triangles)  _glmFree(model, model->triangles);
+   if (model->vertexdata) _glmFree(model, model->vertexdata);
    if (model->materials) {
-      for (i = 0; i < model->nummaterials; i++)
+      for (i = 0; i < model->nummaterials; i++) {
          free(model->materials[i].name);
+         free(model->materials[i].map_kd);
+      }
    }
    free(model->materials);
    while(model->groups) {
       group = model->groups;
       model->groups = model->groups->next;
       free(group->name);
-      free(group->triangles);
+      _glmFree(model, group->triangles);
+      _glmFree(model, group->triIndexes);
+      free(group->clusters);
       free(group);
    }
+   if (model->mapping)
+      _glmUnmapFile(model->mapping, model->mappingsize);
 
    free(model);
 }
@@ -1393,13 +2084,31 @@ glmDefaultMaterial(void)
  */
 GLMmodel*
 glmReadOBJ(char* filename)
+{
+   return glmReadOBJThreaded(filename, 1);
+}
+
+/* glmReadOBJThreaded: Reads a model description from a Wavefront .OBJ
+ * file, splitting it into chunks that are parsed on several threads.
+ * Returns a pointer to the created object which should be free'd with
+ * glmDelete().
+ *
+ * filename   - name of the file containing the Wavefront .OBJ format data.
+ * numthreads - number of threads to use, 0 for one per CPU
+ */
+GLMmodel*
+glmReadOBJThreaded(char* filename, uint numthreads)
 {
    GLMmodel* model;
-   FILE*     file;
+   char*     data;
+   size_t    size;
+   double    t0, t1;
 
-   /* open the file */
-   file = fopen(filename, "r");
-   if (!file) {
+   t0 = _glmNow();
+
+   /* map the file */
+   data = _glmMapFile(filename, &size);
+   if (!data) {
       fprintf(stderr, "glmReadOBJ() failed: can't open data file \"%s\".\n",
               filename);
       exit(1);
@@ -1411,7 +2120,7 @@ glmReadOBJ(char* filename)
 #endif
 
    /* allocate a new model */
-   model = (GLMmodel*)malloc(sizeof(GLMmodel));
+   model = (GLMmodel*)calloc(1, sizeof(GLMmodel));
    model->pathname      = stralloc(filename);
    model->mtllibname    = NULL;
    model->numvertices   = 0;
@@ -1433,37 +2142,24 @@ glmReadOBJ(char* filename)
    model->position[2]   = 0.0;
    model->scale         = 1.0;
 
-   /* make a first pass through the file to get a count of the number
-      of vertices, normals, texcoords & triangles */
-   _glmFirstPass(model, file);
-
-   /* allocate memory */
-   model->vertices = (float*)malloc(sizeof(float) *
-                                    3 * (model->numvertices + 1));
-   model->triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) *
-                                           model->numtriangles);
-   if (model->numnormals) {
-      model->normals = (float*)malloc(sizeof(float) *
-                                      3 * (model->numnormals + 1));
-   }
-   if (model->numtexcoords) {
-      model->texcoords = (float*)malloc(sizeof(float) *
-                                        2 * (model->numtexcoords + 1));
-   }
-
-   /* rewind to beginning of file and read in the data this pass */
-   rewind(file);
+   if (!numthreads)
+      numthreads = _glmNumCPUs();
 
-   _glmSecondPass(model, file);
+   /* read in all the data in one pass */
+   _glmParseOBJ(model, data, size, numthreads);
 
-   /* close the file */
-   fclose(file);
+   _glmUnmapFile(data, size);
 
    if (!model->materials) {
       model->materials = glmDefaultMaterial();
       model->nummaterials = 1;
    }
 
+   t1 = _glmNow();
+   printf("glmReadOBJ(): %u vertices, %u triangles in %.3f sec (%.1f MB/sec)\n",
+          model->numvertices, model->numtriangles, t1 - t0,
+          t1 > t0 ? size / (t1 - t0) / 1e6 : 0.0);
+
    return model;
 }
 
@@ -1645,75 +2341,505 @@ glmWriteOBJ(GLMmodel* model, char* filename, uint mode)
    fclose(file);
 }
 
-/* glmWeld: eliminate (weld) vectors that are within an epsilon of
- * each other.
+/* _glmWriteAligned: write a block of data to a binary model file,
+ * padded to start on a GLM_BINARY_ALIGN boundary.  Returns the offset
+ * of the data in the file, or 0 if there is no data.
  *
- * model      - initialized GLMmodel structure
- * epsilon    - maximum difference between vertices
- *              ( 0.00001 is a good start for a unitized model)
+ * file  - (fopen'd) file descriptor
+ * pos   - current offset in the file, updated
+ * data  - data to write
+ * bytes - size of the data in bytes
+ */
+static uint64_t
+_glmWriteAligned(FILE* file, uint64_t* pos, const void* data, size_t bytes)
+{
+   static const char zeros[GLM_BINARY_ALIGN];
+   uint64_t offset;
+   size_t   pad;
+
+   if (!data || !bytes)
+      return 0;
+
+   pad = (GLM_BINARY_ALIGN - *pos % GLM_BINARY_ALIGN) % GLM_BINARY_ALIGN;
+   fwrite(zeros, 1, pad, file);
+   offset = *pos + pad;
+   fwrite(data, 1, bytes, file);
+   *pos = offset + bytes;
+
+   return offset;
+}
+
+/* _glmWriteString: write a NUL terminated string to a binary model
+ * file.  Returns its offset, or 0 for a NULL string.
+ */
+static uint64_t
+_glmWriteString(FILE* file, uint64_t* pos, const char* string)
+{
+   return string ? _glmWriteAligned(file, pos, string, strlen(string) + 1) : 0;
+}
+
+/* glmWriteBinary: Writes a model to a file in the GLM binary format.
+ * Returns 1 on success, 0 on failure.
  *
+ * model    - initialized GLMmodel structure
+ * filename - name of the file to write the binary data to
  */
-void
-glmWeld(GLMmodel* model, float epsilon)
+int
+glmWriteBinary(GLMmodel* model, char* filename)
 {
-   float* vectors;
-   float* copies;
-   uint   numvectors;
-   uint   i;
+   _GLMbinaryHeader    header;
+   _GLMbinaryMaterial* materials;
+   _GLMbinaryGroup*    groups;
+   GLMgroup*           group;
+   FILE*               file;
+   void*               vertexdata;
+   uint64_t            pos;
+   uint                bytes, i;
+   int                 ok;
 
-   /* vertices */
-   numvectors = model->numvertices;
-   vectors    = model->vertices;
-   copies = _glmWeldVectors(vectors, &numvectors, epsilon);
+   assert(model);
 
-   printf("glmWeld(): %d redundant vertices.\n",
-          model->numvertices - numvectors - 1);
+   file = fopen(filename, "wb");
+   if (!file) {
+      fprintf(stderr, "glmWriteBinary() failed: can't open file \"%s\" to write.\n",
+              filename);
+      return 0;
+   }
 
-   for (i = 0; i < model->numtriangles; i++) {
-      T(i).vindices[0] = (uint)vectors[3 * T(i).vindices[0] + 0];
-      T(i).vindices[1] = (uint)vectors[3 * T(i).vindices[1] + 0];
-      T(i).vindices[2] = (uint)vectors[3 * T(i).vindices[2] + 0];
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, GLM_BINARY_MAGIC, sizeof(header.magic));
+   header.version       = GLM_BINARY_VERSION;
+   header.byteorder     = GLM_BINARY_BYTEORDER;
+   header.headersize    = sizeof(_GLMbinaryHeader);
+   header.trianglesize  = sizeof(GLMtriangle);
+   header.numvertices   = model->numvertices;
+   header.numnormals    = model->numnormals;
+   header.numtexcoords  = model->numtexcoords;
+   header.numfacetnorms = model->numfacetnorms;
+   header.numtriangles  = model->numtriangles;
+   header.nummaterials  = model->nummaterials;
+   header.numgroups     = model->numgroups;
+   header.position[0]   = model->position[0];
+   header.position[1]   = model->position[1];
+   header.position[2]   = model->position[2];
+   header.scale         = model->scale;
+
+   /* header goes first, but is only complete at the end */
+   fwrite(&header, 1, sizeof(header), file);
+   pos = sizeof(header);
+
+   header.pathname   = _glmWriteString(file, &pos, model->pathname);
+   header.mtllibname = _glmWriteString(file, &pos, model->mtllibname);
+
+   if (model->vertices) {
+      header.vertices = _glmWriteAligned(file, &pos, model->vertices,
+                                         sizeof(float) * 3 * (model->numvertices + 1));
+   }
+   if (model->normals && model->numnormals) {
+      header.normals = _glmWriteAligned(file, &pos, model->normals,
+                                        sizeof(float) * 3 * (model->numnormals + 1));
+   }
+   if (model->texcoords && model->numtexcoords) {
+      header.texcoords = _glmWriteAligned(file, &pos, model->texcoords,
+                                          sizeof(float) * 2 * (model->numtexcoords + 1));
    }
+   if (model->facetnorms && model->numfacetnorms) {
+      header.facetnorms = _glmWriteAligned(file, &pos, model->facetnorms,
+                                           sizeof(float) * 3 * (model->numfacetnorms + 1));
+   }
+   header.triangles = _glmWriteAligned(file, &pos, model->triangles,
+                                       sizeof(GLMtriangle) * model->numtriangles);
 
-   /* free space for old vertices */
-   free(vectors);
+   /* materials */
+   materials = (_GLMbinaryMaterial*)calloc(model->nummaterials + 1,
+                                           sizeof(_GLMbinaryMaterial));
+   for (i = 0; i < model->nummaterials; i++) {
+      GLMmaterial* mat = &model->materials[i];
+      materials[i].name   = _glmWriteString(file, &pos, mat->name);
+      materials[i].map_kd = _glmWriteString(file, &pos, mat->map_kd);
+      memcpy(materials[i].diffuse, mat->diffuse, sizeof(mat->diffuse));
+      memcpy(materials[i].ambient, mat->ambient, sizeof(mat->ambient));
+      memcpy(materials[i].specular, mat->specular, sizeof(mat->specular));
+      memcpy(materials[i].emmissive, mat->emmissive, sizeof(mat->emmissive));
+      materials[i].shininess = mat->shininess;
+   }
+   header.materials = _glmWriteAligned(file, &pos, materials,
+                                       sizeof(_GLMbinaryMaterial) *
+                                       model->nummaterials);
+   free(materials);
+
+   /* groups, in list order, with the element indexes of all groups
+      back to back so that they can go into the index VBO in one go */
+   groups = (_GLMbinaryGroup*)calloc(model->numgroups + 1,
+                                     sizeof(_GLMbinaryGroup));
+   for (group = model->groups, i = 0; group; group = group->next, i++) {
+      groups[i].name         = _glmWriteString(file, &pos, group->name);
+      groups[i].triangles    = _glmWriteAligned(file, &pos, group->triangles,
+                                                sizeof(uint) * group->numtriangles);
+      groups[i].numtriangles = group->numtriangles;
+      groups[i].material     = group->material;
+      groups[i].minIndex     = group->minIndex;
+      groups[i].maxIndex     = group->maxIndex;
+   }
+   for (group = model->groups, i = 0; group; group = group->next, i++) {
+      if (group->triIndexes && group->numtriangles) {
+         if (!header.indexdata) {
+            header.indexdata = _glmWriteAligned(file, &pos, group->triIndexes,
+                                                sizeof(uint) * 3 * group->numtriangles);
+            groups[i].triIndexes = header.indexdata;
+         } else {
+            /* no padding, uints are aligned already */
+            groups[i].triIndexes = pos;
+            fwrite(group->triIndexes, sizeof(uint), 3 * group->numtriangles, file);
+            pos += sizeof(uint) * 3 * group->numtriangles;
+         }
+      }
+   }
+   header.groups = _glmWriteAligned(file, &pos, groups,
+                                    sizeof(_GLMbinaryGroup) * model->numgroups);
+   free(groups);
+
+   /* interleaved vertex data for glmMakeVBOs() */
+   if (model->numtriangles && (!model->numnormals ||
+                               model->numnormals == model->numvertices) &&
+       (!model->numtexcoords || model->numtexcoords == model->numvertices)) {
+      if (model->vertexdata) {
+         vertexdata = model->vertexdata;
+         bytes = (model->numvertices + 1) * model->vertexSize;
+      } else {
+         vertexdata = glmInterleave(model, &bytes);
+      }
+      header.vertexdata     = _glmWriteAligned(file, &pos, vertexdata, bytes);
+      header.vertexdatasize = bytes;
+      header.vertexSize     = model->vertexSize;
+      header.posOffset      = model->posOffset;
+      header.normOffset     = model->normOffset;
+      header.texOffset      = model->texOffset;
+      header.vertexFormat   = model->vertexFormat;
+      header.posScale       = model->posScale;
+      memcpy(header.posBias, model->posBias, sizeof(header.posBias));
+      if (vertexdata != model->vertexdata)
+         free(vertexdata);
+   }
 
-   /* allocate space for the new vertices */
-   model->numvertices = numvectors;
-   model->vertices = (float*)malloc(sizeof(float) *
-                                    3 * (model->numvertices + 1));
+   header.filesize = pos;
+   rewind(file);
+   fwrite(&header, 1, sizeof(header), file);
 
-   /* copy the optimized vertices into the actual vertex list */
-   for (i = 1; i <= model->numvertices; i++) {
-      model->vertices[3 * i + 0] = copies[3 * i + 0];
-      model->vertices[3 * i + 1] = copies[3 * i + 1];
-      model->vertices[3 * i + 2] = copies[3 * i + 2];
+   ok = !ferror(file);
+   if (fclose(file) != 0)
+      ok = 0;
+   if (!ok) {
+      fprintf(stderr, "glmWriteBinary() failed: error writing \"%s\".\n",
+              filename);
+      remove(filename);
    }
-
-   free(copies);
+   return ok;
 }
 
+/* _glmBinaryArray: returns a pointer to an array in a binary model
+ * file, or NULL if the array is missing or doesn't fit in the file.
+ */
+static void*
+_glmBinaryArray(char* data, uint64_t size, uint64_t offset, uint64_t bytes)
+{
+   if (!offset || offset > size || bytes > size - offset)
+      return NULL;
+   return data + offset;
+}
 
-void
-glmReIndex(GLMmodel *model)
+/* _glmBinaryString: returns a copy of a string in a binary model
+ * file, or NULL if the string is missing or not properly terminated.
+ */
+static char*
+_glmBinaryString(char* data, uint64_t size, uint64_t offset)
 {
-   uint i, j, n;
-   GLMgroup* group;
-   float *newNormals = NULL;
-   float *newTexcoords = NULL;
-   const uint numv = model->numvertices;
+   if (!offset || offset >= size || !memchr(data + offset, '\0', size - offset))
+      return NULL;
+   return stralloc(data + offset);
+}
 
-   if (model->numnormals > 0)
-      newNormals = (float *) malloc((numv + 1) * 3 * sizeof(float));
+/* glmReadBinary: Reads a model written with glmWriteBinary().
+ * Returns a pointer to the created object which should be free'd with
+ * glmDelete(), or NULL on failure.
+ *
+ * filename - name of the file containing the binary data.
+ */
+GLMmodel*
+glmReadBinary(char* filename)
+{
+   GLMmodel*           model;
+   _GLMbinaryHeader*   header;
+   _GLMbinaryMaterial* materials;
+   _GLMbinaryGroup*    groups;
+   GLMgroup*           group;
+   GLMgroup**          tail;
+   char*               data;
+   size_t              size;
+   uint                i;
+   double              t0, t1;
+
+   t0 = _glmNow();
+
+   data = _glmMapFile(filename, &size);
+   if (!data)
+      return NULL;
 
-   if (model->numtexcoords > 0)
-      newTexcoords = (float *) malloc((numv + 1) * 2 * sizeof(float));
+   header = (_GLMbinaryHeader*)data;
+   if (size < sizeof(_GLMbinaryHeader) ||
+       memcmp(header->magic, GLM_BINARY_MAGIC, sizeof(header->magic)) ||
+       header->version != GLM_BINARY_VERSION ||
+       header->byteorder != GLM_BINARY_BYTEORDER ||
+       header->headersize != sizeof(_GLMbinaryHeader) ||
+       header->trianglesize != sizeof(GLMtriangle) ||
+       header->filesize != size) {
+      fprintf(stderr, "glmReadBinary(): \"%s\" is not a compatible binary model.\n",
+              filename);
+      _glmUnmapFile(data, size);
+      return NULL;
+   }
 
-   for (group = model->groups; group; group = group->next) {
+   /* allocate a new model, pointing into the mapping */
+   model = (GLMmodel*)calloc(1, sizeof(GLMmodel));
+   model->mapping       = data;
+   model->mappingsize   = size;
+   model->pathname      = _glmBinaryString(data, size, header->pathname);
+   model->mtllibname    = _glmBinaryString(data, size, header->mtllibname);
+   model->numvertices   = header->numvertices;
+   model->numnormals    = header->numnormals;
+   model->numtexcoords  = header->numtexcoords;
+   model->numfacetnorms = header->numfacetnorms;
+   model->numtriangles  = header->numtriangles;
+   model->position[0]   = header->position[0];
+   model->position[1]   = header->position[1];
+   model->position[2]   = header->position[2];
+   model->scale         = header->scale;
+
+   model->vertices = _glmBinaryArray(data, size, header->vertices,
+                                     sizeof(float) * 3 * ((uint64_t)model->numvertices + 1));
+   model->normals = _glmBinaryArray(data, size, header->normals,
+                                    sizeof(float) * 3 * ((uint64_t)model->numnormals + 1));
+   model->texcoords = _glmBinaryArray(data, size, header->texcoords,
+                                      sizeof(float) * 2 * ((uint64_t)model->numtexcoords + 1));
+   model->facetnorms = _glmBinaryArray(data, size, header->facetnorms,
+                                       sizeof(float) * 3 * ((uint64_t)model->numfacetnorms + 1));
+   model->triangles = _glmBinaryArray(data, size, header->triangles,
+                                      sizeof(GLMtriangle) * (uint64_t)model->numtriangles);
+   if (!model->normals)
+      model->numnormals = 0;
+   if (!model->texcoords)
+      model->numtexcoords = 0;
+   if (!model->facetnorms)
+      model->numfacetnorms = 0;
+
+   materials = _glmBinaryArray(data, size, header->materials,
+                               sizeof(_GLMbinaryMaterial) * (uint64_t)header->nummaterials);
+   groups = _glmBinaryArray(data, size, header->groups,
+                            sizeof(_GLMbinaryGroup) * (uint64_t)header->numgroups);
+   if (!model->vertices || (model->numtriangles && !model->triangles) ||
+       !materials || (header->numgroups && !groups)) {
+      fprintf(stderr, "glmReadBinary(): \"%s\" is truncated.\n", filename);
+      glmDelete(model);
+      return NULL;
+   }
 
-      n = group->numtriangles;
+   /* the materials get GL state attached, so they are copied */
+   model->nummaterials = header->nummaterials;
+   model->materials = (GLMmaterial*)calloc(model->nummaterials,
+                                           sizeof(GLMmaterial));
+   for (i = 0; i < model->nummaterials; i++) {
+      GLMmaterial* mat = &model->materials[i];
+      mat->name   = _glmBinaryString(data, size, materials[i].name);
+      mat->map_kd = _glmBinaryString(data, size, materials[i].map_kd);
+      memcpy(mat->diffuse, materials[i].diffuse, sizeof(mat->diffuse));
+      memcpy(mat->ambient, materials[i].ambient, sizeof(mat->ambient));
+      memcpy(mat->specular, materials[i].specular, sizeof(mat->specular));
+      memcpy(mat->emmissive, materials[i].emmissive, sizeof(mat->emmissive));
+      mat->shininess = materials[i].shininess;
+   }
 
-      group->triIndexes = (uint *) malloc(n * 3 * sizeof(uint));
+   /* rebuild the list of groups in the same order */
+   tail = &model->groups;
+   for (i = 0; i < header->numgroups; i++) {
+      group = (GLMgroup*)calloc(1, sizeof(GLMgroup));
+      group->name         = _glmBinaryString(data, size, groups[i].name);
+      group->numtriangles = groups[i].numtriangles;
+      group->material     = groups[i].material;
+      group->minIndex     = groups[i].minIndex;
+      group->maxIndex     = groups[i].maxIndex;
+      group->triangles    = _glmBinaryArray(data, size, groups[i].triangles,
+                                            sizeof(uint) * (uint64_t)group->numtriangles);
+      group->triIndexes   = _glmBinaryArray(data, size, groups[i].triIndexes,
+                                            sizeof(uint) * 3 * (uint64_t)group->numtriangles);
+      *tail = group;
+      tail = &group->next;
+      model->numgroups++;
+
+      if (!group->name || (group->numtriangles && !group->triangles) ||
+          group->material >= model->nummaterials) {
+         fprintf(stderr, "glmReadBinary(): \"%s\" is truncated.\n", filename);
+         glmDelete(model);
+         return NULL;
+      }
+   }
+
+   model->vertexdata = _glmBinaryArray(data, size, header->vertexdata,
+                                       header->vertexdatasize);
+   if (header->vertexdatasize !=
+       (uint64_t)(model->numvertices + 1) * header->vertexSize)
+      model->vertexdata = NULL;
+   if (model->vertexdata) {
+      model->vertexSize = header->vertexSize;
+      model->posOffset  = header->posOffset;
+      model->normOffset = header->normOffset;
+      model->texOffset  = header->texOffset;
+      model->vertexFormat = header->vertexFormat;
+      model->posScale   = header->posScale;
+      memcpy(model->posBias, header->posBias, sizeof(model->posBias));
+   }
+
+   t1 = _glmNow();
+   printf("glmReadBinary(): %u vertices, %u triangles in %.3f sec\n",
+          model->numvertices, model->numtriangles, t1 - t0);
+
+   return model;
+}
+
+/* glmWeld: eliminate (weld) vectors that are within an epsilon of
+ * each other.
+ *
+ * model      - initialized GLMmodel structure
+ * epsilon    - maximum difference between vertices
+ *              ( 0.00001 is a good start for a unitized model)
+ *
+ */
+void
+glmWeld(GLMmodel* model, float epsilon)
+{
+   glmWeldMode(model, epsilon, GLM_NONE);
+}
+
+/* glmWeldMode: eliminate (weld) vertices, and optionally normals and
+ * texture coordinates, that are within an epsilon of each other.
+ *
+ * model      - initialized GLMmodel structure
+ * epsilon    - maximum difference between vectors
+ * mode       - a bitwise OR of values describing what else is welded
+ *              GLM_NONE    -  weld only vertices
+ *              GLM_SMOOTH  -  also weld normals
+ *              GLM_TEXTURE -  also weld texture coords
+ */
+void
+glmWeldMode(GLMmodel* model, float epsilon, uint mode)
+{
+   float* copies;
+   uint*  remap;
+   uint   numvectors, total;
+   uint   i, j;
+   double t0, t1;
+
+   assert(model);
+
+   _glmDropVertexData(model);
+
+   t0 = _glmNow();
+   total = 0;
+
+   /* vertices */
+   numvectors = model->numvertices;
+   remap = (uint*)malloc(sizeof(uint) * (numvectors + 1));
+   remap[0] = 0;
+   copies = _glmWeldVectors(model->vertices, 3, &numvectors, epsilon, remap);
+
+   printf("glmWeld(): %u redundant vertices.\n",
+          model->numvertices - numvectors);
+
+   for (i = 0; i < model->numtriangles; i++) {
+      for (j = 0; j < 3; j++)
+         T(i).vindices[j] = remap[T(i).vindices[j]];
+   }
+
+   total += model->numvertices;
+   _glmFree(model, model->vertices);
+   free(remap);
+   model->numvertices = numvectors;
+   model->vertices = copies;
+
+   /* normals */
+   if ((mode & GLM_SMOOTH) && model->numnormals) {
+      numvectors = model->numnormals;
+      remap = (uint*)malloc(sizeof(uint) * (numvectors + 1));
+      remap[0] = 0;
+      copies = _glmWeldVectors(model->normals, 3, &numvectors, epsilon, remap);
+
+      printf("glmWeld(): %u redundant normals.\n",
+             model->numnormals - numvectors);
+
+      for (i = 0; i < model->numtriangles; i++) {
+         for (j = 0; j < 3; j++)
+            T(i).nindices[j] = remap[T(i).nindices[j]];
+      }
+
+      total += model->numnormals;
+      _glmFree(model, model->normals);
+      free(remap);
+      model->numnormals = numvectors;
+      model->normals = copies;
+   }
+
+   /* texcoords */
+   if ((mode & GLM_TEXTURE) && model->numtexcoords) {
+      numvectors = model->numtexcoords;
+      remap = (uint*)malloc(sizeof(uint) * (numvectors + 1));
+      remap[0] = 0;
+      copies = _glmWeldVectors(model->texcoords, 2, &numvectors, epsilon,
+                               remap);
+
+      printf("glmWeld(): %u redundant texcoords.\n",
+             model->numtexcoords - numvectors);
+
+      for (i = 0; i < model->numtriangles; i++) {
+         for (j = 0; j < 3; j++)
+            T(i).tindices[j] = remap[T(i).tindices[j]];
+      }
+
+      total += model->numtexcoords;
+      _glmFree(model, model->texcoords);
+      free(remap);
+      model->numtexcoords = numvectors;
+      model->texcoords = copies;
+   }
+
+   t1 = _glmNow();
+   printf("glmWeld(): %u vectors in %.3f sec (%.2f Mvectors/sec)\n",
+          total, t1 - t0,
+          t1 > t0 ? total / (t1 - t0) / 1e6 : 0.0);
+}
+
+
+void
+glmReIndex(GLMmodel *model)
+{
+   uint i, j, n;
+   GLMgroup* group;
+   float *newNormals = NULL;
+   float *newTexcoords = NULL;
+   const uint numv = model->numvertices;
+
+   _glmDropVertexData(model);
+
+   if (model->numnormals > 0)
+      newNormals = (float *) malloc((numv + 1) * 3 * sizeof(float));
+
+   if (model->numtexcoords > 0)
+      newTexcoords = (float *) malloc((numv + 1) * 2 * sizeof(float));
+
+   for (group = model->groups; group; group = group->next) {
+
+      n = group->numtriangles;
+
+      _glmFree(model, group->triIndexes);
+      group->triIndexes = (uint *) malloc(n * 3 * sizeof(uint));
 
       group->minIndex = 10000000;
       group->maxIndex = 0;
@@ -1752,13 +2878,13 @@ glmReIndex(GLMmodel *model)
    }
 
    if (newNormals) {
-      free(model->normals);
+      _glmFree(model, model->normals);
       model->normals = newNormals;
       model->numnormals = model->numvertices;
    }
 
    if (newTexcoords) {
-      free(model->texcoords);
+      _glmFree(model, model->texcoords);
       model->texcoords = newTexcoords;
       model->numtexcoords = model->numvertices;
    }
@@ -1766,6 +2892,781 @@ glmReIndex(GLMmodel *model)
 
 
 
+/* _glmHalf: converts a float to an IEEE half float, rounding to nearest */
+static unsigned short
+_glmHalf(float f)
+{
+   union { float f; uint32_t u; } v;
+   uint32_t sign, mant;
+   int exp;
+
+   v.f = f;
+   sign = (v.u >> 16) & 0x8000;
+   exp = (int)((v.u >> 23) & 0xff) - 127 + 15;
+   mant = v.u & 0x7fffff;
+
+   if (((v.u >> 23) & 0xff) == 0xff)             /* inf or nan */
+      return sign | 0x7c00 | (mant ? 0x200 : 0);
+   if (exp >= 31)                                 /* overflow */
+      return sign | 0x7c00;
+   if (exp <= 0) {                                /* denormal or zero */
+      uint shift;
+      if (exp < -10)
+         return sign;
+      mant |= 0x800000;
+      shift = 14 - exp;
+      return sign | ((mant >> shift) + ((mant >> (shift - 1)) & 1));
+   }
+   /* a carry out of the mantissa correctly bumps the exponent */
+   return sign | ((((uint32_t)exp << 10) | (mant >> 13)) + ((mant >> 12) & 1));
+}
+
+/* _glmPackNormal: packs a unit vector into normalized signed bytes,
+ * padded to 4 bytes */
+static void
+_glmPackNormal(const float* n, signed char* packed)
+{
+   uint i;
+
+   for (i = 0; i < 3; i++) {
+      float c = n[i] < -1.0f ? -1.0f : n[i] > 1.0f ? 1.0f : n[i];
+      packed[i] = (signed char)floor(c * 127.0f + 0.5f);
+   }
+   packed[3] = 0;
+}
+
+/* glmVertexFormat: Selects the layout glmInterleave() and
+ * glmMakeVBOs() use for the vertices of a model.
+ *
+ * model  - initialized GLMmodel structure
+ * format - a bitwise OR of GLM_PACK_POSITION, GLM_PACK_NORMAL and
+ *          GLM_PACK_TEXCOORD, or GLM_PACK_NONE
+ */
+void
+glmVertexFormat(GLMmodel* model, uint format)
+{
+   assert(model);
+
+   if (model->vertexFormat != format) {
+      /* only the interleaved data depends on the format */
+      if (model->vertexdata) {
+         _glmFree(model, model->vertexdata);
+         model->vertexdata = NULL;
+      }
+      model->vertexFormat = format;
+   }
+}
+
+/* glmInterleave: Packs the vertices, normals and texture coordinates
+ * of a model into one interleaved array, in the layout selected with
+ * glmVertexFormat().  Returns the array, which should be free'd.
+ *
+ * model - initialized GLMmodel structure, after glmReIndex()
+ * bytes - returns the size of the array in bytes
+ */
+void*
+glmInterleave(GLMmodel* model, uint* bytes)
+{
+   const uint format = model->vertexFormat;
+   uint vertexSize, posSize, normSize = 0, texSize = 0, i, j;
+   unsigned char *buffer, *vertex;
+   float min[3], max[3], extent;
+
+   posSize = (format & GLM_PACK_POSITION) ? 4 * sizeof(short) : 3 * sizeof(float);
+   model->posOffset = 0;
+   vertexSize = posSize;
+
+   if (model->numnormals > 0) {
+      assert(model->numnormals == model->numvertices);
+      normSize = (format & GLM_PACK_NORMAL) ? 4 : 3 * sizeof(float);
+      model->normOffset = vertexSize;
+      vertexSize += normSize;
+   }
+
+   if (model->numtexcoords > 0) {
+      assert(model->numtexcoords == model->numvertices);
+      texSize = (format & GLM_PACK_TEXCOORD) ? 2 * sizeof(short) : 2 * sizeof(float);
+      model->texOffset = vertexSize;
+      vertexSize += texSize;
+   }
+
+   model->vertexSize = vertexSize;
+
+   /* 16-bit positions span the bounding box; the scale is the same on
+      all axes so that normals don't need correcting */
+   model->posScale = 1.0f;
+   model->posBias[0] = model->posBias[1] = model->posBias[2] = 0.0f;
+   if (format & GLM_PACK_POSITION && model->numvertices > 0) {
+      for (j = 0; j < 3; j++)
+         min[j] = max[j] = model->vertices[3 + j];
+      for (i = 2; i <= model->numvertices; i++) {
+         for (j = 0; j < 3; j++) {
+            min[j] = _glmMin(min[j], model->vertices[3 * i + j]);
+            max[j] = _glmMax(max[j], model->vertices[3 * i + j]);
+         }
+      }
+      extent = 0.0f;
+      for (j = 0; j < 3; j++) {
+         model->posBias[j] = (min[j] + max[j]) / 2.0f;
+         extent = _glmMax(extent, (max[j] - min[j]) / 2.0f);
+      }
+      if (extent > 0.0f)
+         model->posScale = extent / 32767.0f;
+   }
+
+   /* vertex indexes are 1-based, so there's an unused vertex 0 */
+   *bytes = (model->numvertices + 1) * vertexSize;
+
+   buffer = (unsigned char *) malloc(*bytes);
+   memset(buffer, 0, vertexSize);
+   for (i = 1; i <= model->numvertices; i++) {
+      vertex = buffer + i * vertexSize;
+
+      if (format & GLM_PACK_POSITION) {
+         short pos[4];
+         for (j = 0; j < 3; j++) {
+            float q = (model->vertices[3 * i + j] - model->posBias[j]) /
+                      model->posScale;
+            q = (float)floor(q + 0.5f);
+            pos[j] = (short)(q < -32767.0f ? -32767.0f :
+                             q > 32767.0f ? 32767.0f : q);
+         }
+         pos[3] = 1;
+         memcpy(vertex, pos, posSize);
+      } else {
+         memcpy(vertex, &model->vertices[3 * i], posSize);
+      }
+      vertex += posSize;
+
+      if (model->numnormals > 0) {
+         if (format & GLM_PACK_NORMAL) {
+            _glmPackNormal(&model->normals[3 * i], (signed char*)vertex);
+         } else {
+            memcpy(vertex, &model->normals[3 * i], normSize);
+         }
+         vertex += normSize;
+      }
+
+      if (model->numtexcoords > 0) {
+         if (format & GLM_PACK_TEXCOORD) {
+            unsigned short texcoord[2];
+            texcoord[0] = _glmHalf(model->texcoords[2 * i + 0]);
+            texcoord[1] = _glmHalf(model->texcoords[2 * i + 1]);
+            memcpy(vertex, texcoord, texSize);
+         } else {
+            memcpy(vertex, &model->texcoords[2 * i], texSize);
+         }
+      }
+   }
+
+   return buffer;
+}
+
+
+/* _glmClusterBounds: computes the bounding sphere and normal cone of
+ * a cluster from the triangles it covers.
+ */
+static void
+_glmClusterBounds(GLMmodel* model, const uint* indexes, GLMcluster* cluster)
+{
+   float min[3], max[3], axis[3], u[3], v[3], n[3], d[3];
+   float radius, mindot, length;
+   uint  i, j;
+
+   for (j = 0; j < 3; j++) {
+      min[j] = max[j] = model->vertices[3 * indexes[0] + j];
+      axis[j] = 0.0f;
+   }
+   cluster->minIndex = cluster->maxIndex = indexes[0];
+   for (i = 0; i < cluster->numIndexes; i++) {
+      const float* p = &model->vertices[3 * indexes[i]];
+      for (j = 0; j < 3; j++) {
+         min[j] = _glmMin(min[j], p[j]);
+         max[j] = _glmMax(max[j], p[j]);
+      }
+      if (indexes[i] < cluster->minIndex)
+         cluster->minIndex = indexes[i];
+      if (indexes[i] > cluster->maxIndex)
+         cluster->maxIndex = indexes[i];
+   }
+
+   /* sphere around the bounding box center */
+   for (j = 0; j < 3; j++)
+      cluster->center[j] = (min[j] + max[j]) / 2.0f;
+   radius = 0.0f;
+   for (i = 0; i < cluster->numIndexes; i++) {
+      for (j = 0; j < 3; j++)
+         d[j] = model->vertices[3 * indexes[i] + j] - cluster->center[j];
+      radius = _glmMax(radius, _glmDot(d, d));
+   }
+   cluster->radius = (float)sqrt(radius);
+
+   /* normal cone, with the facet normals computed like
+      glmFacetNormals() does */
+   for (i = 0; i < cluster->numIndexes; i += 3) {
+      const float* p0 = &model->vertices[3 * indexes[i + 0]];
+      const float* p1 = &model->vertices[3 * indexes[i + 1]];
+      const float* p2 = &model->vertices[3 * indexes[i + 2]];
+      for (j = 0; j < 3; j++) {
+         u[j] = p1[j] - p0[j];
+         v[j] = p2[j] - p0[j];
+      }
+      _glmCross(u, v, n);
+      if (_glmDot(n, n) > 0.0f) {
+         _glmNormalize(n);
+         for (j = 0; j < 3; j++)
+            axis[j] += n[j];
+      }
+   }
+   length = (float)sqrt(_glmDot(axis, axis));
+   mindot = -1.0f;
+   if (length > 0.0f) {
+      for (j = 0; j < 3; j++)
+         axis[j] /= length;
+      mindot = 1.0f;
+      for (i = 0; i < cluster->numIndexes; i += 3) {
+         const float* p0 = &model->vertices[3 * indexes[i + 0]];
+         const float* p1 = &model->vertices[3 * indexes[i + 1]];
+         const float* p2 = &model->vertices[3 * indexes[i + 2]];
+         for (j = 0; j < 3; j++) {
+            u[j] = p1[j] - p0[j];
+            v[j] = p2[j] - p0[j];
+         }
+         _glmCross(u, v, n);
+         if (_glmDot(n, n) > 0.0f) {
+            _glmNormalize(n);
+            mindot = _glmMin(mindot, _glmDot(axis, n));
+         }
+      }
+   }
+   for (j = 0; j < 3; j++)
+      cluster->coneAxis[j] = axis[j];
+   /* a cone of 90 degrees or more can't cull anything */
+   if (mindot > 0.0f)
+      cluster->coneCutoff = (float)sqrt(1.0f - mindot * mindot);
+   else
+      cluster->coneCutoff = 2.0f;
+}
+
+/* glmBuildClusters: Splits the triangles of every group into clusters
+ * of consecutive triangles with a bounding sphere and normal cone each.
+ *
+ * model        - initialized GLMmodel structure, after glmReIndex()
+ * maxtriangles - maximum number of triangles per cluster
+ */
+void
+glmBuildClusters(GLMmodel* model, uint maxtriangles)
+{
+   GLMgroup* group;
+   uint      i;
+
+   assert(model);
+   assert(maxtriangles > 0);
+
+   _glmDropClusters(model);
+
+   for (group = model->groups; group; group = group->next) {
+      if (!group->triIndexes || group->numtriangles == 0)
+         continue;
+
+      group->numclusters = (group->numtriangles + maxtriangles - 1) / maxtriangles;
+      group->clusters = (GLMcluster*)malloc(sizeof(GLMcluster) *
+                                            group->numclusters);
+      for (i = 0; i < group->numclusters; i++) {
+         GLMcluster* cluster = &group->clusters[i];
+         uint first = i * maxtriangles;
+         uint count = group->numtriangles - first;
+
+         if (count > maxtriangles)
+            count = maxtriangles;
+         cluster->firstIndex = 3 * first;
+         cluster->numIndexes = 3 * count;
+         _glmClusterBounds(model, &group->triIndexes[3 * first], cluster);
+      }
+      model->numclusters += group->numclusters;
+   }
+}
+
+
+/* glmACMR: Returns the average cache miss ratio (transformed vertices
+ * per triangle) of the element indexes of a model, for a FIFO
+ * post-transform vertex cache.
+ *
+ * model     - initialized GLMmodel structure, after glmReIndex()
+ * cachesize - number of vertices in the cache
+ */
+float
+glmACMR(const GLMmodel* model, uint cachesize)
+{
+   GLMgroup* group;
+   uint*     stamp;
+   uint      time, misses, triangles, i;
+
+   assert(model);
+
+   /* a vertex is in the cache if it went in less than cachesize
+      misses ago */
+   stamp = (uint*)calloc(model->numvertices + 1, sizeof(uint));
+   time = cachesize + 1;
+   misses = triangles = 0;
+   for (group = model->groups; group; group = group->next) {
+      if (!group->triIndexes)
+         continue;
+      for (i = 0; i < 3 * group->numtriangles; i++) {
+         uint v = group->triIndexes[i];
+         if (time - stamp[v] > cachesize) {
+            stamp[v] = time++;
+            misses++;
+         }
+      }
+      triangles += group->numtriangles;
+   }
+   free(stamp);
+
+   return triangles ? (float)misses / triangles : 0.0f;
+}
+
+/* _glmTipsifyNext: pick the next fanning vertex for _glmTipsify(),
+ * preferring the candidate that stays in the cache longest, then any
+ * live vertex on the dead-end stack, then the next live vertex in
+ * input order.  Returns ~0 when all triangles have been emitted.
+ */
+static uint
+_glmTipsifyNext(const uint* live, const uint* stamp, uint time,
+                uint cachesize, const uint* candidates, uint numcandidates,
+                uint* deadend, uint* numdeadend, uint* cursor, uint numverts)
+{
+   uint best = ~0u, bestpriority = 0, i;
+
+   for (i = 0; i < numcandidates; i++) {
+      uint v = candidates[i];
+      if (live[v]) {
+         uint priority = 0;
+         /* will it still be in the cache after fanning it? */
+         if (time - stamp[v] + 2 * live[v] <= cachesize)
+            priority = time - stamp[v];
+         if (best == ~0u || priority > bestpriority) {
+            best = v;
+            bestpriority = priority;
+         }
+      }
+   }
+   if (best != ~0u)
+      return best;
+
+   while (*numdeadend) {
+      uint v = deadend[--*numdeadend];
+      if (live[v])
+         return v;
+   }
+
+   for (; *cursor < numverts; (*cursor)++) {
+      if (live[*cursor])
+         return *cursor;
+   }
+
+   return ~0u;
+}
+
+/* _glmTipsify: reorder the triangles of a group for the post-transform
+ * vertex cache with the Tipsify algorithm (Sander, Nehab and Barczak,
+ * "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw",
+ * 2007), which fans around the vertex that's likely still cached.
+ *
+ * group     - group to reorder, after glmReIndex()
+ * local     - array of numvertices + 1 uints, all ~0, used to number
+ *             the vertices of the group from 0, and left all ~0
+ * cachesize - number of vertices in the cache
+ */
+static void
+_glmTipsify(GLMgroup* group, uint* local, uint cachesize)
+{
+   const uint  n = group->numtriangles;
+   uint*       indexes = group->triIndexes;
+   uint*       globals;      /* model vertex of each group vertex */
+   uint*       tris;         /* group triangle of each corner */
+   uint*       start;        /* CSR vertex -> triangles */
+   uint*       adjacency;
+   uint*       live;         /* triangles left to emit per vertex */
+   uint*       stamp;        /* cache time stamp per vertex */
+   uint*       deadend;
+   uint*       candidates;
+   uint*       newIndexes;
+   uint*       newTriangles;
+   unsigned char* emitted;
+   uint        numverts, numdeadend, numcandidates, numemitted;
+   uint        time, cursor, fan, i, j, k;
+
+   if (n == 0)
+      return;
+
+   /* number the vertices of the group */
+   globals = (uint*)malloc(sizeof(uint) * 3 * n);
+   tris = (uint*)malloc(sizeof(uint) * 3 * n);
+   numverts = 0;
+   for (i = 0; i < 3 * n; i++) {
+      uint v = indexes[i];
+      if (local[v] == ~0u) {
+         local[v] = numverts;
+         globals[numverts++] = v;
+      }
+      tris[i] = local[v];
+   }
+   for (i = 0; i < numverts; i++)
+      local[globals[i]] = ~0u;
+
+   /* vertex -> triangle adjacency */
+   start = (uint*)calloc(numverts + 1, sizeof(uint));
+   live = (uint*)calloc(numverts, sizeof(uint));
+   for (i = 0; i < 3 * n; i++)
+      live[tris[i]]++;
+   for (i = 0; i < numverts; i++)
+      start[i + 1] = start[i] + live[i];
+   adjacency = (uint*)malloc(sizeof(uint) * 3 * n);
+   for (i = 0; i < numverts; i++)
+      live[i] = 0;
+   for (i = 0; i < 3 * n; i++) {
+      uint v = tris[i];
+      adjacency[start[v] + live[v]++] = i / 3;
+   }
+
+   stamp = (uint*)calloc(numverts, sizeof(uint));
+   deadend = (uint*)malloc(sizeof(uint) * 3 * n);
+   candidates = (uint*)malloc(sizeof(uint) * 3 * n);
+   emitted = (unsigned char*)calloc(n, 1);
+   newIndexes = (uint*)malloc(sizeof(uint) * 3 * n);
+   newTriangles = (uint*)malloc(sizeof(uint) * n);
+
+   time = cachesize + 1;
+   numdeadend = 0;
+   numemitted = 0;
+   cursor = 0;
+   fan = 0;
+   while (fan != ~0u) {
+      /* emit all the remaining triangles around the fanning vertex */
+      numcandidates = 0;
+      for (k = start[fan]; k < start[fan + 1]; k++) {
+         uint t = adjacency[k];
+         if (emitted[t])
+            continue;
+         emitted[t] = 1;
+         for (j = 0; j < 3; j++) {
+            uint v = tris[3 * t + j];
+            newIndexes[3 * numemitted + j] = indexes[3 * t + j];
+            deadend[numdeadend++] = v;
+            candidates[numcandidates++] = v;
+            live[v]--;
+            if (time - stamp[v] > cachesize)
+               stamp[v] = time++;
+         }
+         newTriangles[numemitted++] = group->triangles[t];
+      }
+
+      fan = _glmTipsifyNext(live, stamp, time, cachesize, candidates,
+                            numcandidates, deadend, &numdeadend, &cursor,
+                            numverts);
+   }
+   assert(numemitted == n);
+
+   memcpy(indexes, newIndexes, sizeof(uint) * 3 * n);
+   memcpy(group->triangles, newTriangles, sizeof(uint) * n);
+
+   free(newTriangles);
+   free(newIndexes);
+   free(emitted);
+   free(candidates);
+   free(deadend);
+   free(stamp);
+   free(adjacency);
+   free(live);
+   free(start);
+   free(tris);
+   free(globals);
+}
+
+/* _glmCacheMisses: returns how many vertices of a triangle miss a
+ * FIFO cache of cachesize vertices, and adds those to the cache.
+ * stamp and time are as in glmACMR().
+ */
+static uint
+_glmCacheMisses(const uint* indexes, uint* stamp, uint* time,
+                uint cachesize)
+{
+   uint misses = 0, j;
+
+   for (j = 0; j < 3; j++) {
+      uint v = indexes[j];
+      if (*time - stamp[v] > cachesize) {
+         stamp[v] = (*time)++;
+         misses++;
+      }
+   }
+   return misses;
+}
+
+/* _glmCompareOverdraw: qsort() comparison of two _GLMoverdraw, by
+ * decreasing key, then in their original order
+ */
+static int
+_glmCompareOverdraw(const void* a, const void* b)
+{
+   const _GLMoverdraw* u = (const _GLMoverdraw*)a;
+   const _GLMoverdraw* v = (const _GLMoverdraw*)b;
+
+   if (u->key != v->key)
+      return u->key > v->key ? -1 : 1;
+   return u->first < v->first ? -1 : u->first > v->first;
+}
+
+/* _glmSortOverdraw: reorder the triangles of a group reordered by
+ * _glmTipsify() to reduce overdraw, the second half of the Tipsify
+ * paper.  The triangles are split into clusters where the cache was
+ * flushed anyway (a triangle missing all three vertices), and those
+ * again wherever a fresh cache costs at most GLM_OVERDRAW_THRESHOLD
+ * times the cluster's ACMR.  The clusters are then drawn in order of
+ * how far out from the group's centroid they face, since those are
+ * the ones likely to occlude the rest.
+ *
+ * model     - initialized GLMmodel structure
+ * group     - group to reorder, after _glmTipsify()
+ * cachesize - number of vertices in the cache
+ */
+static void
+_glmSortOverdraw(GLMmodel* model, GLMgroup* group, uint cachesize)
+{
+   const uint    n = group->numtriangles;
+   uint*         indexes = group->triIndexes;
+   uint*         stamp;
+   uint*         hard;         /* first triangle of each hard cluster */
+   uint*         newIndexes;
+   uint*         newTriangles;
+   float*        sums;         /* centroid, normal * 2 area, area */
+   _GLMoverdraw* clusters;
+   uint          numhard, numclusters, time, misses, first, h, i, j, t;
+   float         center[3], area, threshold;
+
+   if (n == 0)
+      return;
+
+   stamp = (uint*)calloc(model->numvertices + 1, sizeof(uint));
+   hard = (uint*)malloc(sizeof(uint) * (n + 1));
+   clusters = (_GLMoverdraw*)malloc(sizeof(_GLMoverdraw) * n);
+
+   /* hard boundaries */
+   time = cachesize + 1;
+   numhard = 0;
+   for (t = 0; t < n; t++) {
+      if (_glmCacheMisses(&indexes[3 * t], stamp, &time, cachesize) == 3 ||
+          t == 0)
+         hard[numhard++] = t;
+   }
+   hard[numhard] = n;
+
+   /* soft boundaries, each cluster starting with an empty cache */
+   numclusters = 0;
+   for (h = 0; h < numhard; h++) {
+      time += cachesize + 1;
+      misses = 0;
+      for (t = hard[h]; t < hard[h + 1]; t++)
+         misses += _glmCacheMisses(&indexes[3 * t], stamp, &time, cachesize);
+      threshold = GLM_OVERDRAW_THRESHOLD * misses / (hard[h + 1] - hard[h]);
+
+      time += cachesize + 1;
+      misses = 0;
+      first = hard[h];
+      for (t = hard[h]; t < hard[h + 1]; t++) {
+         misses += _glmCacheMisses(&indexes[3 * t], stamp, &time, cachesize);
+         if (t + 1 == hard[h + 1] ||
+             (float)misses / (t + 1 - first) <= threshold) {
+            clusters[numclusters].first = first;
+            clusters[numclusters].count = t + 1 - first;
+            numclusters++;
+            time += cachesize + 1;
+            misses = 0;
+            first = t + 1;
+         }
+      }
+   }
+
+   /* area weighted centroid and normal of each cluster */
+   sums = (float*)calloc(7 * numclusters, sizeof(float));
+   center[0] = center[1] = center[2] = 0.0f;
+   area = 0.0f;
+   for (i = 0; i < numclusters; i++) {
+      float* sum = &sums[7 * i];
+
+      for (t = clusters[i].first; t < clusters[i].first + clusters[i].count; t++) {
+         float* p0 = &model->vertices[3 * indexes[3 * t + 0]];
+         float* p1 = &model->vertices[3 * indexes[3 * t + 1]];
+         float* p2 = &model->vertices[3 * indexes[3 * t + 2]];
+         float  u[3], v[3], cross[3], ta;
+
+         for (j = 0; j < 3; j++) {
+            u[j] = p1[j] - p0[j];
+            v[j] = p2[j] - p0[j];
+         }
+         _glmCross(u, v, cross);
+         ta = 0.5f * (float)sqrt(_glmDot(cross, cross));
+         for (j = 0; j < 3; j++) {
+            sum[j] += ta * (p0[j] + p1[j] + p2[j]) / 3.0f;
+            sum[3 + j] += cross[j];
+         }
+         sum[6] += ta;
+      }
+      for (j = 0; j < 3; j++)
+         center[j] += sum[j];
+      area += sum[6];
+      if (sum[6] > 0.0f) {
+         for (j = 0; j < 3; j++)
+            sum[j] /= sum[6];
+      }
+   }
+   if (area > 0.0f) {
+      for (j = 0; j < 3; j++)
+         center[j] /= area;
+   }
+
+   /* key: distance of the centroid from the group's, along the normal */
+   for (i = 0; i < numclusters; i++) {
+      float* sum = &sums[7 * i];
+      float  len = (float)sqrt(_glmDot(&sum[3], &sum[3]));
+      float  key = 0.0f;
+
+      if (sum[6] > 0.0f && len > 0.0f) {
+         for (j = 0; j < 3; j++)
+            key += (sum[j] - center[j]) * sum[3 + j];
+         key /= len;
+      }
+      clusters[i].key = key;
+   }
+
+   qsort(clusters, numclusters, sizeof(_GLMoverdraw), _glmCompareOverdraw);
+
+   newIndexes = (uint*)malloc(sizeof(uint) * 3 * n);
+   newTriangles = (uint*)malloc(sizeof(uint) * n);
+   t = 0;
+   for (i = 0; i < numclusters; i++) {
+      memcpy(&newIndexes[3 * t], &indexes[3 * clusters[i].first],
+             sizeof(uint) * 3 * clusters[i].count);
+      memcpy(&newTriangles[t], &group->triangles[clusters[i].first],
+             sizeof(uint) * clusters[i].count);
+      t += clusters[i].count;
+   }
+   assert(t == n);
+   memcpy(indexes, newIndexes, sizeof(uint) * 3 * n);
+   memcpy(group->triangles, newTriangles, sizeof(uint) * n);
+
+   free(newTriangles);
+   free(newIndexes);
+   free(sums);
+   free(clusters);
+   free(hard);
+   free(stamp);
+}
+
+/* _glmPermute: reorder an array of vectors so that vector i moves to
+ * position remap[i].
+ */
+static float*
+_glmPermute(GLMmodel* model, float* vectors, uint size, uint numvectors,
+            const uint* remap)
+{
+   float* permuted;
+   uint   i;
+
+   permuted = (float*)malloc(sizeof(float) * size * (numvectors + 1));
+   memcpy(permuted, vectors, sizeof(float) * size);
+   for (i = 1; i <= numvectors; i++)
+      memcpy(&permuted[size * remap[i]], &vectors[size * i], sizeof(float) * size);
+   _glmFree(model, vectors);
+
+   return permuted;
+}
+
+/* glmOptimizeVertexCache: Reorders the triangles of every group for
+ * the post-transform vertex cache, then puts clusters of them that
+ * face out from the middle of the group first, to reduce overdraw,
+ * and renumbers the vertices in the order the triangles first use
+ * them, so that vertex data is fetched (mostly) sequentially.
+ *
+ * model     - initialized GLMmodel structure, after glmReIndex()
+ * cachesize - number of vertices in the cache to optimize for
+ */
+void
+glmOptimizeVertexCache(GLMmodel* model, uint cachesize)
+{
+   GLMgroup* group;
+   uint*     remap;
+   uint      next, i, j;
+
+   assert(model);
+
+   _glmDropVertexData(model);
+
+   /* triangle order */
+   remap = (uint*)malloc(sizeof(uint) * (model->numvertices + 1));
+   memset(remap, 0xff, sizeof(uint) * (model->numvertices + 1));
+   for (group = model->groups; group; group = group->next) {
+      if (group->triIndexes) {
+         _glmTipsify(group, remap, cachesize);
+         _glmSortOverdraw(model, group, cachesize);
+      }
+   }
+
+   /* vertex order: first use, then whatever is unused */
+   next = 1;
+   for (group = model->groups; group; group = group->next) {
+      if (!group->triIndexes)
+         continue;
+      for (i = 0; i < 3 * group->numtriangles; i++) {
+         if (remap[group->triIndexes[i]] == ~0u)
+            remap[group->triIndexes[i]] = next++;
+      }
+   }
+   for (i = 1; i <= model->numvertices; i++) {
+      if (remap[i] == ~0u)
+         remap[i] = next++;
+   }
+
+   for (group = model->groups; group; group = group->next) {
+      if (!group->triIndexes)
+         continue;
+      group->minIndex = ~0u;
+      group->maxIndex = 0;
+      for (i = 0; i < 3 * group->numtriangles; i++) {
+         uint v = group->triIndexes[i] = remap[group->triIndexes[i]];
+         if (v > group->maxIndex)
+            group->maxIndex = v;
+         if (v < group->minIndex)
+            group->minIndex = v;
+      }
+   }
+
+   /* after glmReIndex() normals and texcoords are per vertex too */
+   for (i = 0; i < model->numtriangles; i++) {
+      for (j = 0; j < 3; j++) {
+         T(i).vindices[j] = remap[T(i).vindices[j]];
+         if (model->numnormals == model->numvertices)
+            T(i).nindices[j] = remap[T(i).nindices[j]];
+         if (model->numtexcoords == model->numvertices)
+            T(i).tindices[j] = remap[T(i).tindices[j]];
+      }
+   }
+   if (model->numnormals == model->numvertices) {
+      model->normals = _glmPermute(model, model->normals, 3,
+                                   model->numnormals, remap);
+   }
+   if (model->numtexcoords == model->numvertices) {
+      model->texcoords = _glmPermute(model, model->texcoords, 2,
+                                     model->numtexcoords, remap);
+   }
+   model->vertices = _glmPermute(model, model->vertices, 3,
+                                 model->numvertices, remap);
+
+   free(remap);
+}
+
+
 void
 glmPrint(const GLMmodel *model)
 {
@@ -1830,73 +3731,6 @@ glmPrint(const GLMmodel *model)
 
 
 
-#if 0
-   /* normals */
-   if (model->numnormals) {
-   numvectors = model->numnormals;
-   vectors    = model->normals;
-   copies = _glmOptimizeVectors(vectors, &numvectors);
-
-   printf("glmOptimize(): %d redundant normals.\n",
-          model->numnormals - numvectors);
-
-   for (i = 0; i < model->numtriangles; i++) {
-      T(i).nindices[0] = (uint)vectors[3 * T(i).nindices[0] + 0];
-      T(i).nindices[1] = (uint)vectors[3 * T(i).nindices[1] + 0];
-      T(i).nindices[2] = (uint)vectors[3 * T(i).nindices[2] + 0];
-   }
-
-   /* free space for old normals */
-   free(vectors);
-
-   /* allocate space for the new normals */
-   model->numnormals = numvectors;
-   model->normals = (float*)malloc(sizeof(float) *
-                                   3 * (model->numnormals + 1));
-
-   /* copy the optimized vertices into the actual vertex list */
-   for (i = 1; i <= model->numnormals; i++) {
-      model->normals[3 * i + 0] = copies[3 * i + 0];
-      model->normals[3 * i + 1] = copies[3 * i + 1];
-      model->normals[3 * i + 2] = copies[3 * i + 2];
-   }
-
-   free(copies);
-   }
-
-   /* texcoords */
-   if (model->numtexcoords) {
-   numvectors = model->numtexcoords;
-   vectors    = model->texcoords;
-   copies = _glmOptimizeVectors(vectors, &numvectors);
-
-   printf("glmOptimize(): %d redundant texcoords.\n",
-          model->numtexcoords - numvectors);
-
-   for (i = 0; i < model->numtriangles; i++) {
-      for (j = 0; j < 3; j++) {
-         T(i).tindices[j] = (uint)vectors[3 * T(i).tindices[j] + 0];
-      }
-   }
-
-   /* free space for old texcoords */
-   free(vectors);
-
-   /* allocate space for the new texcoords */
-   model->numtexcoords = numvectors;
-   model->texcoords = (float*)malloc(sizeof(float) *
-                                     2 * (model->numtexcoords + 1));
-
-   /* copy the optimized vertices into the actual vertex list */
-   for (i = 1; i <= model->numtexcoords; i++) {
-      model->texcoords[2 * i + 0] = copies[2 * i + 0];
-      model->texcoords[2 * i + 1] = copies[2 * i + 1];
-   }
-
-   free(copies);
-   }
-#endif
-
 #if 0
    /* look for unused vertices */
    /* look for unused normals */
@@ -9,6 +9,7 @@
 #ifndef GLM_H
 #define GLM_H
 
+#include <stddef.h>
 
 typedef unsigned int uint;
 
@@ -21,6 +22,13 @@ typedef unsigned int uint;
 #define GLM_COLOR    (1 << 3)   /* render with colors */
 #define GLM_MATERIAL (1 << 4)   /* render with materials */
 
+#define GLM_PACK_NONE     (0)        /* 32-bit floats for all attributes */
+#define GLM_PACK_POSITION (1 << 0)   /* 16-bit positions, see posScale */
+#define GLM_PACK_NORMAL   (1 << 1)   /* signed byte normals */
+#define GLM_PACK_TEXCOORD (1 << 2)   /* half float texcoords */
+#define GLM_PACK_ALL      (GLM_PACK_POSITION | GLM_PACK_NORMAL | \
+                           GLM_PACK_TEXCOORD)
+
 
 /* structs */
 
@@ -50,6 +58,19 @@ typedef struct {
    uint findex;        /* index of triangle facet normal */
 } GLMtriangle;
 
+/* GLMcluster: Structure that defines a run of triangles within a
+ * group, with the bounds used to cull it.
+ */
+typedef struct {
+   uint  firstIndex;       /* first element in the group's triIndexes */
+   uint  numIndexes;       /* number of elements */
+   uint  minIndex, maxIndex;
+   float center[3];        /* bounding sphere */
+   float radius;
+   float coneAxis[3];      /* average facet normal */
+   float coneCutoff;       /* sine of the normal cone angle, > 1 if none */
+} GLMcluster;
+
 /* GLMgroup: Structure that defines a group in a model.
  */
 typedef struct _GLMgroup {
@@ -60,6 +81,8 @@ typedef struct _GLMgroup {
    uint *          triIndexes;
    uint            minIndex, maxIndex;
    uint            indexVboOffset;   /* offset into index VBO for elements */
+   uint            numclusters;    /* number of clusters in group */
+   GLMcluster*     clusters;       /* array of clusters, or NULL */
    struct _GLMgroup* next;           /* pointer to next group in model */
 } GLMgroup;
 
@@ -95,10 +118,20 @@ typedef struct {
 
    uint vbo;          /* OpenGL VBO for vertex data */
    uint index_vbo;    /* VBO for index data */
-   uint vertexSize;   /* number of floats per vertex */
+   uint vertexSize;   /* size of a vertex, in bytes */
    uint posOffset;    /* offset of position within vertex, in bytes */
    uint normOffset;   /* offset of normal within vertex, in bytes */
    uint texOffset;    /* offset of texcoord within vertex, in bytes */
+   uint vertexFormat; /* GLM_PACK_* flags of the interleaved vertices */
+   float posScale;    /* packed positions are posBias + posScale * p */
+   float posBias[3];
+
+   uint numclusters;      /* clusters in all groups */
+   uint numclustersdrawn; /* clusters the last glmDrawVBO() didn't cull */
+
+   void*  vertexdata;   /* prebuilt interleaved vertex data, or NULL */
+   void*  mapping;      /* binary model file the arrays point into, or NULL */
+   size_t mappingsize;  /* size of the mapping in bytes */
 } GLMmodel;
 
 
@@ -167,6 +200,16 @@ glmFacetNormals(GLMmodel* model);
 void
 glmVertexNormals(GLMmodel* model, float angle);
 
+/* glmVertexNormalsThreaded: Generates smooth vertex normals like
+ * glmVertexNormals(), with a given number of threads.
+ *
+ * model      - initialized GLMmodel structure
+ * angle      - maximum angle (in degrees) to smooth across
+ * numthreads - number of threads to use, 0 for one per CPU
+ */
+void
+glmVertexNormalsThreaded(GLMmodel* model, float angle, uint numthreads);
+
 /* glmLinearTexture: Generates texture coordinates according to a
  * linear projection of the texture map.  It generates these by
  * linearly mapping the vertices onto a square.
@@ -206,6 +249,16 @@ glmDelete(GLMmodel* model);
 GLMmodel*
 glmReadOBJ(char* filename);
 
+/* glmReadOBJThreaded: Reads a model description from a Wavefront .OBJ
+ * file like glmReadOBJ(), but splits the file at line boundaries into
+ * chunks that are parsed on worker threads and then merged.
+ *
+ * filename   - name of the file containing the Wavefront .OBJ format data.
+ * numthreads - number of threads to use, 0 for one per CPU
+ */
+GLMmodel*
+glmReadOBJThreaded(char* filename, uint numthreads);
+
 /* glmWriteOBJ: Writes a model description in Wavefront .OBJ format to
  * a file.
  *
@@ -221,6 +274,56 @@ glmReadOBJ(char* filename);
 void
 glmWriteOBJ(GLMmodel* model, char* filename, uint mode);
 
+/* glmWriteBinary: Writes a model to a file in the GLM binary format,
+ * which can be read back much faster than a .OBJ file.  Meant for
+ * caching a model after glmFacetNormals(), glmVertexNormals() and
+ * glmReIndex(); the interleaved vertex data for glmMakeVBOs() is
+ * stored too.  Returns 1 on success, 0 on failure.
+ *
+ * model    - initialized GLMmodel structure
+ * filename - name of the file to write the binary data to
+ */
+int
+glmWriteBinary(GLMmodel* model, char* filename);
+
+/* glmReadBinary: Reads a model written with glmWriteBinary().  The
+ * file is mapped into memory and the model arrays point straight into
+ * it, so nothing is parsed or copied.  Returns a pointer to the
+ * created object which should be free'd with glmDelete(), or NULL if
+ * the file can't be read or wasn't written by a compatible version.
+ *
+ * filename - name of the file containing the binary data.
+ */
+GLMmodel*
+glmReadBinary(char* filename);
+
+/* glmVertexFormat: Selects the layout glmInterleave() and
+ * glmMakeVBOs() use for the vertices of a model.  Packed attributes
+ * roughly halve the size of the vertex buffer.
+ *
+ * model  - initialized GLMmodel structure
+ * format - a bitwise OR of values describing what to pack.
+ *          GLM_PACK_NONE      -  32-bit floats for everything
+ *          GLM_PACK_POSITION  -  16-bit integer positions, scaled and
+ *                                biased back by glmDrawVBO()
+ *          GLM_PACK_NORMAL    -  GL_BYTE normals
+ *          GLM_PACK_TEXCOORD  -  GL_HALF_FLOAT texture coords
+ */
+void
+glmVertexFormat(GLMmodel* model, uint format);
+
+/* glmInterleave: Packs the vertices, normals and texture coordinates
+ * of a model (which must have been through glmReIndex()) into one
+ * interleaved array in the layout selected with glmVertexFormat(), and
+ * sets the vertexSize, attribute offsets and position scale and bias
+ * of the model.  Returns the array, which should be free'd.
+ *
+ * model - initialized GLMmodel structure
+ * bytes - returns the size of the array in bytes
+ */
+void*
+glmInterleave(GLMmodel* model, uint* bytes);
+
 /* glmDraw: Renders the model to the current OpenGL context using the
  * mode specified.
  *
@@ -260,9 +363,59 @@ glmList(GLMmodel* model, uint mode);
 void
 glmWeld(GLMmodel* model, float epsilon);
 
+/* glmWeldMode: eliminate (weld) vertices, and optionally normals and
+ * texture coordinates, that are within an epsilon of each other.
+ * Uses a hash grid of epsilon-sized cells, so it runs in roughly
+ * linear time, and prints the welding throughput.
+ *
+ * model      - initialized GLMmodel structure
+ * epsilon    - maximum difference between vectors
+ * mode       - a bitwise OR of values describing what else is welded
+ *              GLM_NONE    -  weld only vertices
+ *              GLM_SMOOTH  -  also weld normals
+ *              GLM_TEXTURE -  also weld texture coords
+ */
+void
+glmWeldMode(GLMmodel* model, float epsilon, uint mode);
+
 void
 glmReIndex(GLMmodel *model);
 
+/* glmOptimizeVertexCache: Reorders the triangles of every group for
+ * the post-transform vertex cache (Tipsify), then sorts clusters of
+ * them so that those facing out from the middle of the group are drawn
+ * first, to reduce overdraw, and renumbers the vertices in first-use
+ * order so that the vertex buffer is read sequentially.
+ *
+ * model     - initialized GLMmodel structure, after glmReIndex()
+ * cachesize - number of vertices in the cache to optimize for
+ */
+void
+glmOptimizeVertexCache(GLMmodel* model, uint cachesize);
+
+/* glmBuildClusters: Splits the triangles of every group into clusters
+ * of consecutive triangles, and computes a bounding sphere and normal
+ * cone for each.  glmDrawVBO() then culls clusters outside the view
+ * frustum or facing away from the viewer.  Run it after everything
+ * else that changes the model, glmOptimizeVertexCache() in particular
+ * since triangles close in the index order are close in space too.
+ *
+ * model        - initialized GLMmodel structure, after glmReIndex()
+ * maxtriangles - maximum number of triangles per cluster
+ */
+void
+glmBuildClusters(GLMmodel* model, uint maxtriangles);
+
+/* glmACMR: Returns the average cache miss ratio (vertex shader
+ * invocations per triangle) of a model's element indexes for a FIFO
+ * post-transform vertex cache.
+ *
+ * model     - initialized GLMmodel structure, after glmReIndex()
+ * cachesize - number of vertices in the cache
+ */
+float
+glmACMR(const GLMmodel* model, uint cachesize);
+
 void
 glmMakeVBOs(GLMmodel *model);
 
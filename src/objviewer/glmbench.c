@@ -0,0 +1,253 @@
+/*
+ * Benchmark for the GLM model processing functions, without any
+ * rendering.  Reads a .obj file and times the steps objview goes
+ * through before it can draw the model.
+ *
+ * glmVertexNormals() is also compared against the linked list
+ * implementation it replaced, both for speed and for identical output.
+ *
+ * Usage: glmbench [-j threads] file.obj
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "glm.h"
+#include "bench.h"
+
+
+#define T(x) model->triangles[(x)]
+
+
+static double
+Now(void)
+{
+   return bench_time_ns() * 1e-9;
+}
+
+
+static float
+Dot(const float *u, const float *v)
+{
+   return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+}
+
+
+static void
+Normalize(float *n)
+{
+   float l = (float) sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+   n[0] /= l;
+   n[1] /= l;
+   n[2] /= l;
+}
+
+
+typedef struct _Node {
+   uint index;
+   unsigned char averaged;
+   struct _Node *next;
+} Node;
+
+
+/**
+ * The original glmVertexNormals(), which keeps a malloc'd linked list
+ * of triangles for each vertex.  Returns the normals (1-based) and
+ * writes the normal indices to nindices (3 per triangle).
+ */
+static float *
+ReferenceVertexNormals(GLMmodel *model, float angle, uint *numnormalsOut,
+                       uint *nindices)
+{
+   Node *node, *tail, **members;
+   float *normals;
+   uint numnormals, i, avg;
+   float average[3], dot, cos_angle;
+
+   cos_angle = cos(angle * M_PI / 180.0);
+
+   normals = (float *) malloc(sizeof(float) * 3 * (model->numtriangles * 3 + 1));
+
+   members = (Node **) malloc(sizeof(Node *) * (model->numvertices + 1));
+   for (i = 1; i <= model->numvertices; i++)
+      members[i] = NULL;
+
+   for (i = 0; i < model->numtriangles; i++) {
+      uint j;
+      for (j = 0; j < 3; j++) {
+         node = (Node *) malloc(sizeof(Node));
+         node->index = i;
+         node->next = members[T(i).vindices[j]];
+         members[T(i).vindices[j]] = node;
+      }
+   }
+
+   numnormals = 1;
+   for (i = 1; i <= model->numvertices; i++) {
+      node = members[i];
+      average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
+      avg = 0;
+      while (node) {
+         dot = Dot(&model->facetnorms[3 * T(node->index).findex],
+                   &model->facetnorms[3 * T(members[i]->index).findex]);
+         if (dot > cos_angle) {
+            node->averaged = 1;
+            average[0] += model->facetnorms[3 * T(node->index).findex + 0];
+            average[1] += model->facetnorms[3 * T(node->index).findex + 1];
+            average[2] += model->facetnorms[3 * T(node->index).findex + 2];
+            avg = 1;
+         } else {
+            node->averaged = 0;
+         }
+         node = node->next;
+      }
+
+      if (avg) {
+         Normalize(average);
+         normals[3 * numnormals + 0] = average[0];
+         normals[3 * numnormals + 1] = average[1];
+         normals[3 * numnormals + 2] = average[2];
+         avg = numnormals;
+         numnormals++;
+      }
+
+      node = members[i];
+      while (node) {
+         uint *n = &nindices[3 * node->index];
+         uint value;
+
+         if (node->averaged) {
+            value = avg;
+         } else {
+            normals[3 * numnormals + 0] =
+               model->facetnorms[3 * T(node->index).findex + 0];
+            normals[3 * numnormals + 1] =
+               model->facetnorms[3 * T(node->index).findex + 1];
+            normals[3 * numnormals + 2] =
+               model->facetnorms[3 * T(node->index).findex + 2];
+            value = numnormals++;
+         }
+         if (T(node->index).vindices[0] == i)
+            n[0] = value;
+         else if (T(node->index).vindices[1] == i)
+            n[1] = value;
+         else if (T(node->index).vindices[2] == i)
+            n[2] = value;
+         node = node->next;
+      }
+   }
+
+   for (i = 1; i <= model->numvertices; i++) {
+      node = members[i];
+      while (node) {
+         tail = node;
+         node = node->next;
+         free(tail);
+      }
+   }
+   free(members);
+
+   *numnormalsOut = numnormals - 1;
+   return normals;
+}
+
+
+static void
+BenchVertexNormals(GLMmodel *model, float angle, uint threads)
+{
+   uint *nindices, numnormals, i, j, mismatches = 0;
+   float *normals;
+   double t0, t1, t2;
+
+   nindices = (uint *) calloc(3 * model->numtriangles + 1, sizeof(uint));
+
+   t0 = Now();
+   normals = ReferenceVertexNormals(model, angle, &numnormals, nindices);
+   t1 = Now();
+   glmVertexNormalsThreaded(model, angle, threads);
+   t2 = Now();
+
+   if (numnormals != model->numnormals ||
+       memcmp(&normals[3], &model->normals[3], sizeof(float) * 3 * numnormals))
+      mismatches++;
+   for (i = 0; i < model->numtriangles; i++) {
+      for (j = 0; j < 3; j++) {
+         if (nindices[3 * i + j] != T(i).nindices[j])
+            mismatches++;
+      }
+   }
+
+   printf("glmVertexNormals: linked lists %.3f sec, CSR %.3f sec, "
+          "%.2fx speedup (%s)\n",
+          t1 - t0, t2 - t1, t2 > t1 ? (t1 - t0) / (t2 - t1) : 0.0,
+          mismatches ? "OUTPUT DIFFERS" : "identical output");
+
+   free(normals);
+   free(nindices);
+}
+
+
+int
+main(int argc, char **argv)
+{
+   GLMmodel *model;
+   char *file = NULL;
+   uint threads = 0;
+   double t0, t1;
+   float acmr;
+   int i;
+
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+         int n = atoi(argv[++i]);
+         if (n < 1) {
+            fprintf(stderr, "glmbench: -j needs at least 1 thread\n");
+            return 1;
+         }
+         threads = n;
+      }
+      else
+         file = argv[i];
+   }
+   if (!file) {
+      fprintf(stderr, "usage: glmbench [-j threads] file.obj\n");
+      return 1;
+   }
+
+   t0 = Now();
+   model = glmReadOBJThreaded(file, threads);
+   t1 = Now();
+   printf("glmReadOBJ: %.3f sec\n", t1 - t0);
+   printf("%u vertices, %u triangles, %u groups\n",
+          model->numvertices, model->numtriangles, model->numgroups);
+
+   t0 = Now();
+   glmUnitize(model);
+   t1 = Now();
+   printf("glmUnitize: %.3f sec\n", t1 - t0);
+
+   t0 = Now();
+   glmFacetNormals(model);
+   t1 = Now();
+   printf("glmFacetNormals: %.3f sec\n", t1 - t0);
+
+   BenchVertexNormals(model, 90.0, threads);
+
+   t0 = Now();
+   glmReIndex(model);
+   t1 = Now();
+   printf("glmReIndex: %.3f sec\n", t1 - t0);
+
+   t0 = Now();
+   acmr = glmACMR(model, 16);
+   glmOptimizeVertexCache(model, 16);
+   t1 = Now();
+   printf("glmOptimizeVertexCache: %.3f sec, ACMR %.3f -> %.3f\n",
+          t1 - t0, acmr, glmACMR(model, 16));
+
+   glmDelete(model);
+
+   return 0;
+}
@@ -3,11 +3,13 @@
 #define GL_GLEXT_PROTOTYPES
 
 #include <assert.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "glad/gl.h"
 #include "glm.h"
+#include "matrix.h"
 #include "readtex.h"
 #include "shaderutil.h"
 
@@ -154,8 +156,8 @@ glmDraw(GLMmodel* model, GLuint mode)
 void
 glmMakeVBOs(GLMmodel *model)
 {
-   uint bytes, vertexFloats, i;
-   float *buffer;
+   uint bytes, format;
+   void *buffer;
    GLMgroup* group;
    unsigned totalIndexes;
    GLubyte *ibuffer, *ib;
@@ -163,41 +165,18 @@ glmMakeVBOs(GLMmodel *model)
    /*
     * Vertex data
     */
-   vertexFloats = 3;
-   model->posOffset = 0;
-
-   if (model->numnormals > 0) {
-      assert(model->numnormals == model->numvertices);
-      model->normOffset = vertexFloats * sizeof(GLfloat);
-      vertexFloats += 3;
-   }
-
-   if (model->numtexcoords > 0) {
-      assert(model->numtexcoords == model->numvertices);
-      model->texOffset = vertexFloats * sizeof(GLfloat);
-      vertexFloats += 2;
+   format = model->vertexFormat;
+   if (!GLAD_GL_VERSION_3_0 && !GLAD_GL_ARB_half_float_vertex)
+      format &= ~GLM_PACK_TEXCOORD;
+   glmVertexFormat(model, format);
+
+   if (model->vertexdata) {
+      /* prebuilt by glmReadBinary() */
+      buffer = model->vertexdata;
+      bytes = (model->numvertices + 1) * model->vertexSize;
    }
-
-   model->vertexSize = vertexFloats;
-
-   bytes = (model->numvertices + 1) * vertexFloats * sizeof(float);
-
-   buffer = (float *) malloc(bytes);
-   for (i = 0; i < model->numvertices; i++) {
-      /* copy vertex pos */
-      uint j = 0;
-      buffer[i * vertexFloats + j++] = model->vertices[i * 3 + 0];
-      buffer[i * vertexFloats + j++] = model->vertices[i * 3 + 1];
-      buffer[i * vertexFloats + j++] = model->vertices[i * 3 + 2];
-      if (model->numnormals > 0) {
-         buffer[i * vertexFloats + j++] = model->normals[i * 3 + 0];
-         buffer[i * vertexFloats + j++] = model->normals[i * 3 + 1];
-         buffer[i * vertexFloats + j++] = model->normals[i * 3 + 2];
-      }
-      if (model->numtexcoords > 0) {
-         buffer[i * vertexFloats + j++] = model->texcoords[i * 2 + 0];
-         buffer[i * vertexFloats + j++] = model->texcoords[i * 2 + 1];
-      }
+   else {
+      buffer = glmInterleave(model, &bytes);
    }
 
    glGenBuffersARB(1, &model->vbo);
@@ -205,7 +184,8 @@ glmMakeVBOs(GLMmodel *model)
    glBufferDataARB(GL_ARRAY_BUFFER_ARB, bytes, buffer, GL_STATIC_DRAW_ARB);
    glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
 
-   free(buffer);
+   if (buffer != model->vertexdata)
+      free(buffer);
 
    /*
     * Index data
@@ -242,47 +222,202 @@ glmMakeVBOs(GLMmodel *model)
 
 
 static void
-_glmLoadTexture(GLMmaterial *mat)
+_glmFinishTexture(GLMmaterial *mat, RGBMipmapJob *job)
 {
-   if (mat->map_kd) {
-      GLint imgWidth, imgHeight;
-      GLenum imgFormat;
-      GLubyte *image = NULL;
-
-      glGenTextures(1, &mat->texture_kd);
-
-      image = LoadRGBImage( mat->map_kd, &imgWidth, &imgHeight, &imgFormat );
-      if (!image) {
-         /*fprintf(stderr, "Couldn't open texture %s\n", mat->map_kd);*/
-         free(mat->map_kd);
-         mat->map_kd = NULL;
-         mat->texture_kd = 0;
-         return;
-      }
-      if (0)
-         printf("load texture %s %d x %d\n", mat->map_kd, imgWidth, imgHeight);
-
-      glBindTexture(GL_TEXTURE_2D, mat->texture_kd);
-      gluBuild2DMipmaps(GL_TEXTURE_2D, 3, imgWidth, imgHeight,
-                        imgFormat, GL_UNSIGNED_BYTE, image);
-      free(image);
-
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   GLint imgWidth, imgHeight;
+
+   glGenTextures(1, &mat->texture_kd);
+   glBindTexture(GL_TEXTURE_2D, mat->texture_kd);
+
+   if (!FinishRGBMipmaps(job, GL_TEXTURE_2D, 3, &imgWidth, &imgHeight)) {
+      /*fprintf(stderr, "Couldn't open texture %s\n", mat->map_kd);*/
+      glDeleteTextures(1, &mat->texture_kd);
+      free(mat->map_kd);
+      mat->map_kd = NULL;
+      mat->texture_kd = 0;
+      return;
    }
+   if (0)
+      printf("load texture %s %d x %d\n", mat->map_kd, imgWidth, imgHeight);
+
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
 }
 
 void
 glmLoadTextures(GLMmodel *model)
 {
+   RGBMipmapJob **jobs;
    uint i;
 
+   /* decode all the images in parallel, then upload them in order */
+   jobs = (RGBMipmapJob **) calloc(model->nummaterials + 1, sizeof(*jobs));
+   for (i = 0; i < model->nummaterials; i++) {
+      GLMmaterial *mat = &model->materials[i];
+      if (mat->map_kd)
+         jobs[i] = LoadRGBMipmapsAsync(mat->map_kd, 0);
+   }
+
    for (i = 0; i < model->nummaterials; i++) {
       GLMmaterial *mat = &model->materials[i];
-      _glmLoadTexture(mat);
+      if (mat->map_kd)
+         _glmFinishTexture(mat, jobs[i]);
    }
+
+   free(jobs);
+}
+
+
+/* Model space view frustum planes and eye position for culling clusters */
+typedef struct {
+   float planes[6][4];     /* inside when dot(plane.xyz, p) + plane.w >= 0 */
+   float eye[3];
+   float coneSign;         /* 1 or -1 to cull back faces, 0 to not */
+} _GLMculling;
+
+
+static void
+_glmInitCulling(_GLMculling *cull)
+{
+   float mv[4][4], mvp[4][4], a[3][3], det;
+   GLint frontFace, cullMode;
+   uint i, j;
+
+   glGetFloatv(GL_MODELVIEW_MATRIX, &mv[0][0]);
+   glGetFloatv(GL_PROJECTION_MATRIX, &mvp[0][0]);
+   mat4_multiply(mvp, mv);
+
+   /* Gribb & Hartmann: planes are sums of rows of the MVP matrix */
+   for (i = 0; i < 3; i++) {
+      for (j = 0; j < 4; j++) {
+         cull->planes[2 * i + 0][j] = mat4_get(mvp, 3, j) + mat4_get(mvp, i, j);
+         cull->planes[2 * i + 1][j] = mat4_get(mvp, 3, j) - mat4_get(mvp, i, j);
+      }
+   }
+   for (i = 0; i < 6; i++) {
+      float *p = cull->planes[i];
+      float l = (float) sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+      if (l > 0.0f) {
+         for (j = 0; j < 4; j++)
+            p[j] /= l;
+      }
+   }
+
+   /* eye = -A^-1 t for the upper 3x3 A and translation t of the
+      modelview matrix (which may include a scale) */
+   for (i = 0; i < 3; i++)
+      for (j = 0; j < 3; j++)
+         a[i][j] = mat4_get(mv, i, j);
+   det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+         a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+         a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+   cull->coneSign = 0.0f;
+   if (det == 0.0f)
+      return;
+   for (i = 0; i < 3; i++) {
+      /* row i of the inverse is the cross product of columns i+1, i+2
+         of A, over the determinant */
+      uint i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+      float inv[3];
+      inv[0] = (a[1][i1] * a[2][i2] - a[2][i1] * a[1][i2]) / det;
+      inv[1] = (a[2][i1] * a[0][i2] - a[0][i1] * a[2][i2]) / det;
+      inv[2] = (a[0][i1] * a[1][i2] - a[1][i1] * a[0][i2]) / det;
+      cull->eye[i] = -(inv[0] * mat4_get(mv, 0, 3) +
+                       inv[1] * mat4_get(mv, 1, 3) +
+                       inv[2] * mat4_get(mv, 2, 3));
+   }
+
+   /* normal cones only help if GL culls back faces */
+   if (glIsEnabled(GL_CULL_FACE)) {
+      glGetIntegerv(GL_FRONT_FACE, &frontFace);
+      glGetIntegerv(GL_CULL_FACE_MODE, &cullMode);
+      if (cullMode == GL_BACK)
+         cull->coneSign = 1.0f;
+      else if (cullMode == GL_FRONT)
+         cull->coneSign = -1.0f;
+      if (frontFace == GL_CW)
+         cull->coneSign = -cull->coneSign;
+      /* a mirroring modelview flips the winding too */
+      if (det < 0.0f)
+         cull->coneSign = -cull->coneSign;
+   }
+}
+
+
+static GLboolean
+_glmClusterVisible(const _GLMculling *cull, const GLMcluster *cluster)
+{
+   const float *c = cluster->center;
+   float d[3], dist;
+   uint i;
+
+   for (i = 0; i < 6; i++) {
+      const float *p = cull->planes[i];
+      if (p[0] * c[0] + p[1] * c[1] + p[2] * c[2] + p[3] < -cluster->radius)
+         return GL_FALSE;
+   }
+
+   if (cull->coneSign != 0.0f && cluster->coneCutoff <= 1.0f) {
+      /* back facing if every direction from the eye to the sphere is
+         within the complement of the cone angle of its axis */
+      for (i = 0; i < 3; i++)
+         d[i] = c[i] - cull->eye[i];
+      dist = (float) sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+      if (cull->coneSign * (d[0] * cluster->coneAxis[0] +
+                            d[1] * cluster->coneAxis[1] +
+                            d[2] * cluster->coneAxis[2]) >=
+          cluster->coneCutoff * dist + cluster->radius)
+         return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+
+static void
+_glmDrawRange(const GLMgroup *group, uint first, uint count,
+              uint minIndex, uint maxIndex)
+{
+   glDrawRangeElements(GL_TRIANGLES, minIndex, maxIndex, count,
+                       GL_UNSIGNED_INT,
+                       (void *) (GLintptr) (group->indexVboOffset +
+                                            first * sizeof(GLuint)));
+}
+
+
+/* Draws the clusters of a group that survive culling, merging runs of
+ * adjacent visible clusters into one draw call.
+ */
+static void
+_glmDrawClusters(GLMmodel *model, const GLMgroup *group,
+                 const _GLMculling *cull)
+{
+   uint first = 0, count = 0, minIndex = ~0u, maxIndex = 0, i;
+
+   for (i = 0; i < group->numclusters; i++) {
+      const GLMcluster *cluster = &group->clusters[i];
+
+      if (_glmClusterVisible(cull, cluster)) {
+         if (count == 0)
+            first = cluster->firstIndex;
+         count += cluster->numIndexes;
+         if (cluster->minIndex < minIndex)
+            minIndex = cluster->minIndex;
+         if (cluster->maxIndex > maxIndex)
+            maxIndex = cluster->maxIndex;
+         model->numclustersdrawn++;
+      }
+      else if (count > 0) {
+         _glmDrawRange(group, first, count, minIndex, maxIndex);
+         count = 0;
+         minIndex = ~0u;
+         maxIndex = 0;
+      }
+   }
+   if (count > 0)
+      _glmDrawRange(group, first, count, minIndex, maxIndex);
 }
 
 
@@ -291,23 +426,27 @@ glmDrawVBO(GLMmodel *model)
 {
    GLMgroup* group;
    uint prevMaterial = ~0;
+   _GLMculling cull;
 
    assert(model->vbo);
 
    glBindBufferARB(GL_ARRAY_BUFFER_ARB, model->vbo);
 
-   glVertexPointer(3, GL_FLOAT, model->vertexSize * sizeof(float),
+   glVertexPointer(3, (model->vertexFormat & GLM_PACK_POSITION) ?
+                   GL_SHORT : GL_FLOAT, model->vertexSize,
                    (const void *) (size_t) model->posOffset);
    glEnableClientState(GL_VERTEX_ARRAY);
 
    if (model->numnormals > 0) {
-      glNormalPointer(GL_FLOAT, model->vertexSize * sizeof(float),
+      glNormalPointer((model->vertexFormat & GLM_PACK_NORMAL) ?
+                      GL_BYTE : GL_FLOAT, model->vertexSize,
                       (const void *) (size_t) model->normOffset);
       glEnableClientState(GL_NORMAL_ARRAY);
    }
 
    if (model->numtexcoords > 0) {
-      glTexCoordPointer(2, GL_FLOAT, model->vertexSize * sizeof(float),
+      glTexCoordPointer(2, (model->vertexFormat & GLM_PACK_TEXCOORD) ?
+                        GL_HALF_FLOAT : GL_FLOAT, model->vertexSize,
                         (const void *) (size_t) model->texOffset);
       glEnableClientState(GL_TEXTURE_COORD_ARRAY);
    }
@@ -317,6 +456,15 @@ glmDrawVBO(GLMmodel *model)
    glPushMatrix();
    glTranslatef(model->position[0], model->position[1], model->position[2]);
    glScalef(model->scale, model->scale, model->scale);
+   /* cluster bounds are in unquantized model space */
+   model->numclustersdrawn = 0;
+   if (model->numclusters > 0)
+      _glmInitCulling(&cull);
+   if (model->vertexFormat & GLM_PACK_POSITION) {
+      /* undo the quantization of the positions */
+      glTranslatef(model->posBias[0], model->posBias[1], model->posBias[2]);
+      glScalef(model->posScale, model->posScale, model->posScale);
+   }
 
    for (group = model->groups; group; group = group->next) {
       if (group->numtriangles > 0) {
@@ -326,11 +474,14 @@ glmDrawVBO(GLMmodel *model)
             prevMaterial = group->material;
          }
 
-         glDrawRangeElements(GL_TRIANGLES,
-                             group->minIndex, group->maxIndex,
-                             3 * group->numtriangles,
-                             GL_UNSIGNED_INT,
-                             (void *) (GLintptr) group->indexVboOffset);
+         if (group->clusters)
+            _glmDrawClusters(model, group, &cull);
+         else
+            glDrawRangeElements(GL_TRIANGLES,
+                                group->minIndex, group->maxIndex,
+                                3 * group->numtriangles,
+                                GL_UNSIGNED_INT,
+                                (void *) (GLintptr) group->indexVboOffset);
       }
    }
 
@@ -378,7 +529,7 @@ static const char *VertexShader =
    "varying vec3 normal; \n"
    "void main() { \n"
    "   gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex; \n"
-   "   normal = gl_NormalMatrix * gl_Normal; \n"
+   "   normal = normalize(gl_NormalMatrix * gl_Normal); \n"
    "   gl_TexCoord[0] = gl_MultiTexCoord0; \n"
    "} \n";
 
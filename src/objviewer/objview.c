@@ -8,8 +8,10 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <sys/stat.h>
 #include "glad/gl.h"
 #include "glut_wrap.h"
 #include "glm.h"
@@ -32,6 +34,12 @@ static GLenum FrontFace = GL_CCW;
 static GLfloat Yrot = 0.0;
 static GLint WinWidth = 1024, WinHeight = 768;
 static GLuint NumInstances = 1;
+static GLuint NumThreads = 0;     /* threads for loading, 0 = one per CPU */
+static GLboolean UseCache = GL_FALSE;  /* use/write a binary model cache */
+static GLboolean Optimize = GL_FALSE;  /* reorder for the vertex cache */
+static GLuint VertexFormat = GLM_PACK_NONE;  /* GLM_PACK_* vertex layout */
+static GLuint ClusterSize = 0;    /* triangles per culling cluster, 0 = off */
+static const GLuint VertexCacheSize = 16;
 
 
 
@@ -137,21 +145,67 @@ ComputeFPS(void)
 }
 
 
+/**
+ * Is the binary cache of a model at least as new as the model itself?
+ */
+static GLboolean
+CacheIsFresh(const char *cacheFile, const char *modelFile)
+{
+   struct stat cacheStat, modelStat;
+
+   if (stat(cacheFile, &cacheStat) != 0 || stat(modelFile, &modelStat) != 0)
+      return GL_FALSE;
+   return cacheStat.st_mtime >= modelStat.st_mtime;
+}
+
+
 static void
 init_model(void)
 {
-   /* read in the model */
-   Model = glmReadOBJ(Model_file);
-   glmUnitize(Model);
-   glmFacetNormals(Model);
-   if (Model->numnormals == 0) {
-      GLfloat smoothing_angle = 90.0;
-      printf("Generating normals.\n");
-      glmVertexNormals(Model, smoothing_angle);
+   char cacheFile[1000];
+
+   /* the vertex order depends on -optimize and the cache size */
+   if (Optimize)
+      snprintf(cacheFile, sizeof(cacheFile), "%s.opt%u.glmb", Model_file,
+               VertexCacheSize);
+   else
+      snprintf(cacheFile, sizeof(cacheFile), "%s.glmb", Model_file);
+
+   /* try the processed model from the last run first */
+   if (UseCache && CacheIsFresh(cacheFile, Model_file))
+      Model = glmReadBinary(cacheFile);
+
+   if (!Model) {
+      /* read in the model */
+      Model = glmReadOBJThreaded(Model_file, NumThreads);
+      glmUnitize(Model);
+      glmFacetNormals(Model);
+      if (Model->numnormals == 0) {
+         GLfloat smoothing_angle = 90.0;
+         printf("Generating normals.\n");
+         glmVertexNormalsThreaded(Model, smoothing_angle, NumThreads);
+      }
+
+      glmReIndex(Model);
+      if (Optimize) {
+         float acmr = glmACMR(Model, VertexCacheSize);
+         glmOptimizeVertexCache(Model, VertexCacheSize);
+         printf("ACMR: %.3f before, %.3f after vertex cache optimization\n",
+                acmr, glmACMR(Model, VertexCacheSize));
+      }
+      glmVertexFormat(Model, VertexFormat);
+      if (UseCache)
+         glmWriteBinary(Model, cacheFile);
+   }
+   else {
+      /* the cache may have been written with another layout */
+      glmVertexFormat(Model, VertexFormat);
    }
 
+   if (ClusterSize)
+      glmBuildClusters(Model, ClusterSize);
+
    glmLoadTextures(Model);
-   glmReIndex(Model);
    glmMakeVBOs(Model);
    if (0)
       glmPrint(Model);
@@ -277,6 +331,10 @@ display(void)
            Model->numgroups);
       text(5, glutGet(GLUT_WINDOW_HEIGHT) - (5+20*7), 20, "%d materials",
            Model->nummaterials);
+      if (Model->numclusters)
+         text(5, glutGet(GLUT_WINDOW_HEIGHT) - (5+20*8), 20,
+              "%d of %d clusters drawn", Model->numclustersdrawn,
+              Model->numclusters);
    }
 
    glutSwapBuffers();
@@ -464,14 +522,39 @@ DoFeatureChecks(void)
 int
 main(int argc, char** argv)
 {
+   int i;
+
    glutInitWindowSize(WinWidth, WinHeight);
    glutInit(&argc, argv);
 
-   if (argc > 1) {
-      Model_file = argv[1];
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+         int threads = atoi(argv[++i]);
+         if (threads < 1) {
+            fprintf(stderr, "objview: -j needs at least 1 thread\n");
+            exit(1);
+         }
+         NumThreads = threads;
+      }
+      else if (strcmp(argv[i], "-cache") == 0) {
+         UseCache = GL_TRUE;
+      }
+      else if (strcmp(argv[i], "-optimize") == 0) {
+         Optimize = GL_TRUE;
+      }
+      else if (strcmp(argv[i], "-pack") == 0) {
+         VertexFormat = GLM_PACK_ALL;
+      }
+      else if (strcmp(argv[i], "-clusters") == 0) {
+         ClusterSize = 128;
+      }
+      else {
+         Model_file = argv[i];
+      }
    }
    if (!Model_file) {
-      fprintf(stderr, "usage: objview file.obj\n");
+      fprintf(stderr, "usage: objview [-j threads] [-cache] [-optimize] "
+                      "[-pack] [-clusters] file.obj\n");
       fprintf(stderr, "(using default bunny.obj)\n");
       Model_file = "bunny.obj";
    }
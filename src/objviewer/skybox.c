@@ -11,57 +11,16 @@
 
 
 static int
-load(GLenum target, const char *filename,
-     GLboolean flipTB, GLboolean flipLR)
+finish(GLenum target, const char *filename, RGBMipmapJob *job)
 {
    GLint w, h;
-   GLenum format;
-   GLubyte *img = LoadRGBImage( filename, &w, &h, &format );
-   if (!img) {
+
+   if (!FinishRGBMipmaps(job, target, GL_RGB, &w, &h)) {
       printf("Error: couldn't load texture image %s\n", filename);
       return 0;
    }
-   assert(format == GL_RGB);
 
    printf("Load cube face 0x%x: %s %d x %d\n", target, filename, w, h);
-
-   /* <sigh> the way the texture cube mapping works, we have to flip
-    * images to make things look right.
-    */
-   if (flipTB) {
-      const int stride = 3 * w;
-      GLubyte temp[3*1024];
-      int i;
-      for (i = 0; i < h / 2; i++) {
-         memcpy(temp, img + i * stride, stride);
-         memcpy(img + i * stride, img + (h - i - 1) * stride, stride);
-         memcpy(img + (h - i - 1) * stride, temp, stride);
-      }
-   }
-   if (flipLR) {
-      const int stride = 3 * w;
-      GLubyte temp[3];
-      GLubyte *row;
-      int i, j;
-      for (i = 0; i < h; i++) {
-         row = img + i * stride;
-         for (j = 0; j < w / 2; j++) {
-            int k = w - j - 1;
-            temp[0] = row[j*3+0];
-            temp[1] = row[j*3+1];
-            temp[2] = row[j*3+2];
-            row[j*3+0] = row[k*3+0];
-            row[j*3+1] = row[k*3+1];
-            row[j*3+2] = row[k*3+2];
-            row[k*3+0] = temp[0];
-            row[k*3+1] = temp[1];
-            row[k*3+2] = temp[2];
-         }
-      }
-   }
-
-   gluBuild2DMipmaps(target, GL_RGB, w, h, format, GL_UNSIGNED_BYTE, img);
-   free(img);
    return 1;
 }
 
@@ -74,7 +33,18 @@ LoadSkyBoxCubeTexture(const char *filePosX,
                       const char *filePosZ,
                       const char *fileNegZ)
 {
+   const char *files[6] = {
+      filePosX, fileNegX, filePosY, fileNegY, filePosZ, fileNegZ
+   };
+   RGBMipmapJob *jobs[6];
    GLuint tex;
+   int i, ok = 1;
+
+   /* <sigh> the way the texture cube mapping works, we have to flip
+    * images to make things look right.
+    */
+   for (i = 0; i < 6; i++)
+      jobs[i] = LoadRGBMipmapsAsync(files[i], READTEX_FLIP_TB | READTEX_FLIP_LR);
 
    glGenTextures(1, &tex);
    glBindTexture(GL_TEXTURE_CUBE_MAP, tex);
@@ -83,19 +53,16 @@ LoadSkyBoxCubeTexture(const char *filePosX,
    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER,
                    GL_LINEAR_MIPMAP_NEAREST);
 
-   if (!load(GL_TEXTURE_CUBE_MAP_POSITIVE_X, filePosX, GL_TRUE, GL_TRUE))
-      return 0;
-   if (!load(GL_TEXTURE_CUBE_MAP_NEGATIVE_X, fileNegX, GL_TRUE, GL_TRUE))
-      return 0;
-   if (!load(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, filePosY, GL_TRUE, GL_TRUE))
-      return 0;
-   if (!load(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, fileNegY, GL_TRUE, GL_TRUE))
-      return 0;
-   if (!load(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, filePosZ, GL_TRUE, GL_TRUE))
-      return 0;
-   if (!load(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, fileNegZ, GL_TRUE, GL_TRUE))
-      return 0;
+   /* wait for all of them, so that none is left running */
+   for (i = 0; i < 6; i++) {
+      if (!finish(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, files[i], jobs[i]))
+         ok = 0;
+   }
 
+   if (!ok) {
+      glDeleteTextures(1, &tex);
+      return 0;
+   }
    return tex;
 }
 
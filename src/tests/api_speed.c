@@ -27,64 +27,553 @@
  * Simple test to measure the overhead of making GL calls.
  *
  * The main purpose of this test is to measure the difference in calling
- * overhead of different dispatch methods.  Since it uses asm/timex.h to
- * access the Pentium's cycle counters, it will probably only compile on
- * Linux (though most architectures have a get_cycles function in timex.h).
- * That is why it isn't in the default Makefile.
+ * overhead of different dispatch methods.  Each entry point in the tables
+ * below is called in a tight loop through the glad dispatch, timed with
+ * the bench library, and reported as ns per call (and as CPU cycles on
+ * x86, using the TSC calibrated against the monotonic clock).
+ *
+ * Immediate mode calls are made between glBegin/glEnd without vertices.
+ * State setters and queries use the same arguments every time, so drivers
+ * that skip redundant state changes are measured doing that; binds
+ * alternate between two objects.  Entry points the GL doesn't have, or
+ * that raise an error, are skipped.
+ *
+ * Usage: api_speed [-bench-... options] [category or name ...]
+ * where category is immediate, state, query, uniform or bind, and names
+ * match any entry point containing them.  To compare libGL builds, run
+ * with -bench-format json against each (e.g. with LD_LIBRARY_PATH) and
+ * give the results to tools/benchcmp.
  *
  * \author Ian Romanick <idr@us.ibm.com>
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "glad/gl.h"
 #include "glut_wrap.h"
+#include "shaderutil.h"
+#include "bench.h"
 
-#define inline __inline__
-#include <asm/timex.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define HAVE_RDTSC 1
+#endif
 
 static float Width = 400;
 static float Height = 400;
-static unsigned count = 1000000;
+
+static char **Patterns;
+static int NumPatterns;
+
+static double CyclesPerNs = 0.0;
+
+/* arguments */
+static const GLbyte Vb[4] = { 1, 2, 3, 4 };
+static const GLdouble Vd[4] = { 1.0, 0.5, 0.25, 1.0 };
+static const GLfloat Vf[4] = { 1.0f, 0.5f, 0.25f, 1.0f };
+static const GLint Vi[4] = { 1, 2, 3, 4 };
+static const GLshort Vs[4] = { 1, 2, 3, 4 };
+static const GLubyte Vub[4] = { 255, 128, 64, 255 };
+static const GLuint Vui[4] = { 1, 2, 3, 4 };
+static const GLushort Vus[4] = { 1, 2, 3, 4 };
+static const GLboolean Vboolean[1] = { GL_TRUE };
+static const GLfloat Identity[16] = {
+   1.0f, 0.0f, 0.0f, 0.0f,
+   0.0f, 1.0f, 0.0f, 0.0f,
+   0.0f, 0.0f, 1.0f, 0.0f,
+   0.0f, 0.0f, 0.0f, 1.0f
+};
+static const GLdouble Plane[4] = { 0.0, 0.0, 1.0, 0.0 };
+
+/* query results */
+static GLint GetInts[16];
+static GLfloat GetFloats[16];
+static GLboolean GetBools[16];
+
+/* objects to bind, pairs of two or of one and 0 */
+static GLuint Buffers[2], Textures[2], Vaos[2], Fbos[2], Rbos[2];
+static GLuint Samplers[2], Programs[2];
+static GLint LocF1, LocF2, LocF3, LocF4, LocI1, LocI2, LocI3, LocI4;
+static GLint LocM2, LocM3, LocM4;
+
+
+/**
+ * The entry points, as X(function, (arguments)).  This is the place to
+ * add more API calls.
+ */
+#define IMMEDIATE_ENTRIES(X) \
+   X(glColor3b, (1, 2, 3)) \
+   X(glColor3bv, (Vb)) \
+   X(glColor3d, (1.0, 0.5, 0.25)) \
+   X(glColor3dv, (Vd)) \
+   X(glColor3f, (1.0f, 0.5f, 0.25f)) \
+   X(glColor3fv, (Vf)) \
+   X(glColor3i, (1, 2, 3)) \
+   X(glColor3iv, (Vi)) \
+   X(glColor3s, (1, 2, 3)) \
+   X(glColor3sv, (Vs)) \
+   X(glColor3ub, (255, 128, 64)) \
+   X(glColor3ubv, (Vub)) \
+   X(glColor3ui, (1, 2, 3)) \
+   X(glColor3uiv, (Vui)) \
+   X(glColor3us, (1, 2, 3)) \
+   X(glColor3usv, (Vus)) \
+   X(glColor4b, (1, 2, 3, 4)) \
+   X(glColor4bv, (Vb)) \
+   X(glColor4d, (1.0, 0.5, 0.25, 1.0)) \
+   X(glColor4dv, (Vd)) \
+   X(glColor4f, (1.0f, 0.5f, 0.25f, 1.0f)) \
+   X(glColor4fv, (Vf)) \
+   X(glColor4i, (1, 2, 3, 4)) \
+   X(glColor4iv, (Vi)) \
+   X(glColor4s, (1, 2, 3, 4)) \
+   X(glColor4sv, (Vs)) \
+   X(glColor4ub, (255, 128, 64, 255)) \
+   X(glColor4ubv, (Vub)) \
+   X(glColor4ui, (1, 2, 3, 4)) \
+   X(glColor4uiv, (Vui)) \
+   X(glColor4us, (1, 2, 3, 4)) \
+   X(glColor4usv, (Vus)) \
+   X(glNormal3b, (1, 2, 3)) \
+   X(glNormal3bv, (Vb)) \
+   X(glNormal3d, (1.0, 0.5, 0.25)) \
+   X(glNormal3dv, (Vd)) \
+   X(glNormal3f, (1.0f, 0.5f, 0.25f)) \
+   X(glNormal3fv, (Vf)) \
+   X(glNormal3i, (1, 2, 3)) \
+   X(glNormal3iv, (Vi)) \
+   X(glNormal3s, (1, 2, 3)) \
+   X(glNormal3sv, (Vs)) \
+   X(glTexCoord1d, (1.0)) \
+   X(glTexCoord1dv, (Vd)) \
+   X(glTexCoord1f, (1.0f)) \
+   X(glTexCoord1fv, (Vf)) \
+   X(glTexCoord1i, (1)) \
+   X(glTexCoord1iv, (Vi)) \
+   X(glTexCoord1s, (1)) \
+   X(glTexCoord1sv, (Vs)) \
+   X(glTexCoord2d, (1.0, 0.5)) \
+   X(glTexCoord2dv, (Vd)) \
+   X(glTexCoord2f, (1.0f, 0.5f)) \
+   X(glTexCoord2fv, (Vf)) \
+   X(glTexCoord2i, (1, 2)) \
+   X(glTexCoord2iv, (Vi)) \
+   X(glTexCoord2s, (1, 2)) \
+   X(glTexCoord2sv, (Vs)) \
+   X(glTexCoord3d, (1.0, 0.5, 0.25)) \
+   X(glTexCoord3dv, (Vd)) \
+   X(glTexCoord3f, (1.0f, 0.5f, 0.25f)) \
+   X(glTexCoord3fv, (Vf)) \
+   X(glTexCoord3i, (1, 2, 3)) \
+   X(glTexCoord3iv, (Vi)) \
+   X(glTexCoord3s, (1, 2, 3)) \
+   X(glTexCoord3sv, (Vs)) \
+   X(glTexCoord4d, (1.0, 0.5, 0.25, 1.0)) \
+   X(glTexCoord4dv, (Vd)) \
+   X(glTexCoord4f, (1.0f, 0.5f, 0.25f, 1.0f)) \
+   X(glTexCoord4fv, (Vf)) \
+   X(glTexCoord4i, (1, 2, 3, 4)) \
+   X(glTexCoord4iv, (Vi)) \
+   X(glTexCoord4s, (1, 2, 3, 4)) \
+   X(glTexCoord4sv, (Vs)) \
+   X(glMultiTexCoord1d, (GL_TEXTURE1, 1.0)) \
+   X(glMultiTexCoord1dv, (GL_TEXTURE1, Vd)) \
+   X(glMultiTexCoord1f, (GL_TEXTURE1, 1.0f)) \
+   X(glMultiTexCoord1fv, (GL_TEXTURE1, Vf)) \
+   X(glMultiTexCoord1i, (GL_TEXTURE1, 1)) \
+   X(glMultiTexCoord1iv, (GL_TEXTURE1, Vi)) \
+   X(glMultiTexCoord1s, (GL_TEXTURE1, 1)) \
+   X(glMultiTexCoord1sv, (GL_TEXTURE1, Vs)) \
+   X(glMultiTexCoord2d, (GL_TEXTURE1, 1.0, 0.5)) \
+   X(glMultiTexCoord2dv, (GL_TEXTURE1, Vd)) \
+   X(glMultiTexCoord2f, (GL_TEXTURE1, 1.0f, 0.5f)) \
+   X(glMultiTexCoord2fv, (GL_TEXTURE1, Vf)) \
+   X(glMultiTexCoord2i, (GL_TEXTURE1, 1, 2)) \
+   X(glMultiTexCoord2iv, (GL_TEXTURE1, Vi)) \
+   X(glMultiTexCoord2s, (GL_TEXTURE1, 1, 2)) \
+   X(glMultiTexCoord2sv, (GL_TEXTURE1, Vs)) \
+   X(glMultiTexCoord3d, (GL_TEXTURE1, 1.0, 0.5, 0.25)) \
+   X(glMultiTexCoord3dv, (GL_TEXTURE1, Vd)) \
+   X(glMultiTexCoord3f, (GL_TEXTURE1, 1.0f, 0.5f, 0.25f)) \
+   X(glMultiTexCoord3fv, (GL_TEXTURE1, Vf)) \
+   X(glMultiTexCoord3i, (GL_TEXTURE1, 1, 2, 3)) \
+   X(glMultiTexCoord3iv, (GL_TEXTURE1, Vi)) \
+   X(glMultiTexCoord3s, (GL_TEXTURE1, 1, 2, 3)) \
+   X(glMultiTexCoord3sv, (GL_TEXTURE1, Vs)) \
+   X(glMultiTexCoord4d, (GL_TEXTURE1, 1.0, 0.5, 0.25, 1.0)) \
+   X(glMultiTexCoord4dv, (GL_TEXTURE1, Vd)) \
+   X(glMultiTexCoord4f, (GL_TEXTURE1, 1.0f, 0.5f, 0.25f, 1.0f)) \
+   X(glMultiTexCoord4fv, (GL_TEXTURE1, Vf)) \
+   X(glMultiTexCoord4i, (GL_TEXTURE1, 1, 2, 3, 4)) \
+   X(glMultiTexCoord4iv, (GL_TEXTURE1, Vi)) \
+   X(glMultiTexCoord4s, (GL_TEXTURE1, 1, 2, 3, 4)) \
+   X(glMultiTexCoord4sv, (GL_TEXTURE1, Vs)) \
+   X(glSecondaryColor3b, (1, 2, 3)) \
+   X(glSecondaryColor3bv, (Vb)) \
+   X(glSecondaryColor3d, (1.0, 0.5, 0.25)) \
+   X(glSecondaryColor3dv, (Vd)) \
+   X(glSecondaryColor3f, (1.0f, 0.5f, 0.25f)) \
+   X(glSecondaryColor3fv, (Vf)) \
+   X(glSecondaryColor3i, (1, 2, 3)) \
+   X(glSecondaryColor3iv, (Vi)) \
+   X(glSecondaryColor3s, (1, 2, 3)) \
+   X(glSecondaryColor3sv, (Vs)) \
+   X(glSecondaryColor3ub, (255, 128, 64)) \
+   X(glSecondaryColor3ubv, (Vub)) \
+   X(glSecondaryColor3ui, (1, 2, 3)) \
+   X(glSecondaryColor3uiv, (Vui)) \
+   X(glSecondaryColor3us, (1, 2, 3)) \
+   X(glSecondaryColor3usv, (Vus)) \
+   X(glFogCoordd, (1.0)) \
+   X(glFogCoorddv, (Vd)) \
+   X(glFogCoordf, (1.0f)) \
+   X(glFogCoordfv, (Vf)) \
+   X(glIndexd, (1.0)) \
+   X(glIndexdv, (Vd)) \
+   X(glIndexf, (1.0f)) \
+   X(glIndexfv, (Vf)) \
+   X(glIndexi, (1)) \
+   X(glIndexiv, (Vi)) \
+   X(glIndexs, (1)) \
+   X(glIndexsv, (Vs)) \
+   X(glIndexub, (255)) \
+   X(glIndexubv, (Vub)) \
+   X(glEdgeFlag, (GL_TRUE)) \
+   X(glEdgeFlagv, (Vboolean)) \
+   X(glVertexAttrib1d, (1, 1.0)) \
+   X(glVertexAttrib1dv, (1, Vd)) \
+   X(glVertexAttrib1f, (1, 1.0f)) \
+   X(glVertexAttrib1fv, (1, Vf)) \
+   X(glVertexAttrib1s, (1, 1)) \
+   X(glVertexAttrib1sv, (1, Vs)) \
+   X(glVertexAttrib2d, (1, 1.0, 0.5)) \
+   X(glVertexAttrib2dv, (1, Vd)) \
+   X(glVertexAttrib2f, (1, 1.0f, 0.5f)) \
+   X(glVertexAttrib2fv, (1, Vf)) \
+   X(glVertexAttrib2s, (1, 1, 2)) \
+   X(glVertexAttrib2sv, (1, Vs)) \
+   X(glVertexAttrib3d, (1, 1.0, 0.5, 0.25)) \
+   X(glVertexAttrib3dv, (1, Vd)) \
+   X(glVertexAttrib3f, (1, 1.0f, 0.5f, 0.25f)) \
+   X(glVertexAttrib3fv, (1, Vf)) \
+   X(glVertexAttrib3s, (1, 1, 2, 3)) \
+   X(glVertexAttrib3sv, (1, Vs)) \
+   X(glVertexAttrib4d, (1, 1.0, 0.5, 0.25, 1.0)) \
+   X(glVertexAttrib4dv, (1, Vd)) \
+   X(glVertexAttrib4f, (1, 1.0f, 0.5f, 0.25f, 1.0f)) \
+   X(glVertexAttrib4fv, (1, Vf)) \
+   X(glVertexAttrib4s, (1, 1, 2, 3, 4)) \
+   X(glVertexAttrib4sv, (1, Vs)) \
+   X(glVertexAttrib4Nub, (1, 255, 128, 64, 255)) \
+   X(glVertexAttrib4bv, (1, Vb)) \
+   X(glVertexAttrib4iv, (1, Vi)) \
+   X(glVertexAttrib4ubv, (1, Vub)) \
+   X(glVertexAttrib4uiv, (1, Vui)) \
+   X(glVertexAttrib4usv, (1, Vus)) \
+   X(glVertexAttrib4Nbv, (1, Vb)) \
+   X(glVertexAttrib4Niv, (1, Vi)) \
+   X(glVertexAttrib4Nsv, (1, Vs)) \
+   X(glVertexAttrib4Nubv, (1, Vub)) \
+   X(glVertexAttrib4Nuiv, (1, Vui)) \
+   X(glVertexAttrib4Nusv, (1, Vus)) \
+   X(glMaterialf, (GL_FRONT_AND_BACK, GL_SHININESS, 10.0f)) \
+   X(glMaterialfv, (GL_FRONT_AND_BACK, GL_DIFFUSE, Vf)) \
+   X(glMateriali, (GL_FRONT_AND_BACK, GL_SHININESS, 10)) \
+   X(glMaterialiv, (GL_FRONT_AND_BACK, GL_DIFFUSE, Vi))
+
+#define STATE_ENTRIES(X) \
+   X(glEnable, (GL_DITHER)) \
+   X(glDisable, (GL_FOG)) \
+   X(glBlendFunc, (GL_ONE, GL_ZERO)) \
+   X(glBlendFuncSeparate, (GL_ONE, GL_ZERO, GL_ONE, GL_ZERO)) \
+   X(glBlendEquation, (GL_FUNC_ADD)) \
+   X(glBlendColor, (0.0f, 0.0f, 0.0f, 0.0f)) \
+   X(glDepthFunc, (GL_LESS)) \
+   X(glDepthMask, (GL_TRUE)) \
+   X(glDepthRange, (0.0, 1.0)) \
+   X(glColorMask, (GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE)) \
+   X(glCullFace, (GL_BACK)) \
+   X(glFrontFace, (GL_CCW)) \
+   X(glPolygonMode, (GL_FRONT_AND_BACK, GL_FILL)) \
+   X(glPolygonOffset, (0.0f, 0.0f)) \
+   X(glLineWidth, (1.0f)) \
+   X(glLineStipple, (1, 0xffff)) \
+   X(glPointSize, (1.0f)) \
+   X(glScissor, (0, 0, 100, 100)) \
+   X(glViewport, (0, 0, 400, 400)) \
+   X(glStencilFunc, (GL_ALWAYS, 0, ~0u)) \
+   X(glStencilFuncSeparate, (GL_FRONT, GL_ALWAYS, 0, ~0u)) \
+   X(glStencilOp, (GL_KEEP, GL_KEEP, GL_KEEP)) \
+   X(glStencilOpSeparate, (GL_FRONT, GL_KEEP, GL_KEEP, GL_KEEP)) \
+   X(glStencilMask, (~0u)) \
+   X(glClearColor, (0.0f, 0.0f, 0.0f, 0.0f)) \
+   X(glClearDepth, (1.0)) \
+   X(glClearStencil, (0)) \
+   X(glAlphaFunc, (GL_ALWAYS, 0.0f)) \
+   X(glShadeModel, (GL_SMOOTH)) \
+   X(glLogicOp, (GL_COPY)) \
+   X(glSampleCoverage, (1.0f, GL_FALSE)) \
+   X(glHint, (GL_FOG_HINT, GL_DONT_CARE)) \
+   X(glPixelStorei, (GL_UNPACK_ALIGNMENT, 4)) \
+   X(glProvokingVertex, (GL_LAST_VERTEX_CONVENTION)) \
+   X(glPrimitiveRestartIndex, (0xffff)) \
+   X(glClipPlane, (GL_CLIP_PLANE0, Plane)) \
+   X(glActiveTexture, (GL_TEXTURE0)) \
+   X(glClientActiveTexture, (GL_TEXTURE0)) \
+   X(glMatrixMode, (GL_MODELVIEW)) \
+   X(glLoadIdentity, ()) \
+   X(glLoadMatrixf, (Identity)) \
+   X(glMultMatrixf, (Identity)) \
+   X(glTranslatef, (0.0f, 0.0f, 0.0f)) \
+   X(glRotatef, (0.0f, 0.0f, 0.0f, 1.0f)) \
+   X(glScalef, (1.0f, 1.0f, 1.0f)) \
+   X(glTexParameteri, (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST)) \
+   X(glTexParameterf, (GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, 0.0f)) \
+   X(glTexParameterfv, (GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, Vf)) \
+   X(glTexEnvi, (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE)) \
+   X(glTexEnvfv, (GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, Vf)) \
+   X(glTexGeni, (GL_S, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR)) \
+   X(glTexGenfv, (GL_S, GL_OBJECT_PLANE, Vf)) \
+   X(glLightf, (GL_LIGHT0, GL_SPOT_EXPONENT, 0.0f)) \
+   X(glLightfv, (GL_LIGHT0, GL_POSITION, Vf)) \
+   X(glLightModeli, (GL_LIGHT_MODEL_TWO_SIDE, 0)) \
+   X(glColorMaterial, (GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE)) \
+   X(glFogf, (GL_FOG_DENSITY, 1.0f)) \
+   X(glFogi, (GL_FOG_MODE, GL_EXP)) \
+   X(glFogfv, (GL_FOG_COLOR, Vf)) \
+   X(glEnableClientState, (GL_VERTEX_ARRAY)) \
+   X(glDisableClientState, (GL_COLOR_ARRAY)) \
+   X(glVertexPointer, (3, GL_FLOAT, 0, Vf)) \
+   X(glColorPointer, (4, GL_UNSIGNED_BYTE, 0, Vub)) \
+   X(glNormalPointer, (GL_FLOAT, 0, Vf)) \
+   X(glTexCoordPointer, (2, GL_FLOAT, 0, Vf)) \
+   X(glVertexAttribPointer, (1, 4, GL_FLOAT, GL_FALSE, 0, Vf)) \
+   X(glEnableVertexAttribArray, (1)) \
+   X(glDisableVertexAttribArray, (2)) \
+   X(glVertexAttribDivisor, (1, 0))
+
+#define QUERY_ENTRIES(X) \
+   X(glGetError, ()) \
+   X(glIsEnabled, (GL_BLEND)) \
+   X(glGetIntegerv, (GL_VIEWPORT, GetInts)) \
+   X(glGetFloatv, (GL_CURRENT_COLOR, GetFloats)) \
+   X(glGetBooleanv, (GL_DEPTH_WRITEMASK, GetBools)) \
+   X(glGetString, (GL_VENDOR)) \
+   X(glGetTexParameteriv, (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GetInts)) \
+   X(glGetTexEnvfv, (GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, GetFloats)) \
+   X(glIsTexture, (Textures[1])) \
+   X(glIsBuffer, (Buffers[1])) \
+   X(glGetUniformLocation, (Programs[1], "f4"))
+
+#define UNIFORM_ENTRIES(X) \
+   X(glUniform1f, (LocF1, 1.0f)) \
+   X(glUniform2f, (LocF2, 1.0f, 0.5f)) \
+   X(glUniform3f, (LocF3, 1.0f, 0.5f, 0.25f)) \
+   X(glUniform4f, (LocF4, 1.0f, 0.5f, 0.25f, 1.0f)) \
+   X(glUniform1fv, (LocF1, 1, Vf)) \
+   X(glUniform2fv, (LocF2, 1, Vf)) \
+   X(glUniform3fv, (LocF3, 1, Vf)) \
+   X(glUniform4fv, (LocF4, 1, Vf)) \
+   X(glUniform1i, (LocI1, 1)) \
+   X(glUniform2i, (LocI2, 1, 2)) \
+   X(glUniform3i, (LocI3, 1, 2, 3)) \
+   X(glUniform4i, (LocI4, 1, 2, 3, 4)) \
+   X(glUniform1iv, (LocI1, 1, Vi)) \
+   X(glUniform2iv, (LocI2, 1, Vi)) \
+   X(glUniform3iv, (LocI3, 1, Vi)) \
+   X(glUniform4iv, (LocI4, 1, Vi)) \
+   X(glUniformMatrix2fv, (LocM2, 1, GL_FALSE, Identity)) \
+   X(glUniformMatrix3fv, (LocM3, 1, GL_FALSE, Identity)) \
+   X(glUniformMatrix4fv, (LocM4, 1, GL_FALSE, Identity))
+
+#define BIND_ENTRIES(X) \
+   X(glBindBuffer, (GL_ARRAY_BUFFER, Buffers[i & 1])) \
+   X(glBindBufferBase, (GL_UNIFORM_BUFFER, 0, Buffers[i & 1])) \
+   X(glBindBufferRange, (GL_UNIFORM_BUFFER, 0, Buffers[1], 0, (i & 1) ? 256 : 128)) \
+   X(glBindTexture, (GL_TEXTURE_2D, Textures[i & 1])) \
+   X(glBindVertexArray, (Vaos[i & 1])) \
+   X(glBindFramebuffer, (GL_FRAMEBUFFER, Fbos[i & 1])) \
+   X(glBindRenderbuffer, (GL_RENDERBUFFER, Rbos[i & 1])) \
+   X(glBindSampler, (0, Samplers[i & 1])) \
+   X(glUseProgram, (Programs[i & 1]))
+
+
+enum category {
+   IMMEDIATE,
+   STATE,
+   QUERY,
+   UNIFORM,
+   BIND,
+   NUM_CATEGORIES
+};
+
+static const char *CategoryNames[NUM_CATEGORIES] = {
+   "immediate", "state", "query", "uniform", "bind"
+};
+
+struct entry {
+   const char *name;
+   enum category category;
+   bench_func loop;
+   const void *proc;            /* the glad function pointer */
+};
 
 
-static void Idle( void )
+#define DEFINE_LOOP(func, args) \
+   static void \
+   func##_loop(void *data, unsigned iterations) \
+   { \
+      unsigned i; \
+      (void) data; \
+      for (i = 0; i < iterations; i++) \
+         func args; \
+   }
+
+IMMEDIATE_ENTRIES(DEFINE_LOOP)
+STATE_ENTRIES(DEFINE_LOOP)
+QUERY_ENTRIES(DEFINE_LOOP)
+UNIFORM_ENTRIES(DEFINE_LOOP)
+BIND_ENTRIES(DEFINE_LOOP)
+
+#define IMMEDIATE_ENTRY(func, args) \
+   { #func, IMMEDIATE, func##_loop, (const void *) &func },
+#define STATE_ENTRY(func, args) \
+   { #func, STATE, func##_loop, (const void *) &func },
+#define QUERY_ENTRY(func, args) \
+   { #func, QUERY, func##_loop, (const void *) &func },
+#define UNIFORM_ENTRY(func, args) \
+   { #func, UNIFORM, func##_loop, (const void *) &func },
+#define BIND_ENTRY(func, args) \
+   { #func, BIND, func##_loop, (const void *) &func },
+
+static const struct entry Entries[] = {
+   IMMEDIATE_ENTRIES(IMMEDIATE_ENTRY)
+   STATE_ENTRIES(STATE_ENTRY)
+   QUERY_ENTRIES(QUERY_ENTRY)
+   UNIFORM_ENTRIES(UNIFORM_ENTRY)
+   BIND_ENTRIES(BIND_ENTRY)
+};
+
+#define NUM_ENTRIES (sizeof(Entries) / sizeof(Entries[0]))
+
+
+static GLboolean
+Selected(const struct entry *e)
 {
-   glutPostRedisplay();
+   int i;
+
+   if (NumPatterns == 0)
+      return GL_TRUE;
+   for (i = 0; i < NumPatterns; i++) {
+      if (strcmp(Patterns[i], CategoryNames[e->category]) == 0 ||
+          strstr(e->name, Patterns[i]))
+         return GL_TRUE;
+   }
+   return GL_FALSE;
+}
+
+
+static void
+RunEntry(void *data, unsigned iterations)
+{
+   const struct entry *e = (const struct entry *) data;
+
+   if (e->category == IMMEDIATE)
+      glBegin(GL_POINTS);
+   e->loop(NULL, iterations);
+   if (e->category == IMMEDIATE)
+      glEnd();
 }
 
-#define DO_FUNC(f,p) \
-   do { \
-      t0 = get_cycles(); \
-      for ( i = 0 ; i < count ; i++ ) { \
-	 f p ; \
-      } \
-      t1 = get_cycles(); \
-      printf("%u calls to % 20s required %llu cycles.\n", count, # f, t1 - t0); \
-   } while( 0 )
 
 /**
- * Main display function.  This is the place to add more API calls.
+ * Measure the TSC frequency against the monotonic clock, so that times
+ * can be given in cycles as well.
+ */
+static void
+CalibrateCycles(void)
+{
+#ifdef HAVE_RDTSC
+   uint64_t t0, t1;
+   unsigned long long c0, c1;
+
+   t0 = bench_time_ns();
+   c0 = __rdtsc();
+   do {
+      t1 = bench_time_ns();
+   } while (t1 - t0 < 50000000);
+   c1 = __rdtsc();
+
+   CyclesPerNs = (double) (c1 - c0) / (t1 - t0);
+   printf("TSC: %.3f GHz\n", CyclesPerNs);
+#endif
+}
+
+
+/**
+ * Main display function.
  */
 static void Display( void )
 {
-   int i;
-   const float v[3] = { 1.0, 0.0, 0.0 };
-   cycles_t t0;
-   cycles_t t1;
+   double ns[NUM_ENTRIES];
+   unsigned i, j;
+
+   for (j = 0; j < NUM_ENTRIES; j++)
+      ns[j] = -1.0;
+
+   for (i = 0; i < NUM_CATEGORIES; i++) {
+      if (i == UNIFORM) {
+         /* no GLSL, or the program failed to link */
+         if (!Programs[1]) {
+            fprintf(stderr, "uniform entry points: no program, skipped\n");
+            continue;
+         }
+         glUseProgram(Programs[1]);
+      }
+
+      for (j = 0; j < NUM_ENTRIES; j++) {
+         const struct entry *e = &Entries[j];
+         struct bench_result result;
+         GLenum err;
 
-   glBegin(GL_TRIANGLE_STRIP);
+         if (e->category != i || !Selected(e))
+            continue;
 
-   DO_FUNC( glColor3fv, (v) );
-   DO_FUNC( glNormal3fv, (v) );
-   DO_FUNC( glTexCoord2fv, (v) );
-   DO_FUNC( glTexCoord3fv, (v) );
-   DO_FUNC( glMultiTexCoord2fv, (GL_TEXTURE0, v) );
-   DO_FUNC( glMultiTexCoord2f, (GL_TEXTURE0, 0.0, 0.0) );
-   DO_FUNC( glFogCoordfvEXT, (v) );
-   DO_FUNC( glFogCoordfEXT, (0.5) );
+         if (!*(const GLADapiproc *) e->proc) {
+            fprintf(stderr, "%s: not supported\n", e->name);
+            continue;
+         }
 
-   glEnd();
+         while (glGetError() != GL_NO_ERROR)
+            ;
+         RunEntry((void *) e, 1);
+         err = glGetError();
+         if (err != GL_NO_ERROR) {
+            fprintf(stderr, "%s: GL error 0x%x, skipped\n", e->name, err);
+            continue;
+         }
+
+         bench_run(e->name, RunEntry, (void *) e, 1.0, "calls", &result);
+         ns[j] = result.wall_ns_per_op;
+      }
+
+      if (i == UNIFORM)
+         glUseProgram(0);
+   }
+
+   printf("\n%-28s %10s %10s\n", "entry point", "ns/call", "cycles");
+   for (j = 0; j < NUM_ENTRIES; j++) {
+      if (ns[j] < 0.0)
+         continue;
+      printf("%-28s %10.2f", Entries[j].name, ns[j]);
+      if (CyclesPerNs > 0.0)
+         printf(" %10.1f", ns[j] * CyclesPerNs);
+      printf("\n");
+   }
 
    exit(0);
 }
@@ -116,8 +605,89 @@ static void Key( unsigned char key, int x, int y )
 }
 
 
+static const char *VertShaderText =
+   "uniform float f1; \n"
+   "uniform vec2 f2; \n"
+   "uniform vec3 f3; \n"
+   "uniform vec4 f4; \n"
+   "uniform int i1; \n"
+   "uniform ivec2 i2; \n"
+   "uniform ivec3 i3; \n"
+   "uniform ivec4 i4; \n"
+   "uniform mat2 m2; \n"
+   "uniform mat3 m3; \n"
+   "uniform mat4 m4; \n"
+   "void main() \n"
+   "{ \n"
+   "   gl_Position = m4 * gl_Vertex \n"
+   "      + vec4(f1 + float(i1), f2 + vec2(i2), 0.0) \n"
+   "      + vec4(f3 + vec3(i3), 0.0) + f4 + vec4(i4) \n"
+   "      + vec4(m2[0], m3[0].xy); \n"
+   "} \n";
+
+static const char *FragShaderText =
+   "void main() \n"
+   "{ \n"
+   "   gl_FragColor = vec4(1.0); \n"
+   "} \n";
+
+
+/**
+ * Create the objects the bind and uniform entries use.
+ */
+static void Init( void )
+{
+   printf("GL_RENDERER = %s\n", (char *) glGetString(GL_RENDERER));
+   printf("GL_VERSION = %s\n", (char *) glGetString(GL_VERSION));
+   bench_set_renderer((const char *) glGetString(GL_RENDERER));
+
+   glGenTextures(2, Textures);
+
+   if (glGenBuffers) {
+      int i;
+      glGenBuffers(2, Buffers);
+      for (i = 0; i < 2; i++) {
+         glBindBuffer(GL_ARRAY_BUFFER, Buffers[i]);
+         glBufferData(GL_ARRAY_BUFFER, 256, NULL, GL_STATIC_DRAW);
+      }
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+   }
+   if (glGenVertexArrays)
+      glGenVertexArrays(2, Vaos);
+   if (glGenFramebuffers) {
+      glGenFramebuffers(1, &Fbos[1]);
+      glGenRenderbuffers(2, Rbos);
+   }
+   if (glGenSamplers)
+      glGenSamplers(1, &Samplers[1]);
+
+   if (ShadersSupported()) {
+      GLuint vs = CompileShaderText(GL_VERTEX_SHADER, VertShaderText);
+      GLuint fs = CompileShaderText(GL_FRAGMENT_SHADER, FragShaderText);
+      Programs[1] = LinkShaders(vs, fs);
+      LocF1 = glGetUniformLocation(Programs[1], "f1");
+      LocF2 = glGetUniformLocation(Programs[1], "f2");
+      LocF3 = glGetUniformLocation(Programs[1], "f3");
+      LocF4 = glGetUniformLocation(Programs[1], "f4");
+      LocI1 = glGetUniformLocation(Programs[1], "i1");
+      LocI2 = glGetUniformLocation(Programs[1], "i2");
+      LocI3 = glGetUniformLocation(Programs[1], "i3");
+      LocI4 = glGetUniformLocation(Programs[1], "i4");
+      LocM2 = glGetUniformLocation(Programs[1], "m2");
+      LocM3 = glGetUniformLocation(Programs[1], "m3");
+      LocM4 = glGetUniformLocation(Programs[1], "m4");
+   }
+
+   CalibrateCycles();
+}
+
+
 int main( int argc, char *argv[] )
 {
+   /* many short tests */
+   bench_set_defaults(5, 0.02, 0.01);
+   bench_init(&argc, argv);
+
    glutInit( &argc, argv );
    glutInitWindowSize( (int) Width, (int) Height );
    glutInitWindowPosition( 0, 0 );
@@ -127,18 +697,14 @@ int main( int argc, char *argv[] )
    glutCreateWindow( argv[0] );
    gladLoaderLoadGL();
 
-   if ( argc > 1 ) {
-      count = strtoul( argv[1], NULL, 0 );
-      if ( count == 0 ) {
-	 fprintf( stderr, "Usage: %s [iterations]\n", argv[0] );
-	 exit(1);
-      }
-   }
+   Patterns = argv + 1;
+   NumPatterns = argc - 1;
+
+   Init();
 
    glutReshapeFunc( Reshape );
    glutKeyboardFunc( Key );
    glutDisplayFunc( Display );
-   glutIdleFunc( Idle );
 
    glutMainLoop();
    gladLoaderUnloadGL();
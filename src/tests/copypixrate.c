@@ -11,6 +11,7 @@
 #include <math.h>
 #include "glad/gl.h"
 #include "glut_wrap.h"
+#include "bench.h"
 
 static GLint WinWidth = 1000, WinHeight = 800;
 static GLint ImgWidth, ImgHeight;
@@ -95,15 +96,28 @@ BlitOne(void)
 }
 
 
+static void
+CopyLoop(void *data, unsigned iterations)
+{
+   unsigned i;
+
+   (void) data;
+   for (i = 0; i < iterations; i++) {
+      BlitOne();
+
+      if (Buffer == GL_FRONT)
+         glFinish(); /* XXX to view progress */
+   }
+   glFinish();
+}
+
+
 /**
  * Measure glCopyPixels rate
  */
 static void
 RunTest(void)
 {
-   double t1, t0 = glutGet(GLUT_ELAPSED_TIME) / 1000.0;
-   int iters = 0;
-   float copyRate, mbRate;
    int r, g, b, a, bpp;
 
    if (AlphaTest) {
@@ -117,25 +131,11 @@ RunTest(void)
    glGetIntegerv(GL_ALPHA_BITS, &a);
    bpp = (r + g + b + a) / 8;
 
-   do {
-      BlitOne();
-
-      if (Buffer == GL_FRONT)
-         glFinish(); /* XXX to view progress */
-
-      iters++;
-
-      t1 = glutGet(GLUT_ELAPSED_TIME) / 1000.0;
-   } while (t1 - t0 < 5.0);
+   printf("Image size: %d x %d, %d Bpp\n", ImgWidth, ImgHeight, bpp);
+   bench_run(UseBlit ? "glBlitFramebuffer" : "glCopyPixels", CopyLoop, NULL,
+             ImgWidth * ImgHeight * bpp / 1000000.0, "MB", NULL);
 
    glDisable(GL_ALPHA_TEST);
-
-   copyRate = iters / (t1 - t0);
-   mbRate = ImgWidth * ImgHeight * bpp * copyRate / (1024 * 1024);
-
-   printf("Image size: %d x %d, %d Bpp\n", ImgWidth, ImgHeight, bpp);
-   printf("%d copies in %.2f = %.2f copies/sec, %.2f MB/s\n",
-          iters, t1-t0, copyRate, mbRate);
 }
 
 
@@ -244,6 +244,7 @@ int
 main(int argc, char *argv[])
 {
    GLint mode = GLUT_RGB | GLUT_ALPHA | GLUT_DOUBLE | GLUT_DEPTH;
+   bench_init(&argc, argv);
    glutInit(&argc, argv);
 
    ParseArgs(argc, argv);
@@ -261,6 +262,7 @@ main(int argc, char *argv[])
    glutDisplayFunc(Draw);
 
    printf("GL_RENDERER: %s\n", (char *) glGetString(GL_RENDERER));
+   bench_set_renderer((const char *) glGetString(GL_RENDERER));
    printf("Draw Buffer: %s\n", (Buffer == GL_BACK) ? "Back" : "Front");
    Init();
 
@@ -12,6 +12,7 @@
 #include "glad/gl.h"
 #include "glut_wrap.h"
 #include "readtex.h"
+#include "bench.h"
 
 #define TEXTURE_1_FILE DEMOS_DATA_DIR "tile.png"
 #define TEXTURE_2_FILE DEMOS_DATA_DIR "reflect.png"
@@ -53,16 +54,26 @@ DrawQuad(void)
 }
 
 
+static void
+DrawLoop(void *data, unsigned iterations)
+{
+   unsigned i;
+
+   (void) data;
+   for (i = 0; i < iterations; i++) {
+      DrawQuad();
+   }
+   glFinish();
+}
+
+
 /**
  * Compute rate for drawing large quad with given shading/texture state.
  */
 static void
 RunTest(GLenum shading, GLuint numTextures, GLenum texFilter)
 {
-   const GLdouble minPeriod = 2.0;
-   GLdouble t0, t1;
-   GLdouble pixels, rate;
-   GLint i, iters;
+   char name[100];
 
    glActiveTexture(GL_TEXTURE0);
    if (numTextures > 0) {
@@ -89,29 +100,13 @@ RunTest(GLenum shading, GLuint numTextures, GLenum texFilter)
    glShadeModel(shading);
 
 
-   glFinish();
-
-   iters = 1;
-   do {
-      iters *= 4;
-      t0 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
-      for (i = 0; i < iters; i++) {
-         DrawQuad();
-      }
-      glFinish();
-      t1 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
-   } while (t1 - t0 < minPeriod);
+   snprintf(name, sizeof(name), "%s Textures=%u Filter=%s",
+            shading == GL_FLAT ? "GL_FLAT" : "GL_SMOOTH", numTextures,
+            texFilter == GL_LINEAR ? "GL_LINEAR" : "GL_NEAREST");
+   bench_run(name, DrawLoop, NULL,
+             (Width - 10) * (Height - 10) / 1000000.0, "MPixels", NULL);
 
    glutSwapBuffers();
-
-   pixels = (double) iters * (Width - 10) * (Height - 10);
-   rate = pixels / (t1 - t0);
-   rate /= 1000000.0;  /* megapixels/second */
-
-   printf("%s ", shading == GL_FLAT ? "GL_FLAT" : "GL_SMOOTH");
-   printf("Textures=%u ", numTextures);
-   printf("Filter=%s: ", texFilter == GL_LINEAR ? "GL_LINEAR" : "GL_NEAREST");
-   printf("%g MPixels/sec\n", rate);
 }
 
 
@@ -164,6 +159,7 @@ static void
 Init(void)
 {
    printf("GL_RENDERER = %s\n", (char *) glGetString(GL_RENDERER));
+   bench_set_renderer((const char *) glGetString(GL_RENDERER));
 
    glGenTextures(2, Textures);
 
@@ -189,6 +185,7 @@ Init(void)
 int
 main(int argc, char *argv[])
 {
+   bench_init(&argc, argv);
    glutInit(&argc, argv);
    glutInitWindowPosition(0, 0);
    glutInitWindowSize(Width, Height);
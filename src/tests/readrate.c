@@ -11,8 +11,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <stdint.h>
+#include <string.h>
 #include "glad/gl.h"
 #include "glut_wrap.h"
+#include "bench.h"
 
 /* Hack, to test drawing instead of reading */
 #define DRAW 0
@@ -33,6 +36,17 @@ static GLboolean Benchmark = GL_TRUE;
 static GLuint PBObjects[4];
 
 static GLboolean HavePBO = GL_FALSE;
+static GLboolean HaveSync = GL_FALSE;
+
+/*
+ * The readback pipeline: frame N is rendered and read into a PBO, and
+ * frame N - depth is mapped and copied out, as for capturing to an
+ * encoder.  Depth 0 is synchronous readback.
+ */
+#define MAX_DEPTH 3
+
+static const GLuint Depths[] = {0, 1, 2, MAX_DEPTH};
+static GLuint PipePBO[MAX_DEPTH + 1];
 
 
 struct format_type {
@@ -58,6 +72,11 @@ static struct format_type Formats[] = {
 
 #define NUM_FORMATS (sizeof(Formats) / sizeof(struct format_type))
 
+/* Formats[] entry the readback pipeline uses: GL_BGRA,
+ * GLuint_8_8_8_8_rev, the layout most GLs read back without converting
+ */
+#define PIPELINE_FORMAT 7
+
 
 static void
 PrintString(const char *s)
@@ -69,14 +88,22 @@ PrintString(const char *s)
 }
 
 
+struct measure {
+   const struct format_type *fmt;
+   GLint width, height;
+   GLuint pbo;
+   GLuint depth;                 /* of the readback pipeline */
+};
+
+
 static void
-MeasureFormat(struct format_type *fmt, GLint width, GLint height, GLuint pbo)
+ReadLoop(void *data, unsigned iterations)
 {
-   double t0 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
-   double t1;
-   int j;
+   const struct measure *m = (const struct measure *) data;
+   const struct format_type *fmt = m->fmt;
+   unsigned j;
 
-   for (j = 0; ; j++) {
+   for (j = 0; j < iterations; j++) {
 
       glBegin(GL_POINTS);
       glVertex2f(1,1);
@@ -84,46 +111,176 @@ MeasureFormat(struct format_type *fmt, GLint width, GLint height, GLuint pbo)
 
 #if DRAW
       glWindowPos2iARB(0,0);
-      glDrawPixels(width, height,
+      glDrawPixels(m->width, m->height,
                    fmt->Format, fmt->Type, Buffer);
-      glFinish();
 #else
-      if (pbo) {
+      if (m->pbo) {
          glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, PBObjects[j % NUM_PBO]);
-         glReadPixels(0, 0, width, height,
+         glReadPixels(0, 0, m->width, m->height,
                       fmt->Format, fmt->Type, 0);
       }
       else {
-         glReadPixels(0, 0, width, height,
+         glReadPixels(0, 0, m->width, m->height,
                       fmt->Format, fmt->Type, Buffer);
       }
 #endif
+   }
+   glFinish();
+}
 
-      t1 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
-      if (t1 - t0 > 2.0) {
-         GLdouble rate = width * height / (1024.0 * 1024.0) * j / (t1 - t0);
-#if DRAW
-         printf("%-32s  %.2f draws/sec %.2f MPixels/sec  %.2f MBytes/sec\n",
-                fmt->Name, j / (t1-t0), rate, rate * fmt->Bytes);
-#else
-         printf("%-32s  %.2f reads/sec %.2f MPixels/sec  %.2f MBytes/sec\n",
-                fmt->Name, j / (t1-t0), rate, rate * fmt->Bytes);
-#endif
-         break;
+
+static void
+MeasureFormat(struct format_type *fmt, GLint width, GLint height, GLuint pbo)
+{
+   struct measure m;
+   char name[100];
+   GLenum err;
+
+   m.fmt = fmt;
+   m.width = width;
+   m.height = height;
+   m.pbo = pbo;
+   m.depth = 0;
+
+   /* check for error */
+   ReadLoop(&m, 1);
+   err = glGetError();
+   if (err) {
+      printf("GL Error 0x%x for %s\n", err, fmt->Name);
+      return;
+   }
+
+   snprintf(name, sizeof(name), "%s%s", fmt->Name, pbo ? ", PBO" : "");
+   bench_run(name, ReadLoop, &m, width * height / 1000000.0,
+             "MPixels", NULL);
+}
+
+
+
+struct pipe_frame {
+   GLsync fence;
+   uint64_t submitted;
+};
+
+struct pipe_stats {
+   unsigned long frames;
+   unsigned long blocked;        /* maps where the read hadn't finished */
+   uint64_t blocked_ns;
+   uint64_t latency_ns;          /* from submitting a read to mapping it */
+};
+
+static struct pipe_stats PipeStats;
+
+
+/** Wait for a frame's read to land, then copy it out as a consumer would */
+static void
+ConsumeFrame(const struct measure *m, struct pipe_frame *f, GLuint pbo)
+{
+   const struct format_type *fmt = m->fmt;
+   uint64_t t0 = bench_time_ns();
+   const void *ptr;
+
+   if (glClientWaitSync(f->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) ==
+       GL_TIMEOUT_EXPIRED) {
+      while (glClientWaitSync(f->fence, 0, 1000000000) == GL_TIMEOUT_EXPIRED)
+         ;
+      PipeStats.blocked++;
+   }
+   glDeleteSync(f->fence);
+   f->fence = NULL;
+
+   glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, pbo);
+   ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER_EXT, 0,
+                          m->width * m->height * fmt->Bytes, GL_MAP_READ_BIT);
+   PipeStats.blocked_ns += bench_time_ns() - t0;
+   PipeStats.latency_ns += bench_time_ns() - f->submitted;
+   PipeStats.frames++;
+
+   if (ptr)
+      memcpy(Buffer, ptr, m->width * m->height * fmt->Bytes);
+   glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_EXT);
+}
+
+
+static void
+PipelineLoop(void *data, unsigned iterations)
+{
+   const struct measure *m = (const struct measure *) data;
+   const struct format_type *fmt = m->fmt;
+   const unsigned depth = m->depth;
+   struct pipe_frame frames[MAX_DEPTH + 1];
+   unsigned j;
+
+   memset(frames, 0, sizeof(frames));
+
+   for (j = 0; j < iterations + depth; j++) {
+      if (j < iterations) {
+         const unsigned slot = j % (depth + 1);
+
+         /* a new frame, so that nothing is left over from the last */
+         glClearColor((j & 1) * 0.5f, 0.25f, 0.5f, 1.0f);
+         glClear(GL_COLOR_BUFFER_BIT);
+         glBegin(GL_TRIANGLES);
+         glColor3f(1, 1, 1);
+         glVertex2f(-1, -1);
+         glVertex2f(1, -1);
+         glVertex2f(0, 1);
+         glEnd();
+
+         glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, PipePBO[slot]);
+         glReadPixels(0, 0, m->width, m->height,
+                      fmt->Format, fmt->Type, 0);
+         frames[slot].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+         frames[slot].submitted = bench_time_ns();
       }
 
-      if (j == 0) {
-         /* check for error */
-         GLenum err = glGetError();
-         if (err) {
-            printf("GL Error 0x%x for %s\n", err, fmt->Name);
-            return;
-         }
+      /* the frame that went in depth frames ago */
+      if (j >= depth) {
+         const unsigned slot = (j - depth) % (depth + 1);
+         ConsumeFrame(m, &frames[slot], PipePBO[slot]);
       }
    }
+   glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, 0);
+   glFinish();
 }
 
 
+static void
+MeasurePipeline(struct format_type *fmt, GLint width, GLint height,
+                GLuint depth)
+{
+   struct bench_result result;
+   struct measure m;
+   char name[100];
+   GLenum err;
+
+   m.fmt = fmt;
+   m.width = width;
+   m.height = height;
+   m.pbo = 0;
+   m.depth = depth;
+
+   /* check for error */
+   PipelineLoop(&m, 1);
+   err = glGetError();
+   if (err) {
+      printf("GL Error 0x%x for %s, pipeline depth %u\n",
+             err, fmt->Name, depth);
+      return;
+   }
+
+   snprintf(name, sizeof(name), "%s, pipeline depth %u", fmt->Name, depth);
+   memset(&PipeStats, 0, sizeof(PipeStats));
+   bench_run(name, PipelineLoop, &m, width * height / 1000000.0,
+             "MPixels", &result);
+   printf("  %.1f frames/sec, latency %.3f ms, %.0f%% of maps blocked "
+          "(%.3f ms/frame)\n",
+          result.median / (width * height / 1000000.0),
+          PipeStats.latency_ns / 1e6 / PipeStats.frames,
+          100.0 * PipeStats.blocked / PipeStats.frames,
+          PipeStats.blocked_ns / 1e6 / PipeStats.frames);
+}
+
 
 static void
 Draw(void)
@@ -174,6 +331,15 @@ Draw(void)
          }
       }
 
+      if (HavePBO && HaveSync) {
+         printf("Readback pipeline:\n");
+         for (i = 0; i < sizeof(Depths) / sizeof(Depths[0]); i++) {
+            MeasurePipeline(&Formats[PIPELINE_FORMAT], width, height, Depths[i]);
+         }
+         glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, 0);
+         glClearColor(0, 0, 0, 0);
+      }
+
       Benchmark = GL_FALSE;
 
       /* redraw window text */
@@ -250,6 +416,7 @@ Init(void)
    printf("glReadPixels test report:\n");
 #endif
    printf("GL_RENDERER: %s\n", (char *) glGetString(GL_RENDERER));
+   bench_set_renderer((const char *) glGetString(GL_RENDERER));
    printf("GL_VERSION: %s\n", (char *) glGetString(GL_VERSION));
 
    if (glutExtensionSupported("GL_ARB_pixel_buffer_object")) {
@@ -261,6 +428,18 @@ Init(void)
          glBufferDataARB(GL_PIXEL_PACK_BUFFER_EXT,
                          MAX_WIDTH * MAX_HEIGHT * 4, NULL, GL_STREAM_READ);
       }
+
+      /* for the readback pipeline */
+      if (glutExtensionSupported("GL_ARB_sync") &&
+          glutExtensionSupported("GL_ARB_map_buffer_range")) {
+         HaveSync = 1;
+         glGenBuffersARB(MAX_DEPTH + 1, PipePBO);
+         for (i = 0; i < MAX_DEPTH + 1; i++) {
+            glBindBufferARB(GL_PIXEL_PACK_BUFFER_EXT, PipePBO[i]);
+            glBufferDataARB(GL_PIXEL_PACK_BUFFER_EXT,
+                            MAX_WIDTH * MAX_HEIGHT * 4, NULL, GL_STREAM_READ);
+         }
+      }
    }
 }
 
@@ -268,6 +447,7 @@ Init(void)
 int
 main(int argc, char *argv[])
 {
+   bench_init(&argc, argv);
    glutInit(&argc, argv);
    glutInitWindowPosition(0, 0);
    glutInitWindowSize(MAX_WIDTH, MAX_HEIGHT);
@@ -11,6 +11,7 @@
 #include <math.h>
 #include "glad/gl.h"
 #include "glut_wrap.h"
+#include "bench.h"
 
 static GLint WinWidth = 1024, WinHeight = 512;
 static GLint TexWidth = 512, TexHeight = 512;
@@ -139,53 +140,32 @@ SubTex(GLboolean doSubRect, const GLubyte *image)
 }
 
 
-/**
- * Measure gl[Copy]TexSubImage rate.
- * This actually also includes time to render a quad and SwapBuffers.
- */
-static void
-RunTest(GLboolean copyTex, GLboolean doSubRect)
-{
-   double t0, t1;
-   int iters = 0;
-   float copyRate, mbRate;
-   float rot = 0.0;
-   int bpp, r, g, b, a;
-   int w, h;
-   GLubyte *image = NULL;
-
-   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_RED_SIZE, &r);
-   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_GREEN_SIZE, &g);
-   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_BLUE_SIZE, &b);
-   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_ALPHA_SIZE, &a);
-   bpp = (r + g + b + a) / 8;
-
-   if (!copyTex) {
-      /* read image from frame buffer */
-      image = (GLubyte *) malloc(TexWidth * TexHeight * bpp);
-      glPixelStorei(GL_PACK_ALIGNMENT, 1);
-      glReadPixels(0, 0, TexWidth, TexHeight,
-                   ReadFormat, GL_UNSIGNED_BYTE, image);
-   }
+struct subtex {
+   GLboolean copyTex, doSubRect;
+   const GLubyte *image;
+   float rot;
+};
 
-   glEnable(GL_TEXTURE_2D);
-   glViewport(WinWidth / 2, 0, WinWidth / 2, WinHeight);
 
-   t0 = glutGet(GLUT_ELAPSED_TIME) / 1000.0;
+static void
+SubTexLoop(void *data, unsigned iterations)
+{
+   struct subtex *st = (struct subtex *) data;
+   unsigned i;
 
-   do {
-      if (copyTex)
+   for (i = 0; i < iterations; i++) {
+      if (st->copyTex)
          /* Framebuffer -> Texture */
-         DoCopyTex(doSubRect);
+         DoCopyTex(st->doSubRect);
       else {
          /* Main Mem -> Texture */
-         SubTex(doSubRect, image);
+         SubTex(st->doSubRect, st->image);
       }
 
       /* draw textured quad */
       if (DrawQuad) {
          glPushMatrix();
-            glRotatef(rot, 0, 0, 1);
+            glRotatef(st->rot, 0, 0, 1);
             glTranslatef(1, 0, 0);
             glBegin(GL_POLYGON);
                glTexCoord2f(0, 0);  glVertex2f(-1, -1);
@@ -196,38 +176,70 @@ RunTest(GLboolean copyTex, GLboolean doSubRect)
          glPopMatrix();
       }
 
-      iters++;
-      rot += 2.0;
+      st->rot += 2.0;
 
-      t1 = glutGet(GLUT_ELAPSED_TIME) / 1000.0;
       if (DrawQuad) {
          glutSwapBuffers();
       }
-   } while (t1 - t0 < 5.0);
+   }
+   glFinish();
+}
 
-   glDisable(GL_TEXTURE_2D);
-   if (image)
-      free(image);
+
+/**
+ * Measure gl[Copy]TexSubImage rate.
+ * This actually also includes time to render a quad and SwapBuffers.
+ */
+static void
+RunTest(GLboolean copyTex, GLboolean doSubRect)
+{
+   struct subtex st;
+   int bpp, r, g, b, a;
+   int w, h, calls;
+   GLubyte *image = NULL;
+   char name[100];
+
+   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_RED_SIZE, &r);
+   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_GREEN_SIZE, &g);
+   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_BLUE_SIZE, &b);
+   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_ALPHA_SIZE, &a);
+   bpp = (r + g + b + a) / 8;
+
+   if (!copyTex) {
+      /* read image from frame buffer */
+      image = (GLubyte *) malloc(TexWidth * TexHeight * bpp);
+      glPixelStorei(GL_PACK_ALIGNMENT, 1);
+      glReadPixels(0, 0, TexWidth, TexHeight,
+                   ReadFormat, GL_UNSIGNED_BYTE, image);
+   }
+
+   glEnable(GL_TEXTURE_2D);
+   glViewport(WinWidth / 2, 0, WinWidth / 2, WinHeight);
 
    if (doSubRect) {
       w = TexWidth / 2;
       h = TexHeight / 2;
-      iters *= 4;
+      calls = 4;
    }
    else {
       w = TexWidth;
       h = TexHeight;
+      calls = 1;
    }
 
-   copyRate = iters / (t1 - t0);
-   mbRate = w * h * bpp * copyRate / (1024 * 1024);
+   snprintf(name, sizeof(name), "%s %d x %d, %d Bpp",
+            copyTex ? "glCopyTexSubImage" : "glTexSubImage", w, h, bpp);
 
-   if (copyTex)
-      printf("glCopyTexSubImage: %d x %d, %d Bpp:\n", w, h, bpp);
-   else
-      printf("glTexSubImage: %d x %d, %d Bpp:\n", w, h, bpp);
-   printf("   %d calls in %.2f = %.2f calls/sec, %.2f MB/s\n",
-          iters, t1-t0, copyRate, mbRate);
+   st.copyTex = copyTex;
+   st.doSubRect = doSubRect;
+   st.image = image;
+   st.rot = 0.0;
+   bench_run(name, SubTexLoop, &st,
+             calls * w * h * bpp / 1000000.0, "MB", NULL);
+
+   glDisable(GL_TEXTURE_2D);
+   if (image)
+      free(image);
 }
 
 
@@ -329,6 +341,7 @@ int
 main(int argc, char *argv[])
 {
    GLint mode = GLUT_RGB | GLUT_ALPHA | GLUT_DOUBLE | GLUT_DEPTH;
+   bench_init(&argc, argv);
    glutInit(&argc, argv);
 
    ParseArgs(argc, argv);
@@ -344,6 +357,7 @@ main(int argc, char *argv[])
    glutDisplayFunc(Draw);
 
    printf("GL_RENDERER: %s\n", (char *) glGetString(GL_RENDERER));
+   bench_set_renderer((const char *) glGetString(GL_RENDERER));
    Init();
 
    glutMainLoop();
@@ -37,6 +37,7 @@
 #include <math.h>
 #include "gl_wrap.h"
 #include "glut_wrap.h"
+#include "bench.h"
 
 
 static GLsizei MaxSize = 2048;
@@ -155,6 +156,74 @@ static unsigned long align(unsigned long value, unsigned long a)
    return (value + a - 1) & ~(a-1);
 }
 
+struct download {
+   GLubyte *texImage;
+   int w, h, image_bytes;
+   int count, offset;
+};
+
+
+static void
+DownloadLoop(void *data, unsigned iterations)
+{
+   struct download *d = (struct download *) data;
+   const int w = d->w, h = d->h;
+   unsigned j;
+
+   for (j = 0; j < iterations; j++) {
+      int img = d->count%NR_TEXOBJ;
+      GLubyte *img_ptr = d->texImage + img * d->image_bytes;
+
+      glBindTexture(GL_TEXTURE_2D, TexObj[img]);
+
+      if (SubImage && d->count >= NR_TEXOBJ) {
+	 /* Only update a portion of the image each iteration.  This
+	  * is presumably why you'd want to use texsubimage, otherwise
+	  * you may as well just call teximage again.
+	  *
+	  * A bigger question is whether to use a pointer that moves
+	  * with each call, ie does the incoming data come from L2
+	  * cache under normal circumstances, or is it pulled from
+	  * uncached memory?
+	  *
+	  * There's a good argument to say L2 cache, ie you'd expect
+	  * the data to have been recently generated.  It's possible
+	  * that it could have come from a file read, which may or may
+	  * not have gone through the cpu.
+	  */
+         glTexSubImage2D(GL_TEXTURE_2D, 0,
+			 -TexBorder,
+			 -TexBorder + d->offset * h/8,
+			 w,
+			 h/8,
+                         FormatTable[Format].Format,
+                         FormatTable[Format].Type,
+			 d->texImage /* likely in L2$ */
+	    );
+	 d->offset += 1;
+	 d->offset %= 8;
+      }
+      else {
+         glTexImage2D(GL_TEXTURE_2D, 0,
+                      FormatTable[Format].IntFormat, w, h, TexBorder,
+                      FormatTable[Format].Format,
+                      FormatTable[Format].Type,
+		      img_ptr);
+      }
+
+      /* draw a tiny polygon to force texture into texram */
+      glBegin(GL_TRIANGLES);
+      glTexCoord2f(0, 0);     glVertex2f(1, 1);
+      glTexCoord2f(1, 0);     glVertex2f(3, 1);
+      glTexCoord2f(0.5, 1);   glVertex2f(2, 3);
+      glEnd();
+
+      d->count++;
+   }
+   glFinish();
+}
+
+
 static void
 MeasureDownloadRate(void)
 {
@@ -162,12 +231,11 @@ MeasureDownloadRate(void)
    const int h = TexHeight + 2 * TexBorder;
    const int image_bytes = align(w * h * BytesPerTexel(Format), ALIGN);
    const int bytes = image_bytes * NR_TEXOBJ;
+   struct download d;
+   struct bench_result result;
    GLubyte *texImage;
-   GLdouble t0, t1, time;
-   int count;
+   char name[200];
    int i;
-   int offset = 0;
-   GLdouble total = 0;		/* ints will tend to overflow */
 
    printf("allocating %d bytes for %d %dx%d images\n",
 	  bytes, NR_TEXOBJ, w, h);
@@ -216,71 +284,30 @@ MeasureDownloadRate(void)
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
    glEnable(GL_TEXTURE_2D);
 
-   count = 0;
-   t0 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
-   do {
-      int img = count%NR_TEXOBJ;
-      GLubyte *img_ptr = texImage + img * image_bytes;
-
-      glBindTexture(GL_TEXTURE_2D, TexObj[img]);
-
-      if (SubImage && count > 0) {
-	 /* Only update a portion of the image each iteration.  This
-	  * is presumably why you'd want to use texsubimage, otherwise
-	  * you may as well just call teximage again.
-	  *
-	  * A bigger question is whether to use a pointer that moves
-	  * with each call, ie does the incoming data come from L2
-	  * cache under normal circumstances, or is it pulled from
-	  * uncached memory?
-	  *
-	  * There's a good argument to say L2 cache, ie you'd expect
-	  * the data to have been recently generated.  It's possible
-	  * that it could have come from a file read, which may or may
-	  * not have gone through the cpu.
-	  */
-         glTexSubImage2D(GL_TEXTURE_2D, 0,
-			 -TexBorder,
-			 -TexBorder + offset * h/8,
-			 w,
-			 h/8,
-                         FormatTable[Format].Format,
-                         FormatTable[Format].Type,
-#if 1
-			 texImage /* likely in L2$ */
-#else
-			 img_ptr + offset * bytes/8 /* unlikely in L2$ */
-#endif
-	    );
-	 offset += 1;
-	 offset %= 8;
-	 total += w * h / 8;
-      }
-      else {
-         glTexImage2D(GL_TEXTURE_2D, 0,
-                      FormatTable[Format].IntFormat, w, h, TexBorder,
-                      FormatTable[Format].Format,
-                      FormatTable[Format].Type,
-		      img_ptr);
-	 total += w*h;
-      }
-
-      /* draw a tiny polygon to force texture into texram */
-      glBegin(GL_TRIANGLES);
-      glTexCoord2f(0, 0);     glVertex2f(1, 1);
-      glTexCoord2f(1, 0);     glVertex2f(3, 1);
-      glTexCoord2f(0.5, 1);   glVertex2f(2, 3);
-      glEnd();
-
-      t1 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
-      time = t1 - t0;
-      count++;
-   } while (time < 3.0);
+   d.texImage = texImage;
+   d.w = w;
+   d.h = h;
+   d.image_bytes = image_bytes;
+   d.offset = 0;
+   d.count = 0;
+
+   /* with TexSubImage, specify all the images first and only time
+    * the partial updates
+    */
+   if (SubImage)
+      DownloadLoop(&d, NR_TEXOBJ);
+
+   snprintf(name, sizeof(name), "%s %s %dx%d%s%s",
+            FormatStr(FormatTable[Format].Format),
+            TypeStr(FormatTable[Format].Type), w, h,
+            ScaleAndBias ? ", scale&bias" : "",
+            SubImage ? ", TexSubImage" : "");
+   bench_run(name, DownloadLoop, &d,
+             w * h / (SubImage ? 8.0 : 1.0) / 1000000.0, "Mtexels", &result);
 
    glDisable(GL_TEXTURE_2D);
 
-   printf("total texels=%f  time=%f\n", total, time);
-   DownloadRate = total / time;
+   DownloadRate = result.median * 1000000.0;
 
 
 #ifdef _WIN32
@@ -459,12 +486,14 @@ Init(void)
    printf("GL_VENDOR = %s\n", (const char *) glGetString(GL_VENDOR));
    printf("GL_VERSION = %s\n", (const char *) glGetString(GL_VERSION));
    printf("GL_RENDERER = %s\n", (const char *) glGetString(GL_RENDERER));
+   bench_set_renderer((const char *) glGetString(GL_RENDERER));
 }
 
 
 int
 main(int argc, char *argv[])
 {
+   bench_init(&argc, argv);
    glutInit( &argc, argv );
    glutInitWindowPosition( 0, 0 );
    glutInitWindowSize( 600, 100 );
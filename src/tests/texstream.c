@@ -0,0 +1,521 @@
+/*
+ * Measure streaming texture upload, as for video playback: every frame a
+ * new image is written to staging memory, copied into the same texture
+ * and drawn.  Compares these ways of getting the image to the GL:
+ *
+ *   client       glTexSubImage2D from malloc'd memory
+ *   pbo          one pixel buffer object, glMapBuffer
+ *   pbo-orphan   one PBO, reallocated with glBufferData before mapping
+ *   pbo-ring     N PBOs, each guarded by a fence, mapped unsynchronized
+ *   map-unsync   one buffer of N frames, glMapBufferRange with
+ *                UNSYNCHRONIZED|INVALIDATE, invalidating the whole buffer
+ *                when it wraps
+ *   persistent   one ARB_buffer_storage buffer of N frames, mapped once
+ *                persistent and coherent, each frame guarded by a fence
+ *
+ * For each it reports MB/s (10^6 bytes, like the other rate tests), and
+ * the time per frame the CPU spent blocked in buffer mapping and fence
+ * waits, and its total CPU time per frame.
+ *
+ * Command line options:
+ *    -size WxH   frame size (default 1280x720, 1920x1080 and 3840x2160)
+ *    -ring N     frames in flight for the ring strategies (default 3)
+ * and the -bench-* options of util/bench.h.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "glad/gl.h"
+#include "glut_wrap.h"
+#include "bench.h"
+
+
+#define MAX_RING 16
+
+static const struct {
+   GLsizei width, height;
+} DefaultSizes[] = {
+   { 1280, 720 },
+   { 1920, 1080 },
+   { 3840, 2160 },
+};
+
+static GLsizei Width, Height;   /* of the frames */
+static GLsizei SizeWidth, SizeHeight;   /* -size, or 0 for the defaults */
+static GLsizeiptr FrameSize;
+static unsigned RingSize = 3;
+static GLuint Texture;
+static GLubyte *Source[2];      /* the "decoded" frames */
+static GLubyte *ClientBuffer;
+static GLuint Buffers[MAX_RING];
+static GLsync Fences[MAX_RING];
+static GLubyte *Persistent;
+static uint64_t StallNs;
+static unsigned long StallFrames;
+static GLboolean Benchmark = GL_TRUE;
+static int Win;
+
+
+/** Wait for the GPU to finish with the ring slot's previous frame. */
+static void
+WaitFence(unsigned slot)
+{
+   uint64_t t0;
+
+   if (!Fences[slot])
+      return;
+
+   t0 = bench_time_ns();
+   while (glClientWaitSync(Fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT,
+                           1000000000) == GL_TIMEOUT_EXPIRED)
+      ;
+   StallNs += bench_time_ns() - t0;
+
+   glDeleteSync(Fences[slot]);
+   Fences[slot] = NULL;
+}
+
+
+static void *
+MapBuffer(GLintptr offset, GLbitfield access)
+{
+   uint64_t t0 = bench_time_ns();
+   void *ptr;
+
+   if (access)
+      ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, FrameSize,
+                             access);
+   else
+      ptr = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+   StallNs += bench_time_ns() - t0;
+
+   if (!ptr) {
+      printf("Error: failed to map the buffer (0x%x)\n", glGetError());
+      exit(1);
+   }
+   return ptr;
+}
+
+
+static void
+TexSubImage(const void *pixels)
+{
+   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Width, Height,
+                   GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, pixels);
+}
+
+
+static void
+SetupBuffers(unsigned count, GLsizeiptr size)
+{
+   unsigned i;
+
+   glGenBuffers(count, Buffers);
+   for (i = 0; i < count; i++) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, Buffers[i]);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+   }
+}
+
+
+static void
+SetupOne(void)
+{
+   SetupBuffers(1, FrameSize);
+}
+
+
+static void
+SetupRing(void)
+{
+   SetupBuffers(RingSize, FrameSize);
+}
+
+
+static void
+SetupStream(void)
+{
+   SetupBuffers(1, FrameSize * RingSize);
+}
+
+
+static void
+SetupPersistent(void)
+{
+   const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+                            GL_MAP_COHERENT_BIT;
+
+   glGenBuffers(1, Buffers);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, Buffers[0]);
+   glBufferStorage(GL_PIXEL_UNPACK_BUFFER, FrameSize * RingSize, NULL, flags);
+   Persistent = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+                                 FrameSize * RingSize, flags);
+   if (!Persistent) {
+      printf("Error: failed to map the persistent buffer (0x%x)\n",
+             glGetError());
+      exit(1);
+   }
+}
+
+
+static void
+UploadClient(unsigned frame)
+{
+   memcpy(ClientBuffer, Source[frame & 1], FrameSize);
+   TexSubImage(ClientBuffer);
+}
+
+
+static void
+UploadPBO(unsigned frame)
+{
+   GLubyte *ptr = MapBuffer(0, 0);
+
+   memcpy(ptr, Source[frame & 1], FrameSize);
+   glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+   TexSubImage(NULL);
+}
+
+
+static void
+UploadOrphan(unsigned frame)
+{
+   GLubyte *ptr;
+   uint64_t t0 = bench_time_ns();
+
+   glBufferData(GL_PIXEL_UNPACK_BUFFER, FrameSize, NULL, GL_STREAM_DRAW);
+   StallNs += bench_time_ns() - t0;
+
+   ptr = MapBuffer(0, 0);
+   memcpy(ptr, Source[frame & 1], FrameSize);
+   glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+   TexSubImage(NULL);
+}
+
+
+static void
+UploadRing(unsigned frame)
+{
+   unsigned slot = frame % RingSize;
+   GLubyte *ptr;
+
+   WaitFence(slot);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, Buffers[slot]);
+   ptr = MapBuffer(0, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+   memcpy(ptr, Source[frame & 1], FrameSize);
+   glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+   TexSubImage(NULL);
+   Fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+static void
+UploadStream(unsigned frame)
+{
+   unsigned slot = frame % RingSize;
+   GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+   GLubyte *ptr;
+
+   /* on wrapping, let the driver give us fresh storage rather than
+    * overwrite frames the GPU may still be reading
+    */
+   access |= slot ? GL_MAP_INVALIDATE_RANGE_BIT : GL_MAP_INVALIDATE_BUFFER_BIT;
+   ptr = MapBuffer(slot * FrameSize, access);
+   memcpy(ptr, Source[frame & 1], FrameSize);
+   glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+   TexSubImage((const void *) (uintptr_t) (slot * FrameSize));
+}
+
+
+static void
+UploadPersistent(unsigned frame)
+{
+   unsigned slot = frame % RingSize;
+
+   WaitFence(slot);
+   memcpy(Persistent + slot * FrameSize, Source[frame & 1], FrameSize);
+   TexSubImage((const void *) (uintptr_t) (slot * FrameSize));
+   Fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+static GLboolean
+HavePBO(void)
+{
+   return GLAD_GL_VERSION_2_1 || GLAD_GL_ARB_pixel_buffer_object;
+}
+
+
+static GLboolean
+HaveMapRange(void)
+{
+   return HavePBO() &&
+      (GLAD_GL_VERSION_3_0 || GLAD_GL_ARB_map_buffer_range);
+}
+
+
+static GLboolean
+HaveSync(void)
+{
+   return HaveMapRange() && (GLAD_GL_VERSION_3_2 || GLAD_GL_ARB_sync);
+}
+
+
+static GLboolean
+HaveStorage(void)
+{
+   return HaveSync() && (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage);
+}
+
+
+struct strategy {
+   const char *name;
+   GLboolean (*supported)(void);
+   void (*setup)(void);
+   void (*upload)(unsigned frame);
+};
+
+static const struct strategy Strategies[] = {
+   { "client",     NULL,         NULL,            UploadClient },
+   { "pbo",        HavePBO,      SetupOne,        UploadPBO },
+   { "pbo-orphan", HavePBO,      SetupOne,        UploadOrphan },
+   { "pbo-ring",   HaveSync,     SetupRing,       UploadRing },
+   { "map-unsync", HaveMapRange, SetupStream,     UploadStream },
+   { "persistent", HaveStorage,  SetupPersistent, UploadPersistent },
+};
+
+#define NUM_STRATEGIES (sizeof(Strategies) / sizeof(Strategies[0]))
+
+
+static void
+DrawQuad(GLfloat size)
+{
+   glBegin(GL_QUADS);
+   glTexCoord2f(0, 0);  glVertex2f(-1, -1);
+   glTexCoord2f(1, 0);  glVertex2f(-1 + size, -1);
+   glTexCoord2f(1, 1);  glVertex2f(-1 + size, -1 + size);
+   glTexCoord2f(0, 1);  glVertex2f(-1, -1 + size);
+   glEnd();
+}
+
+
+static void
+StreamLoop(void *data, unsigned iterations)
+{
+   const struct strategy *s = (const struct strategy *) data;
+   static unsigned frame = 0;
+   unsigned i;
+
+   for (i = 0; i < iterations; i++) {
+      s->upload(frame++);
+      /* a small quad, so that the texture is used but fill rate doesn't
+       * count
+       */
+      DrawQuad(0.1f);
+   }
+   glFinish();
+
+   StallFrames += iterations;
+}
+
+
+static void
+MeasureStrategy(const struct strategy *s)
+{
+   struct bench_result result;
+   char name[100];
+   unsigned i;
+   GLenum err;
+
+   if (s->supported && !s->supported()) {
+      printf("%s: not supported by this renderer\n", s->name);
+      return;
+   }
+
+   if (s->setup)
+      s->setup();
+
+   /* check for errors */
+   StreamLoop((void *) s, 1);
+   err = glGetError();
+   if (err) {
+      printf("GL Error 0x%x for %s\n", err, s->name);
+   }
+   else {
+      snprintf(name, sizeof(name), "%s %dx%d", s->name, Width, Height);
+      StallNs = 0;
+      StallFrames = 0;
+      bench_run(name, StreamLoop, (void *) s, FrameSize / 1000000.0, "MB",
+                &result);
+      printf("  %s: stall %.3f ms/frame, CPU %.3f ms/frame\n", name,
+             StallNs / 1000000.0 / StallFrames,
+             result.cpu_ns_per_op * FrameSize / 1000000.0 / 1000000.0);
+      fflush(stdout);
+   }
+
+   for (i = 0; i < MAX_RING; i++) {
+      if (Fences[i]) {
+         glDeleteSync(Fences[i]);
+         Fences[i] = NULL;
+      }
+   }
+   if (Persistent) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, Buffers[0]);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      Persistent = NULL;
+   }
+   if (HavePBO()) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      glDeleteBuffers(MAX_RING, Buffers);
+   }
+   memset(Buffers, 0, sizeof(Buffers));
+}
+
+
+static void
+MeasureSize(GLsizei width, GLsizei height)
+{
+   unsigned i, j;
+
+   Width = width;
+   Height = height;
+   FrameSize = (GLsizeiptr) width * height * 4;
+
+   for (i = 0; i < 2; i++) {
+      free(Source[i]);
+      Source[i] = malloc(FrameSize);
+      if (!Source[i]) {
+         printf("Error: out of memory\n");
+         exit(1);
+      }
+      for (j = 0; j < (unsigned) FrameSize; j++)
+         Source[i][j] = (GLubyte) (j * (i + 1));
+   }
+   free(ClientBuffer);
+   ClientBuffer = malloc(FrameSize);
+   if (!ClientBuffer) {
+      printf("Error: out of memory\n");
+      exit(1);
+   }
+
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, Width, Height, 0,
+                GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
+
+   for (i = 0; i < NUM_STRATEGIES; i++)
+      MeasureStrategy(&Strategies[i]);
+}
+
+
+static void
+Draw(void)
+{
+   glClear(GL_COLOR_BUFFER_BIT);
+
+   if (Benchmark) {
+      unsigned i;
+
+      if (SizeWidth) {
+         MeasureSize(SizeWidth, SizeHeight);
+      }
+      else {
+         for (i = 0; i < sizeof(DefaultSizes) / sizeof(DefaultSizes[0]); i++)
+            MeasureSize(DefaultSizes[i].width, DefaultSizes[i].height);
+      }
+      Benchmark = GL_FALSE;
+      glClear(GL_COLOR_BUFFER_BIT);
+   }
+
+   /* show the last frame */
+   DrawQuad(2.0f);
+   glutSwapBuffers();
+}
+
+
+static void
+Reshape(int width, int height)
+{
+   glViewport(0, 0, width, height);
+   glMatrixMode(GL_PROJECTION);
+   glLoadIdentity();
+   glMatrixMode(GL_MODELVIEW);
+   glLoadIdentity();
+}
+
+
+static void
+Key(unsigned char key, int x, int y)
+{
+   (void) x;
+   (void) y;
+   switch (key) {
+   case 'b':
+      Benchmark = GL_TRUE;
+      break;
+   case 27:
+      glutDestroyWindow(Win);
+      exit(0);
+      break;
+   }
+   glutPostRedisplay();
+}
+
+
+static void
+Init(void)
+{
+   printf("GL_RENDERER = %s\n", (char *) glGetString(GL_RENDERER));
+   bench_set_renderer((const char *) glGetString(GL_RENDERER));
+
+   glGenTextures(1, &Texture);
+   glBindTexture(GL_TEXTURE_2D, Texture);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+   glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+   glEnable(GL_TEXTURE_2D);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   int i;
+
+   bench_init(&argc, argv);
+   glutInit(&argc, argv);
+
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-size") == 0 && i + 1 < argc) {
+         if (sscanf(argv[++i], "%dx%d", &SizeWidth, &SizeHeight) != 2 ||
+             SizeWidth <= 0 || SizeHeight <= 0) {
+            printf("Error: bad size %s\n", argv[i]);
+            exit(1);
+         }
+      }
+      else if (strcmp(argv[i], "-ring") == 0 && i + 1 < argc) {
+         RingSize = atoi(argv[++i]);
+         if (RingSize < 1 || RingSize > MAX_RING) {
+            printf("Error: ring size must be 1 to %d\n", MAX_RING);
+            exit(1);
+         }
+      }
+      else {
+         printf("Usage: %s [-size WxH] [-ring N]\n", argv[0]);
+         exit(1);
+      }
+   }
+
+   glutInitWindowPosition(0, 0);
+   glutInitWindowSize(512, 288);
+   glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE);
+   Win = glutCreateWindow(argv[0]);
+   gladLoaderLoadGL();
+   glutReshapeFunc(Reshape);
+   glutKeyboardFunc(Key);
+   glutDisplayFunc(Draw);
+   Init();
+   glutMainLoop();
+   gladLoaderUnloadGL();
+   return 0;
+}
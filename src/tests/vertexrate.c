@@ -0,0 +1,823 @@
+/*
+ * Measure vertex submission rate through each of the GL's drawing paths.
+ *
+ * The same mesh of small triangles is drawn each frame, split into
+ * batches of a given number of triangles, one draw per batch, through:
+ *
+ *   immediate      glBegin/glEnd
+ *   displaylist    a display list per batch
+ *   client         glDrawElements from client arrays
+ *   locked         the same, inside glLockArraysEXT
+ *   vbo-arrays     glDrawArrays from a VBO of unindexed triangles
+ *   vbo-elements   glDrawElements from VBOs
+ *   vbo-range      glDrawRangeElements from VBOs
+ *   multidraw      one glMultiDrawElements of all the batches
+ *   instanced      glDrawElementsInstanced of the first batch, with as
+ *                  many instances as there are batches
+ *   indirect       glDrawElementsIndirect per batch
+ *   multiindirect  one glMultiDrawElementsIndirect of all the batches
+ *
+ * for each vertex format and batch size, and reports Mtri/s and the CPU
+ * time per draw (per batch for the multi-draw paths), then a table of the
+ * rates to find the batch size beyond which the rate stops improving.
+ * The triangles cover a pixel or so each, so rasterization costs little.
+ * Fixed function, without lighting or texturing, is used throughout.
+ *
+ * Command line options:
+ *    -tris N       triangles per frame (default 1000000)
+ *    -batch N      only this batch size (default 10, 100, ... up to -tris)
+ *    -path NAME    only this path
+ *    -format NAME  only this vertex format (P3f, P3f_C4ub, P3f_N3f_T2f)
+ * and the -bench-* options of util/bench.h.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "glad/gl.h"
+#include "glut_wrap.h"
+#include "bench.h"
+
+
+#define MAX_BATCHES 10
+
+struct vertex_format {
+   const char *name;
+   GLsizei stride;
+   GLboolean color;     /* GLubyte[4] at offset 12 */
+   GLboolean normal;    /* GLfloat[3] at offset 12 */
+   GLboolean texcoord;  /* GLfloat[2] at offset 24 */
+};
+
+static const struct vertex_format Formats[] = {
+   { "P3f", 12, GL_FALSE, GL_FALSE, GL_FALSE },
+   { "P3f_C4ub", 16, GL_TRUE, GL_FALSE, GL_FALSE },
+   { "P3f_N3f_T2f", 32, GL_FALSE, GL_TRUE, GL_TRUE },
+};
+
+#define NUM_FORMATS (sizeof(Formats) / sizeof(Formats[0]))
+
+struct draw_indirect_command {
+   GLuint count;
+   GLuint instance_count;
+   GLuint first_index;
+   GLint base_vertex;
+   GLuint base_instance;
+};
+
+/* where a path's vertex arrays point */
+enum source {
+   SOURCE_NONE,
+   SOURCE_CLIENT,       /* Vertices and Indices */
+   SOURCE_VBO,          /* VertexBuffer and IndexBuffer */
+   SOURCE_VBO_ARRAYS,   /* ArrayBuffer, three vertices per triangle */
+};
+
+struct test {
+   const struct vertex_format *format;
+   GLuint batch;        /* triangles per draw */
+   GLuint draws;        /* per frame */
+   GLuint tris;         /* per frame */
+};
+
+struct path {
+   const char *name;
+   enum source source;
+   GLboolean (*supported)(void);
+   void (*setup)(const struct test *t);
+   void (*draw)(const struct test *t);
+   void (*cleanup)(const struct test *t);
+};
+
+/* options */
+static GLuint NumTris = 1000000;
+static GLuint OnlyBatch;
+static const char *OnlyPath, *OnlyFormat;
+
+/* the mesh, in the current format */
+static GLuint GridWidth, GridHeight;
+static GLuint NumVertices;
+static GLubyte *Vertices;
+static GLuint *Indices;
+static GLuint VertexBuffer, IndexBuffer, ArrayBuffer;
+
+/* per batch, for the current batch size */
+static GLuint *MinIndex, *MaxIndex;
+static GLsizei *Counts;
+static const void **Offsets;
+static GLuint IndirectBuffer;
+static GLuint ListBase;
+
+static GLuint BatchSizes[MAX_BATCHES];
+static unsigned NumBatchSizes;
+
+
+static GLsizei
+BatchTris(const struct test *t, GLuint d)
+{
+   return d + 1 < t->draws ? t->batch : t->tris - d * t->batch;
+}
+
+
+static void
+EmitVertex(const struct vertex_format *fmt, GLuint i)
+{
+   const GLubyte *v = Vertices + (size_t) i * fmt->stride;
+
+   if (fmt->color)
+      glColor4ubv(v + 12);
+   if (fmt->normal)
+      glNormal3fv((const GLfloat *) (v + 12));
+   if (fmt->texcoord)
+      glTexCoord2fv((const GLfloat *) (v + 24));
+   glVertex3fv((const GLfloat *) v);
+}
+
+
+static void
+EmitBatch(const struct test *t, GLuint d)
+{
+   const GLuint *idx = Indices + (size_t) d * t->batch * 3;
+   GLsizei i, count = BatchTris(t, d) * 3;
+
+   glBegin(GL_TRIANGLES);
+   for (i = 0; i < count; i++)
+      EmitVertex(t->format, idx[i]);
+   glEnd();
+}
+
+
+static void
+DrawImmediate(const struct test *t)
+{
+   GLuint d;
+
+   for (d = 0; d < t->draws; d++)
+      EmitBatch(t, d);
+}
+
+
+static void
+SetupLists(const struct test *t)
+{
+   GLuint d;
+
+   ListBase = glGenLists(t->draws);
+   for (d = 0; d < t->draws; d++) {
+      glNewList(ListBase + d, GL_COMPILE);
+      EmitBatch(t, d);
+      glEndList();
+   }
+}
+
+
+static void
+DrawLists(const struct test *t)
+{
+   GLuint d;
+
+   for (d = 0; d < t->draws; d++)
+      glCallList(ListBase + d);
+}
+
+
+static void
+CleanupLists(const struct test *t)
+{
+   glDeleteLists(ListBase, t->draws);
+}
+
+
+static void
+DrawClient(const struct test *t)
+{
+   GLuint d;
+
+   for (d = 0; d < t->draws; d++)
+      glDrawElements(GL_TRIANGLES, BatchTris(t, d) * 3, GL_UNSIGNED_INT,
+                     Indices + (size_t) d * t->batch * 3);
+}
+
+
+static void
+DrawLocked(const struct test *t)
+{
+   glLockArraysEXT(0, NumVertices);
+   DrawClient(t);
+   glUnlockArraysEXT();
+}
+
+
+static void
+DrawArrays(const struct test *t)
+{
+   GLuint d;
+
+   for (d = 0; d < t->draws; d++)
+      glDrawArrays(GL_TRIANGLES, d * t->batch * 3, BatchTris(t, d) * 3);
+}
+
+
+static void
+DrawElements(const struct test *t)
+{
+   GLuint d;
+
+   for (d = 0; d < t->draws; d++)
+      glDrawElements(GL_TRIANGLES, Counts[d], GL_UNSIGNED_INT, Offsets[d]);
+}
+
+
+static void
+DrawRangeElements(const struct test *t)
+{
+   GLuint d;
+
+   for (d = 0; d < t->draws; d++)
+      glDrawRangeElements(GL_TRIANGLES, MinIndex[d], MaxIndex[d], Counts[d],
+                          GL_UNSIGNED_INT, Offsets[d]);
+}
+
+
+static void
+DrawMulti(const struct test *t)
+{
+   glMultiDrawElements(GL_TRIANGLES, Counts, GL_UNSIGNED_INT, Offsets,
+                       t->draws);
+}
+
+
+static void
+DrawInstanced(const struct test *t)
+{
+   glDrawElementsInstanced(GL_TRIANGLES, t->batch * 3, GL_UNSIGNED_INT, NULL,
+                           t->draws);
+}
+
+
+static void
+SetupIndirect(const struct test *t)
+{
+   struct draw_indirect_command *cmds;
+   GLuint d;
+
+   cmds = calloc(t->draws, sizeof(*cmds));
+   for (d = 0; d < t->draws; d++) {
+      cmds[d].count = Counts[d];
+      cmds[d].instance_count = 1;
+      cmds[d].first_index = d * t->batch * 3;
+   }
+   glGenBuffers(1, &IndirectBuffer);
+   glBindBuffer(GL_DRAW_INDIRECT_BUFFER, IndirectBuffer);
+   glBufferData(GL_DRAW_INDIRECT_BUFFER, t->draws * sizeof(*cmds), cmds,
+                GL_STATIC_DRAW);
+   free(cmds);
+}
+
+
+static void
+DrawIndirect(const struct test *t)
+{
+   const size_t stride = sizeof(struct draw_indirect_command);
+   GLuint d;
+
+   for (d = 0; d < t->draws; d++)
+      glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                             (const void *) (d * stride));
+}
+
+
+static void
+DrawMultiIndirect(const struct test *t)
+{
+   glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL,
+                               t->draws, 0);
+}
+
+
+static void
+CleanupIndirect(const struct test *t)
+{
+   (void) t;
+   glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+   glDeleteBuffers(1, &IndirectBuffer);
+}
+
+
+static GLboolean
+HaveLocked(void)
+{
+   return GLAD_GL_EXT_compiled_vertex_array;
+}
+
+
+static GLboolean
+HaveVBO(void)
+{
+   return GLAD_GL_VERSION_1_5;
+}
+
+
+static GLboolean
+HaveInstanced(void)
+{
+   return GLAD_GL_VERSION_3_1 || GLAD_GL_ARB_draw_instanced;
+}
+
+
+static GLboolean
+HaveIndirect(void)
+{
+   return GLAD_GL_VERSION_4_0 || GLAD_GL_ARB_draw_indirect;
+}
+
+
+static GLboolean
+HaveMultiIndirect(void)
+{
+   return GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_multi_draw_indirect;
+}
+
+
+static const struct path Paths[] = {
+   { "immediate", SOURCE_NONE, NULL, NULL, DrawImmediate, NULL },
+   { "displaylist", SOURCE_NONE, NULL, SetupLists, DrawLists, CleanupLists },
+   { "client", SOURCE_CLIENT, NULL, NULL, DrawClient, NULL },
+   { "locked", SOURCE_CLIENT, HaveLocked, NULL, DrawLocked, NULL },
+   { "vbo-arrays", SOURCE_VBO_ARRAYS, HaveVBO, NULL, DrawArrays, NULL },
+   { "vbo-elements", SOURCE_VBO, HaveVBO, NULL, DrawElements, NULL },
+   { "vbo-range", SOURCE_VBO, HaveVBO, NULL, DrawRangeElements, NULL },
+   { "multidraw", SOURCE_VBO, HaveVBO, NULL, DrawMulti, NULL },
+   { "instanced", SOURCE_VBO, HaveInstanced, NULL, DrawInstanced, NULL },
+   { "indirect", SOURCE_VBO, HaveIndirect, SetupIndirect, DrawIndirect,
+     CleanupIndirect },
+   { "multiindirect", SOURCE_VBO, HaveMultiIndirect, SetupIndirect,
+     DrawMultiIndirect, CleanupIndirect },
+};
+
+#define NUM_PATHS (sizeof(Paths) / sizeof(Paths[0]))
+
+/* Mtri/s, 0 if not measured */
+static double Rates[NUM_PATHS][NUM_FORMATS][MAX_BATCHES];
+
+
+/**
+ * Make the mesh: a grid of GridWidth x GridHeight squares of two
+ * triangles each, listed a row at a time, so that consecutive batches
+ * use neighbouring vertices.
+ */
+static void
+MakeMesh(const struct vertex_format *fmt)
+{
+   GLuint x, y, i = 0;
+   GLuint *idx;
+
+   free(Vertices);
+   free(Indices);
+   NumVertices = (GridWidth + 1) * (GridHeight + 1);
+   Vertices = calloc(NumVertices, fmt->stride);
+   Indices = malloc((size_t) NumTris * 3 * sizeof(GLuint));
+   if (!Vertices || !Indices) {
+      printf("Error: out of memory\n");
+      exit(1);
+   }
+
+   for (y = 0; y <= GridHeight; y++) {
+      for (x = 0; x <= GridWidth; x++, i++) {
+         GLubyte *v = Vertices + (size_t) i * fmt->stride;
+         GLfloat *pos = (GLfloat *) v;
+
+         pos[0] = -0.9f + 1.8f * x / GridWidth;
+         pos[1] = -0.9f + 1.8f * y / GridHeight;
+         pos[2] = 0.0f;
+         if (fmt->color) {
+            v[12] = (GLubyte) (255 * x / GridWidth);
+            v[13] = (GLubyte) (255 * y / GridHeight);
+            v[14] = 128;
+            v[15] = 255;
+         }
+         if (fmt->normal) {
+            GLfloat *n = (GLfloat *) (v + 12);
+            n[0] = n[1] = 0.0f;
+            n[2] = 1.0f;
+         }
+         if (fmt->texcoord) {
+            GLfloat *tc = (GLfloat *) (v + 24);
+            tc[0] = (GLfloat) x / GridWidth;
+            tc[1] = (GLfloat) y / GridHeight;
+         }
+      }
+   }
+
+   idx = Indices;
+   for (y = 0; y < GridHeight; y++) {
+      for (x = 0; x < GridWidth; x++) {
+         GLuint v0 = y * (GridWidth + 1) + x;
+         GLuint v1 = v0 + 1, v2 = v0 + GridWidth + 1, v3 = v2 + 1;
+         *idx++ = v0;  *idx++ = v1;  *idx++ = v3;
+         *idx++ = v0;  *idx++ = v3;  *idx++ = v2;
+      }
+   }
+}
+
+
+/** Put the mesh in buffer objects, indexed and not */
+static void
+MakeBuffers(const struct vertex_format *fmt)
+{
+   GLubyte *expanded, *p;
+   GLuint i;
+
+   if (!HaveVBO())
+      return;
+
+   if (!VertexBuffer)
+      glGenBuffers(1, &VertexBuffer);
+   glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+   glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) NumVertices * fmt->stride,
+                Vertices, GL_STATIC_DRAW);
+
+   if (!IndexBuffer)
+      glGenBuffers(1, &IndexBuffer);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexBuffer);
+   glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                (GLsizeiptr) NumTris * 3 * sizeof(GLuint), Indices,
+                GL_STATIC_DRAW);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+   expanded = malloc((size_t) NumTris * 3 * fmt->stride);
+   if (!expanded) {
+      printf("Error: out of memory\n");
+      exit(1);
+   }
+   for (i = 0, p = expanded; i < NumTris * 3; i++, p += fmt->stride)
+      memcpy(p, Vertices + (size_t) Indices[i] * fmt->stride, fmt->stride);
+   if (!ArrayBuffer)
+      glGenBuffers(1, &ArrayBuffer);
+   glBindBuffer(GL_ARRAY_BUFFER, ArrayBuffer);
+   glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) NumTris * 3 * fmt->stride,
+                expanded, GL_STATIC_DRAW);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+   free(expanded);
+}
+
+
+/** Work out each batch's draw parameters */
+static void
+MakeBatches(struct test *t)
+{
+   GLuint d;
+
+   t->draws = (NumTris + t->batch - 1) / t->batch;
+   t->tris = NumTris;
+
+   free(MinIndex);
+   free(MaxIndex);
+   free(Counts);
+   free(Offsets);
+   MinIndex = malloc(t->draws * sizeof(GLuint));
+   MaxIndex = malloc(t->draws * sizeof(GLuint));
+   Counts = malloc(t->draws * sizeof(GLsizei));
+   Offsets = malloc(t->draws * sizeof(void *));
+   if (!MinIndex || !MaxIndex || !Counts || !Offsets) {
+      printf("Error: out of memory\n");
+      exit(1);
+   }
+
+   for (d = 0; d < t->draws; d++) {
+      const GLuint first = d * t->batch * 3;
+      GLsizei i;
+
+      Counts[d] = BatchTris(t, d) * 3;
+      Offsets[d] = (const void *) (first * sizeof(GLuint));
+      MinIndex[d] = ~0u;
+      MaxIndex[d] = 0;
+      for (i = 0; i < Counts[d]; i++) {
+         if (Indices[first + i] < MinIndex[d])
+            MinIndex[d] = Indices[first + i];
+         if (Indices[first + i] > MaxIndex[d])
+            MaxIndex[d] = Indices[first + i];
+      }
+   }
+}
+
+
+static void
+SetArrays(const struct vertex_format *fmt, enum source source)
+{
+   const GLubyte *base = NULL;
+
+   if (source == SOURCE_NONE)
+      return;
+
+   if (source == SOURCE_CLIENT) {
+      if (HaveVBO())
+         glBindBuffer(GL_ARRAY_BUFFER, 0);
+      base = Vertices;
+   }
+   else {
+      glBindBuffer(GL_ARRAY_BUFFER,
+                   source == SOURCE_VBO ? VertexBuffer : ArrayBuffer);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                   source == SOURCE_VBO ? IndexBuffer : 0);
+   }
+
+   glVertexPointer(3, GL_FLOAT, fmt->stride, base);
+   glEnableClientState(GL_VERTEX_ARRAY);
+   if (fmt->color) {
+      glColorPointer(4, GL_UNSIGNED_BYTE, fmt->stride, base + 12);
+      glEnableClientState(GL_COLOR_ARRAY);
+   }
+   if (fmt->normal) {
+      glNormalPointer(GL_FLOAT, fmt->stride, base + 12);
+      glEnableClientState(GL_NORMAL_ARRAY);
+   }
+   if (fmt->texcoord) {
+      glTexCoordPointer(2, GL_FLOAT, fmt->stride, base + 24);
+      glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+   }
+}
+
+
+static void
+ResetArrays(void)
+{
+   glDisableClientState(GL_VERTEX_ARRAY);
+   glDisableClientState(GL_COLOR_ARRAY);
+   glDisableClientState(GL_NORMAL_ARRAY);
+   glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+   if (HaveVBO()) {
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+   }
+}
+
+
+struct measure {
+   const struct path *path;
+   const struct test *test;
+};
+
+
+static void
+DrawLoop(void *data, unsigned iterations)
+{
+   const struct measure *m = (const struct measure *) data;
+   unsigned i;
+
+   for (i = 0; i < iterations; i++)
+      m->path->draw(m->test);
+   glFinish();
+}
+
+
+static void
+MeasurePath(unsigned p, unsigned f, unsigned b, const struct test *test)
+{
+   const struct path *path = &Paths[p];
+   struct bench_result result;
+   struct measure m;
+   struct test t = *test;
+   char name[100];
+   GLenum err;
+
+   /* the instances are all the first batch */
+   if (path->draw == DrawInstanced) {
+      t.draws = t.tris / t.batch;
+      t.tris = t.draws * t.batch;
+   }
+
+   m.path = path;
+   m.test = &t;
+
+   SetArrays(t.format, path->source);
+   if (path->setup)
+      path->setup(&t);
+
+   /* check for errors */
+   DrawLoop(&m, 1);
+   err = glGetError();
+   if (err) {
+      printf("GL Error 0x%x for %s %s batch %u\n",
+             err, path->name, t.format->name, t.batch);
+   }
+   else {
+      snprintf(name, sizeof(name), "%s %s batch %u",
+               path->name, t.format->name, t.batch);
+      bench_run(name, DrawLoop, &m, t.tris / 1000000.0, "Mtri", &result);
+      printf("  %s: %.0f ns CPU/draw\n", name,
+             result.cpu_ns_per_op * t.tris / 1000000.0 / t.draws);
+      fflush(stdout);
+      Rates[p][f][b] = result.median;
+   }
+
+   if (path->cleanup)
+      path->cleanup(&t);
+   ResetArrays();
+}
+
+
+static void
+PrintTable(void)
+{
+   unsigned p, f, b;
+
+   printf("\nMtri/s by batch size:\n%-28s", "");
+   for (b = 0; b < NumBatchSizes; b++)
+      printf(" %9u", BatchSizes[b]);
+   printf("\n");
+
+   for (p = 0; p < NUM_PATHS; p++) {
+      for (f = 0; f < NUM_FORMATS; f++) {
+         char label[100];
+
+         if (OnlyPath && strcmp(OnlyPath, Paths[p].name) != 0)
+            continue;
+         if (OnlyFormat && strcmp(OnlyFormat, Formats[f].name) != 0)
+            continue;
+
+         snprintf(label, sizeof(label), "%s %s",
+                  Paths[p].name, Formats[f].name);
+         printf("%-28s", label);
+         for (b = 0; b < NumBatchSizes; b++) {
+            if (Rates[p][f][b] > 0.0)
+               printf(" %9.2f", Rates[p][f][b]);
+            else
+               printf(" %9s", "-");
+         }
+         printf("\n");
+      }
+   }
+}
+
+
+static void
+Draw(void)
+{
+   unsigned p, f, b;
+
+   glClear(GL_COLOR_BUFFER_BIT);
+
+   for (p = 0; p < NUM_PATHS; p++) {
+      if (OnlyPath && strcmp(OnlyPath, Paths[p].name) != 0)
+         continue;
+      if (Paths[p].supported && !Paths[p].supported())
+         printf("%s: not supported by this renderer\n", Paths[p].name);
+   }
+
+   for (f = 0; f < NUM_FORMATS; f++) {
+      struct test t;
+
+      if (OnlyFormat && strcmp(OnlyFormat, Formats[f].name) != 0)
+         continue;
+
+      t.format = &Formats[f];
+      MakeMesh(t.format);
+      MakeBuffers(t.format);
+
+      for (b = 0; b < NumBatchSizes; b++) {
+         t.batch = BatchSizes[b];
+         MakeBatches(&t);
+
+         for (p = 0; p < NUM_PATHS; p++) {
+            if (OnlyPath && strcmp(OnlyPath, Paths[p].name) != 0)
+               continue;
+            if (Paths[p].supported && !Paths[p].supported())
+               continue;
+            MeasurePath(p, f, b, &t);
+         }
+      }
+   }
+
+   PrintTable();
+   exit(0);
+}
+
+
+static void
+Reshape(int width, int height)
+{
+   glViewport(0, 0, width, height);
+   glMatrixMode(GL_PROJECTION);
+   glLoadIdentity();
+   glMatrixMode(GL_MODELVIEW);
+   glLoadIdentity();
+}
+
+
+static void
+Key(unsigned char key, int x, int y)
+{
+   (void) x;
+   (void) y;
+   switch (key) {
+   case 27:
+      exit(0);
+      break;
+   }
+   glutPostRedisplay();
+}
+
+
+static void
+Init(void)
+{
+   GLuint b;
+
+   printf("GL_RENDERER = %s\n", (char *) glGetString(GL_RENDERER));
+   printf("GL_VERSION = %s\n", (char *) glGetString(GL_VERSION));
+   bench_set_renderer((const char *) glGetString(GL_RENDERER));
+
+   /* as square a grid as will give the number of triangles */
+   for (GridHeight = 1; 2 * GridHeight * GridHeight < NumTris; GridHeight++)
+      ;
+   while (NumTris % (2 * GridHeight))
+      GridHeight--;
+   GridWidth = NumTris / (2 * GridHeight);
+
+   if (OnlyBatch) {
+      BatchSizes[NumBatchSizes++] = OnlyBatch;
+   }
+   else {
+      for (b = 10; b <= NumTris && NumBatchSizes < MAX_BATCHES; b *= 10)
+         BatchSizes[NumBatchSizes++] = b;
+   }
+
+   printf("%u triangles per frame, a %u x %u grid\n",
+          NumTris, GridWidth, GridHeight);
+}
+
+
+static void
+Usage(const char *program)
+{
+   unsigned i;
+
+   printf("Usage: %s [-tris N] [-batch N] [-path NAME] [-format NAME]\n",
+          program);
+   printf("Paths:");
+   for (i = 0; i < NUM_PATHS; i++)
+      printf(" %s", Paths[i].name);
+   printf("\nFormats:");
+   for (i = 0; i < NUM_FORMATS; i++)
+      printf(" %s", Formats[i].name);
+   printf("\n");
+   exit(1);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   int i;
+
+   /* a lot of cases */
+   bench_set_defaults(3, 0.1, 0.05);
+   bench_init(&argc, argv);
+   glutInit(&argc, argv);
+
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-tris") == 0 && i + 1 < argc)
+         NumTris = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-batch") == 0 && i + 1 < argc)
+         OnlyBatch = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-path") == 0 && i + 1 < argc)
+         OnlyPath = argv[++i];
+      else if (strcmp(argv[i], "-format") == 0 && i + 1 < argc)
+         OnlyFormat = argv[++i];
+      else
+         Usage(argv[0]);
+   }
+   if (OnlyPath) {
+      for (i = 0; i < (int) NUM_PATHS; i++)
+         if (strcmp(OnlyPath, Paths[i].name) == 0)
+            break;
+      if (i == (int) NUM_PATHS)
+         Usage(argv[0]);
+   }
+   if (OnlyFormat) {
+      for (i = 0; i < (int) NUM_FORMATS; i++)
+         if (strcmp(OnlyFormat, Formats[i].name) == 0)
+            break;
+      if (i == (int) NUM_FORMATS)
+         Usage(argv[0]);
+   }
+   if (NumTris < 2 || NumTris % 2 || OnlyBatch > NumTris) {
+      printf("Error: -tris must be even, and at least -batch\n");
+      exit(1);
+   }
+
+   glutInitWindowPosition(0, 0);
+   glutInitWindowSize(256, 256);
+   glutInitDisplayMode(GLUT_RGB);
+   glutCreateWindow(argv[0]);
+   gladLoaderLoadGL();
+   glutReshapeFunc(Reshape);
+   glutKeyboardFunc(Key);
+   glutDisplayFunc(Draw);
+   Init();
+   glutMainLoop();
+   gladLoaderUnloadGL();
+   return 0;
+}
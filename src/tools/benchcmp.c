@@ -0,0 +1,669 @@
+/*
+ * Compare two sets of benchmark results written by the rate tests
+ * (see util/bench.h) and flag the cases that got slower.
+ *
+ * Cases are matched by test program, name and unit.  Results of several
+ * runs of the same case in one file are pooled.  JSON Lines results carry
+ * the rate of every repetition; the two sets of samples are compared with
+ * a Mann-Whitney U test, and a bootstrap gives a confidence interval for
+ * the relative change of the median.  CSV results only have summaries,
+ * so each run contributes its median as one sample; with a single run
+ * the p5..p95 ranges of the two sides must not overlap instead.  Note
+ * that with fewer than four samples on a side the U test can't reach
+ * p < 0.05, so gate on JSON results or on several CSV runs.
+ *
+ * All rates are "per second", so lower is worse.  A case is a regression
+ * if it is slower by more than the threshold and the difference is
+ * significant.  The exit code is 1 if there are any, 2 on errors.
+ *
+ * Usage: benchcmp [-t percent] [-a alpha] [-b resamples] baseline new
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+struct bench_case {
+   char *test, *name, *unit;
+   double *samples;
+   unsigned num_samples, max_samples;
+   double p5, p95;              /* of the last run */
+   int matched;
+};
+
+struct result_set {
+   const char *file;
+   struct bench_case *cases;
+   unsigned num_cases, max_cases;
+};
+
+/* one parsed result line */
+struct record {
+   char test[256], name[256], unit[64];
+   double median, p5, p95;
+   double samples[1024];
+   unsigned num_samples;
+};
+
+
+static double Threshold = 5.0;  /* percent */
+static double Alpha = 0.05;
+static unsigned Resamples = 10000;
+
+
+static struct bench_case *
+find_case(struct result_set *set, const struct record *rec)
+{
+   struct bench_case *c;
+   unsigned i;
+
+   for (i = 0; i < set->num_cases; i++) {
+      c = &set->cases[i];
+      if (strcmp(c->test, rec->test) == 0 &&
+          strcmp(c->name, rec->name) == 0 &&
+          strcmp(c->unit, rec->unit) == 0)
+         return c;
+   }
+
+   if (set->num_cases == set->max_cases) {
+      set->max_cases = set->max_cases ? 2 * set->max_cases : 64;
+      set->cases = (struct bench_case *)
+         realloc(set->cases, set->max_cases * sizeof(struct bench_case));
+   }
+   c = &set->cases[set->num_cases++];
+   memset(c, 0, sizeof(*c));
+   c->test = strdup(rec->test);
+   c->name = strdup(rec->name);
+   c->unit = strdup(rec->unit);
+   return c;
+}
+
+
+static void
+add_sample(struct bench_case *c, double sample)
+{
+   if (c->num_samples == c->max_samples) {
+      c->max_samples = c->max_samples ? 2 * c->max_samples : 16;
+      c->samples = (double *)
+         realloc(c->samples, c->max_samples * sizeof(double));
+   }
+   c->samples[c->num_samples++] = sample;
+}
+
+
+static void
+add_record(struct result_set *set, const struct record *rec)
+{
+   struct bench_case *c = find_case(set, rec);
+   unsigned i;
+
+   if (rec->num_samples) {
+      for (i = 0; i < rec->num_samples; i++)
+         add_sample(c, rec->samples[i]);
+   }
+   else {
+      add_sample(c, rec->median);
+   }
+   c->p5 = rec->p5;
+   c->p95 = rec->p95;
+}
+
+
+/**
+ * Parsing.  This only handles what bench.c writes: flat JSON objects
+ * with string, number and number array values, and CSV with a header.
+ */
+
+static const char *
+skip_space(const char *s)
+{
+   while (isspace((unsigned char) *s))
+      s++;
+   return s;
+}
+
+
+static const char *
+parse_json_string(const char *s, char *out, size_t size)
+{
+   size_t n = 0;
+
+   if (*s != '"')
+      return NULL;
+   for (s++; *s != '"'; s++) {
+      char ch = *s;
+      if (!ch)
+         return NULL;
+      if (ch == '\\') {
+         s++;
+         switch (*s) {
+         case 'n': ch = '\n'; break;
+         case 't': ch = '\t'; break;
+         case 'u':
+            if (strlen(s) < 5)
+               return NULL;
+            s += 4;
+            ch = '?';
+            break;
+         case '\0':
+            return NULL;
+         default:
+            ch = *s;
+         }
+      }
+      if (n + 1 < size)
+         out[n++] = ch;
+   }
+   out[n] = '\0';
+   return s + 1;
+}
+
+
+static int
+parse_json(const char *s, struct record *rec)
+{
+   char key[64], buf[256];
+   char *end;
+
+   s = skip_space(s);
+   if (*s++ != '{')
+      return 0;
+
+   for (;;) {
+      s = skip_space(s);
+      if (*s == '}')
+         break;
+      s = parse_json_string(s, key, sizeof(key));
+      if (!s)
+         return 0;
+      s = skip_space(s);
+      if (*s++ != ':')
+         return 0;
+      s = skip_space(s);
+
+      if (*s == '"') {
+         if (strcmp(key, "test") == 0)
+            s = parse_json_string(s, rec->test, sizeof(rec->test));
+         else if (strcmp(key, "name") == 0)
+            s = parse_json_string(s, rec->name, sizeof(rec->name));
+         else if (strcmp(key, "unit") == 0)
+            s = parse_json_string(s, rec->unit, sizeof(rec->unit));
+         else
+            s = parse_json_string(s, buf, sizeof(buf));
+         if (!s)
+            return 0;
+      }
+      else if (*s == '[') {
+         s = skip_space(s + 1);
+         while (*s != ']') {
+            double v = strtod(s, &end);
+            if (end == s)
+               return 0;
+            if (strcmp(key, "samples") == 0 &&
+                rec->num_samples < sizeof(rec->samples) / sizeof(double))
+               rec->samples[rec->num_samples++] = v;
+            s = skip_space(end);
+            if (*s == ',')
+               s = skip_space(s + 1);
+         }
+         s++;
+      }
+      else {
+         double v = strtod(s, &end);
+         if (end == s) {
+            /* true, false, null */
+            while (isalpha((unsigned char) *end))
+               end++;
+            if (end == s)
+               return 0;
+         }
+         if (strcmp(key, "median") == 0)
+            rec->median = v;
+         else if (strcmp(key, "p5") == 0)
+            rec->p5 = v;
+         else if (strcmp(key, "p95") == 0)
+            rec->p95 = v;
+         s = end;
+      }
+
+      s = skip_space(s);
+      if (*s == ',')
+         s++;
+      else if (*s != '}')
+         return 0;
+   }
+   return 1;
+}
+
+
+/** Split a CSV line in place, returns the number of fields */
+static unsigned
+split_csv(char *line, char **fields, unsigned max_fields)
+{
+   unsigned n = 0;
+   char *s = line, *d;
+
+   while (n < max_fields) {
+      fields[n++] = d = s;
+      if (*s == '"') {
+         for (s++; *s; s++) {
+            if (*s == '"') {
+               if (s[1] != '"')
+                  break;
+               s++;
+            }
+            *d++ = *s;
+         }
+         if (*s)
+            s++;
+      }
+      else {
+         while (*s && *s != ',' && *s != '\n' && *s != '\r')
+            *d++ = *s++;
+      }
+      if (*s != ',') {
+         *d = '\0';
+         break;
+      }
+      s++;
+      *d = '\0';
+   }
+   return n;
+}
+
+
+enum csv_column {
+   CSV_TEST,
+   CSV_NAME,
+   CSV_UNIT,
+   CSV_MEDIAN,
+   CSV_P5,
+   CSV_P95,
+   CSV_COLUMNS
+};
+
+static const char *CsvNames[CSV_COLUMNS] = {
+   "test", "name", "unit", "median", "p5", "p95"
+};
+
+
+static int
+read_results(struct result_set *set, const char *file)
+{
+   static char line[65536];
+   char *fields[32];
+   int columns[CSV_COLUMNS];
+   int csv = -1, lineno = 0, have_header = 0;
+   unsigned i, j, n;
+   FILE *f;
+
+   set->file = file;
+   f = fopen(file, "r");
+   if (!f) {
+      fprintf(stderr, "benchcmp: couldn't open %s\n", file);
+      return 0;
+   }
+
+   while (fgets(line, sizeof(line), f)) {
+      const char *s = skip_space(line);
+      struct record *rec;
+
+      lineno++;
+      if (!*s)
+         continue;
+
+      rec = (struct record *) calloc(1, sizeof(struct record));
+
+      if (csv < 0)
+         csv = *s != '{';
+
+      if (!csv) {
+         if (!parse_json(s, rec)) {
+            fprintf(stderr, "benchcmp: %s:%d: parse error\n", file, lineno);
+            free(rec);
+            fclose(f);
+            return 0;
+         }
+         add_record(set, rec);
+      }
+      else {
+         n = split_csv(line, fields, 32);
+         if (strcmp(fields[0], "test") == 0) {
+            /* header, the columns may be in any order */
+            for (i = 0; i < CSV_COLUMNS; i++) {
+               columns[i] = -1;
+               for (j = 0; j < n; j++) {
+                  if (strcmp(fields[j], CsvNames[i]) == 0)
+                     columns[i] = j;
+               }
+               if (columns[i] < 0) {
+                  fprintf(stderr, "benchcmp: %s: no %s column\n",
+                          file, CsvNames[i]);
+                  free(rec);
+                  fclose(f);
+                  return 0;
+               }
+            }
+            have_header = 1;
+         }
+         else if (!have_header) {
+            fprintf(stderr, "benchcmp: %s: unknown format\n", file);
+            free(rec);
+            fclose(f);
+            return 0;
+         }
+         else {
+            for (i = 0; i < CSV_COLUMNS; i++) {
+               if ((unsigned) columns[i] >= n) {
+                  fprintf(stderr, "benchcmp: %s:%d: missing fields\n",
+                          file, lineno);
+                  free(rec);
+                  fclose(f);
+                  return 0;
+               }
+            }
+            snprintf(rec->test, sizeof(rec->test), "%s", fields[columns[CSV_TEST]]);
+            snprintf(rec->name, sizeof(rec->name), "%s", fields[columns[CSV_NAME]]);
+            snprintf(rec->unit, sizeof(rec->unit), "%s", fields[columns[CSV_UNIT]]);
+            rec->median = atof(fields[columns[CSV_MEDIAN]]);
+            rec->p5 = atof(fields[columns[CSV_P5]]);
+            rec->p95 = atof(fields[columns[CSV_P95]]);
+            add_record(set, rec);
+         }
+      }
+      free(rec);
+   }
+
+   fclose(f);
+   return 1;
+}
+
+
+/**
+ * Statistics
+ */
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+   double x = *(const double *) a, y = *(const double *) b;
+   return x < y ? -1 : x > y;
+}
+
+
+static double
+median(double *values, unsigned count)
+{
+   qsort(values, count, sizeof(double), compare_doubles);
+   if (count & 1)
+      return values[count / 2];
+   return 0.5 * (values[count / 2 - 1] + values[count / 2]);
+}
+
+
+/**
+ * Exact two-sided p-value of the Mann-Whitney U statistic, for samples
+ * without ties.  The number of orderings giving each U are the
+ * coefficients of the Gaussian binomial [n1 + n2 choose n1](q), built as
+ * the product of (1 - q^(n2 + k)) / (1 - q^k) for k = 1..n1.
+ */
+static double
+exact_u_p(unsigned n1, unsigned n2, double u)
+{
+   unsigned size = n1 * n2 + 1, k, i, deg = 0;
+   double *c = (double *) calloc(size, sizeof(double));
+   double total = 0.0, below = 0.0, above = 0.0, p;
+
+   c[0] = 1.0;
+   for (k = 1; k <= n1; k++) {
+      /* multiply by 1 - q^(n2 + k) */
+      unsigned m = n2 + k;
+      for (i = deg + m; i >= m; i--) {
+         if (i < size)
+            c[i] -= c[i - m];
+      }
+      /* divide by 1 - q^k */
+      for (i = k; i < size; i++)
+         c[i] += c[i - k];
+      deg += n2;
+   }
+
+   for (i = 0; i < size; i++) {
+      total += c[i];
+      if (i <= u)
+         below += c[i];
+      if (i >= u)
+         above += c[i];
+   }
+   free(c);
+
+   p = 2.0 * (below < above ? below : above) / total;
+   return p < 1.0 ? p : 1.0;
+}
+
+
+/** Two-sided Mann-Whitney U test, returns the p-value */
+static double
+mann_whitney(const double *a, unsigned na, const double *b, unsigned nb)
+{
+   unsigned n = na + nb, i, j;
+   double *all = (double *) malloc(n * sizeof(double));
+   double ranks_a = 0.0, ties = 0.0, u, mu, sigma, z;
+
+   memcpy(all, a, na * sizeof(double));
+   memcpy(all + na, b, nb * sizeof(double));
+   qsort(all, n, sizeof(double), compare_doubles);
+
+   /* sum of the (average) ranks of a */
+   for (i = 0; i < n; i = j) {
+      double rank, t;
+      unsigned k;
+      for (j = i + 1; j < n && all[j] == all[i]; j++)
+         ;
+      rank = 0.5 * (i + 1 + j);
+      t = j - i;
+      ties += t * t * t - t;
+      for (k = 0; k < na; k++) {
+         if (a[k] == all[i])
+            ranks_a += rank;
+      }
+   }
+   free(all);
+
+   u = ranks_a - 0.5 * na * (na + 1);
+
+   if (ties == 0.0 && (double) na * nb <= 100000.0)
+      return exact_u_p(na, nb, u);
+
+   /* normal approximation, with tie and continuity corrections */
+   mu = 0.5 * na * nb;
+   sigma = sqrt(na * nb / 12.0 * ((n + 1) - ties / ((double) n * (n - 1))));
+   if (sigma == 0.0)
+      return 1.0;
+   z = (fabs(u - mu) - 0.5) / sigma;
+   if (z < 0.0)
+      z = 0.0;
+   return erfc(z / sqrt(2.0));
+}
+
+
+static uint64_t
+next_random(uint64_t *state)
+{
+   /* xorshift64* */
+   *state ^= *state >> 12;
+   *state ^= *state << 25;
+   *state ^= *state >> 27;
+   return *state * 0x2545f4914f6cdd1dull;
+}
+
+
+/**
+ * Bootstrap confidence interval of median(b) / median(a) - 1, at the
+ * 1 - Alpha level.  Seeded the same every time, so that the same inputs
+ * give the same output.
+ */
+static void
+bootstrap(const double *a, unsigned na, const double *b, unsigned nb,
+          double *lo, double *hi)
+{
+   double *changes = (double *) malloc(Resamples * sizeof(double));
+   double *ra = (double *) malloc(na * sizeof(double));
+   double *rb = (double *) malloc(nb * sizeof(double));
+   uint64_t state = 0x9e3779b97f4a7c15ull;
+   unsigned r, i;
+
+   for (r = 0; r < Resamples; r++) {
+      double ma, mb;
+      for (i = 0; i < na; i++)
+         ra[i] = a[next_random(&state) % na];
+      for (i = 0; i < nb; i++)
+         rb[i] = b[next_random(&state) % nb];
+      ma = median(ra, na);
+      mb = median(rb, nb);
+      changes[r] = ma > 0.0 ? mb / ma - 1.0 : 0.0;
+   }
+   qsort(changes, Resamples, sizeof(double), compare_doubles);
+   *lo = changes[(unsigned) (0.5 * Alpha * (Resamples - 1))];
+   *hi = changes[(unsigned) ((1.0 - 0.5 * Alpha) * (Resamples - 1))];
+
+   free(rb);
+   free(ra);
+   free(changes);
+}
+
+
+/** Compare one case, returns 1 for a regression */
+static int
+compare_case(struct bench_case *base, struct bench_case *new)
+{
+   double *a, *b, ma, mb, change, lo = 0.0, hi = 0.0, p = -1.0;
+   int significant, regression = 0;
+   char label[600];
+
+   /* median() sorts, keep the samples in file order */
+   a = (double *) malloc(base->num_samples * sizeof(double));
+   b = (double *) malloc(new->num_samples * sizeof(double));
+   memcpy(a, base->samples, base->num_samples * sizeof(double));
+   memcpy(b, new->samples, new->num_samples * sizeof(double));
+   ma = median(a, base->num_samples);
+   mb = median(b, new->num_samples);
+   change = ma > 0.0 ? mb / ma - 1.0 : 0.0;
+
+   if (base->num_samples > 1 && new->num_samples > 1) {
+      p = mann_whitney(a, base->num_samples, b, new->num_samples);
+      bootstrap(a, base->num_samples, b, new->num_samples, &lo, &hi);
+      significant = p < Alpha;
+   }
+   else {
+      /* single summaries, use the spread of the runs */
+      significant = new->p95 < base->p5 || new->p5 > base->p95;
+   }
+
+   snprintf(label, sizeof(label), "%s: %s", base->test, base->name);
+   printf("%-48s %11.5g %11.5g %-8s %+7.2f%%", label, ma, mb, base->unit,
+          100.0 * change);
+   if (p >= 0.0)
+      printf("  [%+7.2f%%, %+7.2f%%]  p=%-7.2g",
+             100.0 * lo, 100.0 * hi, p);
+   else
+      printf("  %29s", "");
+
+   if (significant && change < -0.01 * Threshold) {
+      printf("  REGRESSION");
+      regression = 1;
+   }
+   else if (significant && change > 0.01 * Threshold) {
+      printf("  improvement");
+   }
+   printf("\n");
+
+   free(b);
+   free(a);
+   return regression;
+}
+
+
+static void
+usage(void)
+{
+   fprintf(stderr,
+           "usage: benchcmp [-t percent] [-a alpha] [-b resamples] "
+           "baseline new\n"
+           "  -t percent    smallest slowdown that counts (default 5)\n"
+           "  -a alpha      significance level (default 0.05)\n"
+           "  -b resamples  bootstrap resamples (default 10000)\n");
+   exit(2);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   struct result_set base, new;
+   const char *files[2];
+   unsigned num_files = 0, i, j, regressions = 0, unmatched = 0;
+   int k;
+
+   for (k = 1; k < argc; k++) {
+      if (strcmp(argv[k], "-t") == 0 && k + 1 < argc)
+         Threshold = atof(argv[++k]);
+      else if (strcmp(argv[k], "-a") == 0 && k + 1 < argc)
+         Alpha = atof(argv[++k]);
+      else if (strcmp(argv[k], "-b") == 0 && k + 1 < argc)
+         Resamples = atoi(argv[++k]);
+      else if (argv[k][0] == '-' || num_files == 2)
+         usage();
+      else
+         files[num_files++] = argv[k];
+   }
+   if (num_files != 2 || Alpha <= 0.0 || Alpha >= 1.0 || Resamples < 1)
+      usage();
+
+   memset(&base, 0, sizeof(base));
+   memset(&new, 0, sizeof(new));
+   if (!read_results(&base, files[0]) || !read_results(&new, files[1]))
+      return 2;
+
+   printf("%-48s %11s %11s %-8s %8s  %-22s  %s\n", "case", "baseline",
+          "new", "unit", "change", "bootstrap CI", "p");
+
+   for (i = 0; i < base.num_cases; i++) {
+      for (j = 0; j < new.num_cases; j++) {
+         if (!new.cases[j].matched &&
+             strcmp(base.cases[i].test, new.cases[j].test) == 0 &&
+             strcmp(base.cases[i].name, new.cases[j].name) == 0 &&
+             strcmp(base.cases[i].unit, new.cases[j].unit) == 0)
+            break;
+      }
+      if (j < new.num_cases) {
+         base.cases[i].matched = new.cases[j].matched = 1;
+         regressions += compare_case(&base.cases[i], &new.cases[j]);
+      }
+   }
+
+   for (i = 0; i < base.num_cases; i++) {
+      if (!base.cases[i].matched) {
+         printf("only in %s: %s: %s\n", base.file, base.cases[i].test,
+                base.cases[i].name);
+         unmatched++;
+      }
+   }
+   for (i = 0; i < new.num_cases; i++) {
+      if (!new.cases[i].matched) {
+         printf("only in %s: %s: %s\n", new.file, new.cases[i].test,
+                new.cases[i].name);
+         unmatched++;
+      }
+   }
+
+   printf("%u regression%s, %u unmatched case%s\n",
+          regressions, regressions == 1 ? "" : "s",
+          unmatched, unmatched == 1 ? "" : "s");
+
+   return regressions ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * Compare the startup time of programs with glad resolving all GL entry
+ * points up front (the default) and on first call (GLAD_LAZY=1).
+ *
+ * Each program is run -n times each way, interleaved so that drift in
+ * the machine's speed affects both the same, with its output thrown
+ * away.  The median wall time of the runs is reported.  This is meant
+ * for a build with -Dglut-headless=true: GLUT_HEADLESS_FRAMES makes the
+ * GLUT programs exit after a few frames.  A run that takes longer than
+ * -timeout seconds is killed and counts as failed.
+ *
+ * Usage: gladstartup [-n runs] [-frames N] [-timeout seconds] program...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "bench.h"
+
+
+static unsigned Runs = 11;
+static const char *Frames = "1";
+static unsigned Timeout = 10;
+
+
+/** Run the program once, returning its wall time in ns or 0 on failure */
+static uint64_t
+run(const char *program, int lazy)
+{
+   uint64_t start = bench_time_ns();
+   int status;
+   pid_t pid;
+
+   pid = fork();
+   if (pid < 0) {
+      perror("fork");
+      exit(2);
+   }
+   if (pid == 0) {
+      int null = open("/dev/null", O_WRONLY);
+
+      if (null >= 0) {
+         dup2(null, 1);
+         dup2(null, 2);
+      }
+      setenv("GLAD_LAZY", lazy ? "1" : "0", 1);
+      setenv("GLUT_HEADLESS_FRAMES", Frames, 1);
+      alarm(Timeout);
+      execl(program, program, (char *) NULL);
+      _exit(127);
+   }
+
+   if (waitpid(pid, &status, 0) < 0 ||
+       !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      return 0;
+   return bench_time_ns() - start;
+}
+
+
+static int
+compare_u64(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+   return (x > y) - (x < y);
+}
+
+
+static double
+median_ms(uint64_t *ns, unsigned count)
+{
+   qsort(ns, count, sizeof(uint64_t), compare_u64);
+   return ns[count / 2] / 1e6;
+}
+
+
+static void
+usage(void)
+{
+   fprintf(stderr,
+           "usage: gladstartup [-n runs] [-frames N] [-timeout seconds] "
+           "program...\n"
+           "  -n runs            runs of each program each way (default 11)\n"
+           "  -frames N          GLUT_HEADLESS_FRAMES (default 1)\n"
+           "  -timeout seconds   kill a run after this long (default 10)\n");
+   exit(2);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   double total[2] = { 0.0, 0.0 };
+   uint64_t *times[2];
+   unsigned i, failed = 0;
+   int k, first, mode;
+
+   for (k = 1; k < argc && argv[k][0] == '-'; k++) {
+      if (strcmp(argv[k], "-n") == 0 && k + 1 < argc)
+         Runs = atoi(argv[++k]);
+      else if (strcmp(argv[k], "-frames") == 0 && k + 1 < argc)
+         Frames = argv[++k];
+      else if (strcmp(argv[k], "-timeout") == 0 && k + 1 < argc)
+         Timeout = atoi(argv[++k]);
+      else
+         usage();
+   }
+   if (k == argc || Runs < 1)
+      usage();
+   first = k;
+
+   times[0] = malloc(Runs * sizeof(uint64_t));
+   times[1] = malloc(Runs * sizeof(uint64_t));
+   if (!times[0] || !times[1])
+      return 2;
+
+   printf("%-32s %10s %10s %8s\n", "program", "eager ms", "lazy ms",
+          "change");
+
+   for (k = first; k < argc; k++) {
+      double ms[2];
+
+      for (i = 0; i < Runs; i++) {
+         for (mode = 0; mode < 2; mode++) {
+            times[mode][i] = run(argv[k], mode);
+            if (!times[mode][i])
+               break;
+         }
+         if (mode < 2)
+            break;
+      }
+      if (i < Runs) {
+         printf("%-32s failed\n", argv[k]);
+         failed++;
+         continue;
+      }
+
+      for (mode = 0; mode < 2; mode++) {
+         ms[mode] = median_ms(times[mode], Runs);
+         total[mode] += ms[mode];
+      }
+      printf("%-32s %10.2f %10.2f %+7.1f%%\n", argv[k], ms[0], ms[1],
+             100.0 * (ms[1] - ms[0]) / ms[0]);
+      fflush(stdout);
+   }
+
+   if (total[0] > 0.0)
+      printf("%-32s %10.2f %10.2f %+7.1f%%\n", "total", total[0], total[1],
+             100.0 * (total[1] - total[0]) / total[0]);
+   if (failed)
+      printf("%u program%s failed\n", failed, failed == 1 ? "" : "s");
+
+   free(times[0]);
+   free(times[1]);
+   return failed ? 1 : 0;
+}
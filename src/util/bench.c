@@ -0,0 +1,373 @@
+/*
+ * Benchmark helpers shared by the rate tests.  See bench.h.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+#include "bench.h"
+
+
+enum bench_format {
+   BENCH_TEXT,
+   BENCH_JSON,
+   BENCH_CSV,
+};
+
+static struct {
+   enum bench_format format;
+   const char *output;
+   unsigned repetitions;
+   double time;
+   double warmup;
+   const char *test;
+   char *renderer;
+   FILE *file;
+} Bench = { BENCH_TEXT, NULL, 5, 0.25, 0.1, "", NULL, NULL };
+
+
+uint64_t
+bench_time_ns(void)
+{
+#ifdef _WIN32
+   LARGE_INTEGER freq, count;
+   QueryPerformanceFrequency(&freq);
+   QueryPerformanceCounter(&count);
+   return (uint64_t) (count.QuadPart * (1e9 / freq.QuadPart));
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+
+/** User + system CPU time of the process, in seconds */
+double
+bench_cpu_seconds(void)
+{
+#ifdef _WIN32
+   FILETIME creation, exit, kernel, user;
+   ULARGE_INTEGER k, u;
+   GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+   k.LowPart = kernel.dwLowDateTime;
+   k.HighPart = kernel.dwHighDateTime;
+   u.LowPart = user.dwLowDateTime;
+   u.HighPart = user.dwHighDateTime;
+   return (k.QuadPart + u.QuadPart) * 1e-7;
+#else
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+          usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#endif
+}
+
+
+static void
+set_option(const char *name, const char *value)
+{
+   if (strcmp(name, "format") == 0) {
+      if (strcmp(value, "json") == 0)
+         Bench.format = BENCH_JSON;
+      else if (strcmp(value, "csv") == 0)
+         Bench.format = BENCH_CSV;
+      else if (strcmp(value, "text") == 0)
+         Bench.format = BENCH_TEXT;
+      else
+         fprintf(stderr, "bench: unknown format '%s'\n", value);
+   }
+   else if (strcmp(name, "output") == 0) {
+      Bench.output = value;
+   }
+   else if (strcmp(name, "reps") == 0) {
+      Bench.repetitions = atoi(value) > 0 ? atoi(value) : 1;
+   }
+   else if (strcmp(name, "time") == 0) {
+      if (atof(value) > 0.0)
+         Bench.time = atof(value);
+   }
+   else if (strcmp(name, "warmup") == 0) {
+      Bench.warmup = atof(value);
+   }
+   else {
+      fprintf(stderr, "bench: unknown option -bench-%s\n", name);
+   }
+}
+
+
+/**
+ * Change the defaults of -bench-reps, -bench-time and -bench-warmup,
+ * for programs that run many short tests.  Call before bench_init().
+ */
+void
+bench_set_defaults(unsigned repetitions, double time, double warmup)
+{
+   Bench.repetitions = repetitions;
+   Bench.time = time;
+   Bench.warmup = warmup;
+}
+
+
+/**
+ * Read the benchmark options from the environment and the command line,
+ * removing the latter from argv.
+ */
+void
+bench_init(int *argc, char **argv)
+{
+   static const char *names[] = { "format", "output", "reps", "time",
+                                  "warmup" };
+   const char *slash;
+   unsigned i;
+   int j, k;
+
+   for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+      char env[32];
+      const char *value;
+      unsigned c;
+
+      snprintf(env, sizeof(env), "BENCH_%s", names[i]);
+      for (c = 0; env[c]; c++)
+         env[c] = (env[c] >= 'a' && env[c] <= 'z') ? env[c] - 'a' + 'A' : env[c];
+      value = getenv(env);
+      if (value && *value)
+         set_option(names[i], value);
+   }
+
+   for (j = k = 1; j < *argc; j++) {
+      if (strncmp(argv[j], "-bench-", 7) == 0 && j + 1 < *argc) {
+         set_option(argv[j] + 7, argv[j + 1]);
+         j++;
+      }
+      else {
+         argv[k++] = argv[j];
+      }
+   }
+   *argc = k;
+   argv[k] = NULL;
+
+   slash = strrchr(argv[0], '/');
+   Bench.test = slash ? slash + 1 : argv[0];
+}
+
+
+/** Renderer to record with the results, normally GL_RENDERER */
+void
+bench_set_renderer(const char *renderer)
+{
+   free(Bench.renderer);
+   Bench.renderer = renderer ? strdup(renderer) : NULL;
+}
+
+
+static void
+print_string(FILE *f, const char *s, char quote)
+{
+   fputc('"', f);
+   for (; *s; s++) {
+      if (*s == '"')
+         fputc(quote, f);
+      else if (*s == '\\' && quote == '\\')
+         fputc('\\', f);
+      if ((unsigned char) *s >= ' ')
+         fputc(*s, f);
+   }
+   fputc('"', f);
+}
+
+
+static FILE *
+output(void)
+{
+   if (Bench.file)
+      return Bench.file;
+
+   Bench.file = stdout;
+   if (Bench.output) {
+      Bench.file = fopen(Bench.output, "a");
+      if (!Bench.file) {
+         fprintf(stderr, "bench: couldn't open %s\n", Bench.output);
+         Bench.file = stdout;
+      }
+   }
+
+   /* header, unless appending to a file that has one */
+   if (Bench.format == BENCH_CSV && ftell(Bench.file) <= 0) {
+      fprintf(Bench.file, "test,name,unit,renderer,iterations,repetitions,"
+              "median,p5,p95,mean,stddev,cpu_ns_per_op,wall_ns_per_op\n");
+   }
+   return Bench.file;
+}
+
+
+static void
+report(const char *name, const char *unit, const struct bench_result *r,
+       const double *rates)
+{
+   FILE *f = output();
+   const char *renderer = Bench.renderer ? Bench.renderer : "";
+   unsigned i;
+
+   switch (Bench.format) {
+   case BENCH_TEXT:
+      fprintf(f, "%s: %.6g %s/sec (p5 %.6g, p95 %.6g, stddev %.1f%%, "
+              "%.0f ns CPU/%s)\n", name, r->median, unit, r->p5, r->p95,
+              r->mean > 0.0 ? 100.0 * r->stddev / r->mean : 0.0,
+              r->cpu_ns_per_op, unit);
+      break;
+   case BENCH_JSON:
+      fprintf(f, "{\"test\": ");
+      print_string(f, Bench.test, '\\');
+      fprintf(f, ", \"name\": ");
+      print_string(f, name, '\\');
+      fprintf(f, ", \"unit\": ");
+      print_string(f, unit, '\\');
+      fprintf(f, ", \"renderer\": ");
+      print_string(f, renderer, '\\');
+      fprintf(f, ", \"iterations\": %u, \"repetitions\": %u, "
+              "\"median\": %.9g, \"p5\": %.9g, \"p95\": %.9g, "
+              "\"mean\": %.9g, \"stddev\": %.9g, "
+              "\"cpu_ns_per_op\": %.9g, \"wall_ns_per_op\": %.9g, "
+              "\"samples\": [",
+              r->iterations, r->repetitions, r->median, r->p5, r->p95,
+              r->mean, r->stddev, r->cpu_ns_per_op, r->wall_ns_per_op);
+      for (i = 0; i < r->repetitions; i++)
+         fprintf(f, "%s%.9g", i ? ", " : "", rates[i]);
+      fprintf(f, "]}\n");
+      break;
+   case BENCH_CSV:
+      print_string(f, Bench.test, '"');
+      fputc(',', f);
+      print_string(f, name, '"');
+      fputc(',', f);
+      print_string(f, unit, '"');
+      fputc(',', f);
+      print_string(f, renderer, '"');
+      fprintf(f, ",%u,%u,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n",
+              r->iterations, r->repetitions, r->median, r->p5, r->p95,
+              r->mean, r->stddev, r->cpu_ns_per_op, r->wall_ns_per_op);
+      break;
+   }
+   fflush(f);
+}
+
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+   double x = *(const double *) a, y = *(const double *) b;
+   return x < y ? -1 : x > y;
+}
+
+
+/** Percentile of sorted values, interpolating between neighbours */
+static double
+percentile(const double *sorted, unsigned count, double p)
+{
+   double pos = p * (count - 1);
+   unsigned i = (unsigned) pos;
+
+   if (i + 1 >= count)
+      return sorted[count - 1];
+   return sorted[i] + (pos - i) * (sorted[i + 1] - sorted[i]);
+}
+
+
+static double
+time_call(bench_func func, void *data, unsigned iterations)
+{
+   uint64_t t0 = bench_time_ns();
+   func(data, iterations);
+   return (bench_time_ns() - t0) * 1e-9;
+}
+
+
+/**
+ * Measure the rate of an operation.
+ *
+ * \param name  what is measured, for the report
+ * \param func  does the given number of iterations and waits for them
+ * \param data  passed to func
+ * \param ops_per_iteration  operations (pixels, bytes, ...) an iteration
+ *                           does, in the units the rate is reported in
+ * \param unit  name of the operation, e.g. "Mpixels"
+ * \param result  if not NULL, returns the numbers reported
+ */
+void
+bench_run(const char *name, bench_func func, void *data,
+          double ops_per_iteration, const char *unit,
+          struct bench_result *result)
+{
+   struct bench_result r;
+   double *rates, elapsed, sum, cpu, wall;
+   uint64_t start;
+   unsigned iterations, i;
+
+   memset(&r, 0, sizeof(r));
+
+   /* calibrate, which also starts the warmup */
+   start = bench_time_ns();
+   iterations = 1;
+   for (;;) {
+      elapsed = time_call(func, data, iterations);
+      if (elapsed >= Bench.time / 4 || iterations >= (1u << 30))
+         break;
+      if (elapsed < Bench.time / 400)
+         iterations *= 100;
+      else
+         iterations = (unsigned) (iterations * (Bench.time / 4) / elapsed) + 1;
+   }
+   if (elapsed > 0.0) {
+      double scaled = iterations * Bench.time / elapsed;
+      iterations = scaled < 1.0 ? 1 : scaled > 4e9 ? 4000000000u :
+                   (unsigned) scaled;
+   }
+
+   while ((bench_time_ns() - start) * 1e-9 < Bench.warmup)
+      time_call(func, data, iterations);
+
+   rates = (double *) malloc(Bench.repetitions * sizeof(double));
+   cpu = bench_cpu_seconds();
+   wall = 0.0;
+   for (i = 0; i < Bench.repetitions; i++) {
+      elapsed = time_call(func, data, iterations);
+      wall += elapsed;
+      rates[i] = elapsed > 0.0 ?
+         iterations * ops_per_iteration / elapsed : 0.0;
+   }
+   cpu = bench_cpu_seconds() - cpu;
+
+   qsort(rates, Bench.repetitions, sizeof(double), compare_doubles);
+   sum = 0.0;
+   for (i = 0; i < Bench.repetitions; i++)
+      sum += rates[i];
+   r.mean = sum / Bench.repetitions;
+   sum = 0.0;
+   for (i = 0; i < Bench.repetitions; i++)
+      sum += (rates[i] - r.mean) * (rates[i] - r.mean);
+   r.stddev = Bench.repetitions > 1 ?
+      sqrt(sum / (Bench.repetitions - 1)) : 0.0;
+
+   r.iterations = iterations;
+   r.repetitions = Bench.repetitions;
+   r.median = percentile(rates, Bench.repetitions, 0.5);
+   r.p5 = percentile(rates, Bench.repetitions, 0.05);
+   r.p95 = percentile(rates, Bench.repetitions, 0.95);
+   r.cpu_ns_per_op = ops_per_iteration > 0.0 ?
+      cpu * 1e9 / ((double) iterations * Bench.repetitions *
+                   ops_per_iteration) : 0.0;
+   r.wall_ns_per_op = r.median > 0.0 ? 1e9 / r.median : 0.0;
+
+   report(name, unit, &r, rates);
+   free(rates);
+   if (result)
+      *result = r;
+}
@@ -0,0 +1,68 @@
+/*
+ * Benchmark helpers shared by the rate tests.
+ *
+ * A benchmark is a function that does some number of iterations of an
+ * operation and waits for them to complete (glFinish() etc).  bench_run()
+ * calibrates the iteration count so that one call takes about
+ * -bench-time seconds, warms up, then times -bench-reps calls and
+ * reports the median, 5th and 95th percentile rate along with the CPU
+ * time per unit of the rate (per MPixel, per call, ...).
+ *
+ * Options, removed from argv by bench_init():
+ *   -bench-format text|json|csv   output format (default text)
+ *   -bench-output FILE            append results to FILE (default stdout)
+ *   -bench-reps N                 timed repetitions (default 5)
+ *   -bench-time SECONDS           time per repetition (default 0.25)
+ *   -bench-warmup SECONDS         untimed warmup (default 0.1)
+ *
+ * The BENCH_FORMAT, BENCH_OUTPUT, BENCH_REPS, BENCH_TIME and BENCH_WARMUP
+ * environment variables set the same things, for running many programs
+ * the same way.  "json" writes one object per line, so results of
+ * several runs can be appended to the same file, and includes the rate
+ * of each repetition for tools/benchcmp.
+ *
+ * benchcmp matches results by unit, so the tests share their spelling:
+ * MPixels, Mtexels and Mtri are millions, MB is 10^6 bytes.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+
+struct bench_result {
+   unsigned iterations;         /* per repetition */
+   unsigned repetitions;
+   double median;               /* operations per second */
+   double p5, p95;
+   double mean, stddev;
+   double cpu_ns_per_op;        /* user + system CPU time per unit */
+   double wall_ns_per_op;       /* at the median rate */
+};
+
+
+typedef void (*bench_func)(void *data, unsigned iterations);
+
+
+void
+bench_set_defaults(unsigned repetitions, double time, double warmup);
+
+void
+bench_init(int *argc, char **argv);
+
+void
+bench_set_renderer(const char *renderer);
+
+uint64_t
+bench_time_ns(void);
+
+double
+bench_cpu_seconds(void);
+
+void
+bench_run(const char *name, bench_func func, void *data,
+          double ops_per_iteration, const char *unit,
+          struct bench_result *result);
+
+#endif /* BENCH_H */
@@ -0,0 +1,606 @@
+/*
+ * Frame capture on worker threads.  See capture.h.
+ *
+ * Frames go round between the render thread and the workers through two
+ * lock-free queues (bounded multi-producer, multi-consumer rings, after
+ * Dmitry Vyukov's): the render thread takes an empty frame from Free,
+ * fills it and puts it on Full; a worker takes it from Full, writes it
+ * and puts it back on Free.  A thread only takes the mutex to go to
+ * sleep when the queue it wants is empty, and one that puts a frame on
+ * a queue only takes it to wake sleepers if there are any.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_PNG
+#include <png.h>
+#endif
+#include "glad/gl.h"
+#include "capture.h"
+
+
+#define MAX_WORKERS 8
+#define NUM_PBO 3       /* frames being read back at a time */
+
+enum capture_format {
+   CAPTURE_PPM,
+   CAPTURE_PNG,
+   CAPTURE_YUV,
+};
+
+struct frame {
+   int number;
+   GLubyte *pixels;     /* BGRA, bottom row first */
+};
+
+struct cell {
+   atomic_size_t seq;
+   struct frame *frame;
+};
+
+struct queue {
+   struct cell *cells;
+   size_t mask;
+   atomic_size_t head, tail;
+};
+
+struct capture {
+   char *path;
+   enum capture_format format;
+   int width, height;
+   size_t size;         /* of a BGRA frame */
+   int fd;              /* for .yuv */
+
+   struct frame *frames;
+   unsigned num_frames;
+   struct frame quit;
+   struct queue free, full;
+   pthread_mutex_t lock;
+   pthread_cond_t wake;
+   atomic_int sleepers;
+
+   pthread_t workers[MAX_WORKERS];
+   unsigned num_workers;
+   atomic_int written;
+
+   /* frames being read back, the oldest in slot pbo_next */
+   GLboolean use_pbo;
+   GLuint pbo[NUM_PBO];
+   GLsync fence[NUM_PBO];
+   int pbo_number[NUM_PBO];
+   unsigned pbo_next, pbo_count;
+   int number;
+};
+
+
+static GLboolean
+queue_init(struct queue *q, unsigned size)
+{
+   size_t i, n = 1;
+
+   while (n < size)
+      n *= 2;
+   q->cells = calloc(n, sizeof(*q->cells));
+   if (!q->cells)
+      return GL_FALSE;
+   for (i = 0; i < n; i++)
+      atomic_init(&q->cells[i].seq, i);
+   q->mask = n - 1;
+   atomic_init(&q->head, 0);
+   atomic_init(&q->tail, 0);
+   return GL_TRUE;
+}
+
+
+/** Add a frame, returning false if the queue is full */
+static GLboolean
+queue_push(struct queue *q, struct frame *frame)
+{
+   size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+   struct cell *cell;
+
+   for (;;) {
+      intptr_t diff;
+
+      cell = &q->cells[pos & q->mask];
+      diff = (intptr_t) atomic_load_explicit(&cell->seq, memory_order_acquire)
+         - (intptr_t) pos;
+      if (diff == 0) {
+         if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                   memory_order_relaxed,
+                                                   memory_order_relaxed))
+            break;
+      }
+      else if (diff < 0) {
+         return GL_FALSE;
+      }
+      else {
+         pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+      }
+   }
+
+   cell->frame = frame;
+   atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+   return GL_TRUE;
+}
+
+
+/** Remove the oldest frame, returning NULL if the queue is empty */
+static struct frame *
+queue_pop(struct queue *q)
+{
+   size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+   struct cell *cell;
+   struct frame *frame;
+
+   for (;;) {
+      intptr_t diff;
+
+      cell = &q->cells[pos & q->mask];
+      diff = (intptr_t) atomic_load_explicit(&cell->seq, memory_order_acquire)
+         - (intptr_t) (pos + 1);
+      if (diff == 0) {
+         if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                   memory_order_relaxed,
+                                                   memory_order_relaxed))
+            break;
+      }
+      else if (diff < 0) {
+         return NULL;
+      }
+      else {
+         pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+      }
+   }
+
+   frame = cell->frame;
+   atomic_store_explicit(&cell->seq, pos + q->mask + 1, memory_order_release);
+   return frame;
+}
+
+
+static void
+put_frame(struct capture *c, struct queue *q, struct frame *frame)
+{
+   /* the queues have room for every frame */
+   if (!queue_push(q, frame))
+      abort();
+
+   /* pairs with the fence in get_frame(): either we see the sleeper, or
+    * it sees the frame
+    */
+   atomic_thread_fence(memory_order_seq_cst);
+   if (atomic_load_explicit(&c->sleepers, memory_order_relaxed)) {
+      pthread_mutex_lock(&c->lock);
+      pthread_cond_broadcast(&c->wake);
+      pthread_mutex_unlock(&c->lock);
+   }
+}
+
+
+static struct frame *
+get_frame(struct capture *c, struct queue *q)
+{
+   struct frame *frame = queue_pop(q);
+
+   while (!frame) {
+      pthread_mutex_lock(&c->lock);
+      atomic_fetch_add_explicit(&c->sleepers, 1, memory_order_relaxed);
+      atomic_thread_fence(memory_order_seq_cst);
+      frame = queue_pop(q);
+      if (!frame)
+         pthread_cond_wait(&c->wake, &c->lock);
+      atomic_fetch_sub_explicit(&c->sleepers, 1, memory_order_relaxed);
+      pthread_mutex_unlock(&c->lock);
+      if (!frame)
+         frame = queue_pop(q);
+   }
+   return frame;
+}
+
+
+/** BGRA bottom-up to RGB top-down */
+static void
+to_rgb(const struct capture *c, const GLubyte *src, GLubyte *dst)
+{
+   int x, y;
+
+   for (y = c->height - 1; y >= 0; y--) {
+      const GLubyte *p = src + (size_t) y * c->width * 4;
+      for (x = 0; x < c->width; x++) {
+         dst[0] = p[2];
+         dst[1] = p[1];
+         dst[2] = p[0];
+         dst += 3;
+         p += 4;
+      }
+   }
+}
+
+
+/** BGRA bottom-up to I420 top-down, averaging chroma over 2x2 pixels */
+static void
+to_i420(const struct capture *c, const GLubyte *src, GLubyte *dst)
+{
+   const int w = c->width, h = c->height;
+   const int cw = (w + 1) / 2, ch = (h + 1) / 2;
+   GLubyte *py = dst, *pu = dst + (size_t) w * h, *pv = pu + (size_t) cw * ch;
+   int x, y;
+
+   for (y = 0; y < h; y++) {
+      const GLubyte *p = src + (size_t) (h - 1 - y) * w * 4;
+      for (x = 0; x < w; x++, p += 4)
+         *py++ = ((66 * p[2] + 129 * p[1] + 25 * p[0] + 128) >> 8) + 16;
+   }
+
+   for (y = 0; y < ch; y++) {
+      const int y0 = h - 1 - 2 * y, y1 = y0 > 0 ? y0 - 1 : y0;
+      const GLubyte *r0 = src + (size_t) y0 * w * 4;
+      const GLubyte *r1 = src + (size_t) y1 * w * 4;
+      for (x = 0; x < cw; x++) {
+         const int x0 = 2 * x * 4, x1 = 2 * x + 1 < w ? x0 + 4 : x0;
+#define AVG(i) ((r0[x0 + i] + r0[x1 + i] + r1[x0 + i] + r1[x1 + i] + 2) >> 2)
+         const int b = AVG(0), g = AVG(1), r = AVG(2);
+#undef AVG
+         *pu++ = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+         *pv++ = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+      }
+   }
+}
+
+
+static GLboolean
+write_frame(struct capture *c, const struct frame *frame, GLubyte *scratch)
+{
+   char name[1000];
+   size_t size;
+   FILE *f;
+
+   snprintf(name, sizeof(name), c->path, frame->number);
+
+   switch (c->format) {
+   case CAPTURE_YUV:
+      size = (size_t) c->width * c->height +
+         2 * (size_t) ((c->width + 1) / 2) * ((c->height + 1) / 2);
+      to_i420(c, frame->pixels, scratch);
+      if (pwrite(c->fd, scratch, size, (off_t) frame->number * size) !=
+          (ssize_t) size) {
+         fprintf(stderr, "capture: error writing frame %d to %s\n",
+                 frame->number, c->path);
+         return GL_FALSE;
+      }
+      return GL_TRUE;
+
+   case CAPTURE_PNG:
+#ifdef HAVE_PNG
+   {
+      png_image image;
+
+      to_rgb(c, frame->pixels, scratch);
+      memset(&image, 0, sizeof(image));
+      image.version = PNG_IMAGE_VERSION;
+      image.width = c->width;
+      image.height = c->height;
+      image.format = PNG_FORMAT_RGB;
+      if (!png_image_write_to_file(&image, name, 0, scratch, 0, NULL)) {
+         fprintf(stderr, "capture: error writing %s: %s\n",
+                 name, image.message);
+         return GL_FALSE;
+      }
+      return GL_TRUE;
+   }
+#else
+      return GL_FALSE;
+#endif
+
+   case CAPTURE_PPM:
+      to_rgb(c, frame->pixels, scratch);
+      size = (size_t) c->width * c->height * 3;
+      f = fopen(name, "wb");
+      if (!f) {
+         fprintf(stderr, "capture: couldn't open %s\n", name);
+         return GL_FALSE;
+      }
+      fprintf(f, "P6\n%d %d\n255\n", c->width, c->height);
+      if (fwrite(scratch, 1, size, f) != size) {
+         fprintf(stderr, "capture: error writing %s\n", name);
+         fclose(f);
+         return GL_FALSE;
+      }
+      fclose(f);
+      return GL_TRUE;
+   }
+   return GL_FALSE;
+}
+
+
+static void *
+worker(void *arg)
+{
+   struct capture *c = (struct capture *) arg;
+   GLubyte *scratch = malloc((size_t) c->width * c->height * 3);
+   struct frame *frame;
+
+   while ((frame = get_frame(c, &c->full)) != &c->quit) {
+      if (scratch && write_frame(c, frame, scratch))
+         atomic_fetch_add(&c->written, 1);
+      put_frame(c, &c->free, frame);
+   }
+
+   free(scratch);
+   return NULL;
+}
+
+
+/** Check that path has no printf conversions but one for an int */
+static GLboolean
+valid_path(const char *path)
+{
+   const char *p = strchr(path, '%');
+
+   if (!p)
+      return GL_TRUE;
+   p += strspn(p + 1, "#0- +'123456789") + 1;
+   return strchr("diouxX", *p) && *p && !strchr(p, '%');
+}
+
+
+static unsigned
+num_workers(void)
+{
+   long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+   /* leave a CPU for rendering */
+   cpus--;
+   return cpus < 1 ? 1 : cpus > MAX_WORKERS ? MAX_WORKERS : (unsigned) cpus;
+}
+
+
+static void
+free_capture(struct capture *c)
+{
+   unsigned i;
+
+   if (c->frames) {
+      for (i = 0; i < c->num_frames; i++)
+         free(c->frames[i].pixels);
+      free(c->frames);
+   }
+   free(c->free.cells);
+   free(c->full.cells);
+   if (c->fd >= 0)
+      close(c->fd);
+   free(c->path);
+   free(c);
+}
+
+
+/**
+ * Start capturing frames of the given size to path, which names the file
+ * or files as described in capture.h.
+ * \return  NULL on error, after printing a message
+ */
+struct capture *
+capture_open(const char *path, int width, int height)
+{
+   const char *ext = strrchr(path, '.');
+   struct capture *c;
+   unsigned i;
+
+   if (!valid_path(path)) {
+      fprintf(stderr, "capture: %s should contain at most one %%d\n", path);
+      return NULL;
+   }
+
+   c = calloc(1, sizeof(*c));
+   if (!c) {
+      fprintf(stderr, "capture: out of memory\n");
+      return NULL;
+   }
+   c->fd = -1;
+   c->path = strdup(path);
+   c->width = width;
+   c->height = height;
+   c->size = (size_t) width * height * 4;
+
+   if (ext && strcmp(ext, ".png") == 0) {
+#ifndef HAVE_PNG
+      fprintf(stderr, "capture: built without PNG support\n");
+      free_capture(c);
+      return NULL;
+#endif
+      c->format = CAPTURE_PNG;
+   }
+   else if (ext && strcmp(ext, ".yuv") == 0) {
+      c->format = CAPTURE_YUV;
+      c->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      if (c->fd < 0) {
+         fprintf(stderr, "capture: couldn't open %s\n", path);
+         free_capture(c);
+         return NULL;
+      }
+   }
+   else {
+      c->format = CAPTURE_PPM;
+   }
+
+   /* a single file for every frame has to be written by one worker, or
+    * several would write it at once
+    */
+   if (c->format != CAPTURE_YUV && !strchr(path, '%'))
+      c->num_workers = 1;
+   else
+      c->num_workers = num_workers();
+   c->num_frames = 2 * c->num_workers;
+   c->frames = calloc(c->num_frames, sizeof(*c->frames));
+   if (!c->frames || !c->path ||
+       !queue_init(&c->free, c->num_frames) ||
+       !queue_init(&c->full, c->num_frames + c->num_workers)) {
+      fprintf(stderr, "capture: out of memory\n");
+      free_capture(c);
+      return NULL;
+   }
+   for (i = 0; i < c->num_frames; i++) {
+      c->frames[i].pixels = malloc(c->size);
+      if (!c->frames[i].pixels) {
+         fprintf(stderr, "capture: out of memory\n");
+         free_capture(c);
+         return NULL;
+      }
+      queue_push(&c->free, &c->frames[i]);
+   }
+
+   pthread_mutex_init(&c->lock, NULL);
+   pthread_cond_init(&c->wake, NULL);
+   for (i = 0; i < c->num_workers; i++) {
+      if (pthread_create(&c->workers[i], NULL, worker, c) != 0)
+         break;
+   }
+   c->num_workers = i;
+   if (!c->num_workers) {
+      fprintf(stderr, "capture: couldn't start worker threads\n");
+      pthread_cond_destroy(&c->wake);
+      pthread_mutex_destroy(&c->lock);
+      free_capture(c);
+      return NULL;
+   }
+
+   gladLoaderLoadGL();
+   c->use_pbo = (GLAD_GL_VERSION_2_1 || GLAD_GL_ARB_pixel_buffer_object) &&
+                (GLAD_GL_VERSION_3_2 || GLAD_GL_ARB_sync);
+   if (c->use_pbo) {
+      GLint binding;
+
+      glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &binding);
+      glGenBuffers(NUM_PBO, c->pbo);
+      for (i = 0; i < NUM_PBO; i++) {
+         glBindBuffer(GL_PIXEL_PACK_BUFFER, c->pbo[i]);
+         glBufferData(GL_PIXEL_PACK_BUFFER, c->size, NULL, GL_STREAM_READ);
+      }
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, binding);
+   }
+
+   return c;
+}
+
+
+/** Hand the oldest frame being read back to the workers */
+static void
+retire_pbo(struct capture *c)
+{
+   const unsigned slot = c->pbo_next;
+   struct frame *frame;
+   const void *pixels;
+
+   frame = get_frame(c, &c->free);
+   while (glClientWaitSync(c->fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT,
+                           1000000000) == GL_TIMEOUT_EXPIRED)
+      ;
+   glDeleteSync(c->fence[slot]);
+   c->fence[slot] = NULL;
+
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, c->pbo[slot]);
+   pixels = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+   if (pixels) {
+      memcpy(frame->pixels, pixels, c->size);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+   }
+   else {
+      fprintf(stderr, "capture: couldn't map frame %d\n",
+              c->pbo_number[slot]);
+      memset(frame->pixels, 0, c->size);
+   }
+   frame->number = c->pbo_number[slot];
+   put_frame(c, &c->full, frame);
+
+   c->pbo_next = (slot + 1) % NUM_PBO;
+   c->pbo_count--;
+}
+
+
+/**
+ * Capture the lower left width x height pixels of the current read
+ * buffer.  Call after drawing a frame, before swapping buffers.
+ */
+void
+capture_frame(struct capture *c)
+{
+   GLint binding = 0, alignment, row_length, skip_rows, skip_pixels;
+
+   if (c->use_pbo)
+      glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &binding);
+   glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+   glGetIntegerv(GL_PACK_ROW_LENGTH, &row_length);
+   glGetIntegerv(GL_PACK_SKIP_ROWS, &skip_rows);
+   glGetIntegerv(GL_PACK_SKIP_PIXELS, &skip_pixels);
+   glPixelStorei(GL_PACK_ALIGNMENT, 4);
+   glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+   glPixelStorei(GL_PACK_SKIP_ROWS, 0);
+   glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
+
+   if (c->use_pbo) {
+      unsigned slot;
+
+      if (c->pbo_count == NUM_PBO)
+         retire_pbo(c);
+      slot = (c->pbo_next + c->pbo_count++) % NUM_PBO;
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, c->pbo[slot]);
+      glReadPixels(0, 0, c->width, c->height,
+                   GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+      c->fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      c->pbo_number[slot] = c->number++;
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, binding);
+   }
+   else {
+      struct frame *frame = get_frame(c, &c->free);
+
+      glReadPixels(0, 0, c->width, c->height,
+                   GL_BGRA, GL_UNSIGNED_BYTE, frame->pixels);
+      frame->number = c->number++;
+      put_frame(c, &c->full, frame);
+   }
+
+   glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+   glPixelStorei(GL_PACK_ROW_LENGTH, row_length);
+   glPixelStorei(GL_PACK_SKIP_ROWS, skip_rows);
+   glPixelStorei(GL_PACK_SKIP_PIXELS, skip_pixels);
+}
+
+
+/**
+ * Write out the frames still being captured, and free everything.
+ * \return  the number of frames written successfully
+ */
+int
+capture_close(struct capture *c)
+{
+   unsigned i;
+   int written;
+
+   if (c->use_pbo) {
+      GLint binding;
+
+      glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &binding);
+      while (c->pbo_count)
+         retire_pbo(c);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, binding);
+      glDeleteBuffers(NUM_PBO, c->pbo);
+   }
+
+   for (i = 0; i < c->num_workers; i++)
+      put_frame(c, &c->full, &c->quit);
+   for (i = 0; i < c->num_workers; i++)
+      pthread_join(c->workers[i], NULL);
+
+   written = atomic_load(&c->written);
+   pthread_cond_destroy(&c->wake);
+   pthread_mutex_destroy(&c->lock);
+   free_capture(c);
+   return written;
+}
@@ -0,0 +1,40 @@
+/*
+ * Frame capture.
+ *
+ * Reads back rendered frames and writes them to disk on worker threads,
+ * so that a program can dump a long sequence of frames without its frame
+ * rate collapsing.  Where the GL has pixel buffer objects and fences,
+ * each frame is read into a PBO and only mapped a few frames later, so
+ * the render thread doesn't wait for the readback either.  The workers
+ * flip the image right way up, convert it and write it.
+ *
+ * The file format comes from the extension of the path:
+ *   .png   one PNG per frame (needs libpng)
+ *   .yuv   all frames in one file, raw I420 (BT.601, limited range), as
+ *          read by ffmpeg -f rawvideo -pix_fmt yuv420p -s WxH
+ *   other  one binary PPM per frame
+ * For one file per frame, the path should contain a printf conversion
+ * for the frame number, e.g. "frame%04d.png".  Without one each frame
+ * replaces the last, which is only useful for a single frame.
+ *
+ * The context the frames are read from must be current in the calling
+ * thread for capture_open(), capture_frame() and capture_close().
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+
+struct capture;
+
+
+struct capture *
+capture_open(const char *path, int width, int height);
+
+void
+capture_frame(struct capture *c);
+
+int
+capture_close(struct capture *c);
+
+#endif /* CAPTURE_H */
@@ -0,0 +1,519 @@
+/*
+ * Per-frame timing for the gears demos.  See frametime.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "frametime.h"
+
+
+#define NUM_QUERIES 8
+#define HIST_BUCKETS 64         /* 1 ms each, plus one for the rest */
+
+/* GL, without pulling in any GL headers */
+#define GL_EXTENSIONS                  0x1F03
+#define GL_VERSION                     0x1F02
+#define GL_TIME_ELAPSED                0x88BF
+#define GL_QUERY_RESULT                0x8866
+#define GL_QUERY_RESULT_AVAILABLE      0x8867
+#define GL_GPU_DISJOINT                0x8FBB
+
+typedef const unsigned char *(*get_string_func)(unsigned name);
+typedef void (*get_integerv_func)(unsigned pname, int *data);
+typedef void (*gen_queries_func)(int n, unsigned *ids);
+typedef void (*begin_query_func)(unsigned target, unsigned id);
+typedef void (*end_query_func)(unsigned target);
+typedef void (*get_query_objectuiv_func)(unsigned id, unsigned pname,
+                                         unsigned *params);
+typedef void (*get_query_objectui64v_func)(unsigned id, unsigned pname,
+                                           uint64_t *params);
+
+
+struct frame {
+   uint64_t start, swap, end;
+   int64_t gpu;                 /* ns, or -1 if unknown */
+};
+
+struct frametime {
+   char *name;
+   char *trace;
+   uint64_t t0;
+   uint64_t count;              /* frames begun */
+   uint64_t reported;           /* frames covered by frametime_report() */
+   struct frame frames[FRAMETIME_RING];
+
+   struct {
+      int enabled, disjoint;
+      get_integerv_func GetIntegerv;
+      begin_query_func BeginQuery;
+      end_query_func EndQuery;
+      get_query_objectuiv_func GetQueryObjectuiv;
+      get_query_objectui64v_func GetQueryObjectui64v;
+      unsigned ids[NUM_QUERIES];
+      uint64_t frame[NUM_QUERIES];
+      unsigned next, pending;
+      int active;
+   } gl;
+};
+
+static struct frametime *Active;
+
+
+static struct frame *
+get_frame(struct frametime *ft, uint64_t frame)
+{
+   if (frame >= ft->count || ft->count - frame > FRAMETIME_RING)
+      return NULL;
+   return &ft->frames[frame % FRAMETIME_RING];
+}
+
+
+/** Time the swap of the frame ended, 0 if not known yet */
+static uint64_t
+swap_end(struct frametime *ft, uint64_t frame)
+{
+   const struct frame *f = get_frame(ft, frame);
+   const struct frame *next = get_frame(ft, frame + 1);
+
+   if (f->end)
+      return f->end;
+   return next ? next->start : 0;
+}
+
+
+static void
+at_exit(void)
+{
+   frametime_destroy(Active);
+}
+
+
+struct frametime *
+frametime_create(const char *name)
+{
+   const char *stats = getenv("FRAMETIME");
+   const char *trace = getenv("FRAMETIME_TRACE");
+   struct frametime *ft;
+   static int registered;
+
+   if ((!stats || !*stats || !strcmp(stats, "0")) && (!trace || !*trace))
+      return NULL;
+
+   ft = calloc(1, sizeof(*ft));
+   if (!ft)
+      return NULL;
+   ft->name = strdup(name);
+   ft->trace = trace && *trace ? strdup(trace) : NULL;
+   ft->t0 = bench_time_ns();
+
+   frametime_destroy(Active);
+   Active = ft;
+   if (!registered) {
+      atexit(at_exit);
+      registered = 1;
+   }
+   return ft;
+}
+
+
+/** Start a new frame, ending the previous one */
+void
+frametime_begin(struct frametime *ft)
+{
+   struct frame *f;
+
+   if (!ft)
+      return;
+
+   f = &ft->frames[ft->count % FRAMETIME_RING];
+   f->start = bench_time_ns();
+   f->swap = f->end = 0;
+   f->gpu = -1;
+   ft->count++;
+}
+
+
+/** Called just before SwapBuffers/present */
+void
+frametime_swap(struct frametime *ft)
+{
+   if (ft && ft->count)
+      ft->frames[(ft->count - 1) % FRAMETIME_RING].swap = bench_time_ns();
+}
+
+
+/** Called when SwapBuffers/present returns */
+void
+frametime_end(struct frametime *ft)
+{
+   if (ft && ft->count)
+      ft->frames[(ft->count - 1) % FRAMETIME_RING].end = bench_time_ns();
+}
+
+
+/** Record the GPU time of a frame, as numbered by frametime_frame() */
+void
+frametime_gpu(struct frametime *ft, uint64_t frame, uint64_t ns)
+{
+   struct frame *f;
+
+   if (ft && (f = get_frame(ft, frame)))
+      f->gpu = ns;
+}
+
+
+/** Number of the current frame */
+uint64_t
+frametime_frame(const struct frametime *ft)
+{
+   return ft && ft->count ? ft->count - 1 : 0;
+}
+
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+   double x = *(const double *) a, y = *(const double *) b;
+   return (x > y) - (x < y);
+}
+
+
+static void
+print_row(const char *label, double *ms, unsigned count)
+{
+   static const double p[] = { 0.5, 0.9, 0.99 };
+   unsigned i;
+
+   if (!count)
+      return;
+
+   qsort(ms, count, sizeof(double), compare_doubles);
+   printf("  %-6s", label);
+   for (i = 0; i < 3; i++)
+      printf(" %8.3f", ms[(unsigned) (p[i] * (count - 1) + 0.5)]);
+   printf(" %8.3f\n", ms[count - 1]);
+}
+
+
+/**
+ * Print percentiles of the frames ended since the previous report, or
+ * of the last FRAMETIME_RING of them.
+ */
+void
+frametime_report(struct frametime *ft)
+{
+   uint64_t first, last, i;
+   unsigned n[4] = { 0 };
+   double *ms[4];
+   int j;
+
+   if (!ft || ft->count < 2)
+      return;
+
+   /* the current frame hasn't ended */
+   last = ft->count - 1;
+   first = ft->reported;
+   if (last - first > FRAMETIME_RING - 1)
+      first = last - (FRAMETIME_RING - 1);
+   if (first >= last)
+      return;
+
+   for (j = 0; j < 4; j++) {
+      ms[j] = malloc((last - first) * sizeof(double));
+      if (!ms[j])
+         goto out;
+   }
+
+   for (i = first; i < last; i++) {
+      const struct frame *f = get_frame(ft, i);
+      uint64_t end = swap_end(ft, i);
+
+      ms[0][n[0]++] = (get_frame(ft, i + 1)->start - f->start) / 1e6;
+      if (f->swap) {
+         ms[1][n[1]++] = (f->swap - f->start) / 1e6;
+         ms[2][n[2]++] = (end - f->swap) / 1e6;
+      }
+      if (f->gpu >= 0)
+         ms[3][n[3]++] = f->gpu / 1e6;
+   }
+
+   printf("%s: %u frames        p50      p90      p99      max (ms)\n",
+          ft->name, n[0]);
+   print_row("frame", ms[0], n[0]);
+   print_row("cpu", ms[1], n[1]);
+   print_row("swap", ms[2], n[2]);
+   print_row("gpu", ms[3], n[3]);
+   fflush(stdout);
+   ft->reported = last;
+
+out:
+   while (j--)
+      free(ms[j]);
+}
+
+
+static void
+print_histogram(struct frametime *ft)
+{
+   unsigned hist[HIST_BUCKETS + 1] = { 0 }, max = 0;
+   uint64_t first, i;
+   int lo = -1, hi = 0, b;
+
+   if (ft->count < 2)
+      return;
+
+   first = ft->count > FRAMETIME_RING ? ft->count - FRAMETIME_RING : 0;
+   for (i = first; i < ft->count - 1; i++) {
+      uint64_t ms = (get_frame(ft, i + 1)->start -
+                     get_frame(ft, i)->start) / 1000000;
+
+      hist[ms < HIST_BUCKETS ? ms : HIST_BUCKETS]++;
+   }
+
+   for (b = 0; b <= HIST_BUCKETS; b++) {
+      if (!hist[b])
+         continue;
+      if (lo < 0)
+         lo = b;
+      hi = b;
+      if (hist[b] > max)
+         max = hist[b];
+   }
+
+   printf("%s: frame time histogram (ms)\n", ft->name);
+   for (b = lo; b <= hi; b++) {
+      int bar = (hist[b] * 50 + max - 1) / max;
+
+      if (b < HIST_BUCKETS)
+         printf("  %3d-%-3d %7u ", b, b + 1, hist[b]);
+      else
+         printf("  %3d+    %7u ", b, hist[b]);
+      while (bar--)
+         putchar('#');
+      putchar('\n');
+   }
+}
+
+
+static void
+trace_event(FILE *f, const char *name, int tid, uint64_t ts, uint64_t dur,
+            uint64_t frame)
+{
+   fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+           "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+           name, tid, ts / 1e3, dur / 1e3, (unsigned long long) frame);
+}
+
+
+static void
+write_trace(struct frametime *ft)
+{
+   static const char *threads[] = { "frames", "CPU", "GPU" };
+   uint64_t first, i;
+   int t;
+   FILE *f;
+
+   f = fopen(ft->trace, "w");
+   if (!f) {
+      fprintf(stderr, "%s: couldn't write %s\n", ft->name, ft->trace);
+      return;
+   }
+
+   fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+   fprintf(f, "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+           "\"args\":{\"name\":\"%s\"}}", ft->name);
+   for (t = 0; t < 3; t++)
+      fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+              "\"tid\":%d,\"args\":{\"name\":\"%s\"}}", t + 1, threads[t]);
+
+   first = ft->count > FRAMETIME_RING ? ft->count - FRAMETIME_RING : 0;
+   for (i = first; i < ft->count; i++) {
+      const struct frame *fr = get_frame(ft, i);
+      uint64_t ts = fr->start - ft->t0;
+      uint64_t end = swap_end(ft, i);
+
+      if (i + 1 < ft->count)
+         trace_event(f, "frame", 1, ts,
+                     get_frame(ft, i + 1)->start - fr->start, i);
+      if (fr->swap) {
+         trace_event(f, "cpu", 2, ts, fr->swap - fr->start, i);
+         if (end)
+            trace_event(f, "swap", 2, fr->swap - ft->t0,
+                        end - fr->swap, i);
+      }
+      if (fr->gpu >= 0)
+         trace_event(f, "gpu", 3, ts, fr->gpu, i);
+   }
+   fprintf(f, "\n]}\n");
+   fclose(f);
+}
+
+
+/** Print the last report and the histogram, and write the trace */
+void
+frametime_destroy(struct frametime *ft)
+{
+   if (!ft)
+      return;
+
+   frametime_report(ft);
+   print_histogram(ft);
+   if (ft->trace)
+      write_trace(ft);
+
+   if (Active == ft)
+      Active = NULL;
+   free(ft->name);
+   free(ft->trace);
+   free(ft);
+}
+
+
+static int
+has_extension(const char *list, const char *name)
+{
+   size_t len = strlen(name);
+   const char *p = list;
+
+   while (p && (p = strstr(p, name))) {
+      if ((p == list || p[-1] == ' ') && (p[len] == ' ' || !p[len]))
+         return 1;
+      p += len;
+   }
+   return 0;
+}
+
+
+static frametime_proc
+get_either(frametime_get_proc get_proc, const char *name, int ext)
+{
+   char buf[64];
+
+   if (!ext)
+      return get_proc(name);
+   snprintf(buf, sizeof(buf), "%sEXT", name);
+   return get_proc(buf);
+}
+
+
+/**
+ * Set up GL_TIME_ELAPSED queries for frametime_gl_begin/end(), in the
+ * current context.  Returns 0 if the GL doesn't have timer queries.
+ */
+int
+frametime_gl_init(struct frametime *ft, frametime_get_proc get_proc)
+{
+   get_string_func GetString;
+   gen_queries_func GenQueries;
+   const char *version, *extensions;
+   int major = 0, minor = 0, es, ext = 0;
+
+   if (!ft)
+      return 0;
+
+   GetString = (get_string_func) get_proc("glGetString");
+   ft->gl.GetIntegerv = (get_integerv_func) get_proc("glGetIntegerv");
+   if (!GetString || !ft->gl.GetIntegerv)
+      return 0;
+
+   version = (const char *) GetString(GL_VERSION);
+   if (!version)
+      return 0;
+   es = !strncmp(version, "OpenGL ES", 9);
+   sscanf(es ? version + 10 : version, "%d.%d", &major, &minor);
+   if (es) {
+      extensions = (const char *) GetString(GL_EXTENSIONS);
+      if (!has_extension(extensions, "GL_EXT_disjoint_timer_query"))
+         return 0;
+      /* GLES only has the EXT entry points */
+      ft->gl.disjoint = 1;
+      ext = 1;
+   }
+   else if (major * 10 + minor < 33) {
+      extensions = (const char *) GetString(GL_EXTENSIONS);
+      if (!has_extension(extensions, "GL_ARB_timer_query") &&
+          !has_extension(extensions, "GL_EXT_timer_query"))
+         return 0;
+   }
+
+   GenQueries = (gen_queries_func) get_either(get_proc, "glGenQueries", ext);
+   ft->gl.BeginQuery = (begin_query_func)
+      get_either(get_proc, "glBeginQuery", ext);
+   ft->gl.EndQuery = (end_query_func) get_either(get_proc, "glEndQuery", ext);
+   ft->gl.GetQueryObjectuiv = (get_query_objectuiv_func)
+      get_either(get_proc, "glGetQueryObjectuiv", ext);
+   ft->gl.GetQueryObjectui64v = (get_query_objectui64v_func)
+      get_either(get_proc, "glGetQueryObjectui64v", ext);
+   if (!ft->gl.GetQueryObjectui64v)
+      ft->gl.GetQueryObjectui64v = (get_query_objectui64v_func)
+         get_proc("glGetQueryObjectui64vEXT");
+   if (!GenQueries || !ft->gl.BeginQuery || !ft->gl.EndQuery ||
+       !ft->gl.GetQueryObjectuiv || !ft->gl.GetQueryObjectui64v)
+      return 0;
+
+   GenQueries(NUM_QUERIES, ft->gl.ids);
+   ft->gl.enabled = 1;
+   return 1;
+}
+
+
+/** Collect the results of finished queries, oldest first */
+static void
+collect_queries(struct frametime *ft)
+{
+   while (ft->gl.pending) {
+      unsigned q = (ft->gl.next + NUM_QUERIES - ft->gl.pending) % NUM_QUERIES;
+      unsigned available = 0;
+      const struct frame *f;
+      uint64_t ns;
+      int disjoint = 0;
+
+      ft->gl.GetQueryObjectuiv(ft->gl.ids[q], GL_QUERY_RESULT_AVAILABLE,
+                               &available);
+      if (!available)
+         break;
+      ft->gl.GetQueryObjectui64v(ft->gl.ids[q], GL_QUERY_RESULT, &ns);
+      if (ft->gl.disjoint)
+         ft->gl.GetIntegerv(GL_GPU_DISJOINT, &disjoint);
+      /* the GPU can't have spent longer on a frame than has passed
+         since it began; llvmpipe 22.3, for one, returns what looks like
+         a timestamp for the very first query */
+      f = get_frame(ft, ft->gl.frame[q]);
+      if (!disjoint && f && ns > 0 && ns <= bench_time_ns() - f->start)
+         frametime_gpu(ft, ft->gl.frame[q], ns);
+      ft->gl.pending--;
+   }
+}
+
+
+/** Start timing the GPU work of the current frame */
+void
+frametime_gl_begin(struct frametime *ft)
+{
+   if (!ft || !ft->gl.enabled)
+      return;
+
+   collect_queries(ft);
+   /* rather than wait for a result, skip timing this frame */
+   if (ft->gl.pending == NUM_QUERIES)
+      return;
+
+   ft->gl.frame[ft->gl.next] = frametime_frame(ft);
+   ft->gl.BeginQuery(GL_TIME_ELAPSED, ft->gl.ids[ft->gl.next]);
+   ft->gl.active = 1;
+}
+
+
+void
+frametime_gl_end(struct frametime *ft)
+{
+   if (!ft || !ft->gl.active)
+      return;
+
+   ft->gl.EndQuery(GL_TIME_ELAPSED);
+   ft->gl.next = (ft->gl.next + 1) % NUM_QUERIES;
+   ft->gl.pending++;
+   ft->gl.active = 0;
+}
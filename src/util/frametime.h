@@ -0,0 +1,76 @@
+/*
+ * Per-frame timing for the gears demos.
+ *
+ * Records, for each of the last FRAMETIME_RING frames, when the frame
+ * started, when the program handed it to swap/present, when that
+ * returned, and how long the GPU spent on it.  The CPU time of a frame
+ * is start to swap, the swap time is swap to the end of the frame (the
+ * start of the next one, if frametime_end() isn't called) and the frame
+ * time is start to start.
+ *
+ * Nothing is recorded unless one of these is set in the environment:
+ *   FRAMETIME=1            print percentiles with each frame rate line
+ *                          and a frame time histogram at exit
+ *   FRAMETIME_TRACE=FILE   also write the frames to FILE as Chrome trace
+ *                          JSON (chrome://tracing, ui.perfetto.dev)
+ * Otherwise frametime_create() returns NULL, and every other function
+ * does nothing when given NULL, so callers needn't check.
+ *
+ * GPU time comes from the caller through frametime_gpu(), for whatever
+ * frame it has a result for.  The frametime_gl_*() helpers do this with
+ * GL_TIME_ELAPSED queries, where the GL has them (GL 3.3,
+ * GL_ARB_timer_query, GL_EXT_timer_query or GL_EXT_disjoint_timer_query),
+ * reading each result back a few frames later so they never stall.  The
+ * GPU track of the trace shows how long the GPU took, placed at the
+ * start of the frame, not when the GPU actually ran.
+ */
+
+#ifndef FRAMETIME_H
+#define FRAMETIME_H
+
+#include <stdint.h>
+
+
+#define FRAMETIME_RING 16384
+
+struct frametime;
+
+typedef void (*frametime_proc)(void);
+typedef frametime_proc (*frametime_get_proc)(const char *name);
+
+
+struct frametime *
+frametime_create(const char *name);
+
+void
+frametime_begin(struct frametime *ft);
+
+void
+frametime_swap(struct frametime *ft);
+
+void
+frametime_end(struct frametime *ft);
+
+void
+frametime_gpu(struct frametime *ft, uint64_t frame, uint64_t ns);
+
+uint64_t
+frametime_frame(const struct frametime *ft);
+
+void
+frametime_report(struct frametime *ft);
+
+void
+frametime_destroy(struct frametime *ft);
+
+
+int
+frametime_gl_init(struct frametime *ft, frametime_get_proc get_proc);
+
+void
+frametime_gl_begin(struct frametime *ft);
+
+void
+frametime_gl_end(struct frametime *ft);
+
+#endif /* FRAMETIME_H */
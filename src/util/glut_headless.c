@@ -0,0 +1,1771 @@
+/*
+ * Headless GLUT on EGL.  See glut_headless.h.
+ */
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#ifdef HAVE_GBM
+#include <fcntl.h>
+#include <unistd.h>
+#include <gbm.h>
+#endif
+#include "glut_headless.h"
+#include <GL/glext.h>
+#include "capture.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define MAX_WINDOWS 8
+
+
+struct timer {
+   long due;                    /* ms since glutInit() */
+   void (*func)(int value);
+   int value;
+   struct timer *next;
+};
+
+struct window {
+   int id;                      /* 0 if the slot is free */
+   EGLContext context;
+   EGLSurface surface;          /* EGL_NO_SURFACE when drawing to fbo */
+   GLuint fbo, color_rb, depth_rb;
+   int width, height;
+   GLboolean reshape_pending, visibility_pending, redisplay_pending;
+
+   void (*display)(void);
+   void (*reshape)(int width, int height);
+   void (*keyboard)(unsigned char key, int x, int y);
+   void (*special)(int key, int x, int y);
+   void (*visibility)(int state);
+};
+
+static struct {
+   EGLDisplay dpy;
+   EGLConfig config;            /* NULL: no pbuffers, draw to an fbo */
+   long start;                  /* ms */
+   int init_width, init_height;
+   unsigned mode;
+   int major, minor, flags, profile;
+   struct window windows[MAX_WINDOWS];
+   struct window *current;
+   void (*idle)(void);
+   struct timer *timers;
+   struct capture *capture;     /* GLUT_HEADLESS_CAPTURE */
+   struct window *capture_window;
+} Glut = { EGL_NO_DISPLAY, NULL, 0, 300, 300, GLUT_RGB | GLUT_SINGLE,
+           0, 0, 0, 0 };
+
+static struct {
+   PFNGLGENFRAMEBUFFERSPROC GenFramebuffers;
+   PFNGLDELETEFRAMEBUFFERSPROC DeleteFramebuffers;
+   PFNGLBINDFRAMEBUFFERPROC BindFramebuffer;
+   PFNGLGENRENDERBUFFERSPROC GenRenderbuffers;
+   PFNGLDELETERENDERBUFFERSPROC DeleteRenderbuffers;
+   PFNGLBINDRENDERBUFFERPROC BindRenderbuffer;
+   PFNGLRENDERBUFFERSTORAGEPROC RenderbufferStorage;
+   PFNGLFRAMEBUFFERRENDERBUFFERPROC FramebufferRenderbuffer;
+   PFNGLCHECKFRAMEBUFFERSTATUSPROC CheckFramebufferStatus;
+   PFNGLGETSTRINGIPROC GetStringi;
+} GL;
+
+
+static void
+fatal(const char *format, ...)
+{
+   va_list args;
+
+   va_start(args, format);
+   fprintf(stderr, "glut: ");
+   vfprintf(stderr, format, args);
+   va_end(args);
+   putc('\n', stderr);
+
+   exit(1);
+}
+
+
+static long
+now_ms(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+
+static GLboolean
+has_extension(const char *list, const char *name)
+{
+   size_t len = strlen(name);
+   const char *p = list;
+
+   if (!list || !len)
+      return GL_FALSE;
+
+   while ((p = strstr(p, name)) != NULL) {
+      if ((p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0'))
+         return GL_TRUE;
+      p += len;
+   }
+   return GL_FALSE;
+}
+
+
+static EGLDisplay
+open_display(void)
+{
+   const char *platform = getenv("GLUT_HEADLESS_PLATFORM");
+   const char *client_exts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+   PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+   EGLDisplay dpy;
+
+   get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+      eglGetProcAddress("eglGetPlatformDisplayEXT");
+   if (!get_platform_display)
+      fatal("EGL_EXT_platform_base is not supported");
+
+   if (!platform || strcmp(platform, "surfaceless") == 0) {
+      if (has_extension(client_exts, "EGL_MESA_platform_surfaceless")) {
+         dpy = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                    EGL_DEFAULT_DISPLAY, NULL);
+         if (dpy != EGL_NO_DISPLAY && eglInitialize(dpy, NULL, NULL))
+            return dpy;
+      }
+      if (platform)
+         fatal("failed to open a surfaceless EGL display");
+   }
+
+#ifdef HAVE_GBM
+   if (!platform || strcmp(platform, "gbm") == 0) {
+      const char *device = getenv("GLUT_HEADLESS_DEVICE");
+      struct gbm_device *gbm;
+      int fd;
+
+      if (!device)
+         device = "/dev/dri/renderD128";
+      fd = open(device, O_RDWR | O_CLOEXEC);
+      if (fd < 0)
+         fatal("failed to open %s", device);
+      gbm = gbm_create_device(fd);
+      if (!gbm)
+         fatal("failed to create a GBM device on %s", device);
+
+      dpy = get_platform_display(EGL_PLATFORM_GBM_MESA, gbm, NULL);
+      if (dpy != EGL_NO_DISPLAY && eglInitialize(dpy, NULL, NULL))
+         return dpy;
+      fatal("failed to open a GBM EGL display on %s", device);
+   }
+#endif
+
+   if (platform)
+      fatal("unknown GLUT_HEADLESS_PLATFORM \"%s\"", platform);
+   fatal("no headless EGL platform available");
+   return EGL_NO_DISPLAY;
+}
+
+
+/**
+ * Choose a pbuffer config for the display mode, or return NULL if there
+ * is none and windows have to be framebuffer objects.
+ */
+static EGLConfig
+choose_config(void)
+{
+   EGLConfig configs[256];
+   EGLint attribs[32], n, i, k, best, best_score;
+   unsigned mode = Glut.mode;
+
+   for (;;) {
+      i = 0;
+      attribs[i++] = EGL_RED_SIZE;
+      attribs[i++] = 1;
+      attribs[i++] = EGL_GREEN_SIZE;
+      attribs[i++] = 1;
+      attribs[i++] = EGL_BLUE_SIZE;
+      attribs[i++] = 1;
+      attribs[i++] = EGL_ALPHA_SIZE;
+      attribs[i++] = (mode & GLUT_ALPHA) ? 1 : 0;
+      attribs[i++] = EGL_DEPTH_SIZE;
+      attribs[i++] = (mode & GLUT_DEPTH) ? 1 : 0;
+      attribs[i++] = EGL_STENCIL_SIZE;
+      attribs[i++] = (mode & GLUT_STENCIL) ? 1 : 0;
+      attribs[i++] = EGL_SAMPLE_BUFFERS;
+      attribs[i++] = (mode & GLUT_MULTISAMPLE) ? 1 : 0;
+      attribs[i++] = EGL_SURFACE_TYPE;
+      attribs[i++] = EGL_PBUFFER_BIT;
+      attribs[i++] = EGL_RENDERABLE_TYPE;
+      attribs[i++] = EGL_OPENGL_BIT;
+      attribs[i] = EGL_NONE;
+
+      if (eglChooseConfig(Glut.dpy, attribs, configs, 256, &n) && n > 0)
+         break;
+
+      /* like GLUT, settle for a single sample */
+      if (!(mode & GLUT_MULTISAMPLE))
+         return NULL;
+      mode &= ~GLUT_MULTISAMPLE;
+   }
+
+   /* EGL sorts deeper color and shallower depth formats first, but the
+    * programs expect the 8-bit RGB(A), 24-bit depth visual a window system
+    * would have given them.
+    */
+   best = 0;
+   best_score = -1;
+   for (k = 0; k < n; k++) {
+      EGLint r, g, b, depth, score = 0;
+
+      eglGetConfigAttrib(Glut.dpy, configs[k], EGL_RED_SIZE, &r);
+      eglGetConfigAttrib(Glut.dpy, configs[k], EGL_GREEN_SIZE, &g);
+      eglGetConfigAttrib(Glut.dpy, configs[k], EGL_BLUE_SIZE, &b);
+      eglGetConfigAttrib(Glut.dpy, configs[k], EGL_DEPTH_SIZE, &depth);
+      if (r == 8 && g == 8 && b == 8)
+         score += 2;
+      if (!(mode & GLUT_DEPTH) || depth >= 24)
+         score += 1;
+      if (score > best_score) {
+         best = k;
+         best_score = score;
+      }
+   }
+   return configs[best];
+}
+
+
+static void
+load_fbo_functions(void)
+{
+   GL.GenFramebuffers = (PFNGLGENFRAMEBUFFERSPROC)
+      eglGetProcAddress("glGenFramebuffers");
+   GL.DeleteFramebuffers = (PFNGLDELETEFRAMEBUFFERSPROC)
+      eglGetProcAddress("glDeleteFramebuffers");
+   GL.BindFramebuffer = (PFNGLBINDFRAMEBUFFERPROC)
+      eglGetProcAddress("glBindFramebuffer");
+   GL.GenRenderbuffers = (PFNGLGENRENDERBUFFERSPROC)
+      eglGetProcAddress("glGenRenderbuffers");
+   GL.DeleteRenderbuffers = (PFNGLDELETERENDERBUFFERSPROC)
+      eglGetProcAddress("glDeleteRenderbuffers");
+   GL.BindRenderbuffer = (PFNGLBINDRENDERBUFFERPROC)
+      eglGetProcAddress("glBindRenderbuffer");
+   GL.RenderbufferStorage = (PFNGLRENDERBUFFERSTORAGEPROC)
+      eglGetProcAddress("glRenderbufferStorage");
+   GL.FramebufferRenderbuffer = (PFNGLFRAMEBUFFERRENDERBUFFERPROC)
+      eglGetProcAddress("glFramebufferRenderbuffer");
+   GL.CheckFramebufferStatus = (PFNGLCHECKFRAMEBUFFERSTATUSPROC)
+      eglGetProcAddress("glCheckFramebufferStatus");
+
+   if (!GL.GenFramebuffers || !GL.BindFramebuffer ||
+       !GL.GenRenderbuffers || !GL.RenderbufferStorage)
+      fatal("framebuffer objects are not supported");
+}
+
+
+static void
+make_current(struct window *win)
+{
+   if (Glut.current == win)
+      return;
+
+   Glut.current = win;
+   if (win) {
+      if (!eglMakeCurrent(Glut.dpy, win->surface, win->surface,
+                          win->context))
+         fatal("eglMakeCurrent failed (0x%x)", eglGetError());
+   }
+   else {
+      eglMakeCurrent(Glut.dpy, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                     EGL_NO_CONTEXT);
+   }
+}
+
+
+/** Write out the frames still being captured */
+static void
+close_capture(void)
+{
+   struct window *current = Glut.current;
+
+   if (!Glut.capture)
+      return;
+
+   make_current(Glut.capture_window);
+   capture_close(Glut.capture);
+   Glut.capture = NULL;
+   make_current(current);
+}
+
+
+/**
+ * Create or resize the window's color and depth/stencil buffers.  The
+ * window's context must be current.
+ */
+static void
+allocate_buffers(struct window *win)
+{
+   if (Glut.config) {
+      EGLint attribs[] = {
+         EGL_WIDTH, win->width,
+         EGL_HEIGHT, win->height,
+         EGL_NONE
+      };
+      EGLSurface old = win->surface;
+
+      win->surface = eglCreatePbufferSurface(Glut.dpy, Glut.config, attribs);
+      if (win->surface == EGL_NO_SURFACE)
+         fatal("failed to create a %dx%d pbuffer (0x%x)",
+               win->width, win->height, eglGetError());
+      if (!eglMakeCurrent(Glut.dpy, win->surface, win->surface,
+                          win->context))
+         fatal("eglMakeCurrent failed (0x%x)", eglGetError());
+      if (old != EGL_NO_SURFACE)
+         eglDestroySurface(Glut.dpy, old);
+   }
+   else {
+      GLenum depth_format = 0, depth_attachment = 0;
+
+      if (Glut.mode & GLUT_STENCIL) {
+         depth_format = GL_DEPTH24_STENCIL8;
+         depth_attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+      }
+      else if (Glut.mode & GLUT_DEPTH) {
+         depth_format = GL_DEPTH_COMPONENT24;
+         depth_attachment = GL_DEPTH_ATTACHMENT;
+      }
+
+      if (!win->fbo) {
+         GL.GenFramebuffers(1, &win->fbo);
+         GL.GenRenderbuffers(1, &win->color_rb);
+         if (depth_format)
+            GL.GenRenderbuffers(1, &win->depth_rb);
+      }
+
+      GL.BindRenderbuffer(GL_RENDERBUFFER, win->color_rb);
+      GL.RenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8,
+                             win->width, win->height);
+      if (depth_format) {
+         GL.BindRenderbuffer(GL_RENDERBUFFER, win->depth_rb);
+         GL.RenderbufferStorage(GL_RENDERBUFFER, depth_format,
+                                win->width, win->height);
+      }
+      GL.BindRenderbuffer(GL_RENDERBUFFER, 0);
+
+      GL.BindFramebuffer(GL_FRAMEBUFFER, win->fbo);
+      GL.FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                 GL_RENDERBUFFER, win->color_rb);
+      if (depth_format)
+         GL.FramebufferRenderbuffer(GL_FRAMEBUFFER, depth_attachment,
+                                    GL_RENDERBUFFER, win->depth_rb);
+      if (GL.CheckFramebufferStatus(GL_FRAMEBUFFER) !=
+          GL_FRAMEBUFFER_COMPLETE)
+         fatal("incomplete %dx%d framebuffer", win->width, win->height);
+
+      glDrawBuffer(GL_COLOR_ATTACHMENT0);
+      glReadBuffer(GL_COLOR_ATTACHMENT0);
+   }
+
+   win->reshape_pending = GL_TRUE;
+   win->redisplay_pending = GL_TRUE;
+}
+
+
+static void
+add_mode(const char *name, unsigned bit, const char *string)
+{
+   const char *p = strstr(string, name);
+
+   if (p && (p == string || p[-1] == ' '))
+      Glut.mode |= bit;
+}
+
+
+void
+glutInit(int *argc, char **argv)
+{
+   int i, j;
+
+   /* remove the standard GLUT options, honouring -geometry */
+   for (i = j = 1; i < *argc; i++) {
+      if (strcmp(argv[i], "-geometry") == 0 && i + 1 < *argc) {
+         int w, h;
+         if (sscanf(argv[++i], "%dx%d", &w, &h) == 2 && w > 0 && h > 0) {
+            Glut.init_width = w;
+            Glut.init_height = h;
+         }
+      }
+      else if (strcmp(argv[i], "-display") == 0 && i + 1 < *argc) {
+         i++;
+      }
+      else if (strcmp(argv[i], "-direct") == 0 ||
+               strcmp(argv[i], "-indirect") == 0 ||
+               strcmp(argv[i], "-iconic") == 0 ||
+               strcmp(argv[i], "-gldebug") == 0 ||
+               strcmp(argv[i], "-sync") == 0) {
+         ;
+      }
+      else {
+         argv[j++] = argv[i];
+      }
+   }
+   if (j < *argc)
+      argv[j] = NULL;
+   *argc = j;
+
+   if (Glut.dpy == EGL_NO_DISPLAY) {
+      Glut.dpy = open_display();
+      Glut.start = now_ms();
+   }
+}
+
+
+void
+glutInitWindowPosition(int x, int y)
+{
+   (void) x;
+   (void) y;
+}
+
+
+void
+glutInitWindowSize(int width, int height)
+{
+   if (width > 0 && height > 0) {
+      Glut.init_width = width;
+      Glut.init_height = height;
+   }
+}
+
+
+void
+glutInitDisplayMode(unsigned int mode)
+{
+   Glut.mode = mode;
+}
+
+
+void
+glutInitDisplayString(const char *string)
+{
+   Glut.mode = GLUT_RGB;
+   add_mode("index", GLUT_INDEX, string);
+   add_mode("alpha", GLUT_ALPHA, string);
+   add_mode("rgba", GLUT_ALPHA, string);
+   add_mode("double", GLUT_DOUBLE, string);
+   add_mode("depth", GLUT_DEPTH, string);
+   add_mode("stencil", GLUT_STENCIL, string);
+   add_mode("acc", GLUT_ACCUM, string);
+   add_mode("samples", GLUT_MULTISAMPLE, string);
+}
+
+
+void
+glutInitContextVersion(int major, int minor)
+{
+   Glut.major = major;
+   Glut.minor = minor;
+}
+
+
+void
+glutInitContextFlags(int flags)
+{
+   Glut.flags = flags;
+}
+
+
+void
+glutInitContextProfile(int profile)
+{
+   Glut.profile = profile;
+}
+
+
+int
+glutCreateWindow(const char *title)
+{
+   static GLboolean configured = GL_FALSE;
+   struct window *win = NULL;
+   EGLint attribs[16];
+   int i;
+
+   (void) title;
+
+   if (Glut.dpy == EGL_NO_DISPLAY)
+      fatal("glutCreateWindow called before glutInit");
+   if (Glut.mode & GLUT_INDEX)
+      fatal("color index mode is not supported");
+
+   for (i = 0; i < MAX_WINDOWS; i++) {
+      if (!Glut.windows[i].id) {
+         win = &Glut.windows[i];
+         break;
+      }
+   }
+   if (!win)
+      fatal("too many windows");
+
+   if (!configured) {
+      Glut.config = choose_config();
+      if (!Glut.config) {
+         const char *exts = eglQueryString(Glut.dpy, EGL_EXTENSIONS);
+
+         if (!has_extension(exts, "EGL_KHR_no_config_context") ||
+             !has_extension(exts, "EGL_KHR_surfaceless_context"))
+            fatal("no pbuffer config and no surfaceless contexts");
+      }
+      configured = GL_TRUE;
+   }
+
+   i = 0;
+   if (Glut.major) {
+      attribs[i++] = EGL_CONTEXT_MAJOR_VERSION;
+      attribs[i++] = Glut.major;
+      attribs[i++] = EGL_CONTEXT_MINOR_VERSION;
+      attribs[i++] = Glut.minor;
+   }
+   if (Glut.profile) {
+      if (!Glut.major) {
+         attribs[i++] = EGL_CONTEXT_MAJOR_VERSION;
+         attribs[i++] = 3;
+         attribs[i++] = EGL_CONTEXT_MINOR_VERSION;
+         attribs[i++] = 2;
+      }
+      attribs[i++] = EGL_CONTEXT_OPENGL_PROFILE_MASK;
+      attribs[i++] = (Glut.profile & GLUT_CORE_PROFILE) ?
+         EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT :
+         EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT;
+   }
+   if (Glut.flags & GLUT_DEBUG) {
+      attribs[i++] = EGL_CONTEXT_OPENGL_DEBUG;
+      attribs[i++] = EGL_TRUE;
+   }
+   if (Glut.flags & GLUT_FORWARD_COMPATIBLE) {
+      attribs[i++] = EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE;
+      attribs[i++] = EGL_TRUE;
+   }
+   attribs[i] = EGL_NONE;
+
+   eglBindAPI(EGL_OPENGL_API);
+   win->context = eglCreateContext(Glut.dpy,
+                                   Glut.config ? Glut.config
+                                               : EGL_NO_CONFIG_KHR,
+                                   EGL_NO_CONTEXT, attribs);
+   if (win->context == EGL_NO_CONTEXT)
+      fatal("failed to create an OpenGL context (0x%x)", eglGetError());
+
+   win->id = (int) (win - Glut.windows) + 1;
+   win->surface = EGL_NO_SURFACE;
+   win->fbo = win->color_rb = win->depth_rb = 0;
+   win->width = Glut.init_width;
+   win->height = Glut.init_height;
+   win->visibility_pending = GL_TRUE;
+
+   Glut.current = NULL;
+   make_current(win);
+   if (!Glut.config && !GL.GenFramebuffers)
+      load_fbo_functions();
+   allocate_buffers(win);
+
+   return win->id;
+}
+
+
+static struct window *
+lookup_window(int id)
+{
+   if (id < 1 || id > MAX_WINDOWS || !Glut.windows[id - 1].id)
+      return NULL;
+   return &Glut.windows[id - 1];
+}
+
+
+void
+glutDestroyWindow(int id)
+{
+   struct window *win = lookup_window(id);
+
+   if (!win)
+      return;
+
+   if (Glut.capture_window == win)
+      close_capture();
+   if (Glut.current == win)
+      make_current(NULL);
+   if (win->surface != EGL_NO_SURFACE)
+      eglDestroySurface(Glut.dpy, win->surface);
+   eglDestroyContext(Glut.dpy, win->context);
+   memset(win, 0, sizeof(*win));
+}
+
+
+void
+glutSetWindow(int id)
+{
+   struct window *win = lookup_window(id);
+
+   if (win)
+      make_current(win);
+}
+
+
+int
+glutGetWindow(void)
+{
+   return Glut.current ? Glut.current->id : 0;
+}
+
+
+void
+glutSetWindowTitle(const char *title)
+{
+   (void) title;
+}
+
+
+void
+glutReshapeWindow(int width, int height)
+{
+   struct window *win = Glut.current;
+
+   if (!win || width <= 0 || height <= 0 ||
+       (width == win->width && height == win->height))
+      return;
+
+   win->width = width;
+   win->height = height;
+   allocate_buffers(win);
+}
+
+
+void
+glutPositionWindow(int x, int y)
+{
+   (void) x;
+   (void) y;
+}
+
+
+void
+glutFullScreen(void)
+{
+}
+
+
+void
+glutShowWindow(void)
+{
+}
+
+
+void
+glutHideWindow(void)
+{
+}
+
+
+void
+glutPostRedisplay(void)
+{
+   if (Glut.current)
+      Glut.current->redisplay_pending = GL_TRUE;
+}
+
+
+void
+glutSwapBuffers(void)
+{
+   struct window *win = Glut.current;
+
+   if (!win)
+      return;
+
+   /* capture the first window that swaps */
+   if (!Glut.capture_window && getenv("GLUT_HEADLESS_CAPTURE")) {
+      Glut.capture_window = win;
+      Glut.capture = capture_open(getenv("GLUT_HEADLESS_CAPTURE"),
+                                  win->width, win->height);
+      if (!Glut.capture)
+         exit(1);
+      atexit(close_capture);
+   }
+   if (Glut.capture && Glut.capture_window == win)
+      capture_frame(Glut.capture);
+
+   if (win->surface != EGL_NO_SURFACE)
+      eglSwapBuffers(Glut.dpy, win->surface);
+   else
+      glFlush();
+}
+
+
+void
+glutSetCursor(int cursor)
+{
+   (void) cursor;
+}
+
+
+void
+glutEstablishOverlay(void)
+{
+   fatal("overlays are not supported");
+}
+
+
+void
+glutRemoveOverlay(void)
+{
+}
+
+
+void
+glutUseLayer(GLenum layer)
+{
+   (void) layer;
+}
+
+
+void
+glutPostOverlayRedisplay(void)
+{
+}
+
+
+void
+glutShowOverlay(void)
+{
+}
+
+
+void
+glutHideOverlay(void)
+{
+}
+
+
+int
+glutCreateMenu(void (*callback)(int value))
+{
+   static int menus = 0;
+
+   (void) callback;
+   return ++menus;
+}
+
+
+void
+glutDestroyMenu(int menu)
+{
+   (void) menu;
+}
+
+
+void
+glutSetMenu(int menu)
+{
+   (void) menu;
+}
+
+
+void
+glutAddMenuEntry(const char *label, int value)
+{
+   (void) label;
+   (void) value;
+}
+
+
+void
+glutAddSubMenu(const char *label, int submenu)
+{
+   (void) label;
+   (void) submenu;
+}
+
+
+void
+glutAttachMenu(int button)
+{
+   (void) button;
+}
+
+
+void
+glutDetachMenu(int button)
+{
+   (void) button;
+}
+
+
+void
+glutDisplayFunc(void (*callback)(void))
+{
+   if (Glut.current)
+      Glut.current->display = callback;
+}
+
+
+void
+glutReshapeFunc(void (*callback)(int width, int height))
+{
+   if (Glut.current)
+      Glut.current->reshape = callback;
+}
+
+
+void
+glutKeyboardFunc(void (*callback)(unsigned char key, int x, int y))
+{
+   if (Glut.current)
+      Glut.current->keyboard = callback;
+}
+
+
+void
+glutKeyboardUpFunc(void (*callback)(unsigned char key, int x, int y))
+{
+   (void) callback;
+}
+
+
+void
+glutSpecialFunc(void (*callback)(int key, int x, int y))
+{
+   if (Glut.current)
+      Glut.current->special = callback;
+}
+
+
+void
+glutSpecialUpFunc(void (*callback)(int key, int x, int y))
+{
+   (void) callback;
+}
+
+
+void
+glutMouseFunc(void (*callback)(int button, int state, int x, int y))
+{
+   (void) callback;
+}
+
+
+void
+glutMotionFunc(void (*callback)(int x, int y))
+{
+   (void) callback;
+}
+
+
+void
+glutPassiveMotionFunc(void (*callback)(int x, int y))
+{
+   (void) callback;
+}
+
+
+void
+glutVisibilityFunc(void (*callback)(int state))
+{
+   if (Glut.current)
+      Glut.current->visibility = callback;
+}
+
+
+void
+glutEntryFunc(void (*callback)(int state))
+{
+   (void) callback;
+}
+
+
+void
+glutOverlayDisplayFunc(void (*callback)(void))
+{
+   (void) callback;
+}
+
+
+void
+glutIdleFunc(void (*callback)(void))
+{
+   Glut.idle = callback;
+}
+
+
+void
+glutTimerFunc(unsigned int msecs, void (*callback)(int value), int value)
+{
+   struct timer *timer = malloc(sizeof(*timer));
+   struct timer **p;
+
+   if (!timer)
+      fatal("out of memory");
+
+   timer->due = now_ms() - Glut.start + msecs;
+   timer->func = callback;
+   timer->value = value;
+
+   /* keep the list sorted, and timers due at the same time in order */
+   for (p = &Glut.timers; *p && (*p)->due <= timer->due; p = &(*p)->next)
+      ;
+   timer->next = *p;
+   *p = timer;
+}
+
+
+static void
+run_timers(void)
+{
+   long t = now_ms() - Glut.start;
+
+   while (Glut.timers && Glut.timers->due <= t) {
+      struct timer *timer = Glut.timers;
+
+      Glut.timers = timer->next;
+      timer->func(timer->value);
+      free(timer);
+   }
+}
+
+
+static GLboolean
+redisplay_pending(void)
+{
+   int i;
+
+   for (i = 0; i < MAX_WINDOWS; i++) {
+      const struct window *win = &Glut.windows[i];
+      if (win->id && win->display &&
+          (win->redisplay_pending || win->reshape_pending))
+         return GL_TRUE;
+   }
+   return GL_FALSE;
+}
+
+
+void
+glutMainLoop(void)
+{
+   const char *frames_env = getenv("GLUT_HEADLESS_FRAMES");
+   const char *keys = getenv("GLUT_HEADLESS_KEYS");
+   long max_frames = frames_env ? atol(frames_env) : 0;
+   long frames = 0;
+
+   for (;;) {
+      int i;
+
+      run_timers();
+
+      for (i = 0; i < MAX_WINDOWS; i++) {
+         struct window *win = &Glut.windows[i];
+
+         if (win->id && win->reshape_pending) {
+            win->reshape_pending = GL_FALSE;
+            make_current(win);
+            if (win->reshape)
+               win->reshape(win->width, win->height);
+            else
+               glViewport(0, 0, win->width, win->height);
+         }
+         if (win->id && win->visibility_pending) {
+            win->visibility_pending = GL_FALSE;
+            if (win->visibility) {
+               make_current(win);
+               win->visibility(GLUT_VISIBLE);
+            }
+         }
+         if (win->id && win->redisplay_pending && win->display) {
+            win->redisplay_pending = GL_FALSE;
+            make_current(win);
+            win->display();
+            if (++frames == max_frames)
+               exit(0);
+         }
+      }
+
+      /* one scripted key per frame, once something has been drawn */
+      if (keys && *keys && frames > 0) {
+         for (i = 0; i < MAX_WINDOWS; i++) {
+            struct window *win = &Glut.windows[i];
+            if (win->id && win->keyboard) {
+               make_current(win);
+               win->keyboard((unsigned char) *keys++, 0, 0);
+               break;
+            }
+         }
+         if (i < MAX_WINDOWS)
+            continue;
+         keys = NULL;
+      }
+
+      if (Glut.idle) {
+         Glut.idle();
+         continue;
+      }
+
+      if (redisplay_pending())
+         continue;
+
+      /* nothing left to do but wait for timers */
+      if (Glut.timers) {
+         long wait = Glut.timers->due - (now_ms() - Glut.start);
+         if (wait > 0) {
+            struct timespec ts;
+            ts.tv_sec = wait / 1000;
+            ts.tv_nsec = (wait % 1000) * 1000000L;
+            nanosleep(&ts, NULL);
+         }
+         continue;
+      }
+
+      /* there is no input, so nothing can happen any more */
+      exit(0);
+   }
+}
+
+
+static EGLint
+config_attrib(EGLint attrib)
+{
+   EGLint value = 0;
+
+   if (Glut.config) {
+      eglGetConfigAttrib(Glut.dpy, Glut.config, attrib, &value);
+      return value;
+   }
+
+   /* the framebuffer object formats */
+   switch (attrib) {
+   case EGL_RED_SIZE:
+   case EGL_GREEN_SIZE:
+   case EGL_BLUE_SIZE:
+   case EGL_ALPHA_SIZE:
+      return 8;
+   case EGL_BUFFER_SIZE:
+      return 32;
+   case EGL_DEPTH_SIZE:
+      return (Glut.mode & (GLUT_DEPTH | GLUT_STENCIL)) ? 24 : 0;
+   case EGL_STENCIL_SIZE:
+      return (Glut.mode & GLUT_STENCIL) ? 8 : 0;
+   default:
+      return 0;
+   }
+}
+
+
+int
+glutGet(GLenum query)
+{
+   const struct window *win = Glut.current;
+
+   switch (query) {
+   case GLUT_ELAPSED_TIME:
+      return (int) (now_ms() - Glut.start);
+   case GLUT_WINDOW_X:
+   case GLUT_WINDOW_Y:
+      return 0;
+   case GLUT_WINDOW_WIDTH:
+   case GLUT_SCREEN_WIDTH:
+      return win ? win->width : Glut.init_width;
+   case GLUT_WINDOW_HEIGHT:
+   case GLUT_SCREEN_HEIGHT:
+      return win ? win->height : Glut.init_height;
+   case GLUT_WINDOW_BUFFER_SIZE:
+      return config_attrib(EGL_BUFFER_SIZE);
+   case GLUT_WINDOW_RED_SIZE:
+      return config_attrib(EGL_RED_SIZE);
+   case GLUT_WINDOW_GREEN_SIZE:
+      return config_attrib(EGL_GREEN_SIZE);
+   case GLUT_WINDOW_BLUE_SIZE:
+      return config_attrib(EGL_BLUE_SIZE);
+   case GLUT_WINDOW_ALPHA_SIZE:
+      return config_attrib(EGL_ALPHA_SIZE);
+   case GLUT_WINDOW_DEPTH_SIZE:
+      return config_attrib(EGL_DEPTH_SIZE);
+   case GLUT_WINDOW_STENCIL_SIZE:
+      return config_attrib(EGL_STENCIL_SIZE);
+   case GLUT_WINDOW_NUM_SAMPLES:
+      return config_attrib(EGL_SAMPLES);
+   case GLUT_WINDOW_DOUBLEBUFFER:
+      return (Glut.mode & GLUT_DOUBLE) ? 1 : 0;
+   case GLUT_WINDOW_RGBA:
+      return 1;
+   case GLUT_WINDOW_COLORMAP_SIZE:
+      return 0;
+   case GLUT_INIT_WINDOW_WIDTH:
+      return Glut.init_width;
+   case GLUT_INIT_WINDOW_HEIGHT:
+      return Glut.init_height;
+   case GLUT_INIT_DISPLAY_MODE:
+      return (int) Glut.mode;
+   default:
+      return -1;
+   }
+}
+
+
+int
+glutLayerGet(GLenum query)
+{
+   (void) query;
+   return 0;
+}
+
+
+int
+glutGetModifiers(void)
+{
+   return 0;
+}
+
+
+int
+glutExtensionSupported(const char *extension)
+{
+   const char *exts = (const char *) glGetString(GL_EXTENSIONS);
+   GLint n, i;
+
+   if (exts)
+      return has_extension(exts, extension);
+
+   /* core profile */
+   if (!GL.GetStringi)
+      GL.GetStringi = (PFNGLGETSTRINGIPROC) eglGetProcAddress("glGetStringi");
+   if (!GL.GetStringi)
+      return 0;
+
+   glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+   for (i = 0; i < n; i++) {
+      const char *ext = (const char *) GL.GetStringi(GL_EXTENSIONS, i);
+      if (ext && strcmp(ext, extension) == 0)
+         return 1;
+   }
+   return 0;
+}
+
+
+GLUTproc
+glutGetProcAddress(const char *name)
+{
+   return (GLUTproc) eglGetProcAddress(name);
+}
+
+
+void
+glutSetColor(int color, GLfloat red, GLfloat green, GLfloat blue)
+{
+   (void) color;
+   (void) red;
+   (void) green;
+   (void) blue;
+}
+
+
+/*
+ * Text.  Nothing is drawn, but the raster position or modelview matrix
+ * advances by roughly the width of the real glyph so that layout code
+ * keeps working.
+ */
+
+int
+glutBitmapWidth(void *font, int character)
+{
+   (void) character;
+
+   if (font == GLUT_BITMAP_9_BY_15)
+      return 9;
+   else if (font == GLUT_BITMAP_8_BY_13)
+      return 8;
+   else if (font == GLUT_BITMAP_TIMES_ROMAN_24)
+      return 11;
+   else if (font == GLUT_BITMAP_HELVETICA_18)
+      return 10;
+   else if (font == GLUT_BITMAP_HELVETICA_12)
+      return 7;
+   else
+      return 6;
+}
+
+
+void
+glutBitmapCharacter(void *font, int character)
+{
+   glBitmap(0, 0, 0.0f, 0.0f,
+            (GLfloat) glutBitmapWidth(font, character), 0.0f, NULL);
+}
+
+
+int
+glutStrokeWidth(void *font, int character)
+{
+   (void) character;
+   return font == GLUT_STROKE_MONO_ROMAN ? 105 : 80;
+}
+
+
+void
+glutStrokeCharacter(void *font, int character)
+{
+   glTranslatef((GLfloat) glutStrokeWidth(font, character), 0.0f, 0.0f);
+}
+
+
+/*
+ * Geometry.  The curved shapes are drawn as grids over a parametric
+ * surface, the polyhedra from vertex and face lists built on first use.
+ */
+
+typedef void (*surface_func)(const double *params, double u, double v,
+                             double pos[3], double normal[3]);
+
+static void
+surface_vertex(surface_func func, const double *params, double u, double v)
+{
+   double pos[3], normal[3];
+
+   func(params, u, v, pos, normal);
+   glNormal3dv(normal);
+   glVertex3dv(pos);
+}
+
+
+/**
+ * Draw a surface over u, v in [0, 1], where the u and v derivatives form
+ * a right-handed basis with the outward normal.
+ */
+static void
+draw_surface(surface_func func, const double *params,
+             int nu, int nv, GLboolean solid)
+{
+   int i, j;
+
+   if (nu < 1 || nv < 1)
+      return;
+
+   if (solid) {
+      for (j = 0; j < nv; j++) {
+         glBegin(GL_QUAD_STRIP);
+         for (i = 0; i <= nu; i++) {
+            surface_vertex(func, params, (double) i / nu, (double) (j + 1) / nv);
+            surface_vertex(func, params, (double) i / nu, (double) j / nv);
+         }
+         glEnd();
+      }
+   }
+   else {
+      for (j = 0; j <= nv; j++) {
+         glBegin(GL_LINE_STRIP);
+         for (i = 0; i <= nu; i++)
+            surface_vertex(func, params, (double) i / nu, (double) j / nv);
+         glEnd();
+      }
+      for (i = 0; i < nu; i++) {
+         glBegin(GL_LINE_STRIP);
+         for (j = 0; j <= nv; j++)
+            surface_vertex(func, params, (double) i / nu, (double) j / nv);
+         glEnd();
+      }
+   }
+}
+
+
+/* params: radius */
+static void
+sphere_func(const double *params, double u, double v,
+            double pos[3], double normal[3])
+{
+   double theta = 2.0 * M_PI * u, phi = M_PI * v;
+
+   normal[0] = cos(theta) * sin(phi);
+   normal[1] = sin(theta) * sin(phi);
+   normal[2] = -cos(phi);
+   pos[0] = params[0] * normal[0];
+   pos[1] = params[0] * normal[1];
+   pos[2] = params[0] * normal[2];
+}
+
+
+/* params: base radius, height */
+static void
+cone_func(const double *params, double u, double v,
+          double pos[3], double normal[3])
+{
+   double theta = 2.0 * M_PI * u;
+   double base = params[0], height = params[1];
+   double len = sqrt(base * base + height * height);
+
+   pos[0] = (1.0 - v) * base * cos(theta);
+   pos[1] = (1.0 - v) * base * sin(theta);
+   pos[2] = v * height;
+   normal[0] = height * cos(theta) / len;
+   normal[1] = height * sin(theta) / len;
+   normal[2] = base / len;
+}
+
+
+/* params: tube radius, ring radius */
+static void
+torus_func(const double *params, double u, double v,
+           double pos[3], double normal[3])
+{
+   double theta = 2.0 * M_PI * u, phi = 2.0 * M_PI * v;
+   double r = params[1] + params[0] * cos(phi);
+
+   pos[0] = r * cos(theta);
+   pos[1] = r * sin(theta);
+   pos[2] = params[0] * sin(phi);
+   normal[0] = cos(phi) * cos(theta);
+   normal[1] = cos(phi) * sin(theta);
+   normal[2] = sin(phi);
+}
+
+
+void
+glutWireSphere(GLdouble radius, GLint slices, GLint stacks)
+{
+   draw_surface(sphere_func, &radius, slices, stacks, GL_FALSE);
+}
+
+
+void
+glutSolidSphere(GLdouble radius, GLint slices, GLint stacks)
+{
+   draw_surface(sphere_func, &radius, slices, stacks, GL_TRUE);
+}
+
+
+void
+glutWireCone(GLdouble base, GLdouble height, GLint slices, GLint stacks)
+{
+   const double params[2] = { base, height };
+
+   draw_surface(cone_func, params, slices, stacks, GL_FALSE);
+}
+
+
+void
+glutSolidCone(GLdouble base, GLdouble height, GLint slices, GLint stacks)
+{
+   const double params[2] = { base, height };
+   int i;
+
+   draw_surface(cone_func, params, slices, stacks, GL_TRUE);
+
+   /* the base, facing -z */
+   glBegin(GL_TRIANGLE_FAN);
+   glNormal3d(0.0, 0.0, -1.0);
+   glVertex3d(0.0, 0.0, 0.0);
+   for (i = slices; i >= 0; i--) {
+      double theta = 2.0 * M_PI * i / slices;
+      glVertex3d(base * cos(theta), base * sin(theta), 0.0);
+   }
+   glEnd();
+}
+
+
+void
+glutWireTorus(GLdouble inner_radius, GLdouble outer_radius,
+              GLint sides, GLint rings)
+{
+   const double params[2] = { inner_radius, outer_radius };
+
+   draw_surface(torus_func, params, rings, sides, GL_FALSE);
+}
+
+
+void
+glutSolidTorus(GLdouble inner_radius, GLdouble outer_radius,
+               GLint sides, GLint rings)
+{
+   const double params[2] = { inner_radius, outer_radius };
+
+   draw_surface(torus_func, params, rings, sides, GL_TRUE);
+}
+
+
+struct polyhedron {
+   int num_vertices, num_faces, face_size;
+   double vertices[20][3];
+   int faces[20][5];
+};
+
+
+/**
+ * Find the triangles of a convex polyhedron whose vertices are all a
+ * distance edge from each other.
+ */
+static void
+find_triangles(struct polyhedron *p, double edge)
+{
+   int a, b, c;
+
+   p->num_faces = 0;
+   p->face_size = 3;
+   for (a = 0; a < p->num_vertices; a++) {
+      for (b = a + 1; b < p->num_vertices; b++) {
+         for (c = b + 1; c < p->num_vertices; c++) {
+            const double *va = p->vertices[a];
+            const double *vb = p->vertices[b];
+            const double *vc = p->vertices[c];
+            double ab = 0.0, bc = 0.0, ca = 0.0;
+            int k;
+
+            for (k = 0; k < 3; k++) {
+               ab += (va[k] - vb[k]) * (va[k] - vb[k]);
+               bc += (vb[k] - vc[k]) * (vb[k] - vc[k]);
+               ca += (vc[k] - va[k]) * (vc[k] - va[k]);
+            }
+            if (fabs(sqrt(ab) - edge) < 1e-6 &&
+                fabs(sqrt(bc) - edge) < 1e-6 &&
+                fabs(sqrt(ca) - edge) < 1e-6) {
+               p->faces[p->num_faces][0] = a;
+               p->faces[p->num_faces][1] = b;
+               p->faces[p->num_faces][2] = c;
+               p->num_faces++;
+            }
+         }
+      }
+   }
+}
+
+
+static void
+face_normal(const struct polyhedron *p, const int *face, double n[3])
+{
+   const double *a = p->vertices[face[0]];
+   const double *b = p->vertices[face[1]];
+   const double *c = p->vertices[face[2]];
+   double e1[3], e2[3], len;
+   int k;
+
+   for (k = 0; k < 3; k++) {
+      e1[k] = b[k] - a[k];
+      e2[k] = c[k] - a[k];
+   }
+   n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+   n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+   n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+   len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+   for (k = 0; k < 3; k++)
+      n[k] /= len;
+}
+
+
+/**
+ * Make every face counter-clockwise seen from outside.  The polyhedra are
+ * centered on the origin, so a face's normal points outward if it points
+ * away from the origin.
+ */
+static void
+orient_faces(struct polyhedron *p)
+{
+   int f, k;
+
+   for (f = 0; f < p->num_faces; f++) {
+      const double *v = p->vertices[p->faces[f][0]];
+      double n[3];
+
+      face_normal(p, p->faces[f], n);
+      if (n[0] * v[0] + n[1] * v[1] + n[2] * v[2] < 0.0) {
+         for (k = 0; k < p->face_size / 2; k++) {
+            int tmp = p->faces[f][k];
+            p->faces[f][k] = p->faces[f][p->face_size - 1 - k];
+            p->faces[f][p->face_size - 1 - k] = tmp;
+         }
+      }
+   }
+}
+
+
+static void
+draw_polyhedron(const struct polyhedron *p, double scale, GLboolean solid)
+{
+   int f, k;
+
+   for (f = 0; f < p->num_faces; f++) {
+      double n[3];
+
+      face_normal(p, p->faces[f], n);
+      glBegin(solid ? GL_POLYGON : GL_LINE_LOOP);
+      glNormal3dv(n);
+      for (k = 0; k < p->face_size; k++) {
+         const double *v = p->vertices[p->faces[f][k]];
+         glVertex3d(v[0] * scale, v[1] * scale, v[2] * scale);
+      }
+      glEnd();
+   }
+}
+
+
+static const struct polyhedron *
+tetrahedron(void)
+{
+   static struct polyhedron p;
+
+   if (!p.num_vertices) {
+      const double s = 1.0 / sqrt(3.0);
+      const double v[4][3] = {
+         { s, s, s }, { s, -s, -s }, { -s, s, -s }, { -s, -s, s }
+      };
+
+      memcpy(p.vertices, v, sizeof(v));
+      p.num_vertices = 4;
+      find_triangles(&p, 2.0 * sqrt(2.0) * s);
+      orient_faces(&p);
+   }
+   return &p;
+}
+
+
+static const struct polyhedron *
+octahedron(void)
+{
+   static struct polyhedron p;
+
+   if (!p.num_vertices) {
+      const double v[6][3] = {
+         { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 },
+         { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+      };
+
+      memcpy(p.vertices, v, sizeof(v));
+      p.num_vertices = 6;
+      find_triangles(&p, sqrt(2.0));
+      orient_faces(&p);
+   }
+   return &p;
+}
+
+
+static const struct polyhedron *
+icosahedron(void)
+{
+   static struct polyhedron p;
+
+   if (!p.num_vertices) {
+      const double t = (1.0 + sqrt(5.0)) / 2.0;
+      const double s = 1.0 / sqrt(1.0 + t * t);
+      int i, k;
+
+      for (i = 0; i < 4; i++) {
+         double a = (i & 1) ? -1.0 : 1.0, b = (i & 2) ? -t : t;
+         double v[3][3] = { { 0, a, b }, { a, b, 0 }, { b, 0, a } };
+
+         for (k = 0; k < 3; k++) {
+            p.vertices[i * 3 + k][0] = v[k][0] * s;
+            p.vertices[i * 3 + k][1] = v[k][1] * s;
+            p.vertices[i * 3 + k][2] = v[k][2] * s;
+         }
+      }
+      p.num_vertices = 12;
+      find_triangles(&p, 2.0 * s);
+      orient_faces(&p);
+   }
+   return &p;
+}
+
+
+/**
+ * The dodecahedron is the dual of the icosahedron: a vertex at the center
+ * of each icosahedron face and a face around each icosahedron vertex.
+ * Scaled to radius sqrt(3) like GLUT's.
+ */
+static const struct polyhedron *
+dodecahedron(void)
+{
+   static struct polyhedron p;
+
+   if (!p.num_vertices) {
+      const struct polyhedron *ico = icosahedron();
+      int f, v, k;
+
+      for (f = 0; f < ico->num_faces; f++) {
+         double c[3] = { 0.0, 0.0, 0.0 }, len;
+
+         for (k = 0; k < 3; k++) {
+            c[0] += ico->vertices[ico->faces[f][k]][0];
+            c[1] += ico->vertices[ico->faces[f][k]][1];
+            c[2] += ico->vertices[ico->faces[f][k]][2];
+         }
+         len = sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]) / sqrt(3.0);
+         for (k = 0; k < 3; k++)
+            p.vertices[f][k] = c[k] / len;
+      }
+      p.num_vertices = ico->num_faces;
+
+      /* order the five faces around each icosahedron vertex by angle */
+      p.face_size = 5;
+      for (v = 0; v < ico->num_vertices; v++) {
+         const double *axis = ico->vertices[v];
+         double x[3], y[3], angle[5];
+         int n = 0, i, j;
+
+         /* a basis perpendicular to the vertex direction */
+         if (fabs(axis[0]) < 0.9) {
+            x[0] = 0.0;
+            x[1] = axis[2];
+            x[2] = -axis[1];
+         }
+         else {
+            x[0] = -axis[2];
+            x[1] = 0.0;
+            x[2] = axis[0];
+         }
+         y[0] = axis[1] * x[2] - axis[2] * x[1];
+         y[1] = axis[2] * x[0] - axis[0] * x[2];
+         y[2] = axis[0] * x[1] - axis[1] * x[0];
+
+         for (f = 0; f < ico->num_faces && n < 5; f++) {
+            if (ico->faces[f][0] == v || ico->faces[f][1] == v ||
+                ico->faces[f][2] == v) {
+               const double *c = p.vertices[f];
+
+               p.faces[v][n] = f;
+               angle[n] = atan2(c[0] * y[0] + c[1] * y[1] + c[2] * y[2],
+                                c[0] * x[0] + c[1] * x[1] + c[2] * x[2]);
+               n++;
+            }
+         }
+
+         for (i = 1; i < 5; i++) {
+            for (j = i; j > 0 && angle[j - 1] > angle[j]; j--) {
+               double ta = angle[j];
+               int tf = p.faces[v][j];
+
+               angle[j] = angle[j - 1];
+               angle[j - 1] = ta;
+               p.faces[v][j] = p.faces[v][j - 1];
+               p.faces[v][j - 1] = tf;
+            }
+         }
+      }
+      p.num_faces = ico->num_vertices;
+      orient_faces(&p);
+   }
+   return &p;
+}
+
+
+static const struct polyhedron *
+cube(void)
+{
+   static struct polyhedron p;
+
+   if (!p.num_vertices) {
+      const int faces[6][4] = {
+         { 0, 1, 3, 2 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 },
+         { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 3, 7, 5 }
+      };
+      int i, k;
+
+      for (i = 0; i < 8; i++) {
+         p.vertices[i][0] = (i & 4) ? 0.5 : -0.5;
+         p.vertices[i][1] = (i & 2) ? 0.5 : -0.5;
+         p.vertices[i][2] = (i & 1) ? 0.5 : -0.5;
+      }
+      for (i = 0; i < 6; i++)
+         for (k = 0; k < 4; k++)
+            p.faces[i][k] = faces[i][k];
+      p.num_vertices = 8;
+      p.num_faces = 6;
+      p.face_size = 4;
+      orient_faces(&p);
+   }
+   return &p;
+}
+
+
+void
+glutWireCube(GLdouble size)
+{
+   draw_polyhedron(cube(), size, GL_FALSE);
+}
+
+
+void
+glutSolidCube(GLdouble size)
+{
+   draw_polyhedron(cube(), size, GL_TRUE);
+}
+
+
+void
+glutWireTetrahedron(void)
+{
+   draw_polyhedron(tetrahedron(), 1.0, GL_FALSE);
+}
+
+
+void
+glutSolidTetrahedron(void)
+{
+   draw_polyhedron(tetrahedron(), 1.0, GL_TRUE);
+}
+
+
+void
+glutWireOctahedron(void)
+{
+   draw_polyhedron(octahedron(), 1.0, GL_FALSE);
+}
+
+
+void
+glutSolidOctahedron(void)
+{
+   draw_polyhedron(octahedron(), 1.0, GL_TRUE);
+}
+
+
+void
+glutWireDodecahedron(void)
+{
+   draw_polyhedron(dodecahedron(), 1.0, GL_FALSE);
+}
+
+
+void
+glutSolidDodecahedron(void)
+{
+   draw_polyhedron(dodecahedron(), 1.0, GL_TRUE);
+}
+
+
+void
+glutWireIcosahedron(void)
+{
+   draw_polyhedron(icosahedron(), 1.0, GL_FALSE);
+}
+
+
+void
+glutSolidIcosahedron(void)
+{
+   draw_polyhedron(icosahedron(), 1.0, GL_TRUE);
+}
+
+
+/* No teapot patches here; a sphere of about the same size stands in. */
+
+void
+glutWireTeapot(GLdouble size)
+{
+   glutWireSphere(size, 16, 12);
+}
+
+
+void
+glutSolidTeapot(GLdouble size)
+{
+   glutSolidSphere(size, 16, 12);
+}
@@ -0,0 +1,240 @@
+/*
+ * Headless GLUT.
+ *
+ * The subset of the GLUT API used by the demos and tests, implemented on
+ * EGL without a window system, so that the rate tests can run on machines
+ * without an X or Wayland server.  Windows are EGL pbuffers (or, if the
+ * driver has no pbuffer configs, a framebuffer object bound in place of
+ * the default framebuffer) on the Mesa surfaceless platform, or on GBM if
+ * GLUT_HEADLESS_PLATFORM=gbm.
+ *
+ * There is no input and nothing is ever shown.  glutMainLoop() calls the
+ * reshape and visibility callbacks once, then runs display, idle and timer
+ * callbacks until nothing more can happen, at which point it exits.  The
+ * environment variables
+ *   GLUT_HEADLESS_FRAMES=N     exit after N redisplays
+ *   GLUT_HEADLESS_KEYS=STRING  deliver STRING to the keyboard callback,
+ *                              one character per frame, after the first
+ *   GLUT_HEADLESS_CAPTURE=PATH save what the first window to call
+ *                              glutSwapBuffers() draws, each time it does,
+ *                              with util/capture.h, e.g. frame%04d.png
+ * make the interactive programs usable from scripts.  Menus, cursors and
+ * the color map are accepted and ignored.  There are no overlays, color
+ * index or accumulation buffers, and the teapot is drawn as a sphere.
+ *
+ * Selected by configuring with -Dglut-headless=true.
+ */
+
+#ifndef GLUT_HEADLESS_H
+#define GLUT_HEADLESS_H
+
+#ifdef __APPLE__
+#  include <OpenGL/gl.h>
+#  include <OpenGL/glu.h>
+#else
+#  include <GL/gl.h>
+#  include <GL/glu.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The values match freeglut. */
+#define GLUT_API_VERSION            4
+
+#define GLUT_RGB                    0x0000
+#define GLUT_RGBA                   0x0000
+#define GLUT_INDEX                  0x0001
+#define GLUT_SINGLE                 0x0000
+#define GLUT_DOUBLE                 0x0002
+#define GLUT_ACCUM                  0x0004
+#define GLUT_ALPHA                  0x0008
+#define GLUT_DEPTH                  0x0010
+#define GLUT_STENCIL                0x0020
+#define GLUT_MULTISAMPLE            0x0080
+#define GLUT_STEREO                 0x0100
+#define GLUT_LUMINANCE              0x0200
+
+#define GLUT_KEY_F1                 0x0001
+#define GLUT_KEY_F2                 0x0002
+#define GLUT_KEY_F3                 0x0003
+#define GLUT_KEY_F4                 0x0004
+#define GLUT_KEY_F5                 0x0005
+#define GLUT_KEY_F6                 0x0006
+#define GLUT_KEY_F7                 0x0007
+#define GLUT_KEY_F8                 0x0008
+#define GLUT_KEY_F9                 0x0009
+#define GLUT_KEY_F10                0x000A
+#define GLUT_KEY_F11                0x000B
+#define GLUT_KEY_F12                0x000C
+#define GLUT_KEY_LEFT               0x0064
+#define GLUT_KEY_UP                 0x0065
+#define GLUT_KEY_RIGHT              0x0066
+#define GLUT_KEY_DOWN               0x0067
+#define GLUT_KEY_PAGE_UP            0x0068
+#define GLUT_KEY_PAGE_DOWN          0x0069
+#define GLUT_KEY_HOME               0x006A
+#define GLUT_KEY_END                0x006B
+#define GLUT_KEY_INSERT             0x006C
+
+#define GLUT_LEFT_BUTTON            0x0000
+#define GLUT_MIDDLE_BUTTON          0x0001
+#define GLUT_RIGHT_BUTTON           0x0002
+#define GLUT_DOWN                   0x0000
+#define GLUT_UP                     0x0001
+
+#define GLUT_NOT_VISIBLE            0x0000
+#define GLUT_VISIBLE                0x0001
+
+#define GLUT_NORMAL                 0x0000
+#define GLUT_OVERLAY                0x0001
+
+#define GLUT_ACTIVE_SHIFT           0x0001
+#define GLUT_ACTIVE_CTRL            0x0002
+#define GLUT_ACTIVE_ALT             0x0004
+
+#define GLUT_CURSOR_RIGHT_ARROW     0x0000
+#define GLUT_CURSOR_LEFT_ARROW      0x0001
+#define GLUT_CURSOR_CROSSHAIR       0x0009
+#define GLUT_CURSOR_INHERIT         0x0064
+#define GLUT_CURSOR_NONE            0x0065
+
+/* glutGet() and glutLayerGet() */
+#define GLUT_WINDOW_X               0x0064
+#define GLUT_WINDOW_Y               0x0065
+#define GLUT_WINDOW_WIDTH           0x0066
+#define GLUT_WINDOW_HEIGHT          0x0067
+#define GLUT_WINDOW_BUFFER_SIZE     0x0068
+#define GLUT_WINDOW_STENCIL_SIZE    0x0069
+#define GLUT_WINDOW_DEPTH_SIZE      0x006A
+#define GLUT_WINDOW_RED_SIZE        0x006B
+#define GLUT_WINDOW_GREEN_SIZE      0x006C
+#define GLUT_WINDOW_BLUE_SIZE       0x006D
+#define GLUT_WINDOW_ALPHA_SIZE      0x006E
+#define GLUT_WINDOW_DOUBLEBUFFER    0x0073
+#define GLUT_WINDOW_RGBA            0x0074
+#define GLUT_WINDOW_COLORMAP_SIZE   0x0077
+#define GLUT_WINDOW_NUM_SAMPLES     0x0078
+#define GLUT_SCREEN_WIDTH           0x00C8
+#define GLUT_SCREEN_HEIGHT          0x00C9
+#define GLUT_INIT_WINDOW_WIDTH      0x01F6
+#define GLUT_INIT_WINDOW_HEIGHT     0x01F7
+#define GLUT_INIT_DISPLAY_MODE      0x01F8
+#define GLUT_ELAPSED_TIME           0x02BC
+#define GLUT_OVERLAY_POSSIBLE       0x0320
+
+/* glutInitContextFlags() and glutInitContextProfile() */
+#define GLUT_DEBUG                  0x0001
+#define GLUT_FORWARD_COMPATIBLE     0x0002
+#define GLUT_CORE_PROFILE           0x0001
+#define GLUT_COMPATIBILITY_PROFILE  0x0002
+
+#define GLUT_STROKE_ROMAN           ((void *) 0x0000)
+#define GLUT_STROKE_MONO_ROMAN      ((void *) 0x0001)
+#define GLUT_BITMAP_9_BY_15         ((void *) 0x0002)
+#define GLUT_BITMAP_8_BY_13         ((void *) 0x0003)
+#define GLUT_BITMAP_TIMES_ROMAN_10  ((void *) 0x0004)
+#define GLUT_BITMAP_TIMES_ROMAN_24  ((void *) 0x0005)
+#define GLUT_BITMAP_HELVETICA_10    ((void *) 0x0006)
+#define GLUT_BITMAP_HELVETICA_12    ((void *) 0x0007)
+#define GLUT_BITMAP_HELVETICA_18    ((void *) 0x0008)
+
+
+typedef void (*GLUTproc)(void);
+
+
+void glutInit(int *argc, char **argv);
+void glutInitWindowPosition(int x, int y);
+void glutInitWindowSize(int width, int height);
+void glutInitDisplayMode(unsigned int mode);
+void glutInitDisplayString(const char *string);
+void glutInitContextVersion(int major, int minor);
+void glutInitContextFlags(int flags);
+void glutInitContextProfile(int profile);
+
+void glutMainLoop(void);
+
+int glutCreateWindow(const char *title);
+void glutDestroyWindow(int window);
+void glutSetWindow(int window);
+int glutGetWindow(void);
+void glutSetWindowTitle(const char *title);
+void glutReshapeWindow(int width, int height);
+void glutPositionWindow(int x, int y);
+void glutFullScreen(void);
+void glutShowWindow(void);
+void glutHideWindow(void);
+void glutPostRedisplay(void);
+void glutSwapBuffers(void);
+void glutSetCursor(int cursor);
+
+void glutEstablishOverlay(void);
+void glutRemoveOverlay(void);
+void glutUseLayer(GLenum layer);
+void glutPostOverlayRedisplay(void);
+void glutShowOverlay(void);
+void glutHideOverlay(void);
+
+int glutCreateMenu(void (*callback)(int value));
+void glutDestroyMenu(int menu);
+void glutSetMenu(int menu);
+void glutAddMenuEntry(const char *label, int value);
+void glutAddSubMenu(const char *label, int submenu);
+void glutAttachMenu(int button);
+void glutDetachMenu(int button);
+
+void glutDisplayFunc(void (*callback)(void));
+void glutReshapeFunc(void (*callback)(int width, int height));
+void glutKeyboardFunc(void (*callback)(unsigned char key, int x, int y));
+void glutKeyboardUpFunc(void (*callback)(unsigned char key, int x, int y));
+void glutSpecialFunc(void (*callback)(int key, int x, int y));
+void glutSpecialUpFunc(void (*callback)(int key, int x, int y));
+void glutMouseFunc(void (*callback)(int button, int state, int x, int y));
+void glutMotionFunc(void (*callback)(int x, int y));
+void glutPassiveMotionFunc(void (*callback)(int x, int y));
+void glutVisibilityFunc(void (*callback)(int state));
+void glutEntryFunc(void (*callback)(int state));
+void glutOverlayDisplayFunc(void (*callback)(void));
+void glutIdleFunc(void (*callback)(void));
+void glutTimerFunc(unsigned int msecs, void (*callback)(int value), int value);
+
+int glutGet(GLenum query);
+int glutLayerGet(GLenum query);
+int glutGetModifiers(void);
+int glutExtensionSupported(const char *extension);
+GLUTproc glutGetProcAddress(const char *name);
+
+void glutSetColor(int color, GLfloat red, GLfloat green, GLfloat blue);
+
+void glutBitmapCharacter(void *font, int character);
+int glutBitmapWidth(void *font, int character);
+void glutStrokeCharacter(void *font, int character);
+int glutStrokeWidth(void *font, int character);
+
+void glutWireSphere(GLdouble radius, GLint slices, GLint stacks);
+void glutSolidSphere(GLdouble radius, GLint slices, GLint stacks);
+void glutWireCone(GLdouble base, GLdouble height, GLint slices, GLint stacks);
+void glutSolidCone(GLdouble base, GLdouble height, GLint slices, GLint stacks);
+void glutWireCube(GLdouble size);
+void glutSolidCube(GLdouble size);
+void glutWireTorus(GLdouble inner_radius, GLdouble outer_radius,
+                   GLint sides, GLint rings);
+void glutSolidTorus(GLdouble inner_radius, GLdouble outer_radius,
+                    GLint sides, GLint rings);
+void glutWireTetrahedron(void);
+void glutSolidTetrahedron(void);
+void glutWireOctahedron(void);
+void glutSolidOctahedron(void);
+void glutWireDodecahedron(void);
+void glutSolidDodecahedron(void);
+void glutWireIcosahedron(void);
+void glutSolidIcosahedron(void);
+void glutWireTeapot(GLdouble size);
+void glutSolidTeapot(GLdouble size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GLUT_HEADLESS_H */
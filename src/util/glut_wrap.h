@@ -1,7 +1,9 @@
 #ifndef GLUT_WRAP_H
 #define GLUT_WRAP_H
 
-#ifdef HAVE_FREEGLUT
+#ifdef HAVE_GLUT_HEADLESS
+#  include "glut_headless.h"
+#elif defined HAVE_FREEGLUT
 #  include <GL/freeglut.h>
 #elif defined __APPLE__
 #  include <GLUT/glut.h>
@@ -2,6 +2,10 @@
 
 /*
  * Read a PNG image file and generate a mipmap texture set.
+ *
+ * Images can be decoded and mipmapped on a pool of worker threads with
+ * LoadRGBMipmapsAsync(), leaving only the upload in FinishRGBMipmaps()
+ * to the thread that owns the GL context.
  */
 
 
@@ -9,11 +13,27 @@
 #include "gl_wrap.h"
 #include <assert.h>
 #include <png.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include "readtex.h"
 
+#define MAX_WORKERS 8
+#define MAX_LEVELS 16
+
+#define CACHE_MAGIC "RTXCACHE"
+#define CACHE_VERSION 1
+#define CACHE_ALIGN 64
+
 /*
 ** RGB Image Structure
 */
@@ -86,60 +106,605 @@ static void FreeImage( PNGImageRec *image )
 }
 
 
+static void FlipImage( PNGImageRec *image, GLbitfield flags )
+{
+   const int pixel = image->components;
+   const int stride = image->sizeX * pixel;
+   GLubyte temp[4];
+   GLubyte *row;
+   int i, j, k;
+
+   if (flags & READTEX_FLIP_TB) {
+      for (i = 0; i < image->sizeY / 2; i++) {
+         GLubyte *top = image->data + i * stride;
+         GLubyte *bottom = image->data + (image->sizeY - i - 1) * stride;
+         for (j = 0; j < stride; j++) {
+            GLubyte t = top[j];
+            top[j] = bottom[j];
+            bottom[j] = t;
+         }
+      }
+   }
+   if (flags & READTEX_FLIP_LR) {
+      for (i = 0; i < image->sizeY; i++) {
+         row = image->data + i * stride;
+         for (j = 0; j < image->sizeX / 2; j++) {
+            k = image->sizeX - j - 1;
+            memcpy(temp, row + j * pixel, pixel);
+            memcpy(row + j * pixel, row + k * pixel, pixel);
+            memcpy(row + k * pixel, temp, pixel);
+         }
+      }
+   }
+}
+
+
 /*
- * Load an PNG .png file and generate a set of 2-D mipmaps from it.
+ * Box filter an image down to half its size (rounded down, at least 1).
+ * For odd sizes the last row or column is dropped, like the GL's own
+ * mipmap generation commonly does.  The rounding is the same as GLU's:
+ * (a + b + c + d + 2) / 4, or (a + b) / 2 once the image is a single row
+ * or column, so for power-of-two images the levels match
+ * gluBuild2DMipmaps().  The inner loops have no branches so that the
+ * compiler can vectorize them.
+ */
+static void HalveImage( const GLubyte *src, GLint w, GLint h, GLint comps,
+                        GLubyte *dst )
+{
+   GLint x, y, c;
+
+   if (w > 1 && h > 1) {
+      const GLint dw = w / 2, dh = h / 2;
+
+      for (y = 0; y < dh; y++) {
+         const GLubyte *r0 = src + 2 * y * w * comps;
+         const GLubyte *r1 = r0 + w * comps;
+         GLubyte *d = dst + y * dw * comps;
+         for (x = 0; x < dw; x++) {
+            const GLint s = 2 * x * comps;
+            for (c = 0; c < comps; c++) {
+               d[x * comps + c] = (GLubyte)
+                  ((r0[s + c] + r0[s + comps + c] +
+                    r1[s + c] + r1[s + comps + c] + 2) >> 2);
+            }
+         }
+      }
+   }
+   else {
+      /* a single row or column: pairs of neighbours along it */
+      const GLint n = (w > 1 ? w : h) / 2;
+
+      for (x = 0; x < n; x++) {
+         for (c = 0; c < comps; c++) {
+            dst[x * comps + c] = (GLubyte)
+               ((src[2 * x * comps + c] + src[(2 * x + 1) * comps + c]) >> 1);
+         }
+      }
+   }
+}
+
+
+/*
+ * A decoded image and its mipmap chain, built by a worker thread.
+ */
+struct _RGBMipmapJob {
+   char *fileName;
+   GLbitfield flags;
+   GLboolean done;
+   PNGImageRec *image;              /* decoded image, or NULL if cached */
+   GLint components;
+   GLint numLevels;                 /* 0 on error */
+   GLint width[MAX_LEVELS], height[MAX_LEVELS];
+   GLubyte *levels[MAX_LEVELS];     /* levels[0] is image->data */
+   GLubyte *mipmaps;                /* storage for levels 1 and up */
+   void *mapping;                   /* cache file the levels are in */
+   size_t mappingSize;
+   RGBMipmapJob *next;              /* in the work queue */
+};
+
+
+static void BuildMipmaps( RGBMipmapJob *job )
+{
+   const GLint comps = job->image->components;
+   GLint w = job->image->sizeX, h = job->image->sizeY;
+   size_t bytes;
+
+   /* size the whole chain so that it's one allocation */
+   bytes = 0;
+   while (w > 1 || h > 1) {
+      w = w > 1 ? w / 2 : 1;
+      h = h > 1 ? h / 2 : 1;
+      bytes += (size_t) w * h * comps;
+   }
+   job->mipmaps = bytes ? (GLubyte *) malloc(bytes) : NULL;
+   if (bytes && !job->mipmaps) {
+      fprintf(stderr, "Out of memory!\n");
+      return;
+   }
+
+   job->components = comps;
+   job->levels[0] = job->image->data;
+   job->width[0] = job->image->sizeX;
+   job->height[0] = job->image->sizeY;
+   job->numLevels = 1;
+   bytes = 0;
+   while ((job->width[job->numLevels - 1] > 1 ||
+           job->height[job->numLevels - 1] > 1) &&
+          job->numLevels < MAX_LEVELS) {
+      const GLint l = job->numLevels;
+      w = job->width[l - 1];
+      h = job->height[l - 1];
+      job->width[l] = w > 1 ? w / 2 : 1;
+      job->height[l] = h > 1 ? h / 2 : 1;
+      job->levels[l] = job->mipmaps + bytes;
+      HalveImage(job->levels[l - 1], w, h, comps, job->levels[l]);
+      bytes += (size_t) job->width[l] * job->height[l] * comps;
+      job->numLevels++;
+   }
+}
+
+
+/*
+ * On-disk cache of decoded images and their mipmap chains, enabled by
+ * setting READTEX_CACHE_DIR.  Each entry is a header, the source path
+ * and the levels, aligned so the file can be mapped and handed to the
+ * GL as is.  Entries are found by a hash of the key and verified with
+ * the key stored in them.
+ */
+typedef struct {
+   char magic[8];                   /* CACHE_MAGIC */
+   uint32_t version;                /* CACHE_VERSION */
+   uint32_t flags;                  /* READTEX_FLIP_* */
+   int64_t mtime;                   /* of the source file */
+   uint64_t size;                   /* of the source file */
+   uint32_t components;
+   uint32_t numLevels;
+   uint32_t width[MAX_LEVELS], height[MAX_LEVELS];
+   uint64_t offset[MAX_LEVELS];
+   uint32_t pathLength;             /* path follows the header */
+   uint32_t pad;
+} CacheHeader;
+
+
+#ifndef _WIN32
+
+static const char *CacheDir( void )
+{
+   const char *dir = getenv("READTEX_CACHE_DIR");
+   return dir && *dir ? dir : NULL;
+}
+
+
+/* Finds the cache file for an image, and the key to check in it */
+static GLboolean CacheEntry( const RGBMipmapJob *job, char *path,
+                             char *cacheFile, size_t cacheFileSize,
+                             struct stat *st )
+{
+   const char *dir = CacheDir();
+   uint64_t hash = 0xcbf29ce484222325ull;   /* FNV-1a */
+   char key[PATH_MAX + 64];
+   const char *c;
+
+   if (!dir || stat(job->fileName, st) != 0 ||
+       !realpath(job->fileName, path))
+      return GL_FALSE;
+
+   snprintf(key, sizeof(key), "%s\n%lld\n%llu\n%u", path,
+            (long long) st->st_mtime, (unsigned long long) st->st_size,
+            (unsigned) job->flags);
+   for (c = key; *c; c++) {
+      hash ^= (unsigned char) *c;
+      hash *= 0x100000001b3ull;
+   }
+   snprintf(cacheFile, cacheFileSize, "%s/%016llx.rtc", dir,
+            (unsigned long long) hash);
+   return GL_TRUE;
+}
+
+
+static GLboolean ReadCache( RGBMipmapJob *job )
+{
+   char path[PATH_MAX], cacheFile[PATH_MAX];
+   const CacheHeader *header;
+   struct stat st, cst;
+   void *data;
+   GLint l;
+   int fd;
+
+   if (!CacheEntry(job, path, cacheFile, sizeof(cacheFile), &st))
+      return GL_FALSE;
+
+   fd = open(cacheFile, O_RDONLY);
+   if (fd < 0)
+      return GL_FALSE;
+   if (fstat(fd, &cst) != 0 || cst.st_size < (off_t) sizeof(CacheHeader)) {
+      close(fd);
+      return GL_FALSE;
+   }
+   data = mmap(NULL, cst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (data == MAP_FAILED)
+      return GL_FALSE;
+
+   header = (const CacheHeader *) data;
+   if (memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+       header->version != CACHE_VERSION ||
+       header->flags != job->flags ||
+       header->mtime != (int64_t) st.st_mtime ||
+       header->size != (uint64_t) st.st_size ||
+       (header->components != 3 && header->components != 4) ||
+       header->numLevels < 1 || header->numLevels > MAX_LEVELS ||
+       header->pathLength != strlen(path) ||
+       sizeof(CacheHeader) + header->pathLength > (uint64_t) cst.st_size ||
+       memcmp(header + 1, path, header->pathLength) != 0)
+      goto fail;
+
+   for (l = 0; l < (GLint) header->numLevels; l++) {
+      uint64_t bytes = (uint64_t) header->width[l] * header->height[l] *
+                       header->components;
+      if (header->offset[l] > (uint64_t) cst.st_size ||
+          bytes > (uint64_t) cst.st_size - header->offset[l])
+         goto fail;
+      job->width[l] = header->width[l];
+      job->height[l] = header->height[l];
+      job->levels[l] = (GLubyte *) data + header->offset[l];
+   }
+   job->components = header->components;
+   job->numLevels = header->numLevels;
+   job->mapping = data;
+   job->mappingSize = cst.st_size;
+   return GL_TRUE;
+
+fail:
+   munmap(data, cst.st_size);
+   return GL_FALSE;
+}
+
+
+static GLboolean WritePadded( FILE *f, const void *data, size_t bytes,
+                              uint64_t *pos )
+{
+   static const char zeros[CACHE_ALIGN];
+   size_t pad = (CACHE_ALIGN - *pos % CACHE_ALIGN) % CACHE_ALIGN;
+
+   if (fwrite(zeros, 1, pad, f) != pad || fwrite(data, 1, bytes, f) != bytes)
+      return GL_FALSE;
+   *pos += pad + bytes;
+   return GL_TRUE;
+}
+
+
+static void WriteCache( const RGBMipmapJob *job )
+{
+   char path[PATH_MAX], cacheFile[PATH_MAX], tempFile[PATH_MAX + 32];
+   CacheHeader header;
+   struct stat st;
+   uint64_t pos;
+   GLboolean ok;
+   GLint l;
+   FILE *f;
+
+   if (!CacheEntry(job, path, cacheFile, sizeof(cacheFile), &st))
+      return;
+
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+   header.version = CACHE_VERSION;
+   header.flags = job->flags;
+   header.mtime = st.st_mtime;
+   header.size = st.st_size;
+   header.components = job->components;
+   header.numLevels = job->numLevels;
+   header.pathLength = strlen(path);
+   pos = sizeof(header) + header.pathLength;
+   for (l = 0; l < job->numLevels; l++) {
+      pos += (CACHE_ALIGN - pos % CACHE_ALIGN) % CACHE_ALIGN;
+      header.width[l] = job->width[l];
+      header.height[l] = job->height[l];
+      header.offset[l] = pos;
+      pos += (uint64_t) job->width[l] * job->height[l] * job->components;
+   }
+
+   /* write to a temporary file and rename it, so that other processes
+      never see a partial entry */
+   mkdir(CacheDir(), 0777);
+   snprintf(tempFile, sizeof(tempFile), "%s.%ld.tmp", cacheFile,
+            (long) getpid());
+   f = fopen(tempFile, "wb");
+   if (!f)
+      return;
+   ok = fwrite(&header, 1, sizeof(header), f) == sizeof(header) &&
+        fwrite(path, 1, header.pathLength, f) == header.pathLength;
+   pos = sizeof(header) + header.pathLength;
+   for (l = 0; ok && l < job->numLevels; l++) {
+      ok = WritePadded(f, job->levels[l], (size_t) job->width[l] *
+                       job->height[l] * job->components, &pos);
+   }
+   if (fclose(f) != 0)
+      ok = GL_FALSE;
+   if (!ok || rename(tempFile, cacheFile) != 0)
+      unlink(tempFile);
+}
+
+#else
+
+static const char *CacheDir( void )
+{
+   return NULL;
+}
+
+static GLboolean ReadCache( RGBMipmapJob *job )
+{
+   (void) job;
+   return GL_FALSE;
+}
+
+static void WriteCache( const RGBMipmapJob *job )
+{
+   (void) job;
+}
+
+#endif /* _WIN32 */
+
+
+static void RunJob( RGBMipmapJob *job )
+{
+   if (ReadCache(job))
+      return;
+
+   job->image = PNGImageLoad( job->fileName );
+   if (!job->image)
+      return;
+
+   FlipImage(job->image, job->flags);
+   BuildMipmaps(job);
+
+   if (job->numLevels)
+      WriteCache(job);
+}
+
+
+static RGBMipmapJob *NewJob( const char *imageFile, GLbitfield flags )
+{
+   RGBMipmapJob *job;
+
+   job = (RGBMipmapJob *) calloc(1, sizeof(RGBMipmapJob));
+   if (!job)
+      return NULL;
+   job->fileName = strdup(imageFile);
+   job->flags = flags;
+   return job;
+}
+
+
+static void FreeJob( RGBMipmapJob *job )
+{
+#ifndef _WIN32
+   if (job->mapping)
+      munmap(job->mapping, job->mappingSize);
+#endif
+   if (job->image)
+      FreeImage(job->image);
+   free(job->mipmaps);
+   free(job->fileName);
+   free(job);
+}
+
+
+#ifndef _WIN32
+
+static pthread_mutex_t QueueMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t QueueCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t DoneCond = PTHREAD_COND_INITIALIZER;
+static RGBMipmapJob *QueueHead, *QueueTail;
+static int NumWorkers;
+
+
+static void *Worker( void *arg )
+{
+   RGBMipmapJob *job;
+
+   (void) arg;
+   for (;;) {
+      pthread_mutex_lock(&QueueMutex);
+      while (!QueueHead)
+         pthread_cond_wait(&QueueCond, &QueueMutex);
+      job = QueueHead;
+      QueueHead = job->next;
+      if (!QueueHead)
+         QueueTail = NULL;
+      pthread_mutex_unlock(&QueueMutex);
+
+      RunJob(job);
+
+      pthread_mutex_lock(&QueueMutex);
+      job->done = GL_TRUE;
+      pthread_cond_broadcast(&DoneCond);
+      pthread_mutex_unlock(&QueueMutex);
+   }
+   return NULL;
+}
+
+
+/* Start the worker threads on first use; called with QueueMutex held */
+static void StartWorkers( void )
+{
+   long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   int i;
+
+   if (NumWorkers)
+      return;
+
+   NumWorkers = cpus < 1 ? 1 : cpus > MAX_WORKERS ? MAX_WORKERS : (int) cpus;
+   for (i = 0; i < NumWorkers; i++) {
+      pthread_t thread;
+      if (pthread_create(&thread, NULL, Worker, NULL) != 0) {
+         NumWorkers = i;
+         break;
+      }
+      pthread_detach(thread);
+   }
+}
+
+#endif /* _WIN32 */
+
+
+/*
+ * Start loading a PNG .png file and generating a set of 2-D mipmaps from
+ * it on a worker thread.
  * Input:  imageFile - name of .png to read
- *         intFormat - internal texture format to use, or number of components
- * Return:  GL_TRUE if success, GL_FALSE if error.
+ *         flags - READTEX_FLIP_TB and/or READTEX_FLIP_LR, or 0
+ * Return:  job to pass to FinishRGBMipmaps(), or NULL if out of memory
  */
-GLboolean LoadRGBMipmaps( const char *imageFile, GLint intFormat )
+RGBMipmapJob *LoadRGBMipmapsAsync( const char *imageFile, GLbitfield flags )
 {
-   GLint w, h;
-   return LoadRGBMipmaps2( imageFile, GL_TEXTURE_2D, intFormat, &w, &h );
+   RGBMipmapJob *job = NewJob(imageFile, flags);
+
+   if (!job)
+      return NULL;
+
+#ifndef _WIN32
+   pthread_mutex_lock(&QueueMutex);
+   StartWorkers();
+   if (NumWorkers) {
+      if (QueueTail)
+         QueueTail->next = job;
+      else
+         QueueHead = job;
+      QueueTail = job;
+      pthread_cond_signal(&QueueCond);
+      pthread_mutex_unlock(&QueueMutex);
+      return job;
+   }
+   pthread_mutex_unlock(&QueueMutex);
+#endif
+
+   /* no threads, do it now */
+   RunJob(job);
+   job->done = GL_TRUE;
+   return job;
 }
 
 
+static GLboolean HaveNPOT( void )
+{
+   const char *version = (const char *) glGetString(GL_VERSION);
+   const char *extensions;
+
+   if (version && atoi(version) >= 2)
+      return GL_TRUE;
+   extensions = (const char *) glGetString(GL_EXTENSIONS);
+   return extensions &&
+      strstr(extensions, "GL_ARB_texture_non_power_of_two") != NULL;
+}
 
-GLboolean LoadRGBMipmaps2( const char *imageFile, GLenum target,
-                           GLint intFormat, GLint *width, GLint *height )
+
+/*
+ * Wait for a job started with LoadRGBMipmapsAsync() and upload its
+ * mipmaps to the bound texture.  Must be called from the thread that
+ * owns the GL context.  The job is freed.
+ * Input:  job - from LoadRGBMipmapsAsync()
+ *         target - 2D texture target or cube map face
+ *         intFormat - internal texture format to use, or number of components
+ * Output:  width, height - size of the image
+ * Return:  GL_TRUE if success, GL_FALSE if error.
+ */
+GLboolean FinishRGBMipmaps( RGBMipmapJob *job, GLenum target,
+                            GLint intFormat, GLint *width, GLint *height )
 {
-   GLint error;
+   GLboolean ok = GL_FALSE;
    GLenum format;
-   PNGImageRec *image;
+   GLint level, alignment;
 
-   image = PNGImageLoad( imageFile );
-   if (!image) {
+   if (!job)
       return GL_FALSE;
-   }
 
-   if (image->components==3) {
+#ifndef _WIN32
+   pthread_mutex_lock(&QueueMutex);
+   while (!job->done)
+      pthread_cond_wait(&DoneCond, &QueueMutex);
+   pthread_mutex_unlock(&QueueMutex);
+#endif
+
+   if (!job->numLevels)
+      goto done;
+
+   if (job->components==3) {
       format = GL_RGB;
    }
-   else if (image->components==4) {
+   else if (job->components==4) {
       format = GL_RGBA;
    }
    else {
       /* not implemented */
       fprintf(stderr,
               "Error in LoadRGBMipmaps %d-component images not implemented\n",
-              image->components );
-      FreeImage(image);
-      return GL_FALSE;
+              job->components );
+      goto done;
    }
 
-   error = gluBuild2DMipmaps( target,
-                              intFormat,
-                              image->sizeX, image->sizeY,
-                              format,
-                              GL_UNSIGNED_BYTE,
-                              image->data );
+   *width = job->width[0];
+   *height = job->height[0];
 
-   *width = image->sizeX;
-   *height = image->sizeY;
+   glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-   FreeImage(image);
+   if (((*width & (*width - 1)) || (*height & (*height - 1))) && !HaveNPOT()) {
+      /* let GLU rescale it to a power of two */
+      ok = gluBuild2DMipmaps( target, intFormat, *width, *height,
+                              format, GL_UNSIGNED_BYTE,
+                              job->levels[0] ) ? GL_FALSE : GL_TRUE;
+   }
+   else {
+      /* like gluBuild2DMipmaps(), scale images that are too big down,
+       * by leaving out the levels the GL can't take
+       */
+      GLint maxSize, first = 0;
+
+      if (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X &&
+          target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)
+         glGetIntegerv(GL_MAX_CUBE_MAP_TEXTURE_SIZE, &maxSize);
+      else
+         glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+      while (first < job->numLevels - 1 &&
+             (job->width[first] > maxSize || job->height[first] > maxSize))
+         first++;
+
+      for (level = first; level < job->numLevels; level++) {
+         glTexImage2D(target, level - first, intFormat,
+                      job->width[level], job->height[level], 0,
+                      format, GL_UNSIGNED_BYTE, job->levels[level]);
+      }
+      ok = GL_TRUE;
+   }
+
+   glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
 
-   return error ? GL_FALSE : GL_TRUE;
+done:
+   FreeJob(job);
+   return ok;
+}
+
+
+/*
+ * Load an PNG .png file and generate a set of 2-D mipmaps from it.
+ * Input:  imageFile - name of .png to read
+ *         intFormat - internal texture format to use, or number of components
+ * Return:  GL_TRUE if success, GL_FALSE if error.
+ */
+GLboolean LoadRGBMipmaps( const char *imageFile, GLint intFormat )
+{
+   GLint w, h;
+   return LoadRGBMipmaps2( imageFile, GL_TEXTURE_2D, intFormat, &w, &h );
+}
+
+
+
+GLboolean LoadRGBMipmaps2( const char *imageFile, GLenum target,
+                           GLint intFormat, GLint *width, GLint *height )
+{
+   return FinishRGBMipmaps( LoadRGBMipmapsAsync( imageFile, 0 ), target,
+                            intFormat, width, height );
 }
 
 
@@ -159,6 +724,28 @@ GLubyte *LoadRGBImage( const char *imageFile, GLint *width, GLint *height,
    GLint bytes;
    GLubyte *buffer;
 
+   if (CacheDir()) {
+      /* go through the cache, which also stores the mipmaps for the
+         next LoadRGBMipmaps() of this file */
+      RGBMipmapJob *job = NewJob(imageFile, 0);
+      if (!job)
+         return NULL;
+      RunJob(job);
+      buffer = NULL;
+      if (job->numLevels) {
+         bytes = job->width[0] * job->height[0] * job->components;
+         buffer = (GLubyte *) malloc(bytes);
+      }
+      if (buffer) {
+         memcpy(buffer, job->levels[0], bytes);
+         *format = job->components == 4 ? GL_RGBA : GL_RGB;
+         *width = job->width[0];
+         *height = job->height[0];
+      }
+      FreeJob(job);
+      return buffer;
+   }
+
    image = PNGImageLoad( imageFile );
    if (!image) {
       return NULL;
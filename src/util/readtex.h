@@ -16,6 +16,26 @@ LoadRGBMipmaps2( const char *imageFile, GLenum target,
                  GLint intFormat, GLint *width, GLint *height );
 
 
+/*
+ * If the READTEX_CACHE_DIR environment variable is set, decoded images
+ * and their mipmaps are cached in that directory, and later loads of
+ * an unchanged file skip decoding and filtering.
+ */
+
+/* Flags for LoadRGBMipmapsAsync() */
+#define READTEX_FLIP_TB  0x1   /* flip the image top to bottom */
+#define READTEX_FLIP_LR  0x2   /* flip the image left to right */
+
+typedef struct _RGBMipmapJob RGBMipmapJob;
+
+extern RGBMipmapJob *
+LoadRGBMipmapsAsync( const char *imageFile, GLbitfield flags );
+
+extern GLboolean
+FinishRGBMipmaps( RGBMipmapJob *job, GLenum target,
+                  GLint intFormat, GLint *width, GLint *height );
+
+
 extern GLubyte *
 LoadRGBImage( const char *imageFile,
               GLint *width, GLint *height, GLenum *format );
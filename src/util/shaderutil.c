@@ -7,6 +7,7 @@
 
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,6 +21,10 @@ static GLdouble CompileTime = 0.0;
 /** time to linke previous program */
 static GLdouble LinkTime = 0.0;
 
+/** program binary cache directory, see LinkShaders3() */
+static const char *CacheDir = NULL;
+static GLboolean CacheChecked = GL_FALSE;
+
 GLboolean
 ShadersSupported(void)
 {
@@ -35,7 +40,6 @@ GLuint
 CompileShaderText(GLenum shaderType, const char *text)
 {
    GLuint shader;
-   GLint stat;
    GLdouble t0, t1;
 
    shader = glCreateShader(shaderType);
@@ -47,17 +51,8 @@ CompileShaderText(GLenum shaderType, const char *text)
 
    CompileTime = t1 - t0;
 
-   glGetShaderiv(shader, GL_COMPILE_STATUS, &stat);
-   if (!stat) {
-      GLchar log[1000];
-      GLsizei len;
-      glGetShaderInfoLog(shader, 1000, &len, log);
-      fprintf(stderr, "Error: problem compiling shader: %s\n", log);
+   if (!CheckShaderCompile(shader))
       exit(1);
-   }
-   else {
-      /*printf("Shader compiled OK\n");*/
-   }
    return shader;
 }
 
@@ -107,11 +102,197 @@ LinkShaders(GLuint vertShader, GLuint fragShader)
 }
 
 
+/*
+ * Program binary cache.
+ *
+ * If SHADER_CACHE_DIR is set and the GL can retrieve program binaries
+ * (GL 4.1 or GL_ARB_get_program_binary, with at least one binary
+ * format), LinkShaders3() keeps the binaries of the programs it links
+ * in that directory.  They are keyed by a hash of the GL vendor,
+ * renderer and version strings and the type and source of each shader.
+ * A later link of the same shaders loads the binary with
+ * glProgramBinary() instead, and falls back to glLinkProgram() if the GL
+ * rejects it.  The shaders are still compiled and stay attached, so a
+ * program can be relinked as usual.
+ */
+
+#define CACHE_MAGIC 0x42505553  /* "SUPB" */
+
+struct cache_header
+{
+   GLuint magic;
+   GLenum format;
+   GLint length;
+};
+
+
+static const char *
+cache_dir(void)
+{
+   if (!CacheChecked) {
+      const char *dir = getenv("SHADER_CACHE_DIR");
+      GLint formats = 0;
+
+      CacheChecked = GL_TRUE;
+      if (dir && *dir &&
+          (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary)) {
+         glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+         if (formats > 0)
+            CacheDir = dir;
+      }
+   }
+   return CacheDir;
+}
+
+
+static uint64_t
+hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+   const unsigned char *bytes = (const unsigned char *) data;
+   size_t i;
+
+   for (i = 0; i < size; i++) {
+      hash ^= bytes[i];
+      hash *= 0x100000001b3ull;
+   }
+   return hash;
+}
+
+
+static uint64_t
+hash_string(uint64_t hash, const char *s)
+{
+   /* include the terminator, so that "ab" "c" != "a" "bc" */
+   return hash_bytes(hash, s ? s : "", s ? strlen(s) + 1 : 1);
+}
+
+
+static uint64_t
+hash_shader(uint64_t hash, GLuint shader)
+{
+   GLint type = 0, length = 0;
+   GLchar *source;
+
+   if (!shader)
+      return hash_bytes(hash, &type, sizeof(type));
+
+   glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+   glGetShaderiv(shader, GL_SHADER_SOURCE_LENGTH, &length);
+   hash = hash_bytes(hash, &type, sizeof(type));
+
+   source = (GLchar *) malloc(length + 1);
+   if (!source)
+      return hash;
+   source[0] = 0;
+   glGetShaderSource(shader, length + 1, NULL, source);
+   hash = hash_string(hash, source);
+   free(source);
+   return hash;
+}
+
+
+static void
+cache_path(char *path, size_t size, uint64_t key, const char *suffix)
+{
+   snprintf(path, size, "%s/%08x%08x%s", CacheDir,
+            (unsigned) (key >> 32), (unsigned) key, suffix);
+}
+
+
+static uint64_t
+cache_key(GLuint vertShader, GLuint geomShader, GLuint fragShader)
+{
+   uint64_t key = 0xcbf29ce484222325ull;
+
+   key = hash_string(key, (const char *) glGetString(GL_VENDOR));
+   key = hash_string(key, (const char *) glGetString(GL_RENDERER));
+   key = hash_string(key, (const char *) glGetString(GL_VERSION));
+   key = hash_shader(key, vertShader);
+   key = hash_shader(key, geomShader);
+   key = hash_shader(key, fragShader);
+   return key;
+}
+
+
+/**
+ * Try to load the program from the cache.  Returns GL_FALSE if it isn't
+ * there or the GL doesn't take it.
+ */
+static GLboolean
+cache_load(GLuint program, uint64_t key)
+{
+   struct cache_header header;
+   char path[1024];
+   GLboolean ok = GL_FALSE;
+   void *binary;
+   FILE *f;
+
+   cache_path(path, sizeof(path), key, ".bin");
+   f = fopen(path, "rb");
+   if (!f)
+      return GL_FALSE;
+
+   if (fread(&header, sizeof(header), 1, f) == 1 &&
+       header.magic == CACHE_MAGIC && header.length > 0 &&
+       (binary = malloc(header.length))) {
+      if (fread(binary, header.length, 1, f) == 1) {
+         GLint stat = 0;
+
+         glProgramBinary(program, header.format, binary, header.length);
+         glGetProgramiv(program, GL_LINK_STATUS, &stat);
+         ok = stat != 0;
+      }
+      free(binary);
+   }
+
+   fclose(f);
+   return ok;
+}
+
+
+static void
+cache_store(GLuint program, uint64_t key)
+{
+   struct cache_header header;
+   char path[1024], tmp[1024];
+   void *binary;
+   FILE *f;
+
+   header.magic = CACHE_MAGIC;
+   header.length = 0;
+   glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &header.length);
+   if (header.length <= 0)
+      return;
+   binary = malloc(header.length);
+   if (!binary)
+      return;
+   glGetProgramBinary(program, header.length, &header.length,
+                      &header.format, binary);
+
+   /* write a temporary file and rename it, so that another program
+    * never reads half a binary
+    */
+   cache_path(path, sizeof(path), key, ".bin");
+   cache_path(tmp, sizeof(tmp), key, ".tmp");
+   f = fopen(tmp, "wb");
+   if (f) {
+      GLboolean ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                     fwrite(binary, header.length, 1, f) == 1;
+      if (fclose(f) == 0 && ok)
+         ok = rename(tmp, path) == 0;
+      if (!ok)
+         remove(tmp);
+   }
+   free(binary);
+}
+
+
 GLuint
 LinkShaders3(GLuint vertShader, GLuint geomShader, GLuint fragShader)
 {
    GLuint program = glCreateProgram();
    GLdouble t0, t1;
+   uint64_t key = 0;
 
    assert(vertShader || fragShader);
 
@@ -123,23 +304,26 @@ LinkShaders3(GLuint vertShader, GLuint geomShader, GLuint fragShader)
       glAttachShader(program, fragShader);
 
    t0 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
+   if (cache_dir()) {
+      key = cache_key(vertShader, geomShader, fragShader);
+      if (cache_load(program, key)) {
+         t1 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
+         LinkTime = t1 - t0;
+         return program;
+      }
+      glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                          GL_TRUE);
+   }
    glLinkProgram(program);
    t1 = glutGet(GLUT_ELAPSED_TIME) * 0.001;
 
    LinkTime = t1 - t0;
 
-   /* check link */
-   {
-      GLint stat;
-      glGetProgramiv(program, GL_LINK_STATUS, &stat);
-      if (!stat) {
-         GLchar log[1000];
-         GLsizei len;
-         glGetProgramInfoLog(program, 1000, &len, log);
-         fprintf(stderr, "Shader link error:\n%s\n", log);
-         return 0;
-      }
-   }
+   if (!CheckProgramLink(program))
+      return 0;
+
+   if (cache_dir())
+      cache_store(program, key);
 
    return program;
 }
@@ -188,6 +372,145 @@ LinkShaders3WithGeometryInfo(GLuint vertShader, GLuint geomShader, GLuint fragSh
 }
 
 
+/*
+ * Asynchronous compiles and links.
+ *
+ * With GL_ARB_parallel_shader_compile (or the KHR version) the GL may
+ * compile and link on threads of its own, returning from
+ * glCompileShader() and glLinkProgram() before it's done.  Asking for
+ * GL_COMPILE_STATUS or GL_LINK_STATUS waits for it, GL_COMPLETION_STATUS
+ * doesn't.  So to overlap the work, submit all of it first with
+ * CompileShaderTextAsync() and LinkShaders3Async(), then poll
+ * ShaderIsReady() / ProgramIsReady() or wait with CheckShaderCompile() /
+ * CheckProgramLink().  A program can be linked before its shaders are
+ * done compiling.  Without the extension all of this works the same,
+ * just serially.  The async links don't use the program binary cache,
+ * and neither updates GetShaderCompileTime() / GetShaderLinkTime().
+ */
+
+/**
+ * Set the number of threads the GL may compile shaders on: 0 for none,
+ * 0xffffffff for as many as it likes.  Returns GL_FALSE if the GL can't
+ * compile in parallel.
+ */
+GLboolean
+SetShaderCompilerThreads(GLuint count)
+{
+   if (GLAD_GL_ARB_parallel_shader_compile)
+      glMaxShaderCompilerThreadsARB(count);
+   else if (GLAD_GL_KHR_parallel_shader_compile)
+      glMaxShaderCompilerThreadsKHR(count);
+   else
+      return GL_FALSE;
+   return GL_TRUE;
+}
+
+
+/** Start compiling a shader, without waiting for the result */
+GLuint
+CompileShaderTextAsync(GLenum shaderType, const char *text)
+{
+   GLuint shader = glCreateShader(shaderType);
+
+   glShaderSource(shader, 1, (const GLchar **) &text, NULL);
+   glCompileShader(shader);
+   return shader;
+}
+
+
+/** Start linking a program, without waiting for the result */
+GLuint
+LinkShaders3Async(GLuint vertShader, GLuint geomShader, GLuint fragShader)
+{
+   GLuint program = glCreateProgram();
+
+   assert(vertShader || fragShader);
+
+   if (vertShader)
+      glAttachShader(program, vertShader);
+   if (geomShader)
+      glAttachShader(program, geomShader);
+   if (fragShader)
+      glAttachShader(program, fragShader);
+   glLinkProgram(program);
+   return program;
+}
+
+
+static GLboolean
+parallel_compile(void)
+{
+   return GLAD_GL_ARB_parallel_shader_compile ||
+          GLAD_GL_KHR_parallel_shader_compile;
+}
+
+
+/** Has the shader finished compiling?  Never blocks. */
+GLboolean
+ShaderIsReady(GLuint shader)
+{
+   GLint done = GL_TRUE;
+
+   if (parallel_compile())
+      glGetShaderiv(shader, GL_COMPLETION_STATUS_ARB, &done);
+   return done != 0;
+}
+
+
+/** Has the program finished linking?  Never blocks. */
+GLboolean
+ProgramIsReady(GLuint program)
+{
+   GLint done = GL_TRUE;
+
+   if (parallel_compile())
+      glGetProgramiv(program, GL_COMPLETION_STATUS_ARB, &done);
+   return done != 0;
+}
+
+
+/**
+ * Wait for the shader to compile.  Prints the info log and returns
+ * GL_FALSE if it failed.
+ */
+GLboolean
+CheckShaderCompile(GLuint shader)
+{
+   GLint stat;
+
+   glGetShaderiv(shader, GL_COMPILE_STATUS, &stat);
+   if (!stat) {
+      GLchar log[1000];
+      GLsizei len;
+      glGetShaderInfoLog(shader, 1000, &len, log);
+      fprintf(stderr, "Error: problem compiling shader: %s\n", log);
+      return GL_FALSE;
+   }
+   return GL_TRUE;
+}
+
+
+/**
+ * Wait for the program to link.  Prints the info log and returns
+ * GL_FALSE if it failed.
+ */
+GLboolean
+CheckProgramLink(GLuint program)
+{
+   GLint stat;
+
+   glGetProgramiv(program, GL_LINK_STATUS, &stat);
+   if (!stat) {
+      GLchar log[1000];
+      GLsizei len;
+      glGetProgramInfoLog(program, 1000, &len, log);
+      fprintf(stderr, "Shader link error:\n%s\n", log);
+      return GL_FALSE;
+   }
+   return GL_TRUE;
+}
+
+
 GLboolean
 ValidateShaderProgram(GLuint program)
 {
@@ -47,6 +47,27 @@ extern GLuint
 LinkShaders3WithGeometryInfo(GLuint vertShader, GLuint geomShader, GLuint fragShader,
                              GLint verticesOut, GLenum inputType, GLenum outputType);
 
+extern GLboolean
+SetShaderCompilerThreads(GLuint count);
+
+extern GLuint
+CompileShaderTextAsync(GLenum shaderType, const char *text);
+
+extern GLuint
+LinkShaders3Async(GLuint vertShader, GLuint geomShader, GLuint fragShader);
+
+extern GLboolean
+ShaderIsReady(GLuint shader);
+
+extern GLboolean
+ProgramIsReady(GLuint program);
+
+extern GLboolean
+CheckShaderCompile(GLuint shader);
+
+extern GLboolean
+CheckProgramLink(GLuint program);
+
 extern GLboolean
 ValidateShaderProgram(GLuint program);
 
@@ -39,6 +39,7 @@
 #include <vulkan/vulkan.h>
 
 #include "wsi/wsi.h"
+#include "frametime.h"
 
 #ifndef VK_API_VERSION_MAJOR
 /* retain compatibility with old vulkan headers */
@@ -88,8 +89,16 @@ struct {
    VkFence fence;
    VkCommandBuffer cmd_buffer;
    VkSemaphore semaphore;
+   bool timed;                  /* has timestamps for frametime frame */
+   uint64_t frame;
 } frame_data[MAX_CONCURRENT_FRAMES];
 
+/* frame timing, two timestamps per frame_data slot */
+static struct frametime *timing;
+static VkQueryPool query_pool;
+static float timestamp_period;
+static uint64_t timestamp_mask;
+
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 
 /* gear data */
@@ -1421,6 +1430,56 @@ get_devtype_str(VkPhysicalDeviceType devtype)
    }
 }
 
+static void
+init_timing(void)
+{
+   VkPhysicalDeviceProperties properties;
+   VkQueueFamilyProperties queue_props;
+   uint32_t count = 1;
+
+   timing = frametime_create("vkgears");
+   if (!timing)
+      return;
+
+   vkGetPhysicalDeviceProperties(physical_device, &properties);
+   vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count,
+                                            &queue_props);
+   if (!queue_props.timestampValidBits)
+      return;
+
+   timestamp_period = properties.limits.timestampPeriod;
+   timestamp_mask = queue_props.timestampValidBits < 64 ?
+      (1ull << queue_props.timestampValidBits) - 1 : ~0ull;
+
+   vkCreateQueryPool(device,
+      &(VkQueryPoolCreateInfo) {
+         .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+         .queryType = VK_QUERY_TYPE_TIMESTAMP,
+         .queryCount = 2 * MAX_CONCURRENT_FRAMES,
+      },
+      NULL,
+      &query_pool);
+}
+
+/* read the GPU time of the last frame rendered with this slot */
+static void
+read_timestamps(uint32_t frame_index)
+{
+   uint64_t ts[2];
+   VkResult res;
+
+   if (!frame_data[frame_index].timed)
+      return;
+   frame_data[frame_index].timed = false;
+
+   res = vkGetQueryPoolResults(device, query_pool, 2 * frame_index, 2,
+                               sizeof(ts), ts, sizeof(ts[0]),
+                               VK_QUERY_RESULT_64_BIT);
+   if (res == VK_SUCCESS)
+      frametime_gpu(timing, frame_data[frame_index].frame,
+                    ((ts[1] - ts[0]) & timestamp_mask) * timestamp_period);
+}
+
 static void
 usage(void)
 {
@@ -1667,6 +1726,7 @@ main(int argc, char *argv[])
    create_render_pass();
    create_swapchain();
    init_gears();
+   init_timing();
 
    while (1) {
       static int frames = 0;
@@ -1682,6 +1742,7 @@ main(int argc, char *argv[])
       vkWaitForFences(device, 1, &frame_data[frame_index].fence, VK_TRUE,
                       UINT64_MAX);
       vkResetFences(device, 1, &frame_data[frame_index].fence);
+      read_timestamps(frame_index);
 
       uint32_t image_index;
       VkResult result =
@@ -1697,6 +1758,11 @@ main(int argc, char *argv[])
 
       assert(image_index < ARRAY_SIZE(image_data));
 
+      /* waiting for the fence and the image counts as the previous
+       * frame's present time
+       */
+      frametime_begin(timing);
+
       double dt, t = current_time();
 
       if (tRot0 < 0.0)
@@ -1716,6 +1782,14 @@ main(int argc, char *argv[])
             .flags = 0
          });
 
+      if (query_pool) {
+         vkCmdResetQueryPool(frame_data[frame_index].cmd_buffer, query_pool,
+                             2 * frame_index, 2);
+         vkCmdWriteTimestamp(frame_data[frame_index].cmd_buffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             query_pool, 2 * frame_index);
+      }
+
       /* projection matrix */
       float h = (float)height / width;
       struct ubo ubo;
@@ -1764,6 +1838,13 @@ main(int argc, char *argv[])
       draw_gears(frame_data[frame_index].cmd_buffer, view);
 
       vkCmdEndRenderPass(frame_data[frame_index].cmd_buffer);
+      if (query_pool) {
+         vkCmdWriteTimestamp(frame_data[frame_index].cmd_buffer,
+                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             query_pool, 2 * frame_index + 1);
+         frame_data[frame_index].timed = true;
+         frame_data[frame_index].frame = frametime_frame(timing);
+      }
       vkEndCommandBuffer(frame_data[frame_index].cmd_buffer);
 
       vkQueueSubmit(queue, 1,
@@ -1780,6 +1861,7 @@ main(int argc, char *argv[])
             .pCommandBuffers = &frame_data[frame_index].cmd_buffer,
          }, frame_data[frame_index].fence);
 
+      frametime_swap(timing);
       vkQueuePresentKHR(queue,
          &(VkPresentInfoKHR) {
             .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
@@ -1805,11 +1887,13 @@ main(int argc, char *argv[])
          printf("%d frames in %3.1f seconds = %6.3f FPS\n", frames, seconds,
                fps);
          fflush(stdout);
+         frametime_report(timing);
          tRate0 = t;
          frames = 0;
       }
    }
 
+   frametime_destroy(timing);
    wsi.fini_window();
    wsi.fini_display();
    return 0;
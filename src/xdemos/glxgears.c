@@ -37,6 +37,7 @@
 #include <GL/gl.h>
 #include <GL/glx.h>
 #include <GL/glxext.h>
+#include "frametime.h"
 
 #ifndef GLX_MESA_swap_control
 #define GLX_MESA_swap_control 1
@@ -106,6 +107,7 @@ static GLboolean animate = GL_TRUE;     /* Animation */
 static GLfloat eyesep = 5.0;            /* Eye separation. */
 static GLfloat fix_point = 40.0;        /* Fixation point distance.  */
 static GLfloat left, right, asp;        /* Stereo frustum params.  */
+static struct frametime *Timing;        /* NULL unless FRAMETIME is set */
 
 
 /*
@@ -317,6 +319,13 @@ draw_gears(void)
 }
 
 
+static frametime_proc
+get_proc_address(const char *name)
+{
+   return glXGetProcAddressARB((const GLubyte *) name);
+}
+
+
 /** Draw single frame, do SwapBuffers, compute FPS */
 static void
 draw_frame(Display *dpy, Window win)
@@ -336,8 +345,13 @@ draw_frame(Display *dpy, Window win)
       angle = fmodf(angle, 360.0f); /* prevents eventual overflow */
    }
 
+   frametime_begin(Timing);
+   frametime_gl_begin(Timing);
    draw_gears();
+   frametime_gl_end(Timing);
+   frametime_swap(Timing);
    glXSwapBuffers(dpy, win);
+   frametime_end(Timing);
 
    frames++;
 
@@ -349,6 +363,7 @@ draw_frame(Display *dpy, Window win)
       printf("%d frames in %3.1f seconds = %6.3f FPS\n", frames, seconds,
              fps);
       fflush(stdout);
+      frametime_report(Timing);
       tRate0 = t;
       frames = 0;
    }
@@ -860,6 +875,9 @@ main(int argc, char *argv[])
    glXMakeCurrent(dpy, win, ctx);
    setup_vsync(dpy, win);
 
+   Timing = frametime_create("glxgears");
+   frametime_gl_init(Timing, get_proc_address);
+
    if (printInfo) {
       printf("GL_RENDERER   = %s\n", (char *) glGetString(GL_RENDERER));
       printf("GL_VERSION    = %s\n", (char *) glGetString(GL_VERSION));
@@ -878,6 +896,7 @@ main(int argc, char *argv[])
 
    event_loop(dpy, win);
 
+   frametime_destroy(Timing);
    glDeleteLists(gear1, 1);
    glDeleteLists(gear2, 1);
    glDeleteLists(gear3, 1);
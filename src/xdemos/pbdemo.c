@@ -7,11 +7,15 @@
  * course presented at SIGGRAPH '97.  Updated on 5 October 2002.
  *
  * Usage:
- *   pbuffers width height imgfile
+ *   pbuffers width height imgfile [frames]
  * Where:
  *   width is the width, in pixels, of the image to generate.
  *   height is the height, in pixels, of the image to generate.
- *   imgfile is the name of the PPM image file to write.
+ *   imgfile is the name of the image file to write: PPM, or PNG or raw
+ *   YUV for a .png or .yuv name (see util/capture.h).
+ *   frames is the number of images to generate (default 1).  For more
+ *   than one, imgfile should contain a %d for the frame number, unless
+ *   it is a .yuv file.
  *
  *
  * This demo draws 3-D boxes with random orientation.  A pbuffer with
@@ -37,6 +41,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <X11/Xlib.h>
+#include "capture.h"
 #include "pbutil.h"
 
 
@@ -394,55 +399,38 @@ Render(void)
       drawBox(-1.0, 1.0, -1.0, 1.0, -1.0, 1.0, GL_POLYGON);
       glPopMatrix();
    }
-
-   glFinish();
 }
 
 
 
-static void
-WriteFile(const char *filename)
+/*
+ * Render frames and write them out, reading back and writing each one
+ * while the next is rendered.
+ */
+static int
+WriteFiles(const char *filename, int frames)
 {
-   FILE *f;
-   GLubyte *image;
-   int i;
-
-   image = malloc(gWidth * gHeight * 3 * sizeof(GLubyte));
-   if (!image) {
-      printf("Error: couldn't allocate image buffer\n");
-      return;
-   }
+   struct capture *capture;
+   int i, written;
 
-   glPixelStorei(GL_PACK_ALIGNMENT, 1);
-   glReadPixels(0, 0, gWidth, gHeight, GL_RGB, GL_UNSIGNED_BYTE, image);
+   capture = capture_open(filename, gWidth, gHeight);
+   if (!capture)
+      return 0;
 
-   f = fopen(filename, "w");
-   if (!f) {
-      printf("Couldn't open image file: %s\n", filename);
-      return;
-   }
-   fprintf(f, "P6\n");
-   fprintf(f, "# ppm-file created by %s\n", "trdemo2");
-   fprintf(f, "%i %i\n", gWidth, gHeight);
-   fprintf(f, "255\n");
-   fclose(f);
-   f = fopen(filename, "ab"); /* now append binary data */
-   if (!f) {
-      printf("Couldn't append to image file: %s\n", filename);
-      return;
+   for (i = 0; i < frames; i++) {
+      Render();
+      capture_frame(capture);
    }
 
-   for (i = 0; i < gHeight; i++) {
-      GLubyte *rowPtr;
-      /* Remember, OpenGL images are bottom to top.  Have to reverse. */
-      rowPtr = image + (gHeight - 1 - i) * gWidth * 3;
-      fwrite(rowPtr, 1, gWidth * 3, f);
+   written = capture_close(capture);
+   if (written != frames) {
+      printf("Error: wrote %d of %d images\n", written, frames);
+      return 0;
    }
 
-   fclose(f);
-   free(image);
-
-   printf("Wrote %d by %d image file: %s\n", gWidth, gHeight, filename);
+   printf("Wrote %d %d by %d image%s: %s\n", frames, gWidth, gHeight,
+          frames == 1 ? "" : "s", filename);
+   return 1;
 }
 
 
@@ -454,8 +442,8 @@ static void
 Usage(const char *appName)
 {
    printf("Usage:\n");
-   printf("  %s width height imgfile\n", appName);
-   printf("Where imgfile is a ppm file\n");
+   printf("  %s width height imgfile [frames]\n", appName);
+   printf("Where imgfile is a ppm, png or yuv file\n");
 }
 
 
@@ -463,13 +451,16 @@ Usage(const char *appName)
 int
 main(int argc, char *argv[])
 {
-   if (argc != 4) {
+   int ok = 1;
+
+   if (argc != 4 && argc != 5) {
       Usage(argv[0]);
    }
    else {
       int width = atoi(argv[1]);
       int height = atoi(argv[2]);
       char *fileName = argv[3];
+      int frames = argc == 5 ? atoi(argv[4]) : 1;
       if (width <= 0) {
          printf("Error: width parameter must be at least 1.\n");
          return 1;
@@ -478,14 +469,17 @@ main(int argc, char *argv[])
          printf("Error: height parameter must be at least 1.\n");
          return 1;
       }
+      if (frames <= 0) {
+         printf("Error: frames parameter must be at least 1.\n");
+         return 1;
+      }
       if (!Setup(width, height)) {
          return 1;
       }
       InitGL();
-      Render();
-      WriteFile(fileName);
+      ok = WriteFiles(fileName, frames);
       DestroyPbuffer(gDpy, gScreen, gPBuffer);
    }
-   return 0;
+   return ok ? 0 : 1;
 }
 